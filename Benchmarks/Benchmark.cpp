@@ -0,0 +1,253 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+#include "Engine/Image.h"
+
+BenchmarkState::BenchmarkState(int warmupIterations,int iterations)
+: _warmupIterations(warmupIterations)
+, _iterations(iterations)
+, _current(-1)
+, _bytesPerIteration(0)
+, _itemsPerIteration(0)
+, _skipReason()
+, _timer()
+, _samples()
+{
+    _samples.reserve(iterations);
+}
+
+bool
+BenchmarkState::keepRunning()
+{
+    ///record the iteration that just finished, warm-up iterations are not recorded
+    if (_current >= _warmupIterations) {
+        _samples.push_back(_timer.nsecsElapsed());
+    }
+    if (!_skipReason.empty()) {
+        return false;
+    }
+    ++_current;
+    if (_current >= _warmupIterations + _iterations) {
+        return false;
+    }
+    _timer.start();
+    return true;
+}
+
+BenchmarkRegistry&
+BenchmarkRegistry::instance()
+{
+    ///constructed on first use, so it is available to the static registrars of all translation units
+    static BenchmarkRegistry registry;
+    return registry;
+}
+
+void
+BenchmarkRegistry::add(const std::string& group,const std::string& name,BenchmarkFunction func)
+{
+    Entry e;
+    e.name = group + "." + name;
+    e.func = func;
+    _entries.push_back(e);
+}
+
+void
+doNotOptimizeAway(double v)
+{
+    static volatile double sink = 0.;
+    sink = v;
+}
+
+static double
+percentile(const std::vector<qint64>& sorted,double p)
+{
+    assert(!sorted.empty());
+    ///nearest-rank method
+    int rank = (int)std::ceil(p * sorted.size()) - 1;
+    rank = std::max(0,std::min(rank,(int)sorted.size() - 1));
+    return (double)sorted[rank];
+}
+
+BenchmarkResult
+computeBenchmarkResult(const std::string& name,const BenchmarkState& state)
+{
+    BenchmarkResult ret;
+    ret.name = name;
+    std::vector<qint64> sorted = state.getSamples();
+    ret.iterations = (int)sorted.size();
+    if (sorted.empty()) {
+        return ret;
+    }
+    std::sort(sorted.begin(), sorted.end());
+    double sum = 0.;
+    for (U32 i = 0; i < sorted.size(); ++i) {
+        sum += sorted[i];
+    }
+    ret.minNs = sorted.front();
+    ret.maxNs = sorted.back();
+    ret.meanNs = sum / sorted.size();
+    ret.p50Ns = percentile(sorted, 0.5);
+    ret.p90Ns = percentile(sorted, 0.9);
+    ret.p99Ns = percentile(sorted, 0.99);
+    if (ret.p50Ns > 0) {
+        double seconds = ret.p50Ns * 1e-9;
+        ret.mbPerSecond = state.getBytesPerIteration() / (1024. * 1024.) / seconds;
+        ret.itemsPerSecond = state.getItemsPerIteration() / seconds;
+    }
+    return ret;
+}
+
+#define BENCHMARK_RESULTS_HEADER "name\titerations\tmin_ns\tmean_ns\tp50_ns\tp90_ns\tp99_ns\tmax_ns\tMB_per_s\titems_per_s"
+
+bool
+writeBenchmarkResults(const std::string& filename,const std::vector<BenchmarkResult>& results)
+{
+    std::ofstream ofile;
+    std::ostream* out = &std::cout;
+    if (!filename.empty() && filename != "-") {
+        ofile.open(filename.c_str(), std::ofstream::out | std::ofstream::trunc);
+        if (!ofile.good()) {
+            std::cerr << "Failed to open " << filename << " for writing." << std::endl;
+            return false;
+        }
+        out = &ofile;
+    }
+    *out << BENCHMARK_RESULTS_HEADER << '\n';
+    out->setf(std::ios::fixed);
+    out->precision(1);
+    for (U32 i = 0; i < results.size(); ++i) {
+        const BenchmarkResult& r = results[i];
+        *out << r.name << '\t' << r.iterations << '\t' << r.minNs << '\t' << r.meanNs << '\t'
+        << r.p50Ns << '\t' << r.p90Ns << '\t' << r.p99Ns << '\t' << r.maxNs << '\t'
+        << r.mbPerSecond << '\t' << r.itemsPerSecond << '\n';
+    }
+    out->flush();
+    return true;
+}
+
+bool
+readBenchmarkResults(const std::string& filename,std::vector<BenchmarkResult>* results)
+{
+    std::ifstream ifile(filename.c_str());
+    if (!ifile.good()) {
+        std::cerr << "Failed to open " << filename << " for reading." << std::endl;
+        return false;
+    }
+    std::string line;
+    if (!std::getline(ifile, line) || line != BENCHMARK_RESULTS_HEADER) {
+        std::cerr << filename << " is not a benchmark results file." << std::endl;
+        return false;
+    }
+    while (std::getline(ifile, line)) {
+        if (line.empty()) {
+            continue;
+        }
+        std::istringstream ss(line);
+        BenchmarkResult r;
+        if (!std::getline(ss, r.name, '\t')) {
+            continue;
+        }
+        ss >> r.iterations >> r.minNs >> r.meanNs >> r.p50Ns >> r.p90Ns >> r.p99Ns >> r.maxNs
+        >> r.mbPerSecond >> r.itemsPerSecond;
+        if (ss.fail()) {
+            std::cerr << "Ignoring malformed line in " << filename << ": " << line << std::endl;
+            continue;
+        }
+        results->push_back(r);
+    }
+    return true;
+}
+
+int
+compareBenchmarkResults(const std::vector<BenchmarkResult>& results,
+                        const std::vector<BenchmarkResult>& baseline,
+                        double tolerance)
+{
+    std::map<std::string,const BenchmarkResult*> baselineByName;
+    for (U32 i = 0; i < baseline.size(); ++i) {
+        baselineByName[baseline[i].name] = &baseline[i];
+    }
+    int regressions = 0;
+    std::cerr << "Comparison of the median against the baseline (tolerance " << tolerance * 100. << "%):" << std::endl;
+    for (U32 i = 0; i < results.size(); ++i) {
+        std::map<std::string,const BenchmarkResult*>::const_iterator found = baselineByName.find(results[i].name);
+        if (found == baselineByName.end() || found->second->p50Ns <= 0) {
+            std::cerr << "  " << results[i].name << ": no baseline" << std::endl;
+            continue;
+        }
+        double ratio = results[i].p50Ns / found->second->p50Ns;
+        const char* verdict = "ok";
+        if (ratio > 1. + tolerance) {
+            verdict = "REGRESSION";
+            ++regressions;
+        } else if (ratio < 1. - tolerance) {
+            verdict = "improvement";
+        }
+        char buf[256];
+        snprintf(buf, sizeof(buf), "  %s: %.3fx the baseline time (%s)", results[i].name.c_str(), ratio, verdict);
+        std::cerr << buf << std::endl;
+    }
+    return regressions;
+}
+
+template <typename PIX,int maxValue>
+static void
+fillBenchmarkImage(Natron::Image* img,int nComps)
+{
+    const RectI& bounds = img->getPixelRoD();
+    ///a fixed-seed LCG so that every run and every machine get the same pixels
+    U32 seed = 2014;
+    for (int y = bounds.y1; y < bounds.y2; ++y) {
+        PIX* pix = (PIX*)img->pixelAt(bounds.x1, y);
+        for (int x = bounds.x1; x < bounds.x2; ++x) {
+            for (int k = 0; k < nComps; ++k) {
+                seed = seed * 1664525u + 1013904223u;
+                ///mix a smooth gradient with noise, so that neither the luts nor the error diffusion hit degenerate cases
+                float v = 0.5f * ((float)(x - bounds.x1) / bounds.width()) + 0.5f * ((seed >> 8) / 16777216.f);
+                *pix++ = (PIX)(v * maxValue);
+            }
+        }
+    }
+}
+
+boost::shared_ptr<Natron::Image>
+makeBenchmarkImage(Natron::ImageComponents components,
+                   Natron::ImageBitDepth depth,
+                   int width,int height)
+{
+    RectI rod(0,0,width,height);
+    boost::shared_ptr<Natron::Image> img(new Natron::Image(components,rod,0,depth));
+    int nComps = (int)img->getComponentsCount();
+    switch (depth) {
+        case Natron::IMAGE_BYTE:
+            fillBenchmarkImage<unsigned char, 255>(img.get(), nComps);
+            break;
+        case Natron::IMAGE_SHORT:
+            fillBenchmarkImage<unsigned short, 65535>(img.get(), nComps);
+            break;
+        case Natron::IMAGE_FLOAT:
+            fillBenchmarkImage<float, 1>(img.get(), nComps);
+            break;
+        case Natron::IMAGE_HALF:
+            fillBenchmarkImage<Natron::Half, 1>(img.get(), nComps);
+            break;
+        default:
+            break;
+    }
+    img->markForRendered(img->getPixelRoD());
+    return img;
+}
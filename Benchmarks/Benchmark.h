@@ -0,0 +1,180 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef NATRON_BENCHMARKS_BENCHMARK_H_
+#define NATRON_BENCHMARKS_BENCHMARK_H_
+
+#include <string>
+#include <vector>
+
+#include "Global/Macros.h"
+#include "Global/GlobalDefines.h"
+#include <boost/shared_ptr.hpp>
+
+CLANG_DIAG_OFF(deprecated)
+#include <QtCore/QElapsedTimer>
+CLANG_DIAG_ON(deprecated)
+
+namespace Natron {
+class Image;
+}
+
+/**
+ * @brief Passed to every benchmark body. The body prepares its fixtures and then loops with
+ * while (state.keepRunning()) { ...work... }
+ * Each iteration of that loop is timed individually so that percentiles can be reported.
+ * The first few iterations are warm-up iterations and are not recorded.
+ **/
+class BenchmarkState
+{
+public:
+
+    BenchmarkState(int warmupIterations,int iterations);
+
+    /**
+     * @brief Returns true while there are iterations left to run. Must be called at the start
+     * of every iteration: it stops the timer of the previous iteration and starts the next one.
+     **/
+    bool keepRunning();
+
+    /**
+     * @brief The amount of data processed by one iteration, used to compute the throughput (MB/s).
+     **/
+    void setBytesPerIteration(U64 bytes) { _bytesPerIteration = bytes; }
+
+    /**
+     * @brief The number of items (pixels, curve evaluations, cache look-ups...) processed by one iteration.
+     **/
+    void setItemsPerIteration(U64 items) { _itemsPerIteration = items; }
+
+    /**
+     * @brief Marks the benchmark as skipped, e.g: because a fixture could not be created.
+     **/
+    void skip(const std::string& reason) { _skipReason = reason; }
+
+    const std::vector<qint64>& getSamples() const { return _samples; }
+
+    U64 getBytesPerIteration() const { return _bytesPerIteration; }
+
+    U64 getItemsPerIteration() const { return _itemsPerIteration; }
+
+    const std::string& getSkipReason() const { return _skipReason; }
+
+private:
+
+    int _warmupIterations;
+    int _iterations;
+    int _current;
+    U64 _bytesPerIteration;
+    U64 _itemsPerIteration;
+    std::string _skipReason;
+    QElapsedTimer _timer;
+    std::vector<qint64> _samples; //< in nanoseconds
+};
+
+typedef void (*BenchmarkFunction)(BenchmarkState& state);
+
+/**
+ * @brief The statistics computed for one benchmark once all its iterations have run.
+ **/
+struct BenchmarkResult
+{
+    std::string name;
+    int iterations;
+    double minNs,meanNs,p50Ns,p90Ns,p99Ns,maxNs;
+    double mbPerSecond; //< 0 if the benchmark didn't set the bytes per iteration
+    double itemsPerSecond; //< 0 if the benchmark didn't set the items per iteration
+
+    BenchmarkResult()
+    : name()
+    , iterations(0)
+    , minNs(0),meanNs(0),p50Ns(0),p90Ns(0),p99Ns(0),maxNs(0)
+    , mbPerSecond(0)
+    , itemsPerSecond(0)
+    {
+    }
+};
+
+/**
+ * @brief Holds all the benchmarks registered with the NATRON_BENCHMARK macro.
+ **/
+class BenchmarkRegistry
+{
+public:
+
+    struct Entry
+    {
+        std::string name; //< "Group.Name"
+        BenchmarkFunction func;
+    };
+
+    static BenchmarkRegistry& instance();
+
+    void add(const std::string& group,const std::string& name,BenchmarkFunction func);
+
+    const std::vector<Entry>& getEntries() const { return _entries; }
+
+private:
+
+    std::vector<Entry> _entries;
+};
+
+struct BenchmarkRegistrar
+{
+    BenchmarkRegistrar(const char* group,const char* name,BenchmarkFunction func)
+    {
+        BenchmarkRegistry::instance().add(group, name, func);
+    }
+};
+
+/**
+ * @brief Declares a benchmark, in the same spirit as the gtest TEST() macro:
+ * NATRON_BENCHMARK(Image,ConvertRGBAFloatToByte_2K) {
+ *     ...fixtures...
+ *     while (state.keepRunning()) { ... }
+ * }
+ **/
+#define NATRON_BENCHMARK(group,name) \
+    static void group##_##name##_Benchmark(BenchmarkState& state); \
+    static BenchmarkRegistrar group##_##name##_Registrar(#group,#name,&group##_##name##_Benchmark); \
+    static void group##_##name##_Benchmark(BenchmarkState& state)
+
+///Consumes a value computed by a benchmark so that the compiler cannot optimize the computation away.
+void doNotOptimizeAway(double v);
+
+///Computes the statistics of a finished benchmark.
+BenchmarkResult computeBenchmarkResult(const std::string& name,const BenchmarkState& state);
+
+///Writes results as tab separated values with a header line. This is also the format read back by readBenchmarkResults.
+bool writeBenchmarkResults(const std::string& filename,const std::vector<BenchmarkResult>& results);
+
+///Reads back a file written by writeBenchmarkResults, e.g: a stored baseline.
+bool readBenchmarkResults(const std::string& filename,std::vector<BenchmarkResult>* results);
+
+/**
+ * @brief Compares the median of each result with the one stored in the baseline and prints a report.
+ * Returns the number of benchmarks whose median got slower by more than tolerance (0.1 == 10%).
+ **/
+int compareBenchmarkResults(const std::vector<BenchmarkResult>& results,
+                            const std::vector<BenchmarkResult>& baseline,
+                            double tolerance);
+
+///////////////Synthetic fixtures shared by the benchmarks. They are deterministic so that runs are reproducible.
+
+#define NATRON_BENCHMARK_2K_WIDTH 2048
+#define NATRON_BENCHMARK_2K_HEIGHT 1556
+#define NATRON_BENCHMARK_4K_WIDTH 4096
+#define NATRON_BENCHMARK_4K_HEIGHT 3112
+
+/**
+ * @brief Allocates a local image (not in the cache) filled with a deterministic pattern
+ * covering the whole [0,1] range for the given bit depth.
+ **/
+boost::shared_ptr<Natron::Image> makeBenchmarkImage(Natron::ImageComponents components,
+                                                    Natron::ImageBitDepth depth,
+                                                    int width,int height);
+
+#endif // NATRON_BENCHMARKS_BENCHMARK_H_
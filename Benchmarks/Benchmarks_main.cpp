@@ -0,0 +1,111 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Benchmarks/Benchmark.h"
+
+#include "Engine/AppManager.h"
+#include "Engine/AppInstance.h"
+
+static void
+printUsage(const char* binary)
+{
+    std::cout << "Usage: " << binary << " [options]\n"
+    "Runs the engine benchmarks and prints the results as tab separated values.\n\n"
+    "Options:\n"
+    "  --list                 List the available benchmarks and exit.\n"
+    "  --filter <substring>   Only run the benchmarks whose name (Group.Name) contains <substring>.\n"
+    "  --iterations <n>       Number of timed iterations per benchmark (default 20).\n"
+    "  --warmup <n>           Number of untimed warm-up iterations per benchmark (default 2).\n"
+    "  --output <file>        Write the results to <file> instead of the standard output.\n"
+    "  --baseline <file>      Compare the median times against a previous --output file.\n"
+    "                         The exit code is the number of regressions found.\n"
+    "  --tolerance <ratio>    Slow-down allowed before a result is reported as a regression (default 0.1).\n";
+}
+
+int
+main(int argc,char *argv[])
+{
+    std::string filter,outputFile,baselineFile;
+    int iterations = 20;
+    int warmup = 2;
+    double tolerance = 0.1;
+    bool listOnly = false;
+
+    for (int i = 1; i < argc; ++i) {
+        bool hasValue = i + 1 < argc;
+        if (!strcmp(argv[i], "--list")) {
+            listOnly = true;
+        } else if (!strcmp(argv[i], "--filter") && hasValue) {
+            filter = argv[++i];
+        } else if (!strcmp(argv[i], "--iterations") && hasValue) {
+            iterations = std::max(1,std::atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "--warmup") && hasValue) {
+            warmup = std::max(0,std::atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "--output") && hasValue) {
+            outputFile = argv[++i];
+        } else if (!strcmp(argv[i], "--baseline") && hasValue) {
+            baselineFile = argv[++i];
+        } else if (!strcmp(argv[i], "--tolerance") && hasValue) {
+            tolerance = std::atof(argv[++i]);
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    const std::vector<BenchmarkRegistry::Entry>& entries = BenchmarkRegistry::instance().getEntries();
+    if (listOnly) {
+        for (U32 i = 0; i < entries.size(); ++i) {
+            std::cout << entries[i].name << std::endl;
+        }
+        return 0;
+    }
+
+    ///Some benchmarks need a running application (nodes, project...), load it the same way the unit tests do.
+    AppManager* manager = new AppManager;
+    int appArgc = 0;
+    manager->load(appArgc,NULL);
+
+    std::vector<BenchmarkResult> results;
+    for (U32 i = 0; i < entries.size(); ++i) {
+        if (!filter.empty() && entries[i].name.find(filter) == std::string::npos) {
+            continue;
+        }
+        std::cerr << "Running " << entries[i].name << "..." << std::endl;
+        ///Some algorithms (error diffusion) use rand(), make sure all runs start from the same state
+        srand(2014);
+        BenchmarkState state(warmup,iterations);
+        entries[i].func(state);
+        if (!state.getSkipReason().empty()) {
+            std::cerr << "Skipped " << entries[i].name << ": " << state.getSkipReason() << std::endl;
+            continue;
+        }
+        results.push_back(computeBenchmarkResult(entries[i].name, state));
+    }
+
+    manager->getTopLevelInstance()->quit();
+    delete appPTR;
+
+    if (!writeBenchmarkResults(outputFile, results)) {
+        return 1;
+    }
+
+    if (!baselineFile.empty()) {
+        std::vector<BenchmarkResult> baseline;
+        if (!readBenchmarkResults(baselineFile, &baseline)) {
+            return 1;
+        }
+        return compareBenchmarkResults(results, baseline, tolerance);
+    }
+    return 0;
+}
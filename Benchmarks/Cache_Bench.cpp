@@ -0,0 +1,140 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <cstring>
+#include <vector>
+
+#include "Benchmarks/Benchmark.h"
+
+CLANG_DIAG_OFF(deprecated)
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+CLANG_DIAG_ON(deprecated)
+
+#include "Engine/Cache.h"
+#include "Engine/Image.h"
+#include "Engine/ImageParams.h"
+#include "Engine/MemoryFile.h"
+
+using namespace Natron;
+
+///Number of look-ups done by one timed iteration
+#define CACHE_BENCHMARK_LOOKUPS 10000
+
+///Number of frames read back from the disk cache by one timed iteration
+#define CACHE_BENCHMARK_DISK_FRAMES 4
+
+static void
+benchmarkCacheGet(BenchmarkState& state,int entriesCount)
+{
+    ///A cache large enough to hold all entries in RAM, so that we only measure the look-up
+    Cache<Image> cache("NatronBenchmarkCache",1,(U64)4 * 1024 * 1024 * 1024,1.);
+
+    ///small tiles: we are benchmarking the cache structure, not the allocator
+    RectI rod(0,0,32,32);
+    std::map<int, std::vector<RangeD> > framesNeeded;
+    boost::shared_ptr<ImageParams> params = Image::makeParams(0, rod, 0, false, ImageComponentRGBA, IMAGE_FLOAT,
+                                                              -1, 0, framesNeeded);
+    std::vector<ImageKey> keys;
+    keys.reserve(entriesCount);
+    for (int i = 0; i < entriesCount; ++i) {
+        ///many nodes, a 100 frames long sequence for each of them
+        ImageKey key = Image::makeKey((U64)(i / 100) * 0x9E3779B97F4A7C15ULL,i % 100,0,0);
+        boost::shared_ptr<Image> entry;
+        cache.getOrCreate(key, params, &entry);
+        if (!entry) {
+            state.skip("could not allocate the cache entries");
+            return;
+        }
+        keys.push_back(key);
+    }
+
+    ///visit the keys in a pseudo random but reproducible order
+    std::vector<int> order(CACHE_BENCHMARK_LOOKUPS);
+    U32 seed = 2014;
+    for (U32 i = 0; i < order.size(); ++i) {
+        seed = seed * 1664525u + 1013904223u;
+        order[i] = (seed >> 8) % entriesCount;
+    }
+
+    state.setItemsPerIteration(CACHE_BENCHMARK_LOOKUPS);
+    int misses = 0;
+    while (state.keepRunning()) {
+        for (U32 i = 0; i < order.size(); ++i) {
+            boost::shared_ptr<const NonKeyParams> cachedParams;
+            boost::shared_ptr<Image> entry;
+            if (!cache.get(keys[order[i]], &cachedParams, &entry)) {
+                ++misses;
+            }
+        }
+    }
+    doNotOptimizeAway(misses);
+}
+
+NATRON_BENCHMARK(Cache,GetHit_1000Entries) {
+    benchmarkCacheGet(state, 1000);
+}
+
+NATRON_BENCHMARK(Cache,GetHit_20000Entries) {
+    benchmarkCacheGet(state, 20000);
+}
+
+/**
+ * @brief Reads back frames of the disk cache the way the cache does when an entry is moved back to the RAM:
+ * the file is mapped and then read entirely. The files stay in the page cache of the system, so this measures
+ * the cost of the mapping and of the page faults rather than the speed of the disk.
+ **/
+static void
+benchmarkDiskCacheRead(BenchmarkState& state,int mappingFlags)
+{
+    ///a 2K RGBA float frame
+    const size_t frameSize = (size_t)NATRON_BENCHMARK_2K_WIDTH * NATRON_BENCHMARK_2K_HEIGHT * 4 * sizeof(float);
+    QDir tmpDir(QDir::tempPath());
+    std::vector<std::string> paths;
+    for (int i = 0; i < CACHE_BENCHMARK_DISK_FRAMES; ++i) {
+        std::string path = tmpDir.absoluteFilePath(QString("NatronBenchmarkDiskCache%1." NATRON_CACHE_FILE_EXT).arg(i)).toStdString();
+        try {
+            MemoryFile file(path,Natron::if_exists_truncate_if_not_exists_create);
+            file.resize(frameSize);
+            if (!file.data()) {
+                state.skip("could not map the disk cache files");
+                return;
+            }
+            std::memset(file.data(), i + 1, frameSize);
+        } catch (const std::exception& e) {
+            state.skip(e.what());
+            return;
+        }
+        paths.push_back(path);
+    }
+
+    state.setBytesPerIteration((U64)frameSize * CACHE_BENCHMARK_DISK_FRAMES);
+    double sum = 0.;
+    while (state.keepRunning()) {
+        for (U32 i = 0; i < paths.size(); ++i) {
+            MemoryFile file(paths[i],Natron::if_exists_keep_if_dont_exists_create,mappingFlags);
+            const U64* data = (const U64*)file.data();
+            U64 frameSum = 0;
+            for (size_t j = 0; j < frameSize / sizeof(U64); ++j) {
+                frameSum += data[j];
+            }
+            sum += frameSum;
+        }
+    }
+    doNotOptimizeAway(sum);
+
+    for (U32 i = 0; i < paths.size(); ++i) {
+        QFile::remove(paths[i].c_str());
+    }
+}
+
+NATRON_BENCHMARK(Cache,DiskCacheRead_2K) {
+    benchmarkDiskCacheRead(state, MemoryFile::MAPPING_DEFAULT);
+}
+
+NATRON_BENCHMARK(Cache,DiskCacheReadPopulate_2K) {
+    benchmarkDiskCacheRead(state, MemoryFile::MAPPING_POPULATE);
+}
@@ -0,0 +1,91 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <cmath>
+#include <vector>
+
+#include "Benchmarks/Benchmark.h"
+
+#include "Engine/Curve.h"
+
+///Number of evaluations done by one timed iteration, a single getValueAt is too fast to be timed reliably.
+#define CURVE_BENCHMARK_EVALUATIONS 100000
+
+static void
+makeBenchmarkCurve(Curve* c,int keyframesCount,Natron::KeyframeType interp)
+{
+    for (int i = 0; i < keyframesCount; ++i) {
+        c->addKeyFrame(KeyFrame(i * 10.,std::sin(i * 0.1) * 100.,0.,0.,interp));
+    }
+}
+
+static void
+benchmarkGetValueAt(BenchmarkState& state,int keyframesCount,Natron::KeyframeType interp)
+{
+    Curve c;
+    makeBenchmarkCurve(&c, keyframesCount, interp);
+    double first = c.getMinimumTimeCovered();
+    double last = c.getMaximumTimeCovered();
+    double step = (last - first) / CURVE_BENCHMARK_EVALUATIONS;
+
+    state.setItemsPerIteration(CURVE_BENCHMARK_EVALUATIONS);
+    double sum = 0.;
+    while (state.keepRunning()) {
+        ///sweep the whole curve, like the curve editor does when it draws a curve
+        double t = first;
+        for (int i = 0; i < CURVE_BENCHMARK_EVALUATIONS; ++i, t += step) {
+            sum += c.getValueAt(t);
+        }
+    }
+    doNotOptimizeAway(sum);
+}
+
+static void
+benchmarkGetValuesAt(BenchmarkState& state,int keyframesCount,Natron::KeyframeType interp)
+{
+    Curve c;
+    makeBenchmarkCurve(&c, keyframesCount, interp);
+    double first = c.getMinimumTimeCovered();
+    double last = c.getMaximumTimeCovered();
+    double step = (last - first) / CURVE_BENCHMARK_EVALUATIONS;
+    std::vector<double> times(CURVE_BENCHMARK_EVALUATIONS);
+    for (int i = 0; i < CURVE_BENCHMARK_EVALUATIONS; ++i) {
+        times[i] = first + i * step;
+    }
+    std::vector<double> values;
+
+    state.setItemsPerIteration(CURVE_BENCHMARK_EVALUATIONS);
+    double sum = 0.;
+    while (state.keepRunning()) {
+        c.getValuesAt(times, &values);
+        sum += values.back();
+    }
+    doNotOptimizeAway(sum);
+}
+
+NATRON_BENCHMARK(Curve,GetValueAtSmooth_10Keys) {
+    benchmarkGetValueAt(state, 10, Natron::KEYFRAME_SMOOTH);
+}
+
+NATRON_BENCHMARK(Curve,GetValueAtSmooth_1000Keys) {
+    benchmarkGetValueAt(state, 1000, Natron::KEYFRAME_SMOOTH);
+}
+
+NATRON_BENCHMARK(Curve,GetValueAtLinear_1000Keys) {
+    benchmarkGetValueAt(state, 1000, Natron::KEYFRAME_LINEAR);
+}
+
+NATRON_BENCHMARK(Curve,GetValuesAtSmooth_1000Keys) {
+    benchmarkGetValuesAt(state, 1000, Natron::KEYFRAME_SMOOTH);
+}
+
+NATRON_BENCHMARK(Curve,AddKeyFrame_1000Keys) {
+    state.setItemsPerIteration(1000);
+    while (state.keepRunning()) {
+        Curve c;
+        makeBenchmarkCurve(&c, 1000, Natron::KEYFRAME_SMOOTH);
+    }
+}
@@ -0,0 +1,107 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "Benchmarks/Benchmark.h"
+
+#include "Engine/Image.h"
+#include "Engine/ImageParams.h"
+
+using namespace Natron;
+
+static void
+benchmarkConvertToFormat(BenchmarkState& state,
+                         ImageComponents srcComps,ImageBitDepth srcDepth,
+                         ImageComponents dstComps,ImageBitDepth dstDepth,
+                         ViewerColorSpace srcColorSpace,ViewerColorSpace dstColorSpace,
+                         int width,int height)
+{
+    boost::shared_ptr<Image> src = makeBenchmarkImage(srcComps, srcDepth, width, height);
+    boost::shared_ptr<Image> dst(new Image(dstComps,src->getRoD(),0,dstDepth));
+    const RectI& window = src->getPixelRoD();
+    ///channelForAlpha = 3 is only used for the conversions to alpha
+    int channelForAlpha = srcComps == ImageComponentRGBA ? 3 : 0;
+
+    state.setBytesPerIteration((U64)window.area() * src->getComponentsCount() * getSizeOfForBitDepth(srcDepth));
+    state.setItemsPerIteration((U64)window.area());
+    while (state.keepRunning()) {
+        src->convertToFormat(window, dst.get(), srcColorSpace, dstColorSpace, channelForAlpha, false, false);
+    }
+}
+
+NATRON_BENCHMARK(Image,ConvertRGBAFloatToByteSRGB_2K) {
+    benchmarkConvertToFormat(state, ImageComponentRGBA, IMAGE_FLOAT, ImageComponentRGBA, IMAGE_BYTE, Linear, sRGB,
+                             NATRON_BENCHMARK_2K_WIDTH, NATRON_BENCHMARK_2K_HEIGHT);
+}
+
+NATRON_BENCHMARK(Image,ConvertRGBAFloatToByteSRGB_4K) {
+    benchmarkConvertToFormat(state, ImageComponentRGBA, IMAGE_FLOAT, ImageComponentRGBA, IMAGE_BYTE, Linear, sRGB,
+                             NATRON_BENCHMARK_4K_WIDTH, NATRON_BENCHMARK_4K_HEIGHT);
+}
+
+NATRON_BENCHMARK(Image,ConvertRGBAByteToFloat_2K) {
+    benchmarkConvertToFormat(state, ImageComponentRGBA, IMAGE_BYTE, ImageComponentRGBA, IMAGE_FLOAT, sRGB, Linear,
+                             NATRON_BENCHMARK_2K_WIDTH, NATRON_BENCHMARK_2K_HEIGHT);
+}
+
+NATRON_BENCHMARK(Image,ConvertRGBAShortToFloat_2K) {
+    benchmarkConvertToFormat(state, ImageComponentRGBA, IMAGE_SHORT, ImageComponentRGBA, IMAGE_FLOAT, Linear, Linear,
+                             NATRON_BENCHMARK_2K_WIDTH, NATRON_BENCHMARK_2K_HEIGHT);
+}
+
+NATRON_BENCHMARK(Image,ConvertRGBAFloatToFloatCopy_4K) {
+    benchmarkConvertToFormat(state, ImageComponentRGBA, IMAGE_FLOAT, ImageComponentRGBA, IMAGE_FLOAT, Linear, Linear,
+                             NATRON_BENCHMARK_4K_WIDTH, NATRON_BENCHMARK_4K_HEIGHT);
+}
+
+NATRON_BENCHMARK(Image,ConvertRGBAFloatToAlpha_2K) {
+    ///The mask fetch case
+    benchmarkConvertToFormat(state, ImageComponentRGBA, IMAGE_FLOAT, ImageComponentAlpha, IMAGE_FLOAT, Linear, Linear,
+                             NATRON_BENCHMARK_2K_WIDTH, NATRON_BENCHMARK_2K_HEIGHT);
+}
+
+NATRON_BENCHMARK(Image,ConvertRGBByteToRGBAFloat_2K) {
+    benchmarkConvertToFormat(state, ImageComponentRGB, IMAGE_BYTE, ImageComponentRGBA, IMAGE_FLOAT, sRGB, Linear,
+                             NATRON_BENCHMARK_2K_WIDTH, NATRON_BENCHMARK_2K_HEIGHT);
+}
+
+NATRON_BENCHMARK(Image,DownscaleMipMapLevel1_4K) {
+    boost::shared_ptr<Image> src = makeBenchmarkImage(ImageComponentRGBA, IMAGE_FLOAT,
+                                                      NATRON_BENCHMARK_4K_WIDTH, NATRON_BENCHMARK_4K_HEIGHT);
+    const RectI& roi = src->getPixelRoD();
+    boost::shared_ptr<Image> dst(new Image(ImageComponentRGBA,roi.downscalePowerOfTwoSmallestEnclosing(1),0,IMAGE_FLOAT));
+
+    state.setBytesPerIteration((U64)roi.area() * 4 * sizeof(float));
+    state.setItemsPerIteration((U64)roi.area());
+    while (state.keepRunning()) {
+        src->downscale_mipmap(roi, dst.get(), 1);
+    }
+}
+
+static void
+benchmarkMinimalNonMarkedRects(BenchmarkState& state,int width,int height,bool halfRendered)
+{
+    RectI rod(0,0,width,height);
+    Bitmap bm(rod);
+    if (halfRendered) {
+        ///typical of a pan in the viewer: the left half and a band at the bottom are already rendered
+        bm.markForRendered(RectI(0,0,width / 2,height));
+        bm.markForRendered(RectI(0,0,width,height / 8));
+    }
+    state.setBytesPerIteration((U64)rod.area());
+    state.setItemsPerIteration((U64)rod.area());
+    while (state.keepRunning()) {
+        std::list<RectI> rects = bm.minimalNonMarkedRects(rod);
+        (void)rects;
+    }
+}
+
+NATRON_BENCHMARK(Bitmap,MinimalNonMarkedRectsEmpty_4K) {
+    benchmarkMinimalNonMarkedRects(state, NATRON_BENCHMARK_4K_WIDTH, NATRON_BENCHMARK_4K_HEIGHT, false);
+}
+
+NATRON_BENCHMARK(Bitmap,MinimalNonMarkedRectsPartial_4K) {
+    benchmarkMinimalNonMarkedRects(state, NATRON_BENCHMARK_4K_WIDTH, NATRON_BENCHMARK_4K_HEIGHT, true);
+}
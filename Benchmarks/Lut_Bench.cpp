@@ -0,0 +1,57 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <vector>
+
+#include "Benchmarks/Benchmark.h"
+
+#include "Engine/Image.h"
+#include "Engine/Lut.h"
+
+using namespace Natron;
+
+static void
+benchmarkToBytePacked(BenchmarkState& state,int width,int height)
+{
+    ///This is what the writers do for each frame, see QtWriter::render
+    boost::shared_ptr<Image> src = makeBenchmarkImage(ImageComponentRGBA, IMAGE_FLOAT, width, height);
+    const RectI& rod = src->getPixelRoD();
+    std::vector<unsigned char> dst((size_t)rod.area() * 4);
+    const Color::Lut* lut = Color::LutManager::sRGBLut();
+    lut->validate();
+
+    state.setBytesPerIteration((U64)rod.area() * 4 * sizeof(float));
+    state.setItemsPerIteration((U64)rod.area());
+    while (state.keepRunning()) {
+        lut->to_byte_packed(&dst[0], (const float*)src->pixelAt(0, 0), rod, rod, rod,
+                            Color::PACKING_RGBA, Color::PACKING_BGRA, true, false);
+    }
+}
+
+NATRON_BENCHMARK(Lut,ToBytePackedSRGB_2K) {
+    benchmarkToBytePacked(state, NATRON_BENCHMARK_2K_WIDTH, NATRON_BENCHMARK_2K_HEIGHT);
+}
+
+NATRON_BENCHMARK(Lut,ToBytePackedSRGB_4K) {
+    benchmarkToBytePacked(state, NATRON_BENCHMARK_4K_WIDTH, NATRON_BENCHMARK_4K_HEIGHT);
+}
+
+NATRON_BENCHMARK(Lut,FromBytePackedSRGB_2K) {
+    ///This is what the readers do for each frame, see QtReader::render
+    boost::shared_ptr<Image> src = makeBenchmarkImage(ImageComponentRGBA, IMAGE_BYTE,
+                                                      NATRON_BENCHMARK_2K_WIDTH, NATRON_BENCHMARK_2K_HEIGHT);
+    const RectI& rod = src->getPixelRoD();
+    std::vector<float> dst((size_t)rod.area() * 4);
+    const Color::Lut* lut = Color::LutManager::sRGBLut();
+    lut->validate();
+
+    state.setBytesPerIteration((U64)rod.area() * 4);
+    state.setItemsPerIteration((U64)rod.area());
+    while (state.keepRunning()) {
+        lut->from_byte_packed(&dst[0], (const unsigned char*)src->pixelAt(0, 0), rod, rod, rod,
+                              Color::PACKING_BGRA, Color::PACKING_RGBA, true, false);
+    }
+}
@@ -0,0 +1,55 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <vector>
+
+#include "Benchmarks/Benchmark.h"
+
+#include "Engine/AppManager.h"
+#include "Engine/AppInstance.h"
+#include "Engine/Node.h"
+#include "Engine/Project.h"
+
+using namespace Natron;
+
+static void
+benchmarkRehashChain(BenchmarkState& state,int chainLength)
+{
+    AppInstance* app = appPTR->getTopLevelInstance();
+    boost::shared_ptr<Project> project = app->getProject();
+
+    ///Build a deep chain of Dot nodes (the only node that doesn't need any plug-in to be installed)
+    std::vector<boost::shared_ptr<Node> > chain;
+    for (int i = 0; i < chainLength; ++i) {
+        boost::shared_ptr<Node> n = app->createNode(CreateNodeArgs("Dot","",-1,-1,false,-1,false));
+        if (!n) {
+            state.skip("could not create the Dot nodes");
+            break;
+        }
+        if (!chain.empty()) {
+            project->connectNodes(0, chain.back(), n);
+        }
+        chain.push_back(n);
+    }
+
+    if (!chain.empty()) {
+        state.setItemsPerIteration(chainLength);
+        while (state.keepRunning()) {
+            ///Changing a parameter of the head of the chain recomputes the hash of all the nodes downstream
+            chain.front()->incrementKnobsAge();
+        }
+    }
+
+    project->clearNodes(false);
+}
+
+NATRON_BENCHMARK(Node,ComputeHashChain_100) {
+    benchmarkRehashChain(state, 100);
+}
+
+NATRON_BENCHMARK(Node,ComputeHashChain_1000) {
+    benchmarkRehashChain(state, 1000);
+}
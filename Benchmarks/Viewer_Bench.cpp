@@ -0,0 +1,53 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <vector>
+
+#include "Benchmarks/Benchmark.h"
+
+#include "Engine/ViewerInstancePrivate.h"
+#include "Engine/Image.h"
+#include "Engine/Lut.h"
+#include "Engine/OpenGLViewerI.h"
+
+using namespace Natron;
+
+static void
+benchmarkScaleToTexture8bits(BenchmarkState& state,ImageBitDepth depth,int closestPowerOf2)
+{
+    boost::shared_ptr<Image> src = makeBenchmarkImage(ImageComponentRGBA, depth,
+                                                      NATRON_BENCHMARK_2K_WIDTH, NATRON_BENCHMARK_2K_HEIGHT);
+    const RectI& rod = src->getPixelRoD();
+    int w = rod.width() / closestPowerOf2;
+    int h = rod.height() / closestPowerOf2;
+    TextureRect texRect(rod.x1,rod.y1,rod.x2,rod.y2,w,h,closestPowerOf2);
+    const Color::Lut* srcLut = depth == IMAGE_FLOAT ? NULL : Color::LutManager::sRGBLut();
+    const Color::Lut* dstLut = Color::LutManager::sRGBLut();
+    dstLut->validate();
+    if (srcLut) {
+        srcLut->validate();
+    }
+    RenderViewerArgs args(src,texRect,ViewerInstance::RGB,closestPowerOf2,OpenGLViewerI::BYTE,1.,0.,srcLut,dstLut);
+    std::vector<U32> output((size_t)w * h);
+
+    state.setItemsPerIteration((U64)w * h);
+    state.setBytesPerIteration((U64)w * h * 4);
+    while (state.keepRunning()) {
+        scaleToTexture8bits(std::make_pair(rod.y1, rod.y2), args, &output[0]);
+    }
+}
+
+NATRON_BENCHMARK(Viewer,ScaleToTexture8bitsFloat_2K) {
+    benchmarkScaleToTexture8bits(state, IMAGE_FLOAT, 1);
+}
+
+NATRON_BENCHMARK(Viewer,ScaleToTexture8bitsFloatZoomOut_2K) {
+    benchmarkScaleToTexture8bits(state, IMAGE_FLOAT, 4);
+}
+
+NATRON_BENCHMARK(Viewer,ScaleToTexture8bitsByte_2K) {
+    benchmarkScaleToTexture8bits(state, IMAGE_BYTE, 1);
+}
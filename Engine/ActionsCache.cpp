@@ -0,0 +1,198 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "ActionsCache.h"
+
+using namespace Natron;
+
+namespace {
+
+bool
+rectLess(const RectI& a,const RectI& b)
+{
+    if (a.x1 != b.x1) {
+        return a.x1 < b.x1;
+    }
+    if (a.y1 != b.y1) {
+        return a.y1 < b.y1;
+    }
+    if (a.x2 != b.x2) {
+        return a.x2 < b.x2;
+    }
+    return a.y2 < b.y2;
+}
+
+///Inserts a result, starting over when the map is full rather than tracking which result is the oldest
+template<typename K,typename V>
+void
+insertResult(std::map<K,V>& results,const K& key,const V& value)
+{
+    if (results.size() >= NATRON_ACTIONS_CACHE_MAX_ENTRIES) {
+        results.clear();
+    }
+    results[key] = value;
+}
+
+}
+
+bool
+ActionsCache::ActionKey::operator<(const ActionKey& other) const
+{
+    if (time != other.time) {
+        return time < other.time;
+    }
+    if (scaleX != other.scaleX) {
+        return scaleX < other.scaleX;
+    }
+    if (scaleY != other.scaleY) {
+        return scaleY < other.scaleY;
+    }
+    if (view != other.view) {
+        return view < other.view;
+    }
+    if (!(rect1 == other.rect1)) {
+        return rectLess(rect1, other.rect1);
+    }
+    return rectLess(rect2, other.rect2);
+}
+
+ActionsCache::ActionsCache(int maxHashes)
+: _lock()
+, _results()
+, _maxHashes(maxHashes)
+{
+}
+
+void
+ActionsCache::clear()
+{
+    QMutexLocker l(&_lock);
+    _results.clear();
+}
+
+ActionsCache::HashResults*
+ActionsCache::findResults(U64 hash,bool create) const
+{
+    for (std::list<HashResults>::iterator it = _results.begin(); it != _results.end(); ++it) {
+        if (it->hash == hash) {
+            if (it != _results.begin()) {
+                _results.splice(_results.begin(), _results, it);
+            }
+            return &_results.front();
+        }
+    }
+    if (!create) {
+        return NULL;
+    }
+    _results.push_front(HashResults());
+    _results.front().hash = hash;
+    while ((int)_results.size() > _maxHashes) {
+        _results.pop_back();
+    }
+    return &_results.front();
+}
+
+bool
+ActionsCache::getRoDResult(U64 hash,SequenceTime time,const RenderScale& scale,int view,RectI* rod) const
+{
+    QMutexLocker l(&_lock);
+    HashResults* results = findResults(hash, false);
+    if (!results) {
+        return false;
+    }
+    std::map<ActionKey,RectI>::const_iterator found = results->rods.find(ActionKey(time,scale,view));
+    if (found == results->rods.end()) {
+        return false;
+    }
+    *rod = found->second;
+    return true;
+}
+
+void
+ActionsCache::setRoDResult(U64 hash,SequenceTime time,const RenderScale& scale,int view,const RectI& rod)
+{
+    QMutexLocker l(&_lock);
+    insertResult(findResults(hash, true)->rods, ActionKey(time,scale,view), rod);
+}
+
+bool
+ActionsCache::getIdentityResult(U64 hash,SequenceTime time,const RenderScale& scale,const RectI& roi,int view,
+                                bool* isIdentity,SequenceTime* inputTime,int* inputNb) const
+{
+    QMutexLocker l(&_lock);
+    HashResults* results = findResults(hash, false);
+    if (!results) {
+        return false;
+    }
+    std::map<ActionKey,IdentityResult>::const_iterator found = results->identities.find(ActionKey(time,scale,view,roi));
+    if (found == results->identities.end()) {
+        return false;
+    }
+    *isIdentity = found->second.isIdentity;
+    *inputTime = found->second.inputTime;
+    *inputNb = found->second.inputNb;
+    return true;
+}
+
+void
+ActionsCache::setIdentityResult(U64 hash,SequenceTime time,const RenderScale& scale,const RectI& roi,int view,
+                                bool isIdentity,SequenceTime inputTime,int inputNb)
+{
+    IdentityResult result;
+    result.isIdentity = isIdentity;
+    result.inputTime = inputTime;
+    result.inputNb = inputNb;
+    QMutexLocker l(&_lock);
+    insertResult(findResults(hash, true)->identities, ActionKey(time,scale,view,roi), result);
+}
+
+bool
+ActionsCache::getRoIResult(U64 hash,SequenceTime time,const RenderScale& scale,const RectI& outputRoD,
+                           const RectI& renderWindow,int view,RoIMap* rois) const
+{
+    QMutexLocker l(&_lock);
+    HashResults* results = findResults(hash, false);
+    if (!results) {
+        return false;
+    }
+    std::map<ActionKey,RoIMap>::const_iterator found = results->rois.find(ActionKey(time,scale,view,outputRoD,renderWindow));
+    if (found == results->rois.end()) {
+        return false;
+    }
+    *rois = found->second;
+    return true;
+}
+
+void
+ActionsCache::setRoIResult(U64 hash,SequenceTime time,const RenderScale& scale,const RectI& outputRoD,
+                           const RectI& renderWindow,int view,const RoIMap& rois)
+{
+    QMutexLocker l(&_lock);
+    insertResult(findResults(hash, true)->rois, ActionKey(time,scale,view,outputRoD,renderWindow), rois);
+}
+
+bool
+ActionsCache::getFramesNeededResult(U64 hash,SequenceTime time,FramesNeededMap* frames) const
+{
+    QMutexLocker l(&_lock);
+    HashResults* results = findResults(hash, false);
+    if (!results) {
+        return false;
+    }
+    std::map<SequenceTime,FramesNeededMap>::const_iterator found = results->framesNeeded.find(time);
+    if (found == results->framesNeeded.end()) {
+        return false;
+    }
+    *frames = found->second;
+    return true;
+}
+
+void
+ActionsCache::setFramesNeededResult(U64 hash,SequenceTime time,const FramesNeededMap& frames)
+{
+    QMutexLocker l(&_lock);
+    insertResult(findResults(hash, true)->framesNeeded, time, frames);
+}
@@ -0,0 +1,125 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef NATRON_ENGINE_ACTIONSCACHE_H_
+#define NATRON_ENGINE_ACTIONSCACHE_H_
+
+#include <list>
+#include <map>
+#include <vector>
+
+#include "Global/Macros.h"
+CLANG_DIAG_OFF(deprecated)
+#include <QtCore/QMutex>
+CLANG_DIAG_ON(deprecated)
+
+#ifndef Q_MOC_RUN
+#include <boost/noncopyable.hpp>
+#endif
+
+#include "Global/GlobalDefines.h"
+#include "Engine/Rect.h"
+
+///The number of node hashes for which the results are kept, so that renders still running for a previous
+///hash do not evict the results of the current one
+#define NATRON_ACTIONS_CACHE_MAX_HASHES 4
+
+///The maximum number of results kept per action and per hash
+#define NATRON_ACTIONS_CACHE_MAX_ENTRIES 512
+
+namespace Natron {
+
+class EffectInstance;
+
+/**
+ * @brief Memoizes the results of the getRegionOfDefinition, isIdentity, getRegionOfInterest and getFramesNeeded
+ * actions of an effect. The results are stored along with the hash of the node: any change to a parameter or to
+ * the inputs of the node changes its hash, and the results of the previous hashes are forgotten.
+ * Results are also keyed by the arguments of the action they depend on (time, scale, view and rectangles).
+ *
+ * Thread safety: this class is thread-safe.
+ **/
+class ActionsCache
+    : boost::noncopyable
+{
+public:
+
+    typedef std::map<EffectInstance*,RectI> RoIMap;
+    typedef std::map<int, std::vector<RangeD> > FramesNeededMap;
+
+    ActionsCache(int maxHashes = NATRON_ACTIONS_CACHE_MAX_HASHES);
+
+    void clear();
+
+    bool getRoDResult(U64 hash,SequenceTime time,const RenderScale& scale,int view,RectI* rod) const WARN_UNUSED_RETURN;
+
+    void setRoDResult(U64 hash,SequenceTime time,const RenderScale& scale,int view,const RectI& rod);
+
+    bool getIdentityResult(U64 hash,SequenceTime time,const RenderScale& scale,const RectI& roi,int view,
+                           bool* isIdentity,SequenceTime* inputTime,int* inputNb) const WARN_UNUSED_RETURN;
+
+    void setIdentityResult(U64 hash,SequenceTime time,const RenderScale& scale,const RectI& roi,int view,
+                           bool isIdentity,SequenceTime inputTime,int inputNb);
+
+    bool getRoIResult(U64 hash,SequenceTime time,const RenderScale& scale,const RectI& outputRoD,
+                      const RectI& renderWindow,int view,RoIMap* rois) const WARN_UNUSED_RETURN;
+
+    void setRoIResult(U64 hash,SequenceTime time,const RenderScale& scale,const RectI& outputRoD,
+                      const RectI& renderWindow,int view,const RoIMap& rois);
+
+    bool getFramesNeededResult(U64 hash,SequenceTime time,FramesNeededMap* frames) const WARN_UNUSED_RETURN;
+
+    void setFramesNeededResult(U64 hash,SequenceTime time,const FramesNeededMap& frames);
+
+private:
+
+    ///The arguments an action result depends on, the rectangles which are not used by an action are left empty
+    struct ActionKey
+    {
+        SequenceTime time;
+        double scaleX,scaleY;
+        int view;
+        RectI rect1,rect2;
+
+        ActionKey(SequenceTime time_,const RenderScale& scale,int view_,const RectI& rect1_ = RectI(),const RectI& rect2_ = RectI())
+        : time(time_), scaleX(scale.x), scaleY(scale.y), view(view_), rect1(rect1_), rect2(rect2_)
+        {
+        }
+
+        bool operator<(const ActionKey& other) const;
+    };
+
+    struct IdentityResult
+    {
+        bool isIdentity;
+        SequenceTime inputTime;
+        int inputNb;
+    };
+
+    struct HashResults
+    {
+        U64 hash;
+        std::map<ActionKey,RectI> rods;
+        std::map<ActionKey,IdentityResult> identities;
+        std::map<ActionKey,RoIMap> rois;
+        std::map<SequenceTime,FramesNeededMap> framesNeeded;
+    };
+
+    /**
+     * @brief Returns the results of the given hash, marking them as the most recently used.
+     * If create is true and there are none, they are created, possibly forgetting the least recently used hash.
+     * Must be called with _lock locked.
+     **/
+    HashResults* findResults(U64 hash,bool create) const;
+
+    mutable QMutex _lock; //< protects _results
+    mutable std::list<HashResults> _results; //< the most recently used hash first
+    int _maxHashes;
+};
+
+} // namespace Natron
+
+#endif // NATRON_ENGINE_ACTIONSCACHE_H_
@@ -24,6 +24,8 @@ namespace boost {
     namespace archive {
         class xml_iarchive;
         class xml_oarchive;
+        class binary_iarchive;
+        class binary_oarchive;
     }
 }
 
@@ -174,6 +176,10 @@ public:
 
     virtual void saveProjectGui(boost::archive::xml_oarchive& /*archive*/) {}
     
+    virtual void loadProjectGui(boost::archive::binary_iarchive& /*archive*/) const {}
+    
+    virtual void saveProjectGui(boost::archive::binary_oarchive& /*archive*/) {}
+    
     virtual void setupViewersForViews(int /*viewsCount*/) {}
     
     virtual void notifyRenderProcessHandlerStarted(const QString& /*sequenceName*/,
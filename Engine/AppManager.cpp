@@ -10,6 +10,7 @@
 
 #include "AppManager.h"
 
+#include <algorithm>
 #include <clocale>
 
 #include <QDebug>
@@ -32,8 +33,11 @@
 #include "Engine/OfxEffectInstance.h"
 #include "Engine/Image.h"
 #include "Engine/FrameEntry.h"
+#include "Engine/IdentityAliases.h"
 #include "Engine/Format.h"
 #include "Engine/Log.h"
+#include "Engine/MemoryPool.h"
+#include "Engine/NUMA.h"
 #include "Engine/Cache.h"
 #include "Engine/ChannelSet.h"
 #include "Engine/Variant.h"
@@ -61,6 +65,7 @@ struct AppManagerPrivate {
     boost::scoped_ptr<KnobFactory> _knobFactory; //< knob maker
     boost::shared_ptr<Natron::Cache<Natron::Image> >  _nodeCache; //< Images cache
     boost::shared_ptr<Natron::Cache<Natron::FrameEntry> > _viewerCache; //< Viewer textures cache
+    boost::scoped_ptr<Natron::IdentityAliases> _identityAliases; //< the identity images of the node cache
     ProcessInputChannel* _backgroundIPC; //< object used to communicate with the main app
     //if this app is background, see the ProcessInputChannel def
     bool _loaded; //< true when the first instance is completly loaded.
@@ -85,6 +90,7 @@ struct AppManagerPrivate {
         , _knobFactory(new KnobFactory())
         , _nodeCache()
         , _viewerCache()
+        , _identityAliases(new Natron::IdentityAliases())
         ,_backgroundIPC(0)
         ,_loaded(false)
         ,_binaryPath()
@@ -107,6 +113,8 @@ struct AppManagerPrivate {
     
     void restoreCaches();
     
+    void setViewerCacheMemorySize(U64 playbackSize);
+    
     bool checkForCacheDiskStructure(const QString& cachePath);
     
     void cleanUpCacheDiskStructure(const QString& cachePath);
@@ -258,6 +266,25 @@ AppManager::~AppManager(){
     
     _imp->saveCaches();
     
+#ifdef NATRON_DEBUG
+    Natron::MemoryPoolStats poolStats = Natron::MemoryPool::instance()->getStats();
+    if (poolStats.allocations > 0) {
+        qDebug() << "Memory pool:" << poolStats.reuses << "of" << poolStats.allocations << "image buffers recycled ("
+                 << (double)poolStats.reuses * 100. / (double)poolStats.allocations << "%)," << poolStats.heldBlocks
+                 << "blocks held (" << poolStats.heldBytes / (1024 * 1024) << "of" << poolStats.maximumSize / (1024 * 1024) << "MB)";
+    }
+    
+    if (Natron::NUMA::isEnabled()) {
+        U64 localTiles,remoteTiles;
+        Natron::NUMA::getTileLocalityStats(&localTiles, &remoteTiles);
+        if (localTiles + remoteTiles > 0) {
+            qDebug() << "NUMA:" << Natron::NUMA::getNodesCount() << "nodes," << remoteTiles << "of"
+                     << localTiles + remoteTiles << "tiles rendered in remote memory ("
+                     << (double)remoteTiles * 100. / (double)(localTiles + remoteTiles) << "%)";
+        }
+    }
+#endif
+    
 	if(qApp) {
 		delete qApp;
 	}
@@ -316,6 +343,9 @@ bool AppManager::loadInternal(const QString& projectFilename,const QStringList&
     ///Call restore after initializing knobs
     _imp->_settings->restoreSettings();
 
+    ///Must be done before any image is allocated
+    Natron::NUMA::setEnabled(_imp->_settings->isNUMAAwareRenderingEnabled());
+
     ///basically show a splashScreen
     initGui();
 
@@ -326,6 +356,11 @@ bool AppManager::loadInternal(const QString& projectFilename,const QStringList&
 
     _imp->_nodeCache.reset(new Cache<Image>("NodeCache",0x1, maxCacheRAM - playbackSize,1));
     _imp->_viewerCache.reset(new Cache<FrameEntry>("ViewerCache",0x1,maxDiskCache,(double)playbackSize / (double)maxDiskCache));
+    _imp->setViewerCacheMemorySize(playbackSize);
+    
+    ///The memory kept by the pool for reuse is not accounted by the caches, keep it small compared to them
+    Natron::MemoryPool::instance()->setMaximumSize(std::min((U64)NATRON_MEMORY_POOL_DEFAULT_MAX_SIZE, (U64)(maxCacheRAM - playbackSize) / 8));
+    Natron::MemoryPool::instance()->setHugePagesEnabled(_imp->_settings->areHugePagesEnabled());
 
     setLoadingStatus(tr("Restoring the image cache..."));
     _imp->restoreCaches();
@@ -447,6 +482,8 @@ void AppManager::clearNodeCache(){
         it->second.app->clearAllLastRenderedImages();
     }
     _imp->_nodeCache->clear();
+    _imp->_identityAliases->clear();
+    Natron::MemoryPool::instance()->clear();
 }
 
 void AppManager::clearPluginsLoadedCache() {
@@ -569,8 +606,8 @@ void AppManager::setApplicationsCachesMaximumMemoryPercent(double p){
     U64 playbackSize = maxCacheRAM * _imp->_settings->getRamPlaybackMaximumPercent();
     _imp->_nodeCache->setMaximumCacheSize(maxCacheRAM - playbackSize);
     _imp->_nodeCache->setMaximumInMemorySize(1);
-    U64 maxDiskCacheSize = _imp->_settings->getMaximumDiskCacheSize();
-    _imp->_viewerCache->setMaximumInMemorySize((double)playbackSize / (double)maxDiskCacheSize);
+    Natron::MemoryPool::instance()->setMaximumSize(std::min((U64)NATRON_MEMORY_POOL_DEFAULT_MAX_SIZE, (U64)(maxCacheRAM - playbackSize) / 8));
+    _imp->setViewerCacheMemorySize(playbackSize);
     
 }
 
@@ -578,7 +615,7 @@ void AppManager::setApplicationsCachesMaximumDiskSpace(unsigned long long size){
     size_t maxCacheRAM = _imp->_settings->getRamMaximumPercent() * getSystemTotalRAM_conditionnally();
     U64 playbackSize = maxCacheRAM * _imp->_settings->getRamPlaybackMaximumPercent();
     _imp->_viewerCache->setMaximumCacheSize(size);
-    _imp->_viewerCache->setMaximumInMemorySize((double)playbackSize / (double)size);
+    _imp->setViewerCacheMemorySize(playbackSize);
     
 }
 
@@ -588,8 +625,7 @@ void AppManager::setPlaybackCacheMaximumSize(double p)
     U64 playbackSize = maxCacheRAM * p;
     _imp->_nodeCache->setMaximumCacheSize(maxCacheRAM - playbackSize);
     _imp->_nodeCache->setMaximumInMemorySize(1);
-    U64 maxDiskCacheSize = _imp->_settings->getMaximumDiskCacheSize();
-    _imp->_viewerCache->setMaximumInMemorySize((double)playbackSize / (double)maxDiskCacheSize);
+    _imp->setViewerCacheMemorySize(playbackSize);
     
 }
 
@@ -839,6 +875,26 @@ void AppManager::removeAllImagesFromCacheWithMatchingKey(U64 treeVersion)
             _imp->_nodeCache->removeEntry(*it);
         }
     }
+    _imp->_identityAliases->removeAliasesWithHash(treeVersion);
+}
+
+void AppManager::setIdentityAlias(U64 nodeHash,SequenceTime time,unsigned int mipMapLevel,int view,
+                                  const boost::shared_ptr<Natron::Node>& inputNode,U64 inputHash,SequenceTime inputTime)
+{
+    _imp->_identityAliases->setAlias(nodeHash, time, mipMapLevel, view, inputNode, inputHash, inputTime);
+}
+
+bool AppManager::resolveIdentityAlias(U64 nodeHash,SequenceTime time,unsigned int mipMapLevel,int view,
+                                      boost::shared_ptr<Natron::Node>* inputNode,SequenceTime* inputTime) const
+{
+    Natron::IdentityAliases::Target target;
+    if (!_imp->_identityAliases->resolve(nodeHash, time, mipMapLevel, view, &target)) {
+        return false;
+    }
+    ///the node may have been deleted since
+    *inputNode = target.node.lock();
+    *inputTime = target.time;
+    return (bool)*inputNode;
 }
 
 void AppManager::removeAllTexturesFromCacheWithMatchingKey(U64 treeVersion)
@@ -946,6 +1002,10 @@ U64 AppManager::getCachesTotalMemorySize() const {
     return _imp->_viewerCache->getMemoryCacheSize() + _imp->_nodeCache->getMemoryCacheSize();
 }
 
+U64 AppManager::getNodeCacheMaximumSize() const {
+    return _imp->_nodeCache->getMaximumSize();
+}
+
 Natron::CacheSignalEmitter* AppManager::getOrActivateViewerCacheSignalEmitter() const {
     return _imp->_viewerCache->activateSignalEmitter();
 }
@@ -1044,6 +1104,13 @@ void AppManagerPrivate::saveCaches() {
     }
 }
 
+void AppManagerPrivate::setViewerCacheMemorySize(U64 playbackSize) {
+    ///When compression is enabled, half of the playback RAM holds compressed copies of the frames evicted to disk
+    U64 compressedSize = _settings->isPlaybackCacheCompressionEnabled() ? playbackSize / 2 : 0;
+    _viewerCache->setMaximumInMemorySize((double)(playbackSize - compressedSize) / (double)_viewerCache->getMaximumSize());
+    _viewerCache->setMaximumCompressedSize(compressedSize);
+}
+
 void AppManagerPrivate::restoreCaches() {
     
     {
@@ -172,6 +172,9 @@ public:
 
     U64 getCachesTotalMemorySize() const;
 
+    ///The maximum amount of memory the node cache may use, as set by the cache settings
+    U64 getNodeCacheMaximumSize() const;
+
     Natron::CacheSignalEmitter* getOrActivateViewerCacheSignalEmitter() const;
 
     void setApplicationsCachesMaximumMemoryPercent(double p);
@@ -190,6 +193,20 @@ public:
      **/
     void  removeAllImagesFromCacheWithMatchingKey(U64 treeVersion) ;
     void  removeAllTexturesFromCacheWithMatchingKey(U64 treeVersion) ;
+    
+    /**
+     * @brief Records that the image of a node is the image of inputNode at inputTime, instead of caching an image for it.
+     * @see Natron::IdentityAliases
+     **/
+    void setIdentityAlias(U64 nodeHash,SequenceTime time,unsigned int mipMapLevel,int view,
+                          const boost::shared_ptr<Natron::Node>& inputNode,U64 inputHash,SequenceTime inputTime);
+    
+    /**
+     * @brief Returns true if the image of the node of the given hash is an identity, in which case inputNode and inputTime
+     * are set to the first node upstream whose image is not an identity and the time of its image.
+     **/
+    bool resolveIdentityAlias(U64 nodeHash,SequenceTime time,unsigned int mipMapLevel,int view,
+                              boost::shared_ptr<Natron::Node>* inputNode,SequenceTime* inputTime) const WARN_UNUSED_RETURN;
 
     boost::shared_ptr<Settings> getCurrentSettings() const WARN_UNUSED_RETURN;
 
@@ -0,0 +1,123 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "Cache.h"
+
+#include <algorithm>
+
+using namespace Natron;
+
+CacheSignalEmitter::CacheSignalEmitter()
+: QObject()
+, _changesMutex()
+, _changes()
+, _flushTimer(new QTimer(this))
+, _lastFlush()
+{
+    _flushTimer->setSingleShot(true);
+    QObject::connect(_flushTimer, SIGNAL(timeout()), this, SLOT(flushChanges()));
+    ///Always queued: changes are recorded from the render threads but published on the thread of the emitter
+    QObject::connect(this, SIGNAL(changesPending()), this, SLOT(onChangesPending()), Qt::QueuedConnection);
+    _lastFlush.start();
+}
+
+bool
+CacheSignalEmitter::recordChange(SequenceTime time,bool removed,Natron::StorageMode storage)
+{
+    ///The cache blocks signals while it is being cleared, the gui is notified once with the cleared signals instead
+    if (signalsBlocked()) {
+        return false;
+    }
+    QMutexLocker l(&_changesMutex);
+    bool wasEmpty = _changes.isEmpty();
+    ///only the last change of a frame is relevant
+    _changes.inRAM.remove(time);
+    _changes.onDisk.remove(time);
+    _changes.removed.remove(time);
+    if (removed) {
+        _changes.removed.insert(time);
+    } else if (storage == Natron::RAM) {
+        _changes.inRAM.insert(time);
+    } else {
+        _changes.onDisk.insert(time);
+    }
+    return wasEmpty;
+}
+
+void
+CacheSignalEmitter::emitAddedEntry(SequenceTime time)
+{
+    if (recordChange(time, false, Natron::RAM)) {
+        emit changesPending();
+    }
+}
+
+void
+CacheSignalEmitter::emitRemovedEntry(SequenceTime time,int /*storage*/)
+{
+    if (recordChange(time, true, Natron::RAM)) {
+        emit changesPending();
+    }
+}
+
+void
+CacheSignalEmitter::emitEntryStorageChanged(SequenceTime time,int /*oldStorage*/,int newStorage)
+{
+    if (recordChange(time, false, (Natron::StorageMode)newStorage)) {
+        emit changesPending();
+    }
+}
+
+void
+CacheSignalEmitter::emitSignalClearedInMemoryPortion()
+{
+    {
+        ///Frames that went to the RAM since the last flush are not in the cache anymore
+        QMutexLocker l(&_changesMutex);
+        _changes.removed.merge(_changes.inRAM);
+        _changes.inRAM.clear();
+    }
+    emit clearedInMemoryPortion();
+}
+
+void
+CacheSignalEmitter::emitClearedDiskPortion()
+{
+    {
+        QMutexLocker l(&_changesMutex);
+        _changes.removed.merge(_changes.onDisk);
+        _changes.onDisk.clear();
+    }
+    emit clearedDiskPortion();
+}
+
+void
+CacheSignalEmitter::onChangesPending()
+{
+    if (_flushTimer->isActive()) {
+        return;
+    }
+    qint64 elapsed = _lastFlush.elapsed();
+    if (elapsed >= NATRON_CACHE_NOTIFICATIONS_INTERVAL_MS) {
+        flushChanges();
+    } else {
+        _flushTimer->start(NATRON_CACHE_NOTIFICATIONS_INTERVAL_MS - (int)elapsed);
+    }
+}
+
+void
+CacheSignalEmitter::flushChanges()
+{
+    CacheEntriesChanges changes;
+    {
+        QMutexLocker l(&_changesMutex);
+        std::swap(changes,_changes);
+    }
+    _lastFlush.restart();
+    if (!changes.isEmpty()) {
+        emit entriesChanged(changes);
+    }
+}
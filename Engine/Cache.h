@@ -27,6 +27,10 @@ CLANG_DIAG_OFF(deprecated)
 #include <QtCore/QDebug>
 #include <QtCore/QTextStream>
 #include <QtCore/QBuffer>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QTimer>
+#include <QtCore/QThreadPool>
+#include <QtCore/QRunnable>
 CLANG_DIAG_ON(deprecated)
 #include <boost/shared_ptr.hpp>
 CLANG_DIAG_OFF(unused-parameter)
@@ -44,41 +48,82 @@ CLANG_DIAG_ON(unused-parameter)
 #include "Engine/FrameEntrySerialization.h"
 #include "Engine/FrameParamsSerialization.h"
 #include "Engine/CacheEntry.h"
+#include "Engine/FrameRangeSet.h"
 #include "Engine/LRUHashTable.h"
 #include "Engine/StandardPaths.h"
 
+///The minimum interval between 2 notifications of the cache content to the gui. 40ms = 25 refreshes per second at most
+#define NATRON_CACHE_NOTIFICATIONS_INTERVAL_MS 40
+
 namespace Natron {
     
+    /**
+     * @brief The frames whose cache state changed since the last notification. A frame is in at most one of the 3 sets:
+     * only the last change of a frame is kept.
+     **/
+    struct CacheEntriesChanges
+    {
+        FrameRangeSet inRAM; //< frames that were added to the cache or moved back to the RAM
+        FrameRangeSet onDisk; //< frames that were moved to the disk
+        FrameRangeSet removed; //< frames that were removed from the cache
+        
+        bool isEmpty() const { return inRAM.isEmpty() && onDisk.isEmpty() && removed.isEmpty(); }
+    };
+    
+    /**
+     * @brief Notifies the gui of the changes in a cache. Entries are added and removed from any thread and at a very
+     * high rate during playback, so changes are accumulated and published on the main thread at most every
+     * NATRON_CACHE_NOTIFICATIONS_INTERVAL_MS milliseconds with the entriesChanged() signal.
+     * The emitter must be created on the main thread.
+     **/
     class CacheSignalEmitter : public QObject {
         Q_OBJECT
 
     public:
-        CacheSignalEmitter(){}
+        CacheSignalEmitter();
 
         ~CacheSignalEmitter(){}
 
-        void emitSignalClearedInMemoryPortion() { emit clearedInMemoryPortion(); }
+        void emitSignalClearedInMemoryPortion();
         
-        void emitClearedDiskPortion() { emit clearedDiskPortion(); }
+        void emitClearedDiskPortion();
 
-        void emitAddedEntry(SequenceTime time) {emit addedEntry(time);}
+        void emitAddedEntry(SequenceTime time);
 
-        void emitRemovedEntry(SequenceTime time,int storage) {emit removedEntry(time,storage);}
+        void emitRemovedEntry(SequenceTime time,int storage);
+        
+        void emitEntryStorageChanged(SequenceTime time,int oldStorage,int newStorage);
+        
+    public slots:
+        
+        ///Publishes all the changes accumulated so far. Must be called on the main thread.
+        void flushChanges();
+        
+    private slots:
+        
+        void onChangesPending();
         
-        void emitEntryStorageChanged(SequenceTime time,int oldStorage,int newStorage) {
-            emit entryStorageChanged(time,oldStorage,newStorage);
-        }
     signals:
+        
+        ///Internal, used to wake up the main thread when the first change is accumulated
+        void changesPending();
 
         void clearedInMemoryPortion();
         
         void clearedDiskPortion();
 
-        void addedEntry(SequenceTime);
-
-        void removedEntry(SequenceTime,int);
-
-        void entryStorageChanged(SequenceTime,int,int);
+        void entriesChanged(const Natron::CacheEntriesChanges& changes);
+        
+    private:
+        
+        ///Returns true if this is the first change since the last flush.
+        ///If removed is false, storage is where the entry is now stored.
+        bool recordChange(SequenceTime time,bool removed,Natron::StorageMode storage);
+        
+        QMutex _changesMutex; //< protects _changes
+        CacheEntriesChanges _changes;
+        QTimer* _flushTimer;
+        QElapsedTimer _lastFlush;
     };
     
  
@@ -130,6 +175,16 @@ namespace Natron {
             NonKeyParamsPtr params;
         };
 
+        ///Runs compressPendingEntries() in the compression thread of the cache
+        class CompressionTask : public QRunnable {
+            const Cache* _cache;
+
+        public:
+            CompressionTask(const Cache* cache) : QRunnable(), _cache(cache) {}
+
+            virtual void run() OVERRIDE FINAL { _cache->compressPendingEntries(); }
+        };
+
     public:
         
 
@@ -193,6 +248,24 @@ namespace Natron {
         mutable std::size_t _memoryCacheSize; // current size of the cache in bytes
         mutable std::size_t _diskCacheSize;
 
+        ///The maximum amount of RAM used by the compressed copies of the entries stored on disk, 0 disables them.
+        std::size_t _maximumCompressedSize;
+        mutable std::size_t _compressedSize;
+
+        /*The entries of the disk portion that hold a compressed copy, the least recently used first, along with
+             the size of their copy. The pointers are not owning: the entries are forgotten before being destroyed,
+             holding a shared pointer would prevent them from ever being evicted.*/
+        mutable std::list<std::pair<EntryType*,std::size_t> > _compressedEntries;
+
+        /*The entries which left the memory portion and whose file is to be compressed without the lock held, along
+             with the age of their file at that time, @see compressPendingEntries.*/
+        mutable std::list<std::pair<EntryTypePtr,U64> > _entriesToCompress;
+
+        /*The files are compressed by a single thread of its own so that the threads getting entries from the cache,
+             e.g the render and playback threads, never wait for the codec.*/
+        mutable QThreadPool _compressionThread;
+        mutable bool _compressionScheduled; //< true while a CompressionTask is queued or running
+
         mutable QMutex _lock;
 
         /*These 2 are mutable because we need to modify the LRU list even
@@ -220,6 +293,12 @@ namespace Natron {
             ,_maximumCacheSize(maximumCacheSize)
             ,_memoryCacheSize(0)
             ,_diskCacheSize(0)
+            ,_maximumCompressedSize(0)
+            ,_compressedSize(0)
+            ,_compressedEntries()
+            ,_entriesToCompress()
+            ,_compressionThread()
+            ,_compressionScheduled(false)
             ,_lock()
             ,_memoryCache()
             ,_diskCache()
@@ -227,10 +306,18 @@ namespace Natron {
             ,_version(version)
             ,_signalEmitter(NULL)
         {
+            _compressionThread.setMaxThreadCount(1);
         }
 
         virtual ~Cache() {
+            {
+                QMutexLocker locker(&_lock);
+                _entriesToCompress.clear();
+            }
+            ///wait for the file being compressed, if any
+            _compressionThread.waitForDone();
             QMutexLocker locker(&_lock);
+            _compressedEntries.clear();
             _memoryCache.clear();
             _diskCache.clear();
             if(_signalEmitter)
@@ -249,95 +336,26 @@ namespace Natron {
      * False otherwise.
      **/
         bool get(const typename EntryType::key_type& key,NonKeyParamsPtr* params,EntryTypePtr* returnValue) const {
-
-            ///lock the cache before reading it.
-            QMutexLocker locker(&_lock);
-
-            ///find a matching value in the internal memory container
-            CacheIterator memoryCached = _memoryCache(key.getHash());
-
-            if (memoryCached != _memoryCache.end()) {
-                /*we found something with a matching hash key. There may be several entries linked to
-                    this key, we need to find one with matching params*/
-                std::list<CachedValue>& ret = getValueFromIterator(memoryCached);
-                for (typename std::list<CachedValue>::const_iterator it = ret.begin(); it!=ret.end(); ++it) {
-                    if (it->entry->getKey() == key) {
-                        *returnValue = it->entry;
-                        *params = it->params;
-                        
-                        ///emit te added signal otherwise when first reading something that's already cached
-                        ///the timeline wouldn't update
-                        if(_signalEmitter) {
-                            _signalEmitter->emitAddedEntry(key.getTime());
-                        }
-                        return true;
-                    }
-                }
+            EntryTypePtr entry;
+            NonKeyParamsPtr entryParams;
+            bool found;
+            {
+                ///lock the cache before reading it.
+                QMutexLocker locker(&_lock);
+                found = lookup(key,&entryParams,&entry);
+            }
+            ///the codecs run without the lock so that they don't stall the other threads using the cache
+            if (!found) {
                 return false;
-            } else {
-
-                ///fallback on the disk cache internal container
-                CacheIterator diskCached = _diskCache(key.getHash());
-
-                if (diskCached == _diskCache.end()) {
-                    /*the entry was neither in memory or disk, just allocate a new one*/
-                    return false;
-                } else {
-                    /*we found something with a matching hash key. There may be several entries linked to
-                         this key, we need to find one with matching values(operator ==)*/
-                    std::list<CachedValue>& ret = getValueFromIterator(diskCached);
-
-                    for (typename std::list<CachedValue>::iterator it = ret.begin();
-                         it!=ret.end(); ++it) {
-                        if (it->entry->getKey() == key) {
-                            /*If we found 1 entry in the list that has exactly the same key params,
-                         we re-open the mapping to the RAM put the entry
-                         back into the memoryCache.*/
-
-                            if(ret.empty()){
-                                _diskCache.erase(diskCached);
-                            }
-
-                            try {
-                                it->entry->reOpenFileMapping();
-                            } catch (const std::exception& e) {
-                                qDebug() << "Error while reopening cache file: " << e.what();
-                                ret.erase(it);
-                                return false;
-                            } catch (...) {
-                                qDebug() << "Error while reopening cache file";
-                                ret.erase(it);
-                                return false;
-                            }
-                            
-                            //put it back into the RAM
-                            _memoryCache.insert(it->entry->getHashKey(),*it);
-
-                            //now clear extra entries from the disk cache so it doesn't exceed the RAM limit.
-                            while (_memoryCacheSize > _maximumInMemorySize) {
-                                if (!tryEvictEntry()) {
-                                    break;
-                                }
-                            }
-
-                            *returnValue = it->entry;
-                            *params = it->params;
-                            ret.erase(it);
-                            ///emit te added signal otherwise when first reading something that's already cached
-                            ///the timeline wouldn't update
-                            if(_signalEmitter) {
-                                _signalEmitter->emitAddedEntry(key.getTime());
-                            }
-                            return true;
-
-                        }
-                    }
-                    /*if we reache here it means no entries linked to the hash key matches the params,then
-                         we allocate a new one*/
-                    return false;
-                }
             }
-
+            if (!entry->finishReOpenFileMapping()) {
+                qDebug() << "Error while decompressing cache entry";
+                removeEntry(entry);
+                return false;
+            }
+            *returnValue = entry;
+            *params = entryParams;
+            return true;
         }
 
 
@@ -403,6 +421,7 @@ namespace Natron {
             //if the cache couldn't evict that means all entries are used somewhere and we shall not remove them!
             //we'll let the user of these entries purge the extra entries left in the cache later on
             while (evictedFromDisk.second.entry) {
+                forgetCompressedCopy(evictedFromDisk.second.entry.get());
                 evictedFromDisk.second.entry->deallocate();
                 evictedFromDisk.second.entry->removeAnyBackingFile();
                 evictedFromDisk = _diskCache.evict();
@@ -437,6 +456,7 @@ namespace Natron {
                             break;
                         }
                         ///Erase the file from the disk if we reach the limit.
+                        forgetCompressedCopy(evictedFromDisk.second.entry.get());
                         evictedFromDisk.second.entry->removeAnyBackingFile();
                     }
                     
@@ -605,6 +625,19 @@ namespace Natron {
 
         void setMaximumInMemorySize(double percentage) { _maximumInMemorySize = _maximumCacheSize * percentage; }
 
+        /**
+         * @brief Set the amount of RAM that can be used to keep compressed copies of the entries evicted
+         * to the disk portion of the cache. Reading back such an entry decompresses it instead of reading its file.
+         * 0 (the default) disables the compression.
+         **/
+        void setMaximumCompressedSize(U64 newSize) {
+            QMutexLocker locker(&_lock);
+            _maximumCompressedSize = newSize;
+            trimCompressedCopies();
+        }
+
+        std::size_t getCompressedSize() const { QMutexLocker locker(&_lock); return _compressedSize;}
+
         std::size_t getMaximumSize() const  { QMutexLocker locker(&_lock); return _maximumCacheSize;}
 
         std::size_t getMaximumMemorySize() const { QMutexLocker locker(&_lock); return _maximumInMemorySize;}
@@ -636,6 +669,7 @@ namespace Natron {
                 std::list<CachedValue>& ret = getValueFromIterator(existingEntry);
                 for (typename std::list<CachedValue>::iterator it = ret.begin(); it!=ret.end(); ++it) {
                     if(it->entry->getKey() == entry->getKey()){
+                        forgetCompressedCopy(it->entry.get());
                         if (it->entry->isStoredOnDisk()) {
                             it->entry->deallocate();
                             it->entry->removeAnyBackingFile();
@@ -653,6 +687,7 @@ namespace Natron {
                     std::list<CachedValue>& ret = getValueFromIterator(existingEntry);
                     for (typename std::list<CachedValue>::iterator it = ret.begin(); it!=ret.end(); ++it) {
                         if (it->entry->getKey() == entry->getKey()) {
+                            forgetCompressedCopy(it->entry.get());
                             if (it->entry->isStoredOnDisk()) {
                                 it->entry->deallocate();
                                 it->entry->removeAnyBackingFile();
@@ -730,6 +765,101 @@ namespace Natron {
    
 
 
+        /** @brief The look-up of get(), called with the lock held. An entry found in the disk portion is moved back to
+         * the memory portion, its data is not ready until finishReOpenFileMapping() is called.
+         **/
+        bool lookup(const typename EntryType::key_type& key,NonKeyParamsPtr* params,EntryTypePtr* returnValue) const {
+            assert(!_lock.tryLock()); // must be locked
+
+            ///find a matching value in the internal memory container
+            CacheIterator memoryCached = _memoryCache(key.getHash());
+
+            if (memoryCached != _memoryCache.end()) {
+                /*we found something with a matching hash key. There may be several entries linked to
+                    this key, we need to find one with matching params*/
+                std::list<CachedValue>& ret = getValueFromIterator(memoryCached);
+                for (typename std::list<CachedValue>::const_iterator it = ret.begin(); it!=ret.end(); ++it) {
+                    if (it->entry->getKey() == key) {
+                        *returnValue = it->entry;
+                        *params = it->params;
+                        
+                        ///emit te added signal otherwise when first reading something that's already cached
+                        ///the timeline wouldn't update
+                        if(_signalEmitter) {
+                            _signalEmitter->emitAddedEntry(key.getTime());
+                        }
+                        return true;
+                    }
+                }
+                return false;
+            } else {
+
+                ///fallback on the disk cache internal container
+                CacheIterator diskCached = _diskCache(key.getHash());
+
+                if (diskCached == _diskCache.end()) {
+                    /*the entry was neither in memory or disk, just allocate a new one*/
+                    return false;
+                } else {
+                    /*we found something with a matching hash key. There may be several entries linked to
+                         this key, we need to find one with matching values(operator ==)*/
+                    std::list<CachedValue>& ret = getValueFromIterator(diskCached);
+
+                    for (typename std::list<CachedValue>::iterator it = ret.begin();
+                         it!=ret.end(); ++it) {
+                        if (it->entry->getKey() == key) {
+                            /*If we found 1 entry in the list that has exactly the same key params,
+                         we re-open the mapping to the RAM put the entry
+                         back into the memoryCache.*/
+
+                            if(ret.empty()){
+                                _diskCache.erase(diskCached);
+                            }
+
+                            try {
+                                it->entry->reOpenFileMapping();
+                            } catch (const std::exception& e) {
+                                qDebug() << "Error while reopening cache file: " << e.what();
+                                forgetCompressedCopy(it->entry.get());
+                                ret.erase(it);
+                                return false;
+                            } catch (...) {
+                                qDebug() << "Error while reopening cache file";
+                                forgetCompressedCopy(it->entry.get());
+                                ret.erase(it);
+                                return false;
+                            }
+                            
+                            //put it back into the RAM
+                            _memoryCache.insert(it->entry->getHashKey(),*it);
+
+                            //now clear extra entries from the disk cache so it doesn't exceed the RAM limit.
+                            while (_memoryCacheSize > _maximumInMemorySize) {
+                                if (!tryEvictEntry()) {
+                                    break;
+                                }
+                            }
+
+                            *returnValue = it->entry;
+                            *params = it->params;
+                            ret.erase(it);
+                            ///emit te added signal otherwise when first reading something that's already cached
+                            ///the timeline wouldn't update
+                            if(_signalEmitter) {
+                                _signalEmitter->emitAddedEntry(key.getTime());
+                            }
+                            return true;
+
+                        }
+                    }
+                    /*if we reache here it means no entries linked to the hash key matches the params,then
+                         we allocate a new one*/
+                    return false;
+                }
+            }
+
+        }
+
         /** @brief Allocates a new entry by the cache. On failure a NULL pointer is returned.
          * The storage is then handled by the cache solely.
          **/
@@ -785,6 +915,9 @@ namespace Natron {
             if (evicted.second.entry->isStoredOnDisk()) {
 
                 assert(evicted.second.entry.unique());
+                if (_maximumCompressedSize > 0) {
+                    keepCompressedCopy(evicted.second.entry);
+                }
                 evicted.second.entry->deallocate();
                 /*insert it back into the disk portion */
 
@@ -798,6 +931,7 @@ namespace Natron {
                     }
                     
                     ///Erase the file from the disk if we reach the limit.
+                    forgetCompressedCopy(evictedFromDisk.second.entry.get());
                     evictedFromDisk.second.entry->removeAnyBackingFile();
                 }
 
@@ -813,6 +947,97 @@ namespace Natron {
             return true;
         }
 
+        /** @brief Queues the compression of an entry which is about to leave the memory portion, or marks its
+         * existing compressed copy as the most recently used one.
+         **/
+        void keepCompressedCopy(const EntryTypePtr& entry) const {
+            assert(!_lock.tryLock());
+            for (typename std::list<std::pair<EntryType*,std::size_t> >::iterator it = _compressedEntries.begin();
+                 it != _compressedEntries.end(); ++it) {
+                if (it->first == entry.get()) {
+                    if (entry->hasCompressedCopy()) {
+                        _compressedEntries.splice(_compressedEntries.end(), _compressedEntries, it);
+                        return;
+                    }
+                    ///the copy was dropped when the entry got reallocated
+                    _compressedSize -= it->second;
+                    _compressedEntries.erase(it);
+                    break;
+                }
+            }
+            _entriesToCompress.push_back(std::make_pair(entry,entry->getFileAge()));
+            if (!_compressionScheduled) {
+                _compressionScheduled = true;
+                _compressionThread.start(new CompressionTask(this));
+            }
+        }
+
+        /** @brief Compresses the files of the entries queued by keepCompressedCopy(), in the compression thread.
+         * The lock is only taken to pick an entry and to keep its copy, the file is compressed without it. The copy is
+         * dropped if the file was re-opened or removed meanwhile.
+         **/
+        void compressPendingEntries() const {
+            for (;;) {
+                std::pair<EntryTypePtr,U64> pending;
+                {
+                    QMutexLocker locker(&_lock);
+                    if (_entriesToCompress.empty()) {
+                        _compressionScheduled = false;
+                        return;
+                    }
+                    pending = _entriesToCompress.front();
+                    _entriesToCompress.pop_front();
+                }
+                ///not worth keeping if it does not save at least 20%
+                boost::shared_ptr<Natron::CompressedBuffer> compressed(pending.first->compressFile(0.8));
+                if (!compressed) {
+                    continue;
+                }
+                QMutexLocker locker(&_lock);
+                if (pending.first->getFileAge() != pending.second || pending.first->hasCompressedCopy() ||
+                    compressed->getUncompressedSize() != pending.first->dataSize()) {
+                    continue;
+                }
+                pending.first->setCompressedCopy(compressed);
+                _compressedEntries.push_back(std::make_pair(pending.first.get(),compressed->getCompressedSize()));
+                _compressedSize += compressed->getCompressedSize();
+                trimCompressedCopies();
+            }
+        }
+
+        /** @brief Must be called before an entry which may hold a compressed copy is removed from the cache.
+         **/
+        void forgetCompressedCopy(EntryType* entry) const {
+            assert(!_lock.tryLock());
+            for (typename std::list<std::pair<EntryTypePtr,U64> >::iterator it = _entriesToCompress.begin();
+                 it != _entriesToCompress.end(); ++it) {
+                if (it->first.get() == entry) {
+                    _entriesToCompress.erase(it);
+                    break;
+                }
+            }
+            for (typename std::list<std::pair<EntryType*,std::size_t> >::iterator it = _compressedEntries.begin();
+                 it != _compressedEntries.end(); ++it) {
+                if (it->first == entry) {
+                    entry->dropCompressedCopy();
+                    _compressedSize -= it->second;
+                    _compressedEntries.erase(it);
+                    return;
+                }
+            }
+        }
+
+        /** @brief Drops the least recently used compressed copies until they fit in the allowed size.
+         **/
+        void trimCompressedCopies() const {
+            assert(!_lock.tryLock());
+            while (_compressedSize > _maximumCompressedSize && !_compressedEntries.empty()) {
+                _compressedEntries.front().first->dropCompressedCopy();
+                _compressedSize -= _compressedEntries.front().second;
+                _compressedEntries.pop_front();
+            }
+        }
+
     };
 
 
@@ -3,17 +3,22 @@
 
 #include <iostream>
 #include <cassert>
+#include <cstring>
 #include <stdexcept>
 #include <QtCore/QFile>
 #include <QtCore/QDir>
+#include <QtCore/QMutex>
 
 #include <boost/utility.hpp>
 #include <boost/shared_ptr.hpp>
 
 
+#include "Engine/CompressedBuffer.h"
 #include "Engine/Hash64.h"
 #include "Engine/MemoryFile.h"
+#include "Engine/MemoryPool.h"
 #include "Engine/NonKeyParams.h"
+#include "Engine/NUMA.h"
 
 namespace Natron {
 
@@ -96,7 +101,7 @@ private:
 
 
 /** @brief Buffer represents  an internal buffer that can be allocated on different devices.
- * For now the class is simple and can only be either on disk using mmap or in RAM using malloc.
+ * For now the class is simple and can only be either on disk using mmap or in RAM using the MemoryPool.
  * The cost parameter given to the allocate() function is a hint that the Buffer classes uses
  * to select a device to use. By default -1 means it should not allocate any memory,
  * 0 means RAM and >= 1 means the data will be stored on disk using mmap. We could see this
@@ -115,7 +120,8 @@ class Buffer {
 public:
     
     
-    Buffer():_path(),_size(0),_buffer(NULL),_backingFile(NULL),_storageMode(RAM){}
+    Buffer():_path(),_size(0),_buffer(NULL),_backingFile(NULL),_storageMode(RAM),_numaAllocated(false),_compressed()
+    ,_decompressionLock(),_toDecompress(),_fileAge(0){}
     
     ~Buffer(){deallocate();}
     
@@ -152,7 +158,13 @@ public:
             }
         } else if(cost == 0) {
             _storageMode = RAM;
-            _buffer =  (DataType*)malloc(count * sizeof(DataType));
+            ///In NUMA mode the pages are left untouched so that they land on the node of the thread rendering them
+            _numaAllocated = Natron::NUMA::isEnabled();
+            if (_numaAllocated) {
+                _buffer = (DataType*)Natron::NUMA::allocate(count * sizeof(DataType));
+            } else {
+                _buffer = (DataType*)Natron::MemoryPool::instance()->allocate(count * sizeof(DataType));
+            }
             if (!_buffer) {
                 throw std::bad_alloc();
             }
@@ -168,16 +180,33 @@ public:
      **/
     void reallocate(U64 count)
     {
+        size_t oldSize = _size;
         _size = count * sizeof(DataType);
         if (_storageMode == RAM) {
             assert(_buffer);
-            _buffer = (DataType*)realloc((void*)_buffer,_size);
-            if (!_buffer) {
+            DataType* newBuffer;
+            if (_numaAllocated) {
+                newBuffer = (DataType*)Natron::NUMA::reallocate((void*)_buffer,oldSize,_size);
+            } else {
+                try {
+                    newBuffer = (DataType*)Natron::MemoryPool::instance()->reallocate((void*)_buffer,oldSize,_size);
+                } catch (const std::bad_alloc&) {
+                    newBuffer = NULL;
+                }
+            }
+            if (!newBuffer) {
+                _size = oldSize;
                 throw std::bad_alloc();
             }
+            _buffer = newBuffer;
 
         } else if (_storageMode == DISK) {
-            assert(_backingFile);
+            if (!_backingFile) {
+                ///the buffer is a decompressed copy of the file which is about to change: go back to the file
+                dropCompressedCopy();
+                deallocate();
+                reOpenFileMapping();
+            }
             _backingFile->resize(_size);
             if (!_backingFile->data()) {
                 throw std::bad_alloc();
@@ -185,10 +214,30 @@ public:
         }
     }
     
+    /**
+     * @brief Called with the cache locked. If the file has a compressed copy in RAM, only the memory is allocated here
+     * and the copy is decompressed by finishReOpenFileMapping(), which is called without the lock.
+     **/
     void reOpenFileMapping() const {
-        assert(!_backingFile && _storageMode == DISK);
+        assert(!_backingFile && !_buffer && _storageMode == DISK);
+        ++_fileAge;
+        if (_compressed && _compressed->getUncompressedSize() == _size) {
+            ///the data is still in RAM, compressed: this is much faster than reading the file
+            try {
+                _buffer = (DataType*)Natron::MemoryPool::instance()->allocate(_size);
+            } catch (const std::bad_alloc&) {
+                _buffer = NULL;
+            }
+            if (_buffer) {
+                ///never contended: the entry cannot be re-opened again before the threads which got it are done with it
+                QMutexLocker l(&_decompressionLock);
+                _toDecompress = _compressed;
+                return;
+            }
+        }
         try{
-            _backingFile  = new MemoryFile(_path,Natron::if_exists_keep_if_dont_exists_create);
+            ///the entry is re-opened because it is about to be read entirely: start reading all its pages now
+            _backingFile  = new MemoryFile(_path,Natron::if_exists_keep_if_dont_exists_create,MemoryFile::MAPPING_POPULATE);
         }catch(const std::runtime_error& r){
             delete _backingFile;
             _backingFile = NULL;
@@ -197,6 +246,31 @@ public:
         }
     }
     
+    /**
+     * @brief Decompresses the copy taken by reOpenFileMapping(), if any. Every thread which got the entry from the cache
+     * calls this without the cache lock: the first one decompresses and the others wait for it.
+     * Falls back on reading the file if the copy cannot be decompressed, returns false if that fails too.
+     **/
+    bool finishReOpenFileMapping() const {
+        QMutexLocker l(&_decompressionLock);
+        if (!_toDecompress) {
+            return true;
+        }
+        assert(_buffer);
+        bool ok = _toDecompress->decompress((unsigned char*)_buffer);
+        if (!ok) {
+            InputMemoryFile file(_path.c_str());
+            ok = file.data() && file.size() == _size;
+            if (ok) {
+                std::memcpy(_buffer, file.data(), _size);
+            }
+        }
+        if (ok) {
+            _toDecompress.reset();
+        }
+        return ok;
+    }
+    
     void restoreBufferFromFile(const std::string& path)  {
         try{
             _backingFile  = new MemoryFile(path,Natron::if_exists_keep_if_dont_exists_create);
@@ -214,11 +288,23 @@ public:
         
         if (_storageMode == RAM) {
             if (_buffer) {
-                free(_buffer);
+                if (_numaAllocated) {
+                    Natron::NUMA::deallocate(_buffer,_size);
+                } else {
+                    Natron::MemoryPool::instance()->deallocate(_buffer,_size);
+                }
                 _buffer = NULL;
             }
             
-        } else {
+        } else if (_buffer) {
+            ///a decompressed copy of the file, which is left untouched
+            QMutexLocker l(&_decompressionLock);
+            _toDecompress.reset();
+            Natron::MemoryPool::instance()->deallocate(_buffer,_size);
+            _buffer = NULL;
+        } else if (_backingFile) {
+            ///don't let the dirty pages pile up until the system decides to write them all at once
+            _backingFile->startWriteBack();
             delete _backingFile;
             _backingFile = NULL;
         }
@@ -226,6 +312,7 @@ public:
     
     void removeAnyBackingFile() const {
         if(_storageMode == DISK){
+            ++_fileAge;
             if(QFile::exists(_path.c_str())){
                 QFile::remove(_path.c_str());
             }
@@ -243,38 +330,84 @@ public:
     }
     
     DataType* writable() const {
-        if (_storageMode == DISK) {
-            if(_backingFile) {
-                return (DataType*)_backingFile->data();
-            } else {
-                return NULL;
-            }
+        if (_storageMode == DISK && _backingFile) {
+            return (DataType*)_backingFile->data();
         } else {
             return _buffer;
         }
     }
     
     const DataType* readable() const {
-        if (_storageMode == DISK) {
-            return (DataType*)_backingFile->data();
-        } else {
-            return _buffer;
+        return writable();
+    }
+    
+    /**
+     * @brief Compresses the content of the file through a mapping of its own, so that it can be called without the
+     * cache lock while the buffer is deallocated. pixelSize is the size in bytes of the pixels of the buffer.
+     * Returns NULL if the file cannot be read or doesn't compress well enough to be worth it.
+     **/
+    Natron::CompressedBuffer* compressFile(int pixelSize,double maxRatio) const {
+        assert(_storageMode == DISK);
+        InputMemoryFile file(_path.c_str());
+        if (!file.data() || file.size() == 0) {
+            return NULL;
+        }
+        Natron::CompressedBuffer* compressed = new Natron::CompressedBuffer;
+        if (!compressed->compress((const unsigned char*)file.data(), file.size(), pixelSize, maxRatio)) {
+            delete compressed;
+            return NULL;
+        }
+        return compressed;
+    }
+    
+    /**
+     * @brief Keeps a compressed copy of the content of the file in RAM, so that the next reOpenFileMapping()
+     * decompresses it instead of reading the file. The content of the file must not change afterwards.
+     **/
+    void setCompressedCopy(const boost::shared_ptr<Natron::CompressedBuffer>& compressed) { _compressed = compressed; }
+    
+    bool hasCompressedCopy() const { return _compressed.get() != NULL; }
+    
+    /**
+     * @brief Frees the compressed copy, returns the memory it used.
+     **/
+    size_t dropCompressedCopy() {
+        if (!_compressed) {
+            return 0;
         }
+        size_t ret = _compressed->getCompressedSize();
+        _compressed.reset();
+        return ret;
     }
     
+    /**
+     * @brief Incremented whenever the file may change or disappear: when it is re-opened and when it is removed.
+     **/
+    U64 getFileAge() const { return _fileAge; }
+    
     Natron::StorageMode getStorageMode() const {return _storageMode;}
     
 private:
     
     std::string _path;
     size_t _size; //< in bytes!
-    DataType* _buffer;
+    
+    /*mutable so the reOpenFileMapping function can decompress the data of a DISK buffer in RAM.
+     It doesn't change the underlying data*/
+    mutable DataType* _buffer;
     
     /*mutable so the reOpenFileMapping function can reopen the mmaped file. It doesn't
      change the underlying data*/
     mutable MemoryFile* _backingFile;
     
     Natron::StorageMode _storageMode;
+    bool _numaAllocated; //< true if _buffer was allocated by Natron::NUMA::allocate
+    boost::shared_ptr<Natron::CompressedBuffer> _compressed; //< a compressed copy of the file, if any
+    
+    ///held while _buffer is filled from _toDecompress, so that no thread reads the entry before it is done
+    mutable QMutex _decompressionLock;
+    mutable boost::shared_ptr<Natron::CompressedBuffer> _toDecompress; //< the copy to decompress into _buffer, if any
+    mutable U64 _fileAge; //< see getFileAge()
 };
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -435,6 +568,11 @@ public:
             _cache->notifyEntryStorageChanged(Natron::DISK, Natron::RAM,getTime(), size());
         }
     }
+    
+    /** @brief Called by the get() function of the Cache without the lock, once the entry was found,
+     * @see Buffer::finishReOpenFileMapping.
+     **/
+    bool finishReOpenFileMapping() const WARN_UNUSED_RETURN { return _data.finishReOpenFileMapping(); }
   
     /**
      * @brief Can be called several times without harm
@@ -468,6 +606,25 @@ public:
     
     bool isStoredOnDisk() const {return _data.getStorageMode() == Natron::DISK;}
     
+    /**
+     * @brief The size in bytes of a pixel of the entry, so that compressInRAM() can predict a pixel from the previous one.
+     **/
+    virtual int getPixelSize() const { return sizeof(DataType); }
+    
+    /**
+     * @brief Compresses the backing file of an entry stored on disk, @see Buffer::compressFile.
+     * The cache keeps the result with setCompressedCopy() if the file did not change meanwhile.
+     **/
+    Natron::CompressedBuffer* compressFile(double maxRatio) const { return _data.compressFile(getPixelSize(), maxRatio); }
+    
+    void setCompressedCopy(const boost::shared_ptr<Natron::CompressedBuffer>& compressed) { _data.setCompressedCopy(compressed); }
+    
+    bool hasCompressedCopy() const { return _data.hasCompressedCopy(); }
+    
+    U64 getFileAge() const { return _data.getFileAge(); }
+    
+    size_t dropCompressedCopy() { return _data.dropCompressedCopy(); }
+    
     /**
      * @brief An entry stored on disk is effectively destroyed when its backing file is removed.
      **/
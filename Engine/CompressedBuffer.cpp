@@ -0,0 +1,347 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "CompressedBuffer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+CLANG_DIAG_OFF(deprecated)
+#include <QtCore/QtConcurrentMap>
+CLANG_DIAG_ON(deprecated)
+
+#include "Global/GlobalDefines.h"
+
+///Matches are at least that long
+#define NATRON_COMPRESSED_BUFFER_MIN_MATCH 4
+///Matches cannot reference bytes further than that
+#define NATRON_COMPRESSED_BUFFER_MAX_OFFSET 65535
+#define NATRON_COMPRESSED_BUFFER_HASH_LOG 14
+
+using namespace Natron;
+
+/*
+ * The format of a compressed slice is a sequence of:
+ * - a token: the 4 high bits are the number of literals, the 4 low bits the length of the match minus 4.
+ * If a field is 15, extra bytes follow, which are added to it until a byte is not 255.
+ * - the literals.
+ * - the offset of the match, on 2 bytes, little-endian, followed by the extra bytes of the match length.
+ * The last sequence only has literals: it is the one after which the output is full.
+ */
+
+namespace {
+
+inline U32
+read32(const unsigned char* p)
+{
+    U32 ret;
+    std::memcpy(&ret, p, sizeof(U32));
+    return ret;
+}
+
+inline unsigned char*
+writeLength(unsigned char* op,std::size_t length)
+{
+    while (length >= 255) {
+        *op++ = 255;
+        length -= 255;
+    }
+    *op++ = (unsigned char)length;
+    return op;
+}
+
+///writes a sequence, without a match if matchLength is 0
+unsigned char*
+writeSequence(unsigned char* op,const unsigned char* literals,std::size_t literalsCount,std::size_t offset,std::size_t matchLength)
+{
+    std::size_t matchCode = matchLength > 0 ? matchLength - NATRON_COMPRESSED_BUFFER_MIN_MATCH : 0;
+    unsigned char* token = op++;
+    *token = (unsigned char)(((literalsCount < 15 ? literalsCount : 15) << 4) | (matchCode < 15 ? matchCode : 15));
+    if (literalsCount >= 15) {
+        op = writeLength(op, literalsCount - 15);
+    }
+    std::memcpy(op, literals, literalsCount);
+    op += literalsCount;
+    if (matchLength > 0) {
+        *op++ = (unsigned char)(offset & 0xff);
+        *op++ = (unsigned char)(offset >> 8);
+        if (matchCode >= 15) {
+            op = writeLength(op, matchCode - 15);
+        }
+    }
+    return op;
+}
+
+///reads the extra bytes of a length, returns false if the input is exhausted
+inline bool
+readLength(const unsigned char** ip,const unsigned char* iend,std::size_t* length)
+{
+    unsigned char b;
+    do {
+        if (*ip >= iend) {
+            return false;
+        }
+        b = *(*ip)++;
+        *length += b;
+    } while (b == 255);
+    return true;
+}
+
+///Adds the 4 bytes of b to the 4 bytes of a, without carry from one byte to the next
+inline U32
+addBytes(U32 a,U32 b)
+{
+    return ((a & 0x7f7f7f7fU) + (b & 0x7f7f7f7fU)) ^ ((a ^ b) & 0x80808080U);
+}
+
+///Undoes the delta filter applied by compressSlice: each channel is independent from the others
+void
+undoDeltaFilter(unsigned char* dst,std::size_t size,int pixelSize)
+{
+    std::size_t i = pixelSize;
+    if (pixelSize % sizeof(U32) == 0) {
+        ///the channels of 4 bytes are processed at once
+        std::size_t lag = pixelSize / sizeof(U32);
+        std::size_t wordsCount = size / sizeof(U32);
+        for (std::size_t w = lag; w < wordsCount; ++w) {
+            U32 cur,prev;
+            std::memcpy(&cur, dst + w * sizeof(U32), sizeof(U32));
+            std::memcpy(&prev, dst + (w - lag) * sizeof(U32), sizeof(U32));
+            cur = addBytes(cur, prev);
+            std::memcpy(dst + w * sizeof(U32), &cur, sizeof(U32));
+        }
+        i = std::max(i, wordsCount * sizeof(U32));
+    }
+    for (; i < size; ++i) {
+        dst[i] = (unsigned char)(dst[i] + dst[i - pixelSize]);
+    }
+}
+
+struct CompressSliceFunctor
+{
+    typedef void result_type;
+
+    const unsigned char* src;
+    std::size_t size;
+    int pixelSize;
+    std::vector<std::vector<unsigned char> >* slices;
+
+    void operator()(const int& i) const
+    {
+        std::size_t offset = (std::size_t)i * NATRON_COMPRESSED_BUFFER_SLICE_SIZE;
+        std::size_t sliceSize = std::min((std::size_t)NATRON_COMPRESSED_BUFFER_SLICE_SIZE, size - offset);
+        std::vector<unsigned char> tmp(CompressedBuffer::compressBound(sliceSize));
+        std::size_t compressedSize = CompressedBuffer::compressSlice(src + offset, sliceSize, pixelSize, &tmp[0]);
+        ///do not keep the unused capacity
+        std::vector<unsigned char>(tmp.begin(), tmp.begin() + compressedSize).swap((*slices)[i]);
+    }
+};
+
+struct DecompressSliceFunctor
+{
+    typedef void result_type;
+
+    const std::vector<std::vector<unsigned char> >* slices;
+    std::size_t size;
+    int pixelSize;
+    unsigned char* dst;
+    bool* failed; //< each slice writes only if it fails
+
+    void operator()(const int& i) const
+    {
+        std::size_t offset = (std::size_t)i * NATRON_COMPRESSED_BUFFER_SLICE_SIZE;
+        std::size_t sliceSize = std::min((std::size_t)NATRON_COMPRESSED_BUFFER_SLICE_SIZE, size - offset);
+        const std::vector<unsigned char>& slice = (*slices)[i];
+        if (slice.empty() || !CompressedBuffer::decompressSlice(&slice[0], slice.size(), pixelSize, dst + offset, sliceSize)) {
+            *failed = true;
+        }
+    }
+};
+
+} // anon namespace
+
+CompressedBuffer::CompressedBuffer()
+: _slices()
+, _size(0)
+, _pixelSize(1)
+{
+}
+
+CompressedBuffer::~CompressedBuffer()
+{
+}
+
+std::size_t
+CompressedBuffer::compressBound(std::size_t size)
+{
+    return size + size / 255 + 16;
+}
+
+std::size_t
+CompressedBuffer::compressSlice(const unsigned char* src,std::size_t size,int pixelSize,unsigned char* dst)
+{
+    assert(pixelSize > 0);
+    ///replace each byte by its difference with the same channel of the previous pixel
+    std::vector<unsigned char> delta(size + 1);
+    std::size_t head = std::min((std::size_t)pixelSize, size);
+    std::memcpy(&delta[0], src, head);
+    for (std::size_t i = head; i < size; ++i) {
+        delta[i] = (unsigned char)(src[i] - src[i - pixelSize]);
+    }
+    const unsigned char* in = &delta[0];
+
+    ///positions + 1 of the last occurence of the hashed 4 bytes sequences, 0 means none
+    std::vector<U32> table(1 << NATRON_COMPRESSED_BUFFER_HASH_LOG, 0);
+    unsigned char* op = dst;
+    std::size_t anchor = 0;
+    std::size_t i = 0;
+    while (i + NATRON_COMPRESSED_BUFFER_MIN_MATCH <= size) {
+        U32 sequence = read32(in + i);
+        U32 hash = (sequence * 2654435761U) >> (32 - NATRON_COMPRESSED_BUFFER_HASH_LOG);
+        std::size_t ref = table[hash];
+        table[hash] = (U32)(i + 1);
+        if (ref > 0 && i - (ref - 1) <= NATRON_COMPRESSED_BUFFER_MAX_OFFSET && read32(in + ref - 1) == sequence) {
+            std::size_t matchPos = ref - 1;
+            std::size_t matchLength = NATRON_COMPRESSED_BUFFER_MIN_MATCH;
+            while (i + matchLength < size && in[matchPos + matchLength] == in[i + matchLength]) {
+                ++matchLength;
+            }
+            op = writeSequence(op, in + anchor, i - anchor, i - matchPos, matchLength);
+            i += matchLength;
+            anchor = i;
+        } else {
+            ++i;
+        }
+    }
+    op = writeSequence(op, in + anchor, size - anchor, 0, 0);
+    return op - dst;
+}
+
+bool
+CompressedBuffer::decompressSlice(const unsigned char* src,std::size_t srcSize,int pixelSize,
+                                  unsigned char* dst,std::size_t dstSize)
+{
+    assert(pixelSize > 0);
+    const unsigned char* ip = src;
+    const unsigned char* iend = src + srcSize;
+    std::size_t op = 0;
+    for (;;) {
+        if (ip >= iend) {
+            return false;
+        }
+        unsigned char token = *ip++;
+        std::size_t literalsCount = token >> 4;
+        if (literalsCount == 15 && !readLength(&ip, iend, &literalsCount)) {
+            return false;
+        }
+        if (literalsCount > dstSize - op || literalsCount > (std::size_t)(iend - ip)) {
+            return false;
+        }
+        std::memcpy(dst + op, ip, literalsCount);
+        ip += literalsCount;
+        op += literalsCount;
+        if (op == dstSize) {
+            break;
+        }
+
+        if (iend - ip < 2) {
+            return false;
+        }
+        std::size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        std::size_t matchLength = token & 15;
+        if (matchLength == 15 && !readLength(&ip, iend, &matchLength)) {
+            return false;
+        }
+        matchLength += NATRON_COMPRESSED_BUFFER_MIN_MATCH;
+        if (offset == 0 || offset > op || matchLength > dstSize - op) {
+            return false;
+        }
+        unsigned char* out = dst + op;
+        if (offset >= matchLength) {
+            std::memcpy(out, out - offset, matchLength);
+        } else {
+            ///Overlapping copy, e.g a run of the same byte: the bytes written so far repeat with a period of offset,
+            ///so each copy can reach back a multiple of offset, doubling the size of the next copy.
+            std::size_t k = 0;
+            while (k < matchLength) {
+                std::size_t distance = ((k + offset) / offset) * offset;
+                std::size_t n = std::min(distance, matchLength - k);
+                std::memcpy(out + k, out + k - distance, n);
+                k += n;
+            }
+        }
+        op += matchLength;
+    }
+
+    undoDeltaFilter(dst, dstSize, pixelSize);
+    return ip == iend;
+}
+
+bool
+CompressedBuffer::compress(const unsigned char* src,std::size_t size,int pixelSize,double maxRatio)
+{
+    clear();
+    int slicesCount = (int)((size + NATRON_COMPRESSED_BUFFER_SLICE_SIZE - 1) / NATRON_COMPRESSED_BUFFER_SLICE_SIZE);
+    _slices.resize(slicesCount);
+    std::vector<int> indexes(slicesCount);
+    for (int i = 0; i < slicesCount; ++i) {
+        indexes[i] = i;
+    }
+    CompressSliceFunctor f;
+    f.src = src;
+    f.size = size;
+    f.pixelSize = pixelSize;
+    f.slices = &_slices;
+    QtConcurrent::blockingMap(indexes, f);
+
+    _size = size;
+    _pixelSize = pixelSize;
+    if ((double)getCompressedSize() > maxRatio * (double)size) {
+        clear();
+        return false;
+    }
+    return true;
+}
+
+bool
+CompressedBuffer::decompress(unsigned char* dst) const
+{
+    if (_slices.empty()) {
+        return false;
+    }
+    std::vector<int> indexes(_slices.size());
+    for (U32 i = 0; i < indexes.size(); ++i) {
+        indexes[i] = i;
+    }
+    bool failed = false;
+    DecompressSliceFunctor f;
+    f.slices = &_slices;
+    f.size = _size;
+    f.pixelSize = _pixelSize;
+    f.dst = dst;
+    f.failed = &failed;
+    QtConcurrent::blockingMap(indexes, f);
+    return !failed;
+}
+
+std::size_t
+CompressedBuffer::getCompressedSize() const
+{
+    std::size_t ret = 0;
+    for (U32 i = 0; i < _slices.size(); ++i) {
+        ret += _slices[i].size();
+    }
+    return ret;
+}
+
+void
+CompressedBuffer::clear()
+{
+    _slices.clear();
+    _size = 0;
+}
@@ -0,0 +1,85 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef NATRON_ENGINE_COMPRESSEDBUFFER_H_
+#define NATRON_ENGINE_COMPRESSEDBUFFER_H_
+
+#include <cstddef>
+#include <vector>
+
+#include "Global/Macros.h"
+
+#ifndef Q_MOC_RUN
+#include <boost/noncopyable.hpp>
+#endif
+
+///The size of the independently compressed slices of a buffer, a multiple of all the possible pixel sizes
+#define NATRON_COMPRESSED_BUFFER_SLICE_SIZE (256 * 1024)
+
+namespace Natron {
+
+/**
+ * @brief A losslessly compressed copy of a buffer of pixels, used to keep more frames in RAM than
+ * their uncompressed size would allow.
+ * The pixels are first replaced by their difference with the previous pixel (channel by channel), which turns
+ * flat areas and smooth gradients into repeated patterns, and then compressed with a byte-oriented LZ77 scheme
+ * in the spirit of LZ4: no entropy coding, so that decompression is a sequence of memory copies.
+ * The buffer is cut in slices of NATRON_COMPRESSED_BUFFER_SLICE_SIZE bytes which are compressed
+ * and decompressed independently, in parallel.
+ **/
+class CompressedBuffer
+    : boost::noncopyable
+{
+public:
+
+    CompressedBuffer();
+
+    ~CompressedBuffer();
+
+    /**
+     * @brief Compresses size bytes of src. pixelSize is the number of bytes of a pixel, e.g 4 for 8-bit BGRA.
+     * If the compressed size would exceed maxRatio * size, nothing is kept and false is returned.
+     **/
+    bool compress(const unsigned char* src,std::size_t size,int pixelSize,double maxRatio = 1.) WARN_UNUSED_RETURN;
+
+    /**
+     * @brief Decompresses the buffer into dst which must hold getUncompressedSize() bytes.
+     * Returns false if the buffer is empty or corrupted.
+     **/
+    bool decompress(unsigned char* dst) const WARN_UNUSED_RETURN;
+
+    std::size_t getUncompressedSize() const WARN_UNUSED_RETURN { return _size; }
+
+    std::size_t getCompressedSize() const WARN_UNUSED_RETURN;
+
+    bool isEmpty() const WARN_UNUSED_RETURN { return _slices.empty(); }
+
+    void clear();
+
+    /**
+     * @brief Compresses a single slice, returns the number of bytes written to dst which must be able to hold
+     * compressBound(size) bytes.
+     **/
+    static std::size_t compressSlice(const unsigned char* src,std::size_t size,int pixelSize,unsigned char* dst) WARN_UNUSED_RETURN;
+
+    /**
+     * @brief Decompresses a single slice of exactly dstSize bytes. Returns false if src is corrupted.
+     **/
+    static bool decompressSlice(const unsigned char* src,std::size_t srcSize,int pixelSize,
+                                unsigned char* dst,std::size_t dstSize) WARN_UNUSED_RETURN;
+
+    static std::size_t compressBound(std::size_t size) WARN_UNUSED_RETURN;
+
+private:
+
+    std::vector<std::vector<unsigned char> > _slices;
+    std::size_t _size;
+    int _pixelSize;
+};
+
+} // namespace Natron
+
+#endif // NATRON_ENGINE_COMPRESSEDBUFFER_H_
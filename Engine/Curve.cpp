@@ -12,6 +12,7 @@
 #include "Curve.h"
 
 #include <algorithm>
+#include <limits>
 #include <stdexcept>
 #include <boost/math/special_functions/fpclassify.hpp>
 
@@ -224,6 +225,7 @@ void Curve::clearKeyFrames()
 {
     QWriteLocker l(&_imp->_lock);
     _imp->keyFrames.clear();
+    refreshSegments();
 }
 
 
@@ -239,6 +241,7 @@ void Curve::clone(const Curve& other)
     QWriteLocker l(&_imp->_lock);
     _imp->keyFrames.clear();
     std::transform(otherKeys.begin(), otherKeys.end(), std::inserter(_imp->keyFrames, _imp->keyFrames.begin()), KeyFrameCloner());
+    refreshSegments();
 }
 
 void Curve::clone(const Curve& other, SequenceTime offset, const RangeD* range)
@@ -260,6 +263,7 @@ void Curve::clone(const Curve& other, SequenceTime offset, const RangeD* range)
         }
         _imp->keyFrames.insert(k);
     }
+    refreshSegments();
 }
 
 
@@ -291,6 +295,7 @@ bool Curve::addKeyFrame(KeyFrame key)
     std::pair<KeyFrameSet::iterator,bool> it = addKeyFrameNoUpdate(key);
     
     it.first = evaluateCurveChanged(KEYFRAME_CHANGED,it.first);
+    refreshSegments();
     l.unlock();
     ///This call must not be locked!
     if (_imp->owner) {
@@ -369,6 +374,7 @@ void Curve::removeKeyFrameWithIndex(int index)
 {
     QWriteLocker l(&_imp->_lock);
     removeKeyFrame(atIndex(index));
+    refreshSegments();
 }
 
 void Curve::removeKeyFrameWithTime(double time)
@@ -381,6 +387,7 @@ void Curve::removeKeyFrameWithTime(double time)
     }
 
     removeKeyFrame(it);
+    refreshSegments();
 }
 
 bool Curve::getKeyFrameWithIndex(int index, KeyFrame* k) const
@@ -572,44 +579,85 @@ double Curve::getValueAt(double t) const
     if (_imp->keyFrames.empty()) {
         throw std::runtime_error("Curve has no control points!");
     }
+    assert(_imp->segments.size() == _imp->keyFrames.size() + 1);
 
     // even when there is only one keyframe, there may be tangents!
-    //if (_imp->keyFrames.size() == 1) {
-    //    //if there's only 1 keyframe, don't bother interpolating
-    //    return (*_imp->keyFrames.begin()).getValue();
-    //}
-    double tcur,tnext;
-    double vcurDerivRight ,vnextDerivLeft ,vcur ,vnext ;
-    Natron::KeyframeType interp ,interpNext;
-
-    KeyFrame k(t,0.);
-    // find the first keyframe with time greater than t
-    KeyFrameSet::const_iterator itup;
-    itup = _imp->keyFrames.upper_bound(k);
-    interParams(_imp->keyFrames,
-                t,
-                itup,
-                &tcur,
-                &vcur,
-                &vcurDerivRight,
-                &interp,
-                &tnext,
-                &vnext,
-                &vnextDerivLeft,
-                &interpNext);
-
-    double v = Natron::interpolate(tcur,vcur,
-                                   vcurDerivRight,
-                                   vnextDerivLeft,
-                                   tnext,vnext,
-                                   t,
-                                   interp,
-                                   interpNext);
+    // find the last segment starting before t, the first segment always starts at -infinity
+    std::vector<CurveSegment>::const_iterator it = std::upper_bound(_imp->segments.begin() + 1, _imp->segments.end(),
+                                                                    t, CurveSegment_compare_start());
+    --it;
+    double v = it->evaluate(t);
 
     if (mustClamp()) {
         v = clampValueToCurveYRange(v);
     }
 
+    return roundValueToCurveType(v);
+}
+
+void Curve::getValuesAt(const std::vector<double>& times,std::vector<double>* values) const
+{
+    assert(values);
+    QReadLocker l(&_imp->_lock);
+    
+    if (_imp->keyFrames.empty()) {
+        throw std::runtime_error("Curve has no control points!");
+    }
+    assert(_imp->segments.size() == _imp->keyFrames.size() + 1);
+    
+    bool clamp = mustClamp();
+    std::pair<double,double> minmax;
+    if (clamp) {
+        minmax = getCurveYRange();
+    }
+    
+    const std::vector<CurveSegment>& segments = _imp->segments;
+    values->resize(times.size());
+    std::vector<CurveSegment>::size_type s = 0;
+    for (std::vector<double>::size_type i = 0; i < times.size(); ++i) {
+        const double t = times[i];
+        assert(i == 0 || times[i - 1] <= t);
+        while (s + 1 < segments.size() && segments[s + 1].start <= t) {
+            ++s;
+        }
+        double v = segments[s].evaluate(t);
+        if (clamp) {
+            v = std::max(minmax.first,std::min(v,minmax.second));
+        }
+        (*values)[i] = roundValueToCurveType(v);
+    }
+}
+
+boost::shared_ptr<const CurveTable> Curve::getTable() const
+{
+    QReadLocker l(&_imp->_lock);
+    QMutexLocker tl(&_imp->tableMutex);
+    if (_imp->table) {
+        return _imp->table;
+    }
+    
+    if (_imp->keyFrames.empty() || _imp->xMin <= INT_MIN || _imp->xMax >= INT_MAX || _imp->xMax <= _imp->xMin) {
+        return boost::shared_ptr<const CurveTable>();
+    }
+    for (KeyFrameSet::const_iterator it = _imp->keyFrames.begin(); it != _imp->keyFrames.end(); ++it) {
+        if (it->getInterpolation() == Natron::KEYFRAME_CONSTANT) {
+            return boost::shared_ptr<const CurveTable>();
+        }
+    }
+    
+    std::vector<double> times(NATRON_CURVE_TABLE_SIZE);
+    for (int i = 0; i < NATRON_CURVE_TABLE_SIZE; ++i) {
+        times[i] = _imp->xMin + (_imp->xMax - _imp->xMin) * i / (NATRON_CURVE_TABLE_SIZE - 1);
+    }
+    std::vector<double> values;
+    getValuesAt(times, &values);
+    _imp->table.reset(new CurveTable(_imp->xMin, _imp->xMax, values));
+    return _imp->table;
+}
+
+double Curve::roundValueToCurveType(double v) const
+{
+    // PRIVATE - should not lock
     switch (_imp->type) {
         case CurvePrivate::STRING_CURVE:
         case CurvePrivate::INT_CURVE:
@@ -623,6 +671,61 @@ double Curve::getValueAt(double t) const
     }
 }
 
+void Curve::refreshSegments()
+{
+    // PRIVATE - should not lock
+    _imp->table.reset();
+    _imp->segments.clear();
+    if (_imp->keyFrames.empty()) {
+        return;
+    }
+    _imp->segments.reserve(_imp->keyFrames.size() + 1);
+    
+    ///segment i goes from keyframe i-1 to keyframe i
+    KeyFrameSet::const_iterator itup = _imp->keyFrames.begin();
+    for (;;) {
+        double t;
+        CurveSegment segment;
+        if (itup == _imp->keyFrames.begin()) {
+            t = itup->getTime() - 1.;
+            segment.start = -std::numeric_limits<double>::infinity();
+        } else {
+            KeyFrameSet::const_iterator prev = itup;
+            --prev;
+            t = prev->getTime();
+            segment.start = t;
+        }
+        
+        double tcur,tnext;
+        double vcurDerivRight ,vnextDerivLeft ,vcur ,vnext ;
+        Natron::KeyframeType interp ,interpNext;
+        interParams(_imp->keyFrames,
+                    t,
+                    itup,
+                    &tcur,
+                    &vcur,
+                    &vcurDerivRight,
+                    &interp,
+                    &tnext,
+                    &vnext,
+                    &vnextDerivLeft,
+                    &interpNext);
+        Natron::interpolationCoefficients(tcur, vcur,
+                                          vcurDerivRight,
+                                          vnextDerivLeft,
+                                          tnext, vnext,
+                                          interp,
+                                          interpNext,
+                                          &segment.t0, &segment.t1, segment.c);
+        _imp->segments.push_back(segment);
+        
+        if (itup == _imp->keyFrames.end()) {
+            break;
+        }
+        ++itup;
+    }
+}
+
 double Curve::getDerivativeAt(double t) const
 {
     QReadLocker l(&_imp->_lock);
@@ -835,6 +938,7 @@ void Curve::setXRange(double a,double b)
     QWriteLocker l(&_imp->_lock);
     _imp->xMin = a;
     _imp->xMax = b;
+    _imp->table.reset();
 }
 
 std::pair<double,double> Curve::getXRange() const
@@ -884,6 +988,7 @@ KeyFrame Curve::setKeyFrameValueAndTime(double time,double value,int index,int*
         if (setTime || setValue) {
             it = setKeyFrameValueAndTimeNoUpdate(value,time, it);
             it = evaluateCurveChanged(KEYFRAME_CHANGED,it);
+            refreshSegments();
             evaluateAnimation = true;
         }
         if (newIndex) {
@@ -916,6 +1021,7 @@ KeyFrame Curve::setKeyFrameLeftDerivative(double value,int index,int* newIndex)
             newKey.setLeftDerivative(value);
             it = addKeyFrameNoUpdate(newKey).first;
             it = evaluateCurveChanged(DERIVATIVES_CHANGED,it);
+            refreshSegments();
             evaluateAnimation = true;
         }
         if (newIndex) {
@@ -946,6 +1052,7 @@ KeyFrame Curve::setKeyFrameRightDerivative(double value,int index,int* newIndex)
             newKey.setRightDerivative(value);
             it = addKeyFrameNoUpdate(newKey).first;
             it = evaluateCurveChanged(DERIVATIVES_CHANGED,it);
+            refreshSegments();
             evaluateAnimation = true;
         }
         if (newIndex) {
@@ -976,6 +1083,7 @@ KeyFrame Curve::setKeyFrameDerivatives(double left, double right,int index,int*
             newKey.setRightDerivative(right);
             it = addKeyFrameNoUpdate(newKey).first;
             it = evaluateCurveChanged(DERIVATIVES_CHANGED,it);
+            refreshSegments();
             evaluateAnimation = true;
             
         }
@@ -1010,6 +1118,7 @@ KeyFrame Curve::setKeyFrameInterpolation(Natron::KeyframeType interp,int index,i
         
         if (interp != it->getInterpolation()) {
             it = setKeyframeInterpolation_internal(it, interp);
+            refreshSegments();
         }
         if (newIndex) {
             *newIndex = std::distance(_imp->keyFrames.begin(),it);
@@ -1042,6 +1151,9 @@ void Curve::setCurveInterpolation(Natron::KeyframeType interp)
                 evaluateAnimation = true;
             }
         }
+        if (evaluateAnimation) {
+            refreshSegments();
+        }
     }
     if (evaluateAnimation && _imp->owner) {
         _imp->owner->evaluateAnimationChange();
@@ -1248,10 +1360,11 @@ bool Curve::areKeyFramesValuesClampedToBooleans() const
 
 void Curve::setYRange(double yMin, double yMax)
 {
-    QReadLocker l(&_imp->_lock);
+    QWriteLocker l(&_imp->_lock);
     _imp->yMin = yMin;
     _imp->yMax = yMax;
     _imp->hasYRange = true;
+    _imp->table.reset();
 }
 
 bool Curve::hasYRange() const
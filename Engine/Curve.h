@@ -14,6 +14,7 @@
 
 #include <vector>
 #include <map>
+#include <algorithm>
 
 #include "Global/Macros.h"
 #include <boost/scoped_ptr.hpp>
@@ -118,6 +119,48 @@ class KnobI;
 struct CurvePrivate;
 class RectD;
 
+///The number of samples of a CurveTable
+#define NATRON_CURVE_TABLE_SIZE 4096
+
+/**
+ * @brief A curve sampled at NATRON_CURVE_TABLE_SIZE regularly spaced positions of its x range, see Curve::getTable.
+ * It is immutable, hence it can be read without any lock. Between two samples the value is linearly interpolated:
+ * plug-ins evaluating parametric parameters per pixel read it instead of locking and evaluating the curve.
+ **/
+class CurveTable
+{
+public:
+
+    CurveTable(double xMin,double xMax,const std::vector<double>& values)
+    : _xMin(xMin)
+    , _xMax(xMax)
+    , _scale((double)(values.size() - 1) / (xMax - xMin))
+    , _values(values)
+    {
+    }
+
+    /**
+     * @brief Returns false if x is outside of the range of the table.
+     **/
+    bool getValueAt(double x,double* value) const WARN_UNUSED_RETURN
+    {
+        if (!(x >= _xMin && x <= _xMax)) {
+            return false;
+        }
+        double pos = (x - _xMin) * _scale;
+        std::size_t i = std::min((std::size_t)pos, _values.size() - 2);
+        double v0 = _values[i];
+        *value = v0 + (_values[i + 1] - v0) * (pos - (double)i);
+        return true;
+    }
+
+private:
+
+    double _xMin,_xMax;
+    double _scale; //< samples per unit of x
+    std::vector<double> _values;
+};
+
 class Curve
 {
     friend class boost::serialization::access;
@@ -207,6 +250,20 @@ public:
     double getMaximumTimeCovered() const WARN_UNUSED_RETURN;
 
     double getValueAt(double t) const WARN_UNUSED_RETURN;
+    
+    /**
+     * @brief Same as getValueAt for each of the given times, which must be sorted by increasing order.
+     * The curve is locked once and the segments are walked linearly: this is much faster than calling
+     * getValueAt for each time when sampling a range, e.g: to draw the curve.
+     **/
+    void getValuesAt(const std::vector<double>& times,std::vector<double>* values) const;
+    
+    /**
+     * @brief Returns the curve sampled over its x range, which is built on the first call after the curve changed.
+     * Returns NULL if the curve cannot be sampled: it has no keyframes, its x range is not bounded (it is only
+     * set for parametric curves), or a keyframe has a constant interpolation whose steps would be smoothed.
+     **/
+    boost::shared_ptr<const CurveTable> getTable() const WARN_UNUSED_RETURN;
 
     double getDerivativeAt(double t) const WARN_UNUSED_RETURN;
 
@@ -275,6 +332,12 @@ private:
     void removeKeyFrame(KeyFrameSet::const_iterator it);
 
     double clampValueToCurveYRange(double v) const WARN_UNUSED_RETURN;
+    
+    ///rounds the interpolated value v depending on the type of the curve (int, bool...)
+    double roundValueToCurveType(double v) const WARN_UNUSED_RETURN;
+    
+    ///rebuilds the segments from the keyframes, must be called with the write lock held every time the keyframes change
+    void refreshSegments();
 
     ///returns an iterator to the new keyframe in the keyframe set and
     ///a boolean indicating whether it removed a keyframe already existing at this time or not
@@ -11,8 +11,10 @@
 #ifndef NATRON_ENGINE_CURVEPRIVATE_H_
 #define NATRON_ENGINE_CURVEPRIVATE_H_
 
+#include <vector>
 #include <boost/shared_ptr.hpp>
 #include <QReadWriteLock>
+#include <QMutex>
 
 #include "Engine/Rect.h"
 #include "Engine/Variant.h"
@@ -24,6 +26,34 @@ class Curve;
 class KeyFrame;
 class KnobI;
 
+/**
+ * @brief The cubic interpolating a curve between 2 consecutive keyframes, as computed by Natron::interpolationCoefficients.
+ * A curve with N keyframes has N+1 segments: the first one extrapolates the curve before the first keyframe
+ * and the last one after the last keyframe.
+ **/
+struct CurveSegment
+{
+    double start; //< the segment is used for times in [start, start of the next segment[
+    double t0,t1; //< times are normalized to this interval before evaluating the cubic
+    double c[4];
+    
+    double evaluate(double t) const
+    {
+        const double x = (t - t0) / (t1 - t0);
+        const double x2 = x * x;
+        const double x3 = x2 * x;
+        return c[0] + c[1] * x + c[2] * x2 + c[3] * x3;
+    }
+};
+
+struct CurveSegment_compare_start
+{
+    bool operator() (double t,const CurveSegment& s) const
+    {
+        return t < s.start;
+    }
+};
+
 struct CurvePrivate{
     
     enum CurveType{
@@ -36,6 +66,11 @@ struct CurvePrivate{
     };
 
     KeyFrameSet keyFrames;
+    
+    ///The segments of the curve, contiguous in memory and sorted by time. They are rebuilt from keyFrames
+    ///by Curve::refreshSegments() whenever the keyframes change so that evaluating the curve does not walk
+    ///the keyframes set nor recompute the Hermite coefficients.
+    std::vector<CurveSegment> segments;
 
     KnobI* owner;
     bool isParametric;
@@ -45,9 +80,14 @@ struct CurvePrivate{
     bool hasYRange;
     mutable QReadWriteLock _lock; //< the plug-ins can call getValueAt at any moment and we must make sure the user is not playing around
     
+    ///Built on demand by Curve::getTable, reset whenever the curve changes (under the write lock)
+    mutable boost::shared_ptr<const CurveTable> table;
+    mutable QMutex tableMutex; //< protects the creation of table by the readers
+    
     
     CurvePrivate()
     : keyFrames()
+    , segments()
     , owner(NULL)
     , isParametric(false)
     , type(DOUBLE_CURVE)
@@ -57,6 +97,8 @@ struct CurvePrivate{
     , yMax(INT_MAX)
     , hasYRange(false)
     , _lock(QReadWriteLock::Recursive)
+    , table()
+    , tableMutex()
     {}
     
     CurvePrivate(const CurvePrivate& other)
@@ -67,6 +109,7 @@ struct CurvePrivate{
     
     void operator=(const CurvePrivate& other) {
         keyFrames = other.keyFrames;
+        segments = other.segments;
         owner = other.owner;
         isParametric = other.isParametric;
         type = other.type;
@@ -75,6 +118,7 @@ struct CurvePrivate{
         yMin = other.yMin;
         yMax = other.yMax;
         hasYRange = other.hasYRange;
+        table = other.table;
     }
 };
 
@@ -20,6 +20,8 @@ CLANG_DIAG_OFF(unused-parameter)
 #include <boost/archive/xml_iarchive.hpp>
 CLANG_DIAG_ON(unused-parameter)
 #include <boost/archive/xml_oarchive.hpp>
+#include <boost/archive/binary_iarchive.hpp>
+#include <boost/archive/binary_oarchive.hpp>
 #include <boost/serialization/shared_ptr.hpp>
 #include <boost/serialization/set.hpp>
 #include <boost/serialization/scoped_ptr.hpp>
@@ -34,6 +36,9 @@ void Curve::serialize(Archive & ar, const unsigned int version)
     (void)version;
     QReadLocker l(&_imp->_lock);
     ar & boost::serialization::make_nvp("KeyFrameSet",_imp->keyFrames);
+    if (Archive::is_loading::value) {
+        refreshSegments();
+    }
 }
 
 
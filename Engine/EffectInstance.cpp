@@ -11,7 +11,10 @@
 
 #include "EffectInstance.h"
 
+#include <algorithm>
+#include <map>
 #include <sstream>
+#include <vector>
 #include <QtConcurrentMap>
 #include <QReadWriteLock>
 #include <QCoreApplication>
@@ -37,10 +40,19 @@
 #include "Engine/BlockingBackgroundRender.h"
 #include "Engine/AppInstance.h"
 #include "Engine/ThreadStorage.h"
+#include "Engine/KnobsSnapshot.h"
 #include "Engine/Settings.h"
 #include "Engine/RotoContext.h"
+#include "Engine/NUMA.h"
+#include "Engine/ActionsCache.h"
+#include "Engine/WriteQueue.h"
 using namespace Natron;
 
+///The number of times for which the snapshots of the knobs of an effect are kept, @see getKnobsSnapshot
+#define NATRON_KNOBS_SNAPSHOTS_MAX 16
+
+///How many rows of a rendered tile are sampled to find out whether its memory is on the node of the thread
+#define NATRON_NUMA_LOCALITY_SAMPLED_ROWS 8
 
 class File_Knob;
 class OutputFile_Knob;
@@ -61,6 +73,83 @@ OutputImageLocker::~OutputImageLocker()
 
 
 
+namespace {
+    
+/**
+ * @brief Gives back a clone obtained with Node::acquireRenderClone to the node when it is destroyed.
+ **/
+class RenderCloneReleaser {
+    Natron::Node* _node;
+    EffectInstance* _clone;
+public:
+    
+    RenderCloneReleaser(Natron::Node* node,EffectInstance* clone)
+    : _node(node)
+    , _clone(clone)
+    {
+    }
+    
+    ~RenderCloneReleaser()
+    {
+        if (_clone) {
+            _node->releaseRenderClone(_clone);
+        }
+    }
+    
+    EffectInstance* get() const { return _clone; }
+};
+
+/**
+ * @brief If the image of the given effect is an identity, renders the image it is an alias of and returns true.
+ * The identity effects in-between are skipped: no action is called on them.
+ **/
+bool
+renderIdentityAlias(EffectInstance* effect,const EffectInstance::RenderRoIArgs& args,U64 nodeHash,
+                    boost::shared_ptr<Natron::Image>* image)
+{
+    boost::shared_ptr<Natron::Node> inputNode;
+    SequenceTime inputTime;
+    if (!appPTR->resolveIdentityAlias(nodeHash, args.time, args.mipMapLevel, args.view, &inputNode, &inputTime)) {
+        return false;
+    }
+    EffectInstance* input = inputNode->getLiveInstance();
+    EffectInstance::RenderRoIArgs inputArgs = args;
+    inputArgs.time = inputTime;
+    inputArgs.preComputedRoD = NULL;
+    if (input != effect) {
+        ///like getImage does for the input of an identity, fetch the image in the preferred format of the input
+        input->getPreferredDepthAndComponents(-1, &inputArgs.components, &inputArgs.bitdepth);
+        inputArgs.channelForAlpha = 3;
+    }
+    *image = input->renderRoI(inputArgs);
+    return true;
+}
+
+/**
+ * @brief Returns the image in the bit depth requested by the caller of renderRoI. Images are stored as half in the
+ * cache if the project asks for it: only the RoI of the caller is converted, into an image bounded to it.
+ **/
+boost::shared_ptr<Natron::Image>
+convertToRequestedDepth(AppInstance* app,const EffectInstance::RenderRoIArgs& args,const boost::shared_ptr<Natron::Image>& image)
+{
+    if (!image || image->getBitDepth() == args.bitdepth) {
+        return image;
+    }
+    RectI bounds;
+    if (!args.roi.intersect(image->getPixelRoD(), &bounds) || bounds.isNull()) {
+        bounds = image->getPixelRoD();
+    }
+    boost::shared_ptr<Natron::Image> convertedImage(new Natron::Image(args.components,image->getRoD(),bounds,
+                                                                      image->getMipMapLevel(),args.bitdepth));
+    image->convertToFormat(bounds, convertedImage.get(),
+                           app->getDefaultColorSpaceForBitDepth(image->getBitDepth()),
+                           app->getDefaultColorSpaceForBitDepth(args.bitdepth),
+                           args.channelForAlpha,false, true);
+    return convertedImage;
+}
+    
+}
+
 struct EffectInstance::RenderArgs {
     RectI _roi; //< The RoI in PIXEL coordinates
     RoIMap _regionOfInterestResults; //< the input RoI's in CANONICAL coordinates
@@ -113,6 +202,11 @@ struct EffectInstance::Implementation {
     , duringInteractAction(false)
     , pluginMemoryChunksMutex()
     , pluginMemoryChunks()
+    , knobsSnapshot()
+    , knobsSnapshotsMutex()
+    , knobsSnapshotsHash(0)
+    , knobsSnapshots()
+    , actionsCache()
     {
     }
 
@@ -136,6 +230,67 @@ struct EffectInstance::Implementation {
     mutable QMutex pluginMemoryChunksMutex;
     std::list<PluginMemory*> pluginMemoryChunks;
     
+    ///The snapshot of the knobs used by the render running in this thread, @see KnobHolder::getKnobsSnapshot
+    ThreadStorage< boost::shared_ptr<const KnobsSnapshot> > knobsSnapshot;
+    
+    QMutex knobsSnapshotsMutex; //< protects knobsSnapshotsHash and knobsSnapshots
+    U64 knobsSnapshotsHash; //< the node hash of the snapshots in knobsSnapshots
+    std::map<SequenceTime,boost::shared_ptr<const KnobsSnapshot> > knobsSnapshots; //< shared by the renders of the same time
+    
+    ///The results of the actions which only depend on the node hash and their arguments
+    Natron::ActionsCache actionsCache;
+    
+    /**
+     * @brief Returns the snapshot of the knobs for the given hash and time. The snapshots of the last hash are kept
+     * for the NATRON_KNOBS_SNAPSHOTS_MAX times closest to the last one asked for, so that renders of different
+     * frames in parallel do not evict each other's.
+     * The knobs are evaluated without holding the lock: 2 renders asking for the same missing snapshot at once
+     * may both evaluate it, the first one published is kept.
+     * If source is not NULL, the knobs are a render clone's and the values are copied from source, the snapshot of the
+     * instance rendering with the clone, instead of being evaluated.
+     **/
+    boost::shared_ptr<const KnobsSnapshot> getKnobsSnapshot(const std::vector< boost::shared_ptr<KnobI> >& knobs,
+                                                            U64 nodeHash,
+                                                            SequenceTime time,
+                                                            const KnobsSnapshot* source = NULL)
+    {
+        {
+            QMutexLocker l(&knobsSnapshotsMutex);
+            if (knobsSnapshotsHash == nodeHash) {
+                std::map<SequenceTime,boost::shared_ptr<const KnobsSnapshot> >::const_iterator found = knobsSnapshots.find(time);
+                if (found != knobsSnapshots.end()) {
+                    return found->second;
+                }
+            }
+        }
+        
+        boost::shared_ptr<KnobsSnapshot> snapshot;
+        if (source) {
+            snapshot.reset(new KnobsSnapshot(*source,knobs));
+        } else {
+            snapshot.reset(new KnobsSnapshot(nodeHash,time));
+            snapshot->addKnobs(knobs);
+        }
+        
+        QMutexLocker l(&knobsSnapshotsMutex);
+        if (knobsSnapshotsHash != nodeHash) {
+            knobsSnapshots.clear();
+            knobsSnapshotsHash = nodeHash;
+        }
+        std::pair<std::map<SequenceTime,boost::shared_ptr<const KnobsSnapshot> >::iterator,bool> inserted =
+        knobsSnapshots.insert(std::make_pair(time,boost::shared_ptr<const KnobsSnapshot>(snapshot)));
+        boost::shared_ptr<const KnobsSnapshot> ret = inserted.first->second;
+        while (knobsSnapshots.size() > NATRON_KNOBS_SNAPSHOTS_MAX) {
+            ///forget the snapshot of the time the farthest from this one
+            if (time - knobsSnapshots.begin()->first > knobsSnapshots.rbegin()->first - time) {
+                knobsSnapshots.erase(knobsSnapshots.begin());
+            } else {
+                knobsSnapshots.erase(--knobsSnapshots.end());
+            }
+        }
+        return ret;
+    }
+    
     void setDuringInteractAction(bool b) {
         QWriteLocker l(&duringInteractActionMutex);
         duringInteractAction = b;
@@ -265,6 +420,34 @@ struct EffectInstance::Implementation {
         const RenderArgs& getArgs() const { return args; }
     };
     
+    /**
+     * @brief Small helper class that sets the knobs snapshot of the calling thread and
+     * restores the previous one when it is destroyed (renders of the same effect may be nested).
+     **/
+    class ScopedKnobsSnapshot {
+        
+        ThreadStorage< boost::shared_ptr<const KnobsSnapshot> >* _dst;
+        boost::shared_ptr<const KnobsSnapshot> _previous;
+    public:
+        
+        ScopedKnobsSnapshot(ThreadStorage< boost::shared_ptr<const KnobsSnapshot> >* dst,
+                            const boost::shared_ptr<const KnobsSnapshot>& snapshot)
+        : _dst(dst)
+        , _previous()
+        {
+            assert(_dst);
+            if (_dst->hasLocalData()) {
+                _previous = _dst->localData();
+            }
+            _dst->setLocalData(snapshot);
+        }
+        
+        ~ScopedKnobsSnapshot()
+        {
+            _dst->setLocalData(_previous);
+        }
+    };
+    
     void addInputImageTempPointer(const boost::shared_ptr<Natron::Image>& img) {
         if (inputImages.hasLocalData()) {
             inputImages.localData().push_back(img);
@@ -321,6 +504,14 @@ U64 EffectInstance::hash() const
     return _node->getHashValue();
 }
 
+const KnobsSnapshot* EffectInstance::getKnobsSnapshot() const
+{
+    if (!_imp->knobsSnapshot.hasLocalData()) {
+        return NULL;
+    }
+    return _imp->knobsSnapshot.localData().get();
+}
+
 bool EffectInstance::getRenderHash(U64* hash) const
 {
     if (!_imp->renderArgs.hasLocalData() || !_imp->renderArgs.localData()._validArgs) {
@@ -801,6 +992,13 @@ boost::shared_ptr<Natron::Image> EffectInstance::renderRoI(const RenderRoIArgs&
     
 
     Natron::ImageKey key = Natron::Image::makeKey(nodeHash, args.time,args.mipMapLevel,args.view);
+    
+    ///The bit depth of the image kept in the cache: 32 bits floating point images are stored as half
+    ///if the project asks for it, and converted back when returned.
+    Natron::ImageBitDepth storageDepth = args.bitdepth;
+    if (args.bitdepth == Natron::IMAGE_FLOAT && getApp()->getProject()->isHalfFloatStorageEnabled()) {
+        storageDepth = Natron::IMAGE_HALF;
+    }
     {
         ///If the last rendered image had a different hash key (i.e a parameter changed or an input changed)
         ///just remove the old image from the cache to recycle memory.
@@ -827,6 +1025,14 @@ boost::shared_ptr<Natron::Image> EffectInstance::renderRoI(const RenderRoIArgs&
         }
     }
     
+    ///If this image is known to be an identity, render directly the first image upstream which is not
+    if (!byPassCache) {
+        boost::shared_ptr<Image> aliasedImage;
+        if (renderIdentityAlias(this, args, nodeHash, &aliasedImage)) {
+            return aliasedImage;
+        }
+    }
+    
     /// First-off look-up the cache and see if we can find the cached actions results and cached image.
     bool isCached = Natron::getImageFromCache(key, &cachedImgParams,&image);
     
@@ -839,7 +1045,15 @@ boost::shared_ptr<Natron::Image> EffectInstance::renderRoI(const RenderRoIArgs&
         
         imageLock.reset(new OutputImageLocker(_node.get(),image));
         
-        if (cachedImgParams->isRodProjectFormat()) {
+        if (cachedImgParams->getInputNbIdentity() != -1) {
+            ///Identities are no longer cached as empty images but recorded as aliases, this entry was restored
+            ///from the disk cache of a previous version: discard it
+            isCached = false;
+            appPTR->removeFromNodeCache(image);
+            cachedImgParams.reset();
+            imageLock.reset();
+            image.reset();
+        } else if (cachedImgParams->isRodProjectFormat()) {
             ////If the image was cached with a RoD dependent on the project format, but the project format changed,
             ////just discard this entry
             Format projectFormat;
@@ -853,18 +1067,18 @@ boost::shared_ptr<Natron::Image> EffectInstance::renderRoI(const RenderRoIArgs&
             }
         }
         
-        //Do the following only if we're not an identity
-        if (image && cachedImgParams->getInputNbIdentity() == -1) {
+        if (image) {
             ///If components are different but convertible without damage, or bit depth is different, keep this image, convert it
             ///and continue render on it. This is in theory still faster than ignoring the image and doing a full render again.
+            ///An image stored as half can be used as is, it is converted to float once rendered.
             if ((image->getComponents() != args.components && Image::hasEnoughDataToConvert(image->getComponents(),args.components)) ||
-                image->getBitDepth() != args.bitdepth) {
+                (image->getBitDepth() != args.bitdepth && image->getBitDepth() != storageDepth)) {
                 ///Convert the image to the requested components
-                boost::shared_ptr<Image> remappedImage(new Image(args.components,image->getRoD(),args.mipMapLevel,args.bitdepth));
+                boost::shared_ptr<Image> remappedImage(new Image(args.components,image->getRoD(),args.mipMapLevel,storageDepth));
                 if (!byPassCache) {
                     image->convertToFormat(image->getPixelRoD(), remappedImage.get(),
                                            getApp()->getDefaultColorSpaceForBitDepth(image->getBitDepth()),
-                                           getApp()->getDefaultColorSpaceForBitDepth(args.bitdepth),
+                                           getApp()->getDefaultColorSpaceForBitDepth(storageDepth),
                                            args.channelForAlpha,false, true);
                 }
                 ///switch the pointer
@@ -894,7 +1108,7 @@ boost::shared_ptr<Natron::Image> EffectInstance::renderRoI(const RenderRoIArgs&
     if (!isCached) {
         
         ///first-off check whether the effect is identity, in which case we don't want
-        /// to cache anything or render anything for this effect.
+        /// to cache anything or render anything for this effect: an alias to the image of the input is recorded instead.
         SequenceTime inputTimeIdentity = 0.;
         int inputNbIdentity;
         RectI rod;
@@ -909,7 +1123,20 @@ boost::shared_ptr<Natron::Image> EffectInstance::renderRoI(const RenderRoIArgs&
             ///The effect is an identity but it has no inputs
             if (inputNbIdentity == -1) {
                 return boost::shared_ptr<Natron::Image>();
-            } else if (inputNbIdentity == -2) {
+            }
+            
+            ///the effect whose image this image is
+            Natron::EffectInstance* aliasedEffect = inputNbIdentity == -2 ? this : input_other_thread(inputNbIdentity);
+            if (!byPassCache && aliasedEffect) {
+                appPTR->setIdentityAlias(nodeHash, args.time, args.mipMapLevel, args.view,
+                                         aliasedEffect->getNode(), aliasedEffect->hash(), inputTimeIdentity);
+                boost::shared_ptr<Image> aliasedImage;
+                if (renderIdentityAlias(this, args, nodeHash, &aliasedImage)) {
+                    return aliasedImage;
+                }
+            }
+            
+            if (inputNbIdentity == -2) {
                 ///This special value of -2 indicates that the plugin is identity of itself at another time
                 RenderRoIArgs argCpy = args;
                 argCpy.time = inputTimeIdentity;
@@ -944,14 +1171,8 @@ boost::shared_ptr<Natron::Image> EffectInstance::renderRoI(const RenderRoIArgs&
                     image = getImage(inputNbIdentity, inputTimeIdentity, args.scale, args.view, NULL, inputPrefComps, inputPrefDepth, true);
                     ///Clear input images pointer because getImage has stored the image .
                     _imp->clearInputImagePointers();
-                } else {
-                    return image;
-                }
-                
-                ///if we bypass the cache, don't cache the result of isIdentity
-                if (byPassCache) {
-                    return image;
                 }
+                return image;
             }
         } else {
             ///set it to -1 so the cache knows it's not an identity
@@ -983,23 +1204,17 @@ boost::shared_ptr<Natron::Image> EffectInstance::renderRoI(const RenderRoIArgs&
             cost = 1;
         }
         
-        if (identity) {
-            cost = -1;
-        }
-      
         
         ///Cache the image with the requested components instead of the remapped ones
         cachedImgParams = Natron::Image::makeParams(cost, rod,args.mipMapLevel,isProjectFormat,
                                                     args.components,
-                                                    args.bitdepth,
+                                                    storageDepth,
                                                     inputNbIdentity, inputTimeIdentity,
                                                     framesNeeded);
     
         ///even though we called getImage before and it returned false, it may now
         ///return true if another thread created the image in the cache, so we can't
         ///make any assumption on the return value of this function call.
-        ///
-        ///!!!Note that if isIdentity is true it will allocate an empty image object with 0 bytes of data.
         boost::shared_ptr<Image> newImage;
         bool cached = appPTR->getImageOrCreate(key, cachedImgParams, &newImage);
         if (!newImage) {
@@ -1020,17 +1235,12 @@ boost::shared_ptr<Natron::Image> EffectInstance::renderRoI(const RenderRoIArgs&
             newImage->clearBitmap();
         }
         
-        ///if the plugin is an identity we just inserted in the cache the identity params, we can now return.
-        if (identity) {
-            ///don't return the empty allocated image but the input effect image instead!
-            return image;
-        }
         image = newImage;
         downscaledImage = image;
         
         if (!supportsRenderScale() && args.mipMapLevel != 0) {
             ///Allocate the upscaled image
-            image.reset(new Natron::Image(args.components,rod,0,args.bitdepth));
+            image.reset(new Natron::Image(args.components,rod,0,downscaledImage->getBitDepth()));
         }
         
         
@@ -1045,51 +1255,9 @@ boost::shared_ptr<Natron::Image> EffectInstance::renderRoI(const RenderRoIArgs&
         assert(image);
         
 
-        ///if it was cached, first thing to check is to see if it is an identity
-        int inputNbIdentity = cachedImgParams->getInputNbIdentity();
-        if (inputNbIdentity != -1) {
-            SequenceTime inputTimeIdentity = cachedImgParams->getInputTimeIdentity();
-            RectI canonicalRoI = args.roi.upscalePowerOfTwo(args.mipMapLevel);
-            RoIMap inputsRoI;
-            inputsRoI.insert(std::make_pair(input_other_thread(inputNbIdentity), args.roi.upscalePowerOfTwo(args.mipMapLevel)));
-            Implementation::ScopedRenderArgs scopedArgs(&_imp->renderArgs,
-                                                        args.roi,
-                                                        inputsRoI,
-                                                        args.time,
-                                                        args.view,
-                                                        args.scale,
-                                                        args.mipMapLevel,
-                                                        args.isSequentialRender,
-                                                        args.isRenderUserInteraction,
-                                                        byPassCache,
-                                                        nodeHash,
-                                                        0,
-                                                        args.channelForAlpha,
-                                                        true,
-                                                        inputTimeIdentity,
-                                                        inputNbIdentity);
-            Natron::ImageComponents inputPrefComps;
-            Natron::ImageBitDepth inputPrefDepth;
-            Natron::EffectInstance* inputEffectIdentity = input_other_thread(inputNbIdentity);
-            if (inputEffectIdentity) {
-                inputEffectIdentity->getPreferredDepthAndComponents(-1, &inputPrefComps, &inputPrefDepth);
-                boost::shared_ptr<Image> ret =  getImage(inputNbIdentity, inputTimeIdentity,
-                                                         args.scale, args.view, NULL, inputPrefComps, inputPrefDepth, true);
-                ///Clear input images pointer because getImage has stored ret .
-                _imp->clearInputImagePointers();
-                return ret;
-            } else {
-                return boost::shared_ptr<Image>();
-            }
-        }
+        ///identities are never cached, @see the alias lookup above
+        assert(cachedImgParams->getInputNbIdentity() == -1);
         
-#ifdef NATRON_DEBUG
-        ///If the precomputed rod parameter was set, assert that it is the same than the image in cache.
-        if (inputNbIdentity != -1 && args.preComputedRoD) {
-            assert(*args.preComputedRoD == cachedImgParams->getRoD());
-        }
-#endif
-
         ///For effects that don't support the render scale we have to upscale this cached image,
         ///render the parts we are interested in and then downscale again
         ///Before doing that we verify if everything we want is already rendered in which case we
@@ -1100,13 +1268,14 @@ boost::shared_ptr<Natron::Image> EffectInstance::renderRoI(const RenderRoIArgs&
             args.roi.intersect(image->getPixelRoD(), &intersection);
             std::list<RectI> rectsRendered = image->getRestToRender(intersection);
             if (rectsRendered.empty()) {
-                return image;
+                return convertToRequestedDepth(getApp(), args, image);
             }
         
             downscaledImage = image;
             
             ///Allocate the upscaled image
-            boost::shared_ptr<Natron::Image> upscaledImage(new Natron::Image(args.components,cachedImgParams->getRoD(),0,args.bitdepth));
+            boost::shared_ptr<Natron::Image> upscaledImage(new Natron::Image(args.components,cachedImgParams->getRoD(),0,
+                                                                             downscaledImage->getBitDepth()));
             downscaledImage->scale_box_generic(downscaledImage->getPixelRoD(),upscaledImage.get());
             image = upscaledImage;
         }
@@ -1140,6 +1309,8 @@ boost::shared_ptr<Natron::Image> EffectInstance::renderRoI(const RenderRoIArgs&
         _imp->lastImage = downscaledImage;
     }
     
+    downscaledImage = convertToRequestedDepth(getApp(), args, downscaledImage);
+    
 #ifdef NATRON_LOG
     Natron::Log::endFunction(getName(),"renderRoI");
 #endif
@@ -1242,6 +1413,15 @@ EffectInstance::RenderRoIStatus EffectInstance::renderRoIInternal(SequenceTime t
     boost::shared_ptr<RotoContext> rotoContext = _node->getRotoContext();
     U64 rotoAge = rotoContext ? rotoContext->getAge() : 0;
     
+    ///The actions called to render read the knobs values from a snapshot evaluated once for this hash and time:
+    ///they don't lock the knobs and are not affected by the user editing them.
+    ///It is not needed when everything is already rendered, e.g upon a cache hit.
+    boost::shared_ptr<const KnobsSnapshot> knobsSnapshot;
+    if (!rectsToRender.empty()) {
+        knobsSnapshot = _imp->getKnobsSnapshot(getKnobs(), nodeHash, time);
+    }
+    Implementation::ScopedKnobsSnapshot scopedKnobsSnapshot(&_imp->knobsSnapshot,knobsSnapshot);
+    
     Natron::Status renderStatus = StatOK;
     
     if (rectsToRender.empty()) {
@@ -1465,7 +1645,8 @@ EffectInstance::RenderRoIStatus EffectInstance::renderRoIInternal(SequenceTime t
                 // the bitmap is checked again at the beginning of EffectInstance::tiledRenderingFunctor()
                 QFuture<Natron::Status> ret = QtConcurrent::mapped(splitRects,
                                                                    boost::bind(&EffectInstance::tiledRenderingFunctor,
-                                                                               this,args,_1,downscaledMappedImage,fullScaleMappedImage,
+                                                                               this,args,_imp->knobsSnapshot.localData(),
+                                                                               _1,downscaledMappedImage,fullScaleMappedImage,
                                                                                downscaledMappedImage,fullScaleMappedImage));
                 ret.waitForFinished();
                 
@@ -1496,12 +1677,11 @@ EffectInstance::RenderRoIStatus EffectInstance::renderRoIInternal(SequenceTime t
                 
             case INSTANCE_SAFE: // indicating that any instance can have a single 'render' call at any one time,
             {
-                // NOTE: the per-instance lock should probably be shared between
-                // all clones of the same instance, because an InstanceSafe plugin may assume it is the sole owner of the output image,
-                // and read-write on it.
-                // It is probably safer to assume that several clones may write to the same output image only in the FULLY_SAFE case.
-                
-                QMutexLocker l(&getNode()->getRenderInstancesSharedMutex());
+                // An idle clone of the live instance is used if the node has one, so that renders of different frames
+                // run concurrently, each on its own instance. Otherwise the render waits for the live instance.
+                // Two renders never write to the same output image at once: it is locked by renderRoI (see OutputImageLocker).
+                RenderCloneReleaser clone(_node.get(), _node->getLiveInstance() == this ? _node->acquireRenderClone() : NULL);
+                QMutexLocker l(clone.get() ? NULL : &getNode()->getRenderInstancesSharedMutex());
                 
                 // at this point, it may be unnecessary to call render because it was done a long time ago => check the bitmap here!
                 rectToRender = downscaledImage->getMinimalRect(rectToRender);
@@ -1512,9 +1692,14 @@ EffectInstance::RenderRoIStatus EffectInstance::renderRoIInternal(SequenceTime t
                 }
                 
                 if (!canonicalRectToRender.isNull()) {
-                    renderStatus = render_public(time, scale, canonicalRectToRender,view,isSequentialRender,
-                                               isRenderMadeInResponseToUserInteraction,
-                                                      useFullResImage ? fullScaleMappedImage : downscaledMappedImage);
+                    if (clone.get()) {
+                        renderStatus = renderOnClone(clone.get(), args, canonicalRectToRender,
+                                                     useFullResImage ? fullScaleMappedImage : downscaledMappedImage);
+                    } else {
+                        renderStatus = render_public(time, scale, canonicalRectToRender,view,isSequentialRender,
+                                                     isRenderMadeInResponseToUserInteraction,
+                                                     useFullResImage ? fullScaleMappedImage : downscaledMappedImage);
+                    }
                 }
             } break;
             case FULLY_SAFE:    // indicating that any instance of a plugin can have multiple renders running simultaneously
@@ -1624,7 +1809,44 @@ EffectInstance::RenderRoIStatus EffectInstance::renderRoIInternal(SequenceTime t
 
 }
 
+Natron::Status EffectInstance::renderOnClone(EffectInstance* clone,
+                                             const RenderArgs& args,
+                                             const RectI& roi,
+                                             boost::shared_ptr<Natron::Image> output)
+{
+    ///The clone fetches the input images with the render args of this thread, @see getImage
+    Implementation::ScopedRenderArgs scopedArgs(&clone->_imp->renderArgs,args);
+    
+    ///The knobs of the clone were copied when it was acquired and may be more recent than the render: the clone
+    ///reads the values of the snapshot of this render, keyed by its own knobs.
+    boost::shared_ptr<const KnobsSnapshot> cloneKnobsSnapshot;
+    const boost::shared_ptr<const KnobsSnapshot>& knobsSnapshot = _imp->knobsSnapshot.localData();
+    if (knobsSnapshot) {
+        cloneKnobsSnapshot = clone->_imp->getKnobsSnapshot(clone->getKnobs(), knobsSnapshot->getNodeHash(),
+                                                           knobsSnapshot->getTime(), knobsSnapshot.get());
+    }
+    Implementation::ScopedKnobsSnapshot scopedKnobsSnapshot(&clone->_imp->knobsSnapshot,cloneKnobsSnapshot);
+    
+    ///The clone is a separate instance of the plug-in: the begin/end sequence render actions called on the live
+    ///instance do not apply to it, so its render action is enclosed by its own.
+    Natron::Status stat = clone->beginSequenceRender_public(args._time, args._time, 1, !appPTR->isBackground(), args._scale,
+                                                            args._isSequentialRender, args._isRenderResponseToUserInteraction,
+                                                            args._view);
+    if (stat == StatFailed) {
+        return stat;
+    }
+    stat = clone->render_public(args._time, args._scale, roi, args._view, args._isSequentialRender,
+                                args._isRenderResponseToUserInteraction, output);
+    if (clone->endSequenceRender_public(args._time, args._time, 1, !appPTR->isBackground(), args._scale,
+                                        args._isSequentialRender, args._isRenderResponseToUserInteraction,
+                                        args._view) == StatFailed) {
+        stat = StatFailed;
+    }
+    return stat;
+}
+
 Natron::Status EffectInstance::tiledRenderingFunctor(const RenderArgs& args,
+                                                     const boost::shared_ptr<const KnobsSnapshot>& knobsSnapshot,
                                                      const RectI& roi,
                                                      boost::shared_ptr<Natron::Image> downscaledOutput,
                                                      boost::shared_ptr<Natron::Image> fullScaleOutput,
@@ -1632,6 +1854,9 @@ Natron::Status EffectInstance::tiledRenderingFunctor(const RenderArgs& args,
                                                      boost::shared_ptr<Natron::Image> fullScaleMappedOutput)
 {
     Implementation::ScopedRenderArgs scopedArgs(&_imp->renderArgs,args);
+    Implementation::ScopedKnobsSnapshot scopedKnobsSnapshot(&_imp->knobsSnapshot,knobsSnapshot);
+    ///the thread belongs to the global thread pool: it is only pinned while it renders the tile
+    Natron::NUMA::ScopedThreadPinning scopedPinning;
     // at this point, it may be unnecessary to call render because it was done a long time ago => check the bitmap here!
     RectI rectToRender = downscaledOutput->getMinimalRect(roi);
     bool useFullResImage = (!supportsRenderScale() && args._mipMapLevel != 0);
@@ -1655,6 +1880,16 @@ Natron::Status EffectInstance::tiledRenderingFunctor(const RenderArgs& args,
         
         if (!aborted()) {
             downscaledOutput->markForRendered(rectToRender);
+            if (Natron::NUMA::isEnabled()) {
+                ///sample the first and last pixels of a few rows, which span several pages
+                std::vector<const void*> pages;
+                int rowsStep = std::max(1,rectToRender.height() / NATRON_NUMA_LOCALITY_SAMPLED_ROWS);
+                for (int y = rectToRender.y1; y < rectToRender.y2; y += rowsStep) {
+                    pages.push_back(downscaledOutput->pixelAt(rectToRender.x1, y));
+                    pages.push_back(downscaledOutput->pixelAt(rectToRender.x2 - 1, y));
+                }
+                Natron::NUMA::recordTileLocality(pages);
+            }
         }
         ///copy the rectangle rendered in the full scale image to the downscaled output
         if (useFullResImage) {
@@ -2155,8 +2390,12 @@ bool EffectInstance::isIdentity_public(SequenceTime time,RenderScale scale,const
                        int view,SequenceTime* inputTime,int* inputNb)
 {
     assertActionIsNotRecursive();
-    incrementRecursionLevel();
+    U64 nodeHash = hash();
     bool ret = false;
+    if (_imp->actionsCache.getIdentityResult(nodeHash, time, scale, roi, view, &ret, inputTime, inputNb)) {
+        return ret;
+    }
+    incrementRecursionLevel();
     if (_node->isNodeDisabled()) {
         ret = true;
         *inputTime = time;
@@ -2184,6 +2423,7 @@ bool EffectInstance::isIdentity_public(SequenceTime time,RenderScale scale,const
         }
     }
     decrementRecursionLevel();
+    _imp->actionsCache.setIdentityResult(nodeHash, time, scale, roi, view, ret, ret ? *inputTime : time, ret ? *inputNb : -1);
     return ret;
 }
 
@@ -2194,19 +2434,27 @@ Natron::Status EffectInstance::getRegionOfDefinition_public(SequenceTime time,
                                                             bool* isProjectFormat)
 {
     assertActionIsNotRecursive();
-    incrementRecursionLevel();
-    Natron::Status ret;
+    U64 nodeHash = hash();
+    Natron::Status ret = StatOK;
     
-    try {
-        ret = getRegionOfDefinition(time, scale, view, rod);
+    if (!_imp->actionsCache.getRoDResult(nodeHash, time, scale, view, rod)) {
+        incrementRecursionLevel();
+        try {
+            ret = getRegionOfDefinition(time, scale, view, rod);
+            
+        } catch (const std::exception& e) {
+            decrementRecursionLevel();
+            throw e;
+        }
+        assert(rod->x2 >= rod->x1 && rod->y2 >= rod->y1);
         
-    } catch (const std::exception& e) {
         decrementRecursionLevel();
-        throw e;
+        if (ret == StatFailed) {
+            return ret;
+        }
+        ///The heuristic is not cached: it depends on the project format which is not part of the hash
+        _imp->actionsCache.setRoDResult(nodeHash, time, scale, view, *rod);
     }
-    assert(rod->x2 >= rod->x1 && rod->y2 >= rod->y1);
-    
-    decrementRecursionLevel();
     *isProjectFormat = ifInfiniteApplyHeuristic(time, scale, view, rod);
     assert(rod->x2 >= rod->x1 && rod->y2 >= rod->y1);
     return ret;
@@ -2220,8 +2468,12 @@ EffectInstance::RoIMap EffectInstance::getRegionOfInterest_public(SequenceTime t
     assertActionIsNotRecursive();
     assert(outputRoD.x2 >= outputRoD.x1 && outputRoD.y2 >= outputRoD.y1);
     assert(renderWindow.x2 >= renderWindow.x1 && renderWindow.y2 >= renderWindow.y1);
-    incrementRecursionLevel();
+    U64 nodeHash = hash();
     EffectInstance::RoIMap ret;
+    if (_imp->actionsCache.getRoIResult(nodeHash, time, scale, outputRoD, renderWindow, view, &ret)) {
+        return ret;
+    }
+    incrementRecursionLevel();
     try {
         ret = getRegionOfInterest(time, scale, outputRoD, renderWindow, view);
     } catch (const std::exception& e) {
@@ -2229,15 +2481,22 @@ EffectInstance::RoIMap EffectInstance::getRegionOfInterest_public(SequenceTime t
         throw e;
     }
     decrementRecursionLevel();
+    _imp->actionsCache.setRoIResult(nodeHash, time, scale, outputRoD, renderWindow, view, ret);
     return ret;
 }
 
 EffectInstance::FramesNeededMap EffectInstance::getFramesNeeded_public(SequenceTime time)
 {
     assertActionIsNotRecursive();
+    U64 nodeHash = hash();
+    EffectInstance::FramesNeededMap ret;
+    if (_imp->actionsCache.getFramesNeededResult(nodeHash, time, &ret)) {
+        return ret;
+    }
     incrementRecursionLevel();
-    EffectInstance::FramesNeededMap ret = getFramesNeeded(time);
+    ret = getFramesNeeded(time);
     decrementRecursionLevel();
+    _imp->actionsCache.setFramesNeededResult(nodeHash, time, ret);
     return ret;
 }
 
@@ -2475,6 +2734,12 @@ void EffectInstance::clearLastRenderedImage()
         QMutexLocker l(&_imp->lastRenderArgsMutex);
         _imp->lastImage.reset();
     }
+    clearActionsCache();
+}
+
+void EffectInstance::clearActionsCache()
+{
+    _imp->actionsCache.clear();
 }
 
 
@@ -2498,6 +2763,7 @@ OutputEffectInstance::OutputEffectInstance(boost::shared_ptr<Node> node)
 , _doingFullSequenceRender()
 , _outputEffectDataLock(new QMutex)
 , _renderController(0)
+, _writeQueue()
 {
 }
 
@@ -2607,3 +2873,41 @@ bool OutputEffectInstance::isDoingFullSequenceRender() const {
     QMutexLocker l(_outputEffectDataLock);
     return _doingFullSequenceRender;
 }
+
+Natron::WriteQueue* OutputEffectInstance::getWriteQueue() {
+    QMutexLocker l(_outputEffectDataLock);
+    if (!_writeQueue) {
+        _writeQueue.reset(new Natron::WriteQueue);
+    }
+    return _writeQueue.get();
+}
+
+void OutputEffectInstance::waitForPendingWrites() {
+    Natron::WriteQueue* queue;
+    {
+        QMutexLocker l(_outputEffectDataLock);
+        queue = _writeQueue.get();
+    }
+    if (!queue) {
+        return;
+    }
+    queue->waitForPendingWrites();
+    
+    Natron::WriteQueueStats stats = queue->getStats();
+    if (stats.failedWrites > 0) {
+        std::stringstream ss;
+        ss << stats.failedWrites << " of " << stats.framesWritten + stats.failedWrites << " frames could not be written";
+        if (!stats.lastError.empty()) {
+            ss << ": " << stats.lastError;
+        }
+        setPersistentMessage(Natron::ERROR_MESSAGE, ss.str());
+    }
+#ifdef NATRON_LOG
+    if (stats.framesWritten + stats.failedWrites > 0) {
+        qDebug() << getNode()->getName_mt_safe().c_str() << ":" << stats.framesWritten << "frames written," << stats.failedWrites << "failed, the render waited"
+                 << queue->getBackPressure() * 100. << "% of the time for the" << stats.workersCount << "writers ("
+                 << (queue->isWriteBound() ? "write-bound)" : "render-bound)");
+    }
+#endif
+    queue->resetStats();
+}
@@ -34,6 +34,8 @@ namespace Natron{
 class Node;
 class Image;
 class ImageParams;
+class KnobsSnapshot;
+class WriteQueue;
 /**
  * @brief This is the base class for visual effects.
  * A live instance is always living throughout the lifetime of a Node and other copies are
@@ -115,6 +117,11 @@ public:
      **/
     U64 hash() const WARN_UNUSED_RETURN;
     
+    /**
+     * @brief Returns the snapshot of the knobs used by the render running in this thread, if any.
+     **/
+    virtual const Natron::KnobsSnapshot* getKnobsSnapshot() const OVERRIDE FINAL WARN_UNUSED_RETURN;
+    
     /**
      * @brief Returns the hash the node had at the start of renderRoI. This will return the same value
      * at any time during the same render call. 
@@ -257,8 +264,8 @@ public:
     /**
      * @brief Must return the deepest bit depth that this plug-in can support.
      * If 32 float is supported then return Natron::IMAGE_FLOAT, otherwise
-     * return IMAGE_SHORT if 16 bits is supported, and as a last resort, return
-     * IMAGE_BYTE. At least one must be returned.
+     * return IMAGE_HALF if 16 bits floating point is supported, then IMAGE_SHORT
+     * if 16 bits is supported, and as a last resort, return IMAGE_BYTE. At least one must be returned.
      **/
     Natron::ImageBitDepth getBitDepth() const;
     
@@ -545,6 +552,12 @@ public:
     virtual void purgeCaches(){};
     
     void clearLastRenderedImage();
+    
+    /**
+     * @brief Forgets the memoized results of the getRegionOfDefinition, isIdentity, getRegionOfInterest
+     * and getFramesNeeded actions. They are otherwise only invalidated by a change of the hash of the node.
+     **/
+    void clearActionsCache();
      
     /**
      * @brief Use this function to post a transient message to the user. It will be displayed using
@@ -811,7 +824,17 @@ private:
 
     
     
+    /**
+     * @brief Calls the render action of clone, a render clone of this effect obtained with Node::acquireRenderClone,
+     * with the given args instead of this effect. @see INSTANCE_SAFE in renderRoIInternal
+     **/
+    Natron::Status renderOnClone(EffectInstance* clone,
+                                 const RenderArgs& args,
+                                 const RectI& roi,
+                                 boost::shared_ptr<Natron::Image> output);
+    
     Natron::Status tiledRenderingFunctor(const RenderArgs& args,
+                                         const boost::shared_ptr<const KnobsSnapshot>& knobsSnapshot,
                                          const RectI& roi,
                                          boost::shared_ptr<Natron::Image> downscaledOutput,
                                          boost::shared_ptr<Natron::Image> fullScaleOutput,
@@ -863,6 +886,7 @@ class OutputEffectInstance : public Natron::EffectInstance {
     mutable QMutex* _outputEffectDataLock;
     
     BlockingBackgroundRender* _renderController; //< pointer to a blocking renderer
+    boost::scoped_ptr<Natron::WriteQueue> _writeQueue; //< created by the first call to getWriteQueue()
 public:
 
     OutputEffectInstance(boost::shared_ptr<Node> node);
@@ -908,6 +932,18 @@ public:
     
     bool isDoingFullSequenceRender() const;
     
+    /**
+     * @brief Returns the queue to which writers hand off the writing of their frames so that the next frame
+     * is rendered meanwhile. It is created by the first call.
+     **/
+    Natron::WriteQueue* getWriteQueue();
+    
+    /**
+     * @brief Blocks until every frame handed off to the write queue is written. Called by the video engine
+     * when a render stops.
+     **/
+    void waitForPendingWrites();
+    
 };
 
 
@@ -37,18 +37,25 @@ INCLUDEPATH += $$PWD/../libs/SequenceParsing
 DEPENDPATH += $$PWD/../Global
 
 SOURCES += \
+    ActionsCache.cpp \
     AppInstance.cpp \
     AppManager.cpp \
     BlockingBackgroundRender.cpp \
+    Cache.cpp \
     ChannelSet.cpp \
+    CompressedBuffer.cpp \
     Curve.cpp \
     CurveSerialization.cpp \
     EffectInstance.cpp \
     FileDownloader.cpp \
     FrameEntry.cpp \
     FrameParamsSerialization.cpp \
+    FramePrefetcher.cpp \
+    FrameRangeSet.cpp \
+    HalfFloat.cpp \
     Hash64.cpp \
     HistogramCPU.cpp \
+    IdentityAliases.cpp \
     Image.cpp \
     ImageParamsSerialization.cpp \
     Interpolation.cpp \
@@ -57,13 +64,16 @@ SOURCES += \
     KnobFactory.cpp \
     KnobFile.cpp \
     KnobTypes.cpp \
+    KnobsSnapshot.cpp \
     LibraryBinary.cpp \
     Log.cpp \
     Lut.cpp \
     MemoryFile.cpp \
+    MemoryPool.cpp \
     Node.cpp \
     NonKeyParams.cpp \
     NonKeyParamsSerialization.cpp \
+    NUMA.cpp \
     NodeSerialization.cpp \
     NoOp.cpp \
     OfxClipInstance.cpp \
@@ -81,6 +91,7 @@ SOURCES += \
     ProjectSerialization.cpp \
     RotoContext.cpp \
     RotoSerialization.cpp  \
+    SequenceScanner.cpp \
     Settings.cpp \
     StandardPaths.cpp \
     StringAnimationManager.cpp \
@@ -89,14 +100,17 @@ SOURCES += \
     Transform.cpp \
     VideoEngine.cpp \
     ViewerInstance.cpp \
+    WriteQueue.cpp \
     ../libs/SequenceParsing/SequenceParsing.cpp
 
 HEADERS += \
+    ActionsCache.h \
     AppInstance.h \
     AppManager.h \
     BlockingBackgroundRender.h \
     Cache.h \
     CacheEntry.h \
+    CompressedBuffer.h \
     Curve.h \
     CurveSerialization.h \
     CurvePrivate.h \
@@ -108,8 +122,12 @@ HEADERS += \
     FrameEntrySerialization.h \
     FrameParams.h \
     FrameParamsSerialization.h \
+    FramePrefetcher.h \
+    FrameRangeSet.h \
+    HalfFloat.h \
     Hash64.h \
     HistogramCPU.h \
+    IdentityAliases.h \
     ImageInfo.h \
     Image.h \
     ImageSerialization.h \
@@ -123,14 +141,17 @@ HEADERS += \
     KnobFactory.h \
     KnobFile.h \
     KnobTypes.h \
+    KnobsSnapshot.h \
     LibraryBinary.h \
     Log.h \
     LRUHashTable.h \
     Lut.h \
     MemoryFile.h \
+    MemoryPool.h \
     Node.h \
     NonKeyParams.h \
     NonKeyParamsSerialization.h \
+    NUMA.h \
     NodeSerialization.h \
     NoOp.h \
     OfxClipInstance.h \
@@ -152,6 +173,7 @@ HEADERS += \
     RotoContext.h \
     RotoContextPrivate.h \
     RotoSerialization.h \
+    SequenceScanner.h \
     Settings.h \
     Singleton.h \
     StandardPaths.h \
@@ -166,6 +188,7 @@ HEADERS += \
     VideoEngine.h \
     ViewerInstance.h \
     ViewerInstancePrivate.h \
+    WriteQueue.h \
     ../Global/Enums.h \
     ../Global/GitVersion.h \
     ../Global/GLIncludes.h \
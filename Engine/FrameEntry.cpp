@@ -11,6 +11,7 @@
 
 #include "Engine/FrameEntry.h"
 #include "Engine/FrameParams.h"
+#include "Engine/OpenGLViewerI.h"
 
 using namespace Natron;
 
@@ -95,3 +96,7 @@ boost::shared_ptr<const FrameParams> FrameEntry::makeParams(const RectI rod,int
     return boost::shared_ptr<const FrameParams>(new FrameParams(rod,bitDepth,texW,texH));
 }
 
+int FrameEntry::getPixelSize() const {
+    ///8-bit textures are packed BGRA, the others are RGBA floats
+    return getKey().getBitDepth() == OpenGLViewerI::BYTE ? 4 : 4 * sizeof(float);
+}
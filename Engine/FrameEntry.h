@@ -66,6 +66,8 @@ namespace Natron{
 
         const RenderScale& getScale() const WARN_UNUSED_RETURN { return _scale; }
 
+        const TextureRect& getTexRect() const WARN_UNUSED_RETURN { return _textureRect; }
+
         const std::string& getInputName() const WARN_UNUSED_RETURN { return _inputName; }
 
     private:
@@ -116,6 +118,8 @@ namespace Natron{
         {
             return _data.writable();
         }
+        
+        virtual int getPixelSize() const OVERRIDE FINAL;
     };
     
     
@@ -0,0 +1,356 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "FramePrefetcher.h"
+
+#include <algorithm>
+#include <cmath>
+#include <list>
+#include <set>
+#include <stdexcept>
+
+#ifdef __NATRON_LINUX__
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+CLANG_DIAG_OFF(deprecated)
+#include <QtCore/QDebug>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QMutex>
+#include <QtCore/QThread>
+#include <QtCore/QWaitCondition>
+CLANG_DIAG_ON(deprecated)
+
+///The weight of the last measure in the moving averages of the decoding time and of the interval between requests
+#define NATRON_FRAME_PREFETCHER_AVERAGE_WEIGHT 0.2
+
+using namespace Natron;
+
+namespace {
+
+class FramePrefetcherWorker
+    : public QThread
+{
+public:
+
+    explicit FramePrefetcherWorker(FramePrefetcherPrivate* prefetcher)
+    : QThread()
+    , _prefetcher(prefetcher)
+    {
+    }
+
+    virtual ~FramePrefetcherWorker()
+    {
+    }
+
+private:
+
+    virtual void run() OVERRIDE FINAL;
+
+    FramePrefetcherPrivate* _prefetcher;
+};
+
+struct DecodedFile
+{
+    std::string filename;
+    boost::shared_ptr<PrefetchedFrame> frame;
+    std::size_t size;
+};
+
+inline void
+updateAverage(double value,
+              double* average)
+{
+    *average = *average < 0. ? value : *average + (value - *average) * NATRON_FRAME_PREFETCHER_AVERAGE_WEIGHT;
+}
+} // anon namespace
+
+namespace Natron {
+struct FramePrefetcherPrivate
+{
+    FramePrefetcher::Decoder decoder;
+    int threadsCount;
+    mutable QMutex lock; //< protects all the members below
+    QWaitCondition requestAppended; //< the workers wait on it for a file to decode
+    QWaitCondition fileDecoded; //< the requests wait on it for a file being decoded
+    std::list<std::string> requests; //< the files to prefetch not picked by a worker yet
+    std::set<std::string> decoding; //< the files being decoded
+    std::list<DecodedFile> decoded; //< the least recently requested first
+    int generation; //< incremented by clear(), the files decoded for a previous generation are dropped
+    bool mustQuit;
+    FramePrefetcherStats stats;
+    bool hasRequested;
+    QElapsedTimer sinceLastRequest;
+    U64 maximumMemory;
+    std::size_t lastFrameSize; //< the size of the last frame decoded, the estimate of the size of the next ones
+    std::vector<FramePrefetcherWorker*> workers; //< started by the first call to prefetch()
+
+    FramePrefetcherPrivate(const FramePrefetcher::Decoder& decoder_,int threadsCount_)
+    : decoder(decoder_)
+    , threadsCount(threadsCount_)
+    , lock()
+    , requestAppended()
+    , fileDecoded()
+    , requests()
+    , decoding()
+    , decoded()
+    , generation(0)
+    , mustQuit(false)
+    , stats()
+    , hasRequested(false)
+    , sinceLastRequest()
+    , maximumMemory(NATRON_FRAME_PREFETCHER_DEFAULT_MAX_MEMORY)
+    , lastFrameSize(0)
+    , workers()
+    {
+        stats.averageDecodeMs = -1.;
+        stats.averageRequestIntervalMs = -1.;
+    }
+
+    ///must be called with the lock held
+    std::list<DecodedFile>::iterator findDecoded(const std::string& filename)
+    {
+        for (std::list<DecodedFile>::iterator it = decoded.begin(); it != decoded.end(); ++it) {
+            if (it->filename == filename) {
+                return it;
+            }
+        }
+        return decoded.end();
+    }
+
+    ///must be called with the lock held, forgets the least recently requested frames until they fit in maximumMemory
+    void evictExceedingFrames()
+    {
+        while (stats.decodedMemory > maximumMemory && decoded.size() > 1) {
+            stats.decodedMemory -= decoded.front().size;
+            decoded.pop_front();
+        }
+    }
+
+    ///decodes the file without the lock held, returns with the lock held
+    boost::shared_ptr<PrefetchedFrame> decode(QMutexLocker& l,const std::string& filename)
+    {
+        int decodeGeneration = generation;
+        decoding.insert(filename);
+        l.unlock();
+
+        QElapsedTimer timer;
+        timer.start();
+        boost::shared_ptr<PrefetchedFrame> frame;
+        try {
+            frame = decoder(filename);
+        } catch (const std::exception& e) {
+            qDebug() << "Failed to decode" << filename.c_str() << ":" << e.what();
+        }
+        double decodeMs = (double)timer.elapsed();
+
+        l.relock();
+        decoding.erase(filename);
+        ++stats.decodedFrames;
+        updateAverage(decodeMs, &stats.averageDecodeMs);
+        ///a file that could not be decoded is not kept: it is decoded again if requested
+        if (frame && decodeGeneration == generation) {
+            DecodedFile file;
+            file.filename = filename;
+            file.frame = frame;
+            file.size = frame->getSize();
+            lastFrameSize = file.size;
+            decoded.push_back(file);
+            stats.decodedMemory += file.size;
+            ///the frame being processed is kept besides the prefetched ones
+            while (decoded.size() > NATRON_FRAME_PREFETCHER_MAX_FRAMES + 1) {
+                stats.decodedMemory -= decoded.front().size;
+                decoded.pop_front();
+            }
+            evictExceedingFrames();
+        }
+        fileDecoded.wakeAll();
+        return frame;
+    }
+};
+}
+
+void
+FramePrefetcherWorker::run()
+{
+    QMutexLocker l(&_prefetcher->lock);
+    for (;;) {
+        while (_prefetcher->requests.empty() && !_prefetcher->mustQuit) {
+            _prefetcher->requestAppended.wait(&_prefetcher->lock);
+        }
+        if (_prefetcher->mustQuit) {
+            return;
+        }
+        std::string filename = _prefetcher->requests.front();
+        _prefetcher->requests.pop_front();
+        if (!_prefetcher->requests.empty()) {
+            ///the next file is read from the disk while this one is decoded
+            std::string next = _prefetcher->requests.front();
+            l.unlock();
+            FramePrefetcher::adviseWillRead(next);
+            l.relock();
+        }
+        ///the file may have been requested meanwhile
+        if (_prefetcher->mustQuit ||
+            _prefetcher->decoding.find(filename) != _prefetcher->decoding.end() ||
+            _prefetcher->findDecoded(filename) != _prefetcher->decoded.end()) {
+            continue;
+        }
+        (void)_prefetcher->decode(l, filename);
+    }
+}
+
+FramePrefetcher::FramePrefetcher(const Decoder& decoder,int threadsCount)
+: _imp()
+{
+    if (threadsCount <= 0) {
+        threadsCount = std::min(QThread::idealThreadCount() / 2, NATRON_FRAME_PREFETCHER_MIN_FRAMES * 2);
+    }
+    _imp.reset(new FramePrefetcherPrivate(decoder, std::max(threadsCount, 1)));
+}
+
+FramePrefetcher::~FramePrefetcher()
+{
+    {
+        QMutexLocker l(&_imp->lock);
+        _imp->requests.clear();
+        _imp->mustQuit = true;
+        _imp->requestAppended.wakeAll();
+    }
+    for (U32 i = 0; i < _imp->workers.size(); ++i) {
+        _imp->workers[i]->wait();
+        delete _imp->workers[i];
+    }
+}
+
+boost::shared_ptr<PrefetchedFrame>
+FramePrefetcher::getFrame(const std::string& filename)
+{
+    QMutexLocker l(&_imp->lock);
+    if (_imp->hasRequested) {
+        double intervalMs = (double)_imp->sinceLastRequest.restart();
+        if (intervalMs <= NATRON_FRAME_PREFETCHER_MAX_REQUEST_INTERVAL) {
+            updateAverage(intervalMs, &_imp->stats.averageRequestIntervalMs);
+        }
+    } else {
+        _imp->hasRequested = true;
+        _imp->sinceLastRequest.start();
+    }
+
+    bool waited = false;
+    while (_imp->decoding.find(filename) != _imp->decoding.end()) {
+        _imp->fileDecoded.wait(&_imp->lock);
+        waited = true;
+    }
+    std::list<DecodedFile>::iterator found = _imp->findDecoded(filename);
+    if (found != _imp->decoded.end()) {
+        if (waited) {
+            ++_imp->stats.waits;
+        } else {
+            ++_imp->stats.hits;
+        }
+        ///this is now the most recently requested frame
+        _imp->decoded.splice(_imp->decoded.end(), _imp->decoded, found);
+        return _imp->decoded.back().frame;
+    }
+
+    ++_imp->stats.misses;
+    _imp->requests.remove(filename);
+    return _imp->decode(l, filename);
+}
+
+void
+FramePrefetcher::prefetch(const std::vector<std::string>& filenames)
+{
+    QMutexLocker l(&_imp->lock);
+    _imp->requests.clear();
+    for (U32 i = 0; i < filenames.size(); ++i) {
+        if (_imp->decoding.find(filenames[i]) == _imp->decoding.end() &&
+            _imp->findDecoded(filenames[i]) == _imp->decoded.end()) {
+            _imp->requests.push_back(filenames[i]);
+        }
+    }
+    if (_imp->requests.empty()) {
+        return;
+    }
+    if (_imp->workers.empty()) {
+        for (int i = 0; i < _imp->threadsCount; ++i) {
+            FramePrefetcherWorker* worker = new FramePrefetcherWorker(_imp.get());
+            _imp->workers.push_back(worker);
+            worker->start();
+        }
+    }
+    _imp->requestAppended.wakeAll();
+}
+
+int
+FramePrefetcher::getPrefetchCount() const
+{
+    QMutexLocker l(&_imp->lock);
+    if (_imp->stats.averageDecodeMs < 0. || _imp->stats.averageRequestIntervalMs <= 0.) {
+        return NATRON_FRAME_PREFETCHER_MIN_FRAMES;
+    }
+    int count = (int)std::ceil(_imp->stats.averageDecodeMs / _imp->stats.averageRequestIntervalMs) + 1;
+    count = std::max(NATRON_FRAME_PREFETCHER_MIN_FRAMES, std::min(count, NATRON_FRAME_PREFETCHER_MAX_FRAMES));
+    if (_imp->lastFrameSize > 0) {
+        U64 fittingFrames = _imp->maximumMemory / _imp->lastFrameSize;
+        ///the last requested frame is kept besides the prefetched ones
+        int fittingAhead = fittingFrames > 0 ? (int)std::min(fittingFrames - 1, (U64)count) : 0;
+        count = std::min(count, fittingAhead);
+    }
+    return count;
+}
+
+void
+FramePrefetcher::setMaximumMemory(U64 bytes)
+{
+    QMutexLocker l(&_imp->lock);
+    _imp->maximumMemory = bytes;
+    _imp->evictExceedingFrames();
+}
+
+U64
+FramePrefetcher::getMaximumMemory() const
+{
+    QMutexLocker l(&_imp->lock);
+
+    return _imp->maximumMemory;
+}
+
+void
+FramePrefetcher::clear()
+{
+    QMutexLocker l(&_imp->lock);
+    ++_imp->generation;
+    _imp->requests.clear();
+    _imp->decoded.clear();
+    _imp->stats.decodedMemory = 0;
+}
+
+FramePrefetcherStats
+FramePrefetcher::getStats() const
+{
+    QMutexLocker l(&_imp->lock);
+
+    return _imp->stats;
+}
+
+void
+FramePrefetcher::adviseWillRead(const std::string& filename)
+{
+#ifdef __NATRON_LINUX__
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd == -1) {
+        return;
+    }
+    ///the advice outlives the descriptor: the pages are read into the system cache
+    (void)::posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+    ::close(fd);
+#else
+    (void)filename;
+#endif
+}
@@ -0,0 +1,148 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef NATRON_ENGINE_FRAMEPREFETCHER_H_
+#define NATRON_ENGINE_FRAMEPREFETCHER_H_
+
+#include <string>
+#include <vector>
+
+#include "Global/Macros.h"
+#include "Global/GlobalDefines.h"
+
+#ifndef Q_MOC_RUN
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+#endif
+
+///The number of frames prefetched before the decoding time and the rate of the requests are known
+#define NATRON_FRAME_PREFETCHER_MIN_FRAMES 2
+
+///The maximum number of frames prefetched ahead of the last requested one, this is also the number of decoded frames kept
+#define NATRON_FRAME_PREFETCHER_MAX_FRAMES 8
+
+///Requests further apart than this (in milliseconds) are not playback: they are not accounted in the request rate
+#define NATRON_FRAME_PREFETCHER_MAX_REQUEST_INTERVAL 1000
+
+///The memory the decoded frames may use until setMaximumMemory() is called
+#define NATRON_FRAME_PREFETCHER_DEFAULT_MAX_MEMORY (256 * 1024 * 1024)
+
+///A reader may keep decoded frames up to 1 / NATRON_FRAME_PREFETCHER_NODE_CACHE_FRACTION of the maximum size of the node cache
+#define NATRON_FRAME_PREFETCHER_NODE_CACHE_FRACTION 16
+
+namespace Natron {
+
+/**
+ * @brief A decoded file, subclassed by the readers to hold their own decoded representation.
+ **/
+class PrefetchedFrame
+{
+public:
+
+    virtual ~PrefetchedFrame()
+    {
+    }
+
+    ///The memory used by the decoded file, in bytes
+    virtual std::size_t getSize() const = 0;
+};
+
+struct FramePrefetcherStats
+{
+    U64 hits; //< requested frames that were already decoded
+    U64 waits; //< requested frames that were being decoded, the request waited for them
+    U64 misses; //< requested frames that were decoded by the requesting thread
+    U64 decodedFrames; //< frames decoded, prefetched or not
+    U64 decodedMemory; //< the memory used by the decoded frames kept
+    double averageDecodeMs; //< moving average of the time it takes to decode a frame
+    double averageRequestIntervalMs; //< moving average of the time between 2 requests of a different file
+};
+
+struct FramePrefetcherPrivate;
+
+/**
+ * @brief The I/O stage of sequence readers: while a frame is processed, the next ones are read and decoded by dedicated
+ * threads so that playback does not block on file access. The reader asks for the files it will need next with prefetch(),
+ * in the order it will need them, and gets the decoded frames with getFrame(). A file is never decoded twice at the same time:
+ * a request for a file being prefetched waits for it.
+ * How many frames should be prefetched adapts to the ratio of the decoding time to the interval between 2 requests,
+ * see getPrefetchCount(). Before decoding a file, the workers tell the system that the following file will be read, so that
+ * it is read from the disk during the decoding.
+ * The decoded frames kept never use more than getMaximumMemory(), except for the most recently requested one.
+ * The threads are started by the first call to prefetch().
+ *
+ * Thread safety: this class is thread-safe.
+ **/
+class FramePrefetcher
+    : boost::noncopyable
+{
+public:
+
+    ///Decodes a file, returns NULL upon failure
+    typedef boost::function<boost::shared_ptr<PrefetchedFrame> (const std::string& filename)> Decoder;
+
+    /**
+     * @brief If threadsCount is not positive, the number of threads is half the ideal thread count of the machine,
+     * at least 1 and at most NATRON_FRAME_PREFETCHER_MIN_FRAMES * 2.
+     **/
+    explicit FramePrefetcher(const Decoder& decoder,int threadsCount = 0);
+
+    ///Waits for the files being decoded, the files not started are dropped
+    ~FramePrefetcher();
+
+    /**
+     * @brief Returns the decoded file, or NULL if it could not be decoded. If it was not prefetched the
+     * file is decoded by the calling thread. The failures are not kept: a file that could not be decoded is
+     * decoded again on the next request.
+     **/
+    boost::shared_ptr<PrefetchedFrame> getFrame(const std::string& filename) WARN_UNUSED_RETURN;
+
+    /**
+     * @brief Replaces the files to prefetch by the given ones, in the order they will be requested.
+     * The files already decoded or being decoded are skipped.
+     **/
+    void prefetch(const std::vector<std::string>& filenames);
+
+    /**
+     * @brief Returns how many frames to prefetch ahead of the last request so that the next requests do not wait:
+     * the number of requests occurring while a frame is decoded, plus one, between NATRON_FRAME_PREFETCHER_MIN_FRAMES
+     * and NATRON_FRAME_PREFETCHER_MAX_FRAMES. It is lower, possibly 0, if that many frames would not fit in
+     * getMaximumMemory() besides the last requested one.
+     **/
+    int getPrefetchCount() const WARN_UNUSED_RETURN;
+
+    /**
+     * @brief Sets the memory the decoded frames may use, the least recently requested frames are forgotten
+     * if they use more.
+     **/
+    void setMaximumMemory(U64 bytes);
+
+    U64 getMaximumMemory() const WARN_UNUSED_RETURN;
+
+    /**
+     * @brief Forgets the decoded frames and the files to prefetch, e.g because the files changed.
+     * The files being decoded are dropped once decoded.
+     **/
+    void clear();
+
+    FramePrefetcherStats getStats() const WARN_UNUSED_RETURN;
+
+    /**
+     * @brief Tells the system that the file will be read, so that it starts reading it into its cache.
+     * This does nothing on systems without posix_fadvise.
+     **/
+    static void adviseWillRead(const std::string& filename);
+
+private:
+
+    boost::scoped_ptr<FramePrefetcherPrivate> _imp;
+};
+
+} // namespace Natron
+
+#endif // NATRON_ENGINE_FRAMEPREFETCHER_H_
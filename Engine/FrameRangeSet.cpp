@@ -0,0 +1,104 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "FrameRangeSet.h"
+
+#include <algorithm>
+#include <cassert>
+
+using namespace Natron;
+
+void
+FrameRangeSet::insertRange(SequenceTime first,SequenceTime last)
+{
+    assert(first <= last);
+
+    ///the first range starting after first
+    Ranges::iterator it = _ranges.upper_bound(first);
+
+    ///extend the previous range if it overlaps or touches the new one
+    if (it != _ranges.begin()) {
+        Ranges::iterator prev = it;
+        --prev;
+        if (prev->second >= first - 1) {
+            first = prev->first;
+            it = prev;
+        }
+    }
+
+    ///absorb all the ranges that overlap or touch [first,last]
+    while (it != _ranges.end() && it->first <= last + 1) {
+        last = std::max(last,it->second);
+        _ranges.erase(it++);
+    }
+    _ranges.insert(it, std::make_pair(first,last));
+}
+
+void
+FrameRangeSet::removeRange(SequenceTime first,SequenceTime last)
+{
+    assert(first <= last);
+
+    ///start from the range containing first, if any
+    Ranges::iterator it = _ranges.upper_bound(first);
+    if (it != _ranges.begin()) {
+        --it;
+        if (it->second < first) {
+            ++it;
+        }
+    }
+
+    while (it != _ranges.end() && it->first <= last) {
+        SequenceTime rangeFirst = it->first;
+        SequenceTime rangeLast = it->second;
+        _ranges.erase(it++);
+        ///keep the parts of the range outside of [first,last]
+        if (rangeFirst < first) {
+            _ranges.insert(std::make_pair(rangeFirst,first - 1));
+        }
+        if (rangeLast > last) {
+            _ranges.insert(std::make_pair(last + 1,rangeLast));
+            break;
+        }
+    }
+}
+
+bool
+FrameRangeSet::contains(SequenceTime time) const
+{
+    Ranges::const_iterator it = _ranges.upper_bound(time);
+    if (it == _ranges.begin()) {
+        return false;
+    }
+    --it;
+    return it->second >= time;
+}
+
+void
+FrameRangeSet::merge(const FrameRangeSet& other)
+{
+    for (Ranges::const_iterator it = other._ranges.begin(); it != other._ranges.end(); ++it) {
+        insertRange(it->first, it->second);
+    }
+}
+
+void
+FrameRangeSet::subtract(const FrameRangeSet& other)
+{
+    for (Ranges::const_iterator it = other._ranges.begin(); it != other._ranges.end(); ++it) {
+        removeRange(it->first, it->second);
+    }
+}
+
+int
+FrameRangeSet::getFramesCount() const
+{
+    int ret = 0;
+    for (Ranges::const_iterator it = _ranges.begin(); it != _ranges.end(); ++it) {
+        ret += it->second - it->first + 1;
+    }
+    return ret;
+}
@@ -0,0 +1,66 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef NATRON_ENGINE_FRAMERANGESET_H_
+#define NATRON_ENGINE_FRAMERANGESET_H_
+
+#include <map>
+
+#include "Global/GlobalDefines.h"
+
+namespace Natron {
+
+/**
+ * @brief A set of frames stored as sorted, disjoint ranges of consecutive frames.
+ * Inserting or removing a frame costs O(log(R)) where R is the number of ranges, and
+ * a fully cached sequence of 10,000 frames is a single range.
+ **/
+class FrameRangeSet
+{
+public:
+
+    ///Maps the first frame of a range to its last frame (included).
+    ///Two ranges never overlap nor touch: they are merged on insertion.
+    typedef std::map<SequenceTime,SequenceTime> Ranges;
+
+    FrameRangeSet()
+    : _ranges()
+    {
+    }
+
+    void insert(SequenceTime time) { insertRange(time, time); }
+
+    void insertRange(SequenceTime first,SequenceTime last);
+
+    void remove(SequenceTime time) { removeRange(time, time); }
+
+    void removeRange(SequenceTime first,SequenceTime last);
+
+    bool contains(SequenceTime time) const WARN_UNUSED_RETURN;
+
+    ///Inserts all the frames of other into this set
+    void merge(const FrameRangeSet& other);
+
+    ///Removes all the frames of other from this set
+    void subtract(const FrameRangeSet& other);
+
+    bool isEmpty() const { return _ranges.empty(); }
+
+    void clear() { _ranges.clear(); }
+
+    ///Returns the number of frames in the set (not the number of ranges)
+    int getFramesCount() const WARN_UNUSED_RETURN;
+
+    const Ranges& getRanges() const { return _ranges; }
+
+private:
+
+    Ranges _ranges;
+};
+
+}
+
+#endif // NATRON_ENGINE_FRAMERANGESET_H_
@@ -0,0 +1,53 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "HalfFloat.h"
+
+#ifdef __F16C__
+#include <immintrin.h>
+#endif
+
+using namespace Natron;
+
+void
+HalfFloat::fromFloat(const float* src,unsigned short* dst,std::size_t count)
+{
+    std::size_t i = 0;
+#ifdef __F16C__
+    for (; i + 8 <= count; i += 8) {
+        __m128i h = _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT);
+        _mm_storeu_si128((__m128i*)(dst + i), h);
+    }
+#endif
+    for (; i < count; ++i) {
+        dst[i] = fromFloat(src[i]);
+    }
+}
+
+void
+HalfFloat::toFloat(const unsigned short* src,float* dst,std::size_t count)
+{
+    std::size_t i = 0;
+#ifdef __F16C__
+    for (; i + 8 <= count; i += 8) {
+        __m128i h = _mm_loadu_si128((const __m128i*)(src + i));
+        _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(h));
+    }
+#endif
+    for (; i < count; ++i) {
+        dst[i] = toFloat(src[i]);
+    }
+}
+
+bool
+HalfFloat::isHardwareAccelerated()
+{
+#ifdef __F16C__
+    return true;
+#else
+    return false;
+#endif
+}
@@ -0,0 +1,164 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef NATRON_ENGINE_HALFFLOAT_H_
+#define NATRON_ENGINE_HALFFLOAT_H_
+
+#include <cstddef>
+#include <cstring>
+
+#include "Global/Macros.h"
+#include "Global/GlobalDefines.h"
+
+namespace Natron {
+
+/**
+ * @brief Conversions between 32 bits floats and IEEE 754 16 bits floats (half), the format of
+ * Natron::IMAGE_HALF images and of OFX kOfxBitDepthHalf buffers.
+ * Conversions to half round to the nearest even value, overflow to infinity and keep NaNs.
+ **/
+namespace HalfFloat {
+
+inline U32
+floatBits(float f)
+{
+    U32 ret;
+    std::memcpy(&ret, &f, sizeof(float));
+    return ret;
+}
+
+inline float
+bitsFloat(U32 bits)
+{
+    float ret;
+    std::memcpy(&ret, &bits, sizeof(float));
+    return ret;
+}
+
+inline unsigned short
+fromFloat(float f)
+{
+    U32 bits = floatBits(f);
+    U32 sign = bits & 0x80000000U;
+    bits ^= sign;
+    unsigned short ret;
+    if (bits >= (U32)(127 + 16) << 23) {
+        ///too large for a half: infinity, NaNs stay NaNs
+        ret = bits > (U32)255 << 23 ? 0x7e00 : 0x7c00;
+    } else if (bits < (U32)113 << 23) {
+        ///denormalized half: let the float unit do the rounding by aligning the mantissa
+        const U32 denormMagic = (U32)((127 - 15) + (23 - 10) + 1) << 23;
+        ret = (unsigned short)(floatBits(bitsFloat(bits) + bitsFloat(denormMagic)) - denormMagic);
+    } else {
+        U32 mantissaOdd = (bits >> 13) & 1;
+        bits += ((U32)(15 - 127) << 23) + 0xfff;
+        bits += mantissaOdd;
+        ret = (unsigned short)(bits >> 13);
+    }
+    return (unsigned short)(ret | (sign >> 16));
+}
+
+inline float
+toFloat(unsigned short h)
+{
+    const U32 shiftedExponent = (U32)0x7c00 << 13;
+    U32 bits = ((U32)h & 0x7fff) << 13;
+    U32 exponent = bits & shiftedExponent;
+    bits += (U32)(127 - 15) << 23;
+    if (exponent == shiftedExponent) {
+        ///infinity or NaN
+        bits += (U32)(128 - 16) << 23;
+    } else if (exponent == 0) {
+        ///zero or denormalized half, which is a normalized float
+        bits += 1 << 23;
+        bits = floatBits(bitsFloat(bits) - bitsFloat((U32)113 << 23));
+    }
+    return bitsFloat(bits | (((U32)h & 0x8000) << 16));
+}
+
+/**
+ * @brief Converts count values. These use the F16C instructions when Natron is compiled for a cpu
+ * that has them (e.g -mf16c), and fall back to fromFloat()/toFloat() otherwise.
+ **/
+void fromFloat(const float* src,unsigned short* dst,std::size_t count);
+
+void toFloat(const unsigned short* src,float* dst,std::size_t count);
+
+/**
+ * @brief Returns true if the bulk conversions above use the F16C instructions.
+ **/
+bool isHardwareAccelerated() WARN_UNUSED_RETURN;
+
+} // namespace HalfFloat
+
+/**
+ * @brief The pixel type of Natron::IMAGE_HALF images. It holds the bits of a half and converts implicitly
+ * from and to float so that the templated pixel processing code works on it like on floats: arithmetic
+ * is done in float and rounded once when stored. Like floats, halves are meant to hold values in [0 - 1.f]
+ * in the conversions from and to the integer bit depths (i.e the maxValue of a half is 1).
+ **/
+class Half
+{
+public:
+
+    Half()
+    : _bits(0)
+    {
+    }
+
+    Half(float f)
+    : _bits(HalfFloat::fromFloat(f))
+    {
+    }
+
+    operator float() const
+    {
+        return HalfFloat::toFloat(_bits);
+    }
+
+    Half& operator=(float f)
+    {
+        _bits = HalfFloat::fromFloat(f);
+        return *this;
+    }
+
+    Half& operator+=(float f)
+    {
+        return *this = (float)*this + f;
+    }
+
+    Half& operator-=(float f)
+    {
+        return *this = (float)*this - f;
+    }
+
+    Half& operator*=(float f)
+    {
+        return *this = (float)*this * f;
+    }
+
+    Half& operator/=(float f)
+    {
+        return *this = (float)*this / f;
+    }
+
+    unsigned short bits() const WARN_UNUSED_RETURN { return _bits; }
+
+    static Half fromBits(unsigned short bits)
+    {
+        Half ret;
+        ret._bits = bits;
+        return ret;
+    }
+
+private:
+
+    unsigned short _bits;
+};
+
+} // namespace Natron
+
+#endif // NATRON_ENGINE_HALFFLOAT_H_
@@ -0,0 +1,114 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "IdentityAliases.h"
+
+#include <vector>
+
+#ifndef Q_MOC_RUN
+#include <boost/functional/hash.hpp>
+#endif
+
+using namespace Natron;
+
+std::size_t
+IdentityAliases::AliasKeyHash::operator()(const AliasKey& key) const
+{
+    std::size_t seed = 0;
+    boost::hash_combine(seed, key.hash);
+    boost::hash_combine(seed, key.time);
+    boost::hash_combine(seed, key.mipMapLevel);
+    boost::hash_combine(seed, key.view);
+    return seed;
+}
+
+IdentityAliases::IdentityAliases()
+: _lock()
+, _aliases()
+{
+}
+
+void
+IdentityAliases::clear()
+{
+    QMutexLocker l(&_lock);
+    _aliases.clear();
+}
+
+void
+IdentityAliases::setAlias(U64 hash,SequenceTime time,unsigned int mipMapLevel,int view,
+                          const boost::shared_ptr<Natron::Node>& inputNode,U64 inputHash,SequenceTime inputTime)
+{
+    Target target;
+    target.node = inputNode;
+    target.hash = inputHash;
+    target.time = inputTime;
+    QMutexLocker l(&_lock);
+    ///start over when full rather than tracking which alias is the oldest, they are cheap to record again
+    if (_aliases.size() >= NATRON_IDENTITY_ALIASES_MAX_ENTRIES) {
+        _aliases.clear();
+    }
+    _aliases[AliasKey(hash,time,mipMapLevel,view)] = target;
+}
+
+bool
+IdentityAliases::resolve(U64 hash,SequenceTime time,unsigned int mipMapLevel,int view,Target* target)
+{
+    QMutexLocker l(&_lock);
+    Aliases::iterator last = _aliases.find(AliasKey(hash,time,mipMapLevel,view));
+    if (last == _aliases.end()) {
+        return false;
+    }
+
+    ///the aliases of the chain before its last one
+    std::vector<Aliases::iterator> chain;
+    for (;;) {
+        Aliases::iterator next = _aliases.find(AliasKey(last->second.hash,last->second.time,mipMapLevel,view));
+        if (next == _aliases.end()) {
+            break;
+        }
+        chain.push_back(last);
+        if (chain.size() > _aliases.size()) {
+            ///the chain loops, every alias of the loop was visited (some of them twice)
+            std::vector<AliasKey> keys;
+            for (U32 i = 0; i < chain.size(); ++i) {
+                keys.push_back(chain[i]->first);
+            }
+            for (U32 i = 0; i < keys.size(); ++i) {
+                _aliases.erase(keys[i]);
+            }
+            return false;
+        }
+        last = next;
+    }
+
+    ///compress the chain
+    for (U32 i = 0; i < chain.size(); ++i) {
+        chain[i]->second = last->second;
+    }
+    *target = last->second;
+    return true;
+}
+
+void
+IdentityAliases::removeAliasesWithHash(U64 hash)
+{
+    QMutexLocker l(&_lock);
+    for (Aliases::iterator it = _aliases.begin(); it != _aliases.end();) {
+        if (it->first.hash == hash || it->second.hash == hash) {
+            it = _aliases.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+std::size_t
+IdentityAliases::getAliasesCount() const
+{
+    QMutexLocker l(&_lock);
+    return _aliases.size();
+}
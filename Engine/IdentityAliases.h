@@ -0,0 +1,110 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef NATRON_ENGINE_IDENTITYALIASES_H_
+#define NATRON_ENGINE_IDENTITYALIASES_H_
+
+#include "Global/Macros.h"
+CLANG_DIAG_OFF(deprecated)
+#include <QtCore/QMutex>
+CLANG_DIAG_ON(deprecated)
+
+#ifndef Q_MOC_RUN
+#include <boost/noncopyable.hpp>
+#include <boost/unordered_map.hpp>
+#include <boost/weak_ptr.hpp>
+#endif
+
+#include "Global/GlobalDefines.h"
+
+///The maximum number of aliases, all of them are forgotten when it is reached
+#define NATRON_IDENTITY_ALIASES_MAX_ENTRIES 4096
+
+namespace Natron {
+
+class Node;
+
+/**
+ * @brief Records the images of the node cache that are identities: the image of a node at a time is the image
+ * of one of its inputs (or of itself at another time). An alias is keyed like an image (node hash, time, mipmap level
+ * and view) and points to the key of the image it is an identity of, which may be an alias itself.
+ * Resolving an alias follows the chain to the first image which is not an identity and then makes every alias of
+ * the chain point directly to it, so that chains of identities are walked once.
+ *
+ * Thread safety: this class is thread-safe.
+ **/
+class IdentityAliases
+    : boost::noncopyable
+{
+public:
+
+    ///The image an alias points to
+    struct Target
+    {
+        boost::weak_ptr<Natron::Node> node; //< the node rendering the image
+        U64 hash; //< the hash of the node when the alias was recorded
+        SequenceTime time;
+    };
+
+    IdentityAliases();
+
+    void clear();
+
+    /**
+     * @brief Records that the image of the given key is the image of inputNode (whose hash is inputHash) at inputTime,
+     * for the same mipmap level and view.
+     **/
+    void setAlias(U64 hash,SequenceTime time,unsigned int mipMapLevel,int view,
+                  const boost::shared_ptr<Natron::Node>& inputNode,U64 inputHash,SequenceTime inputTime);
+
+    /**
+     * @brief Returns false if the image of the given key is not an identity. Otherwise target is set to
+     * the image at the end of the chain of aliases.
+     * A chain that loops (e.g an effect which is an identity of itself at another time and back) is forgotten.
+     **/
+    bool resolve(U64 hash,SequenceTime time,unsigned int mipMapLevel,int view,Target* target) WARN_UNUSED_RETURN;
+
+    /**
+     * @brief Forgets the aliases of the images of the given hash and the aliases pointing to them.
+     **/
+    void removeAliasesWithHash(U64 hash);
+
+    std::size_t getAliasesCount() const WARN_UNUSED_RETURN;
+
+private:
+
+    struct AliasKey
+    {
+        U64 hash;
+        SequenceTime time;
+        unsigned int mipMapLevel;
+        int view;
+
+        AliasKey(U64 hash_,SequenceTime time_,unsigned int mipMapLevel_,int view_)
+        : hash(hash_), time(time_), mipMapLevel(mipMapLevel_), view(view_)
+        {
+        }
+
+        bool operator==(const AliasKey& other) const
+        {
+            return hash == other.hash && time == other.time && mipMapLevel == other.mipMapLevel && view == other.view;
+        }
+    };
+
+    struct AliasKeyHash
+    {
+        std::size_t operator()(const AliasKey& key) const;
+    };
+
+    typedef boost::unordered_map<AliasKey,Target,AliasKeyHash> Aliases;
+
+    mutable QMutex _lock; //< protects _aliases
+    Aliases _aliases;
+};
+
+} // namespace Natron
+
+#endif // NATRON_ENGINE_IDENTITYALIASES_H_
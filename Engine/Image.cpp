@@ -11,12 +11,23 @@
 
 #include "Image.h"
 
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
 #include <QDebug>
+CLANG_DIAG_OFF(deprecated)
+#include <QtCore/QThreadPool>
+#include <QtCore/QtConcurrentMap>
+CLANG_DIAG_ON(deprecated)
 
 #include "Engine/AppManager.h"
 #include "Engine/ImageParams.h"
 #include "Engine/Lut.h"
 
+///Conversions of windows of more pixels than this are split across the threads of the global thread pool
+#define NATRON_CONVERT_TO_FORMAT_PARALLEL_THRESHOLD (256 * 256)
+
 using namespace Natron;
 
 
@@ -359,6 +370,30 @@ Image::Image(ImageComponents components,const RectI& regionOfDefinition,unsigned
     allocateMemory(false, "");
 }
 
+Image::Image(ImageComponents components,const RectI& regionOfDefinition,const RectI& bounds,unsigned int mipMapLevel,
+             Natron::ImageBitDepth bitdepth)
+: CacheEntryHelper<unsigned char,ImageKey>(makeKey(0,0,mipMapLevel,0),
+            boost::shared_ptr<const NonKeyParams>(new ImageParams(0,
+                                                regionOfDefinition,
+                                                bounds,
+                                                bitdepth,
+                                                false ,
+                                                components,
+                                                -1,
+                                                0,
+                                                std::map<int,std::vector<RangeD> >())),NULL)
+{
+    assert(!bounds.isNull());
+    assert(regionOfDefinition.downscalePowerOfTwoSmallestEnclosing(mipMapLevel).contains(bounds));
+    
+    _components = components;
+    _bitDepth = bitdepth;
+    _bitmap.initialize(bounds);
+    _rod = regionOfDefinition;
+    _pixelRod = bounds;
+    allocateMemory(false, "");
+}
+
 #ifdef NATRON_DEBUG
 void Image::onMemoryAllocated()
 {
@@ -385,15 +420,15 @@ boost::shared_ptr<ImageParams> Image::makeParams(int cost,const RectI& rod,unsig
 }
 
 template<typename PIX>
-void copyInternal(const Image& srcImg,Image& dstImg,const RectI& dstRoD,int elemCount,const RectI& renderWindow,bool copyBitmap)
+void copyInternal(const Image& srcImg,Image& dstImg,int elemCount,const RectI& renderWindow,bool copyBitmap)
 {
     for (int y = renderWindow.y1; y < renderWindow.y2; ++y) {
-        const PIX* src = (const PIX*)srcImg.pixelAt(dstRoD.x1, y);
+        const PIX* src = (const PIX*)srcImg.pixelAt(renderWindow.x1, y);
         PIX* dst = (PIX*)dstImg.pixelAt(renderWindow.x1, y);
         memcpy(dst, src, renderWindow.width() * sizeof(PIX) * elemCount);
         
         if (copyBitmap) {
-            const char* srcBm = srcImg.getBitmapAt(dstRoD.x1, y);
+            const char* srcBm = srcImg.getBitmapAt(renderWindow.x1, y);
             char* dstBm = dstImg.getBitmapAt(renderWindow.x1, y);
             memcpy(dstBm, srcBm, renderWindow.width());
         }
@@ -430,13 +465,16 @@ void Natron::Image::copy(const Natron::Image& other,const RectI& roi,bool copyBi
     int components = getElementsCountForComponents(getComponents());
     switch (depth) {
         case IMAGE_BYTE:
-            copyInternal<unsigned char>(other, *this, dstRoD, components, intersection, copyBitmap);
+            copyInternal<unsigned char>(other, *this, components, intersection, copyBitmap);
             break;
         case IMAGE_SHORT:
-            copyInternal<unsigned short>(other, *this, dstRoD, components, intersection, copyBitmap);
+            copyInternal<unsigned short>(other, *this, components, intersection, copyBitmap);
             break;
         case IMAGE_FLOAT:
-            copyInternal<float>(other, *this, dstRoD, components, intersection, copyBitmap);
+            copyInternal<float>(other, *this, components, intersection, copyBitmap);
+            break;
+        case IMAGE_HALF:
+            copyInternal<Half>(other, *this, components, intersection, copyBitmap);
             break;
         default:
             break;
@@ -482,6 +520,9 @@ void Natron::Image::fill(const RectI& rect,float r,float g,float b,float a) {
         case IMAGE_FLOAT:
             fillInternal<float, 1>(*this, rect, rowElems, comps, r, g, b, a);
             break;
+        case IMAGE_HALF:
+            fillInternal<Half, 1>(*this, rect, rowElems, comps, r, g, b, a);
+            break;
 
         default:
             break;
@@ -585,6 +626,9 @@ std::string Image::getDepthString(Natron::ImageBitDepth depth)
         case Natron::IMAGE_FLOAT:
             s += "32f";
             break;
+        case Natron::IMAGE_HALF:
+            s += "16f";
+            break;
         default:
             break;
     }
@@ -705,6 +749,9 @@ void Image::halveRoI(const RectI& roi,Natron::Image* output) const
         case IMAGE_FLOAT:
             halveRoIInternal<float,1>(*this,srcRoD, *output, dstRoD, srcRoI, dstRoI, components);
             break;
+        case IMAGE_HALF:
+            halveRoIInternal<Half,1>(*this,srcRoD, *output, dstRoD, srcRoI, dstRoI, components);
+            break;
         default:
             break;
     }
@@ -772,6 +819,9 @@ void Image::halve1DImage(const RectI& roi,Natron::Image* output) const
         case IMAGE_FLOAT:
             halve1DImageInternal<float , 1>(*this, *output, roi, width, height, components);
             break;
+        case IMAGE_HALF:
+            halve1DImageInternal<Half , 1>(*this, *output, roi, width, height, components);
+            break;
         default:
             break;
     }
@@ -854,6 +904,9 @@ void Image::upscale_mipmap(const RectI& roi,Natron::Image* output,unsigned int l
         case IMAGE_FLOAT:
             upscale_mipmapInternal<float,1>(*this, *output, srcRod, dstRod, components, srcRowSize, dstRowSize, scale);
             break;
+        case IMAGE_HALF:
+            upscale_mipmapInternal<Half,1>(*this, *output, srcRod, dstRod, components, srcRowSize, dstRowSize, scale);
+            break;
         default:
             break;
     }
@@ -1089,6 +1142,9 @@ void Image::scale_box_generic(const RectI& roi,Natron::Image* output) const
         case IMAGE_FLOAT:
             scale_box_genericInternal<float>(*this,srcRod, *output, dstRod);
             break;
+        case IMAGE_HALF:
+            scale_box_genericInternal<Half>(*this,srcRod, *output, dstRod);
+            break;
         default:
             break;
     }
@@ -1229,6 +1285,41 @@ template <> float convertPixelDepth(float pix)
 {
     return pix;
 }
+
+template <> Half convertPixelDepth(unsigned char pix)
+{
+    return Half(Color::intToFloat<256>(pix));
+}
+
+template <> Half convertPixelDepth(unsigned short pix)
+{
+    return Half(Color::intToFloat<65536>(pix));
+}
+
+template <> Half convertPixelDepth(float pix)
+{
+    return Half(pix);
+}
+
+template <> Half convertPixelDepth(Half pix)
+{
+    return pix;
+}
+
+template <> unsigned char convertPixelDepth(Half pix)
+{
+    return (unsigned char)Color::floatToInt<256>(pix);
+}
+
+template <> unsigned short convertPixelDepth(Half pix)
+{
+    return (unsigned short)Color::floatToInt<65536>(pix);
+}
+
+template <> float convertPixelDepth(Half pix)
+{
+    return pix;
+}
     
 template <typename PIX,int maxVal>
 PIX clampInternal(PIX v) {
@@ -1241,6 +1332,7 @@ template <> unsigned char clamp(unsigned char v) { return clampInternal<unsigned
 template <> unsigned short clamp(unsigned short v) { return clampInternal<unsigned short, 65535>(v); }
 template <> float clamp(float v) { return clampInternal<float, 1>(v); }
 template <> double clamp(double v) { return clampInternal<double, 1>(v); }
+template <> Half clamp(Half v) { return Half(clampInternal<float, 1>(v)); }
 
 }
 
@@ -1266,434 +1358,389 @@ lutFromColorspace(Natron::ViewerColorSpace cs)
     return lut;
 }
 
-///Fast version when components are the same
-template <typename SRCPIX,typename DSTPIX,int srcMaxValue,int dstMaxValue>
-void convertToFormatInternal_sameComps(const RectI& renderWindow,const Image& srcImg,Image& dstImg,
-                                       Natron::ViewerColorSpace srcColorSpace,
-                                       Natron::ViewerColorSpace dstColorSpace,
-                                       bool invert,bool copyBitmap)
+namespace {
+
+///The arguments of a conversion, shared by all the rows of the render window
+struct ConvertToFormatArgs
+{
+    const Image* srcImg;
+    Image* dstImg;
+    RectI window; //< the render window clipped to the bounds of the images
+    const Natron::Color::Lut* srcLut;
+    const Natron::Color::Lut* dstLut;
+    int channelForAlpha;
+    bool invert;
+    bool copyBitmap;
+    ///For 8 bits outputs converted through the color-spaces, the column of each row where the error diffusion starts.
+    ///They are drawn before the rows are split across threads so that the result does not depend on the split.
+    std::vector<int> ditherStarts;
+};
+
+typedef void (*ConvertRowsFunction)(const ConvertToFormatArgs& args,int y1,int y2);
+
+inline float
+toLinear(const Natron::Color::Lut* lut,unsigned char v)
 {
-    const RectI& r = srcImg.getPixelRoD();
+    return lut->fromColorSpaceUint8ToLinearFloatFast(v);
+}
 
-    RectI intersection;
-    if (!renderWindow.intersect(r, &intersection)) {
-        return;
+inline float
+toLinear(const Natron::Color::Lut* lut,unsigned short v)
+{
+    return lut->fromColorSpaceUint16ToLinearFloatFast(v);
+}
+
+inline float
+toLinear(const Natron::Color::Lut* lut,float v)
+{
+    return lut->fromColorSpaceFloatToLinearFloat(v);
+}
+
+inline float
+toLinear(const Natron::Color::Lut* lut,Half v)
+{
+    return lut->fromColorSpaceHalfToLinearFloatFast(v);
+}
+
+///Converts a linear float to the destination depth and color-space (if dstLut is not NULL).
+///error is the error diffusion of the channel, only 8 bits outputs use it.
+template <typename DSTPIX,int dstMaxValue>
+struct FromLinear
+{
+    static DSTPIX convert(const Natron::Color::Lut* dstLut,float pixFloat,unsigned* /*error*/)
+    {
+        if (dstLut) {
+            pixFloat = dstLut->toColorSpaceFloatFromLinearFloat(pixFloat);
+        }
+        return convertPixelDepth<float, DSTPIX>(pixFloat);
     }
-    
-    Natron::ImageBitDepth dstDepth = dstImg.getBitDepth();
-    Natron::ImageBitDepth srcDepth = srcImg.getBitDepth();
-    
-    int nComp = (int)srcImg.getComponentsCount();
+};
 
-    const Natron::Color::Lut* srcLut = lutFromColorspace(srcColorSpace);
-    const Natron::Color::Lut* dstLut = lutFromColorspace(dstColorSpace);
-    
-    ///no colorspace conversion applied when luts are the same
-    if (srcLut == dstLut) {
-        srcLut = dstLut = 0;
+template <>
+struct FromLinear<unsigned char,255>
+{
+    static unsigned char convert(const Natron::Color::Lut* dstLut,float pixFloat,unsigned* error)
+    {
+        ///small increase in perf we use Luts. This should be anyway the most used case.
+        *error = (*error & 0xff) + (dstLut ? dstLut->toColorSpaceUint8xxFromLinearFloatFast(pixFloat) :
+                                    Color::floatToInt<0xff01>(pixFloat));
+        return (unsigned char)(*error >> 8);
     }
-    
-    for (int y = 0; y < intersection.height();++y) {
-        
-        int start = rand() % intersection.width();
-        
-        const SRCPIX* srcPixels = (const SRCPIX*)srcImg.pixelAt(intersection.x1 + start, intersection.y1 + y);
-        DSTPIX* dstPixels = (DSTPIX*)dstImg.pixelAt(intersection.x1 + start, intersection.y1 + y);
-        const SRCPIX* srcStart = srcPixels;
-        DSTPIX* dstStart = dstPixels;
-        
-        for (int backward = 0;backward < 2; ++backward) {
-            int x = backward ? start - 1 : start;
-            int end = backward ? -1 : intersection.width();
-            
-            unsigned error[3] = { 0x80,0x80,0x80 };
-            
-            while (x != end && x >= 0 && x < intersection.width()) {
-                
-                for (int k = 0; k < nComp; ++k) {
-                    
-                    if (k <= 2 && (srcLut || dstLut)) {
-                        float pixFloat;
-                        
-                        if (srcLut) {
-                            if (srcDepth == IMAGE_BYTE) {
-                                pixFloat = srcLut->fromColorSpaceUint8ToLinearFloatFast(srcPixels[k]);
-                            } else if (srcDepth == IMAGE_SHORT) {
-                                pixFloat = srcLut->fromColorSpaceUint16ToLinearFloatFast(srcPixels[k]);
-                            } else {
-                                pixFloat = srcLut->fromColorSpaceFloatToLinearFloat(srcPixels[k]);
-                            }
-                        } else {
-                            pixFloat = convertPixelDepth<SRCPIX, float>(srcPixels[k]);
-                        }
-                        
-
-                        DSTPIX pix;
-                        if (dstDepth == IMAGE_BYTE) {
-                            ///small increase in perf we use Luts. This should be anyway the most used case.
-                            error[k] = (error[k]&0xff) + (dstLut ? dstLut->toColorSpaceUint8xxFromLinearFloatFast(pixFloat) :
-                                                          Color::floatToInt<0xff01>(pixFloat));
-                            pix = error[k] >> 8;
-                        } else if (dstDepth == IMAGE_SHORT) {
-                            pix = dstLut ? dstLut->toColorSpaceUint16FromLinearFloatFast(pixFloat) :
-                            convertPixelDepth<float, DSTPIX>(pixFloat);
-                        } else {
-                            
-                            if (dstLut) {
-                                pixFloat = dstLut->toColorSpaceFloatFromLinearFloat(pixFloat);
-                            }
-                            pix = convertPixelDepth<float, DSTPIX>(pixFloat);
-                        }
-                        dstPixels[k] = invert ? dstMaxValue - pix : pix;
-                        
-                    } else {
-                        DSTPIX pix = convertPixelDepth<SRCPIX, DSTPIX>(srcPixels[k]);
-                        dstPixels[k] = invert ? dstMaxValue - pix : pix;
-                    }
-                }
-                
-                if (backward) {
-                    --x;
-                    srcPixels -= nComp;
-                    dstPixels -= nComp;
+};
+
+template <>
+struct FromLinear<unsigned short,65535>
+{
+    static unsigned short convert(const Natron::Color::Lut* dstLut,float pixFloat,unsigned* /*error*/)
+    {
+        return dstLut ? (unsigned short)dstLut->toColorSpaceUint16FromLinearFloatFast(pixFloat) :
+        convertPixelDepth<float, unsigned short>(pixFloat);
+    }
+};
+
+///The number of channels converted through the color-spaces: alpha is never converted, except by alpha to alpha conversions
+template <int srcNComps,int dstNComps>
+struct ColorChannels
+{
+    enum { value = ((srcNComps == 1) != (dstNComps == 1)) ? 0 :
+           (srcNComps == 4 && dstNComps == 4) ? 3 : (srcNComps < dstNComps ? srcNComps : dstNComps) };
+};
+
+template <typename SRCPIX,typename DSTPIX,int srcMaxValue,int dstMaxValue,int srcNComps,int dstNComps,int colorChannels>
+inline void
+convertPixel(const ConvertToFormatArgs& args,const SRCPIX* srcPixels,DSTPIX* dstPixels,unsigned* error)
+{
+    if (dstNComps == 1 && srcNComps != 1) {
+        assert(args.channelForAlpha < srcNComps && args.channelForAlpha >= 0);
+        DSTPIX pix = convertPixelDepth<SRCPIX, DSTPIX>(srcPixels[args.channelForAlpha]);
+        *dstPixels = args.invert ? DSTPIX(dstMaxValue - pix) : pix;
+    } else if (srcNComps == 1 && dstNComps != 1) {
+        DSTPIX pix = convertPixelDepth<SRCPIX, DSTPIX>(*srcPixels);
+        if (dstNComps == 3) {
+            for (int k = 0; k < dstNComps; ++k) {
+                dstPixels[k] = args.invert ? DSTPIX(dstMaxValue - pix) : pix;
+            }
+        } else {
+            for (int k = 0; k < dstNComps - 1; ++k) {
+                dstPixels[k] = args.invert ? dstMaxValue : 0;
+            }
+            dstPixels[dstNComps - 1] = args.invert ? DSTPIX(dstMaxValue) : pix;
+        }
+    } else {
+        for (int k = 0; k < dstNComps; ++k) {
+            if (k < srcNComps) {
+                DSTPIX pix;
+                if (k < colorChannels) {
+                    float pixFloat = args.srcLut ? toLinear(args.srcLut, srcPixels[k]) : convertPixelDepth<SRCPIX, float>(srcPixels[k]);
+                    pix = FromLinear<DSTPIX,dstMaxValue>::convert(args.dstLut, pixFloat, &error[k]);
                 } else {
-                    ++x;
-                    srcPixels += nComp;
-                    dstPixels += nComp;
+                    pix = convertPixelDepth<SRCPIX, DSTPIX>(srcPixels[k]);
+                }
+                dstPixels[k] = args.invert ? DSTPIX(dstMaxValue - pix) : pix;
+            } else {
+                dstPixels[k] = k == 3 ? dstMaxValue :  0.;
+                if (args.invert) {
+                    dstPixels[k] = dstMaxValue - dstPixels[k];
                 }
             }
-            srcPixels = srcStart - nComp;
-            dstPixels = dstStart - nComp;
         }
+    }
+}
 
-        if (copyBitmap) {
-            const char* srcBitmap = srcImg.getBitmapAt(intersection.x1, intersection.y1 + y);
-            char* dstBitmap = dstImg.getBitmapAt(intersection.x1, intersection.y1 + y);
-            memcpy(dstBitmap, srcBitmap, intersection.width());
+/**
+ * @brief Converts the rows [y1,y2[ of the window. All the parameters that change the inner loop are template
+ * parameters, so that the compiler can unroll the channels loop and vectorize the conversions that do not go
+ * through the color-spaces.
+ **/
+template <typename SRCPIX,typename DSTPIX,int srcMaxValue,int dstMaxValue,int srcNComps,int dstNComps,int colorChannels>
+void
+convertRows(const ConvertToFormatArgs& args,int y1,int y2)
+{
+    const RectI& window = args.window;
+    ///8 bits outputs of values converted through the color-spaces are dithered by error diffusion
+    const bool dither = colorChannels > 0 && dstMaxValue == 255;
+    const bool sameDepth = srcMaxValue == dstMaxValue && sizeof(SRCPIX) == sizeof(DSTPIX);
+
+    for (int y = y1; y < y2; ++y) {
+        const SRCPIX* srcPixels = (const SRCPIX*)args.srcImg->pixelAt(window.x1, y);
+        DSTPIX* dstPixels = (DSTPIX*)args.dstImg->pixelAt(window.x1, y);
+
+        if (dstNComps == 1 && srcNComps != 1 && args.channelForAlpha == -1) {
+            ///clear out the mask
+            std::fill(dstPixels, dstPixels + window.width(), 0.);
+        } else if (sameDepth && srcNComps == dstNComps && colorChannels == 0 && !args.invert) {
+            ///Same as a copy
+            memcpy((void*)dstPixels, (const void*)srcPixels, window.width() * dstNComps * sizeof(DSTPIX));
+        } else if (dither) {
+            ///the error diffusion goes forward from a random column, then backward from it
+            int start = args.ditherStarts[y - window.y1];
+            unsigned error[3] = { 0x80,0x80,0x80 };
+            for (int x = start; x < window.width(); ++x) {
+                convertPixel<SRCPIX,DSTPIX,srcMaxValue,dstMaxValue,srcNComps,dstNComps,colorChannels>(args, srcPixels + x * srcNComps,
+                                                                                                        dstPixels + x * dstNComps, error);
+            }
+            error[0] = error[1] = error[2] = 0x80;
+            for (int x = start - 1; x >= 0; --x) {
+                convertPixel<SRCPIX,DSTPIX,srcMaxValue,dstMaxValue,srcNComps,dstNComps,colorChannels>(args, srcPixels + x * srcNComps,
+                                                                                                        dstPixels + x * dstNComps, error);
+            }
+        } else {
+            unsigned error[3] = { 0x80,0x80,0x80 };
+            for (int x = 0; x < window.width(); ++x, srcPixels += srcNComps, dstPixels += dstNComps) {
+                convertPixel<SRCPIX,DSTPIX,srcMaxValue,dstMaxValue,srcNComps,dstNComps,colorChannels>(args, srcPixels, dstPixels, error);
+            }
+        }
+
+        if (args.copyBitmap) {
+            memcpy(args.dstImg->getBitmapAt(window.x1, y), args.srcImg->getBitmapAt(window.x1, y), window.width());
         }
     }
 }
 
-template <typename SRCPIX,typename DSTPIX,int srcMaxValue,int dstMaxValue>
-void convertToFormatInternal(const RectI& renderWindow,const Image& srcImg,Image& dstImg,
-                             Natron::ViewerColorSpace srcColorSpace,
-                             Natron::ViewerColorSpace dstColorSpace,
-                             int channelForAlpha,bool invert,bool copyBitmap)
+///Float <-> half conversions without color-space conversion: the rows are contiguous, convert them at once
+///with the bulk conversions which use the F16C instructions when available.
+void
+convertFloatHalfRows(const ConvertToFormatArgs& args,int y1,int y2)
 {
-    
-    const RectI& r = srcImg.getPixelRoD();
-    
-    RectI intersection;
-    if (!renderWindow.intersect(r, &intersection)) {
-        return;
+    const RectI& window = args.window;
+    std::size_t rowElems = (std::size_t)window.width() * args.srcImg->getComponentsCount();
+    bool toHalf = args.dstImg->getBitDepth() == IMAGE_HALF;
+    for (int y = y1; y < y2; ++y) {
+        if (toHalf) {
+            HalfFloat::fromFloat((const float*)args.srcImg->pixelAt(window.x1, y),
+                                 (unsigned short*)args.dstImg->pixelAt(window.x1, y), rowElems);
+        } else {
+            HalfFloat::toFloat((const unsigned short*)args.srcImg->pixelAt(window.x1, y),
+                               (float*)args.dstImg->pixelAt(window.x1, y), rowElems);
+        }
+        if (args.copyBitmap) {
+            memcpy(args.dstImg->getBitmapAt(window.x1, y), args.srcImg->getBitmapAt(window.x1, y), window.width());
+        }
     }
-    
-    Natron::ImageComponents dstComp = dstImg.getComponents();
-    Natron::ImageBitDepth dstDepth = dstImg.getBitDepth();
-    Natron::ImageBitDepth srcDepth = srcImg.getBitDepth();
-    
-    bool sameBitDepth = srcImg.getBitDepth() == dstImg.getBitDepth();
+}
 
-    int dstNComp = getElementsCountForComponents(dstComp);
-    int srcNComp = getElementsCountForComponents(srcImg.getComponents());
+template <typename SRCPIX,typename DSTPIX,int srcMaxValue,int dstMaxValue,int srcNComps,int dstNComps>
+ConvertRowsFunction
+getConvertRowsFunction(bool useColorSpace)
+{
+    if (useColorSpace) {
+        return &convertRows<SRCPIX,DSTPIX,srcMaxValue,dstMaxValue,srcNComps,dstNComps,ColorChannels<srcNComps,dstNComps>::value>;
+    }
+    return &convertRows<SRCPIX,DSTPIX,srcMaxValue,dstMaxValue,srcNComps,dstNComps,0>;
+}
 
-    ///special case comp == alpha && channelForAlpha = -1 clear out the mask
-    if (dstComp == Natron::ImageComponentAlpha && channelForAlpha == -1) {
-        DSTPIX* dstPixels = (DSTPIX*)dstImg.pixelAt(intersection.x1, intersection.y1);
-        
-        for (int y = 0; y < intersection.height();
-             ++y, dstPixels += (r.width() * dstNComp)) {
-            std::fill(dstPixels, dstPixels + intersection.width() * dstNComp, 0.);
-            if (copyBitmap) {
-                const char* srcBitmap = srcImg.getBitmapAt(intersection.x1, intersection.y1 + y);
-                char* dstBitmap = dstImg.getBitmapAt(intersection.x1, intersection.y1 + y);
-                memcpy(dstBitmap, srcBitmap, intersection.width());
+template <typename SRCPIX,typename DSTPIX,int srcMaxValue,int dstMaxValue>
+ConvertRowsFunction
+getConvertRowsFunctionForDepths(int srcNComps,int dstNComps,bool useColorSpace)
+{
+    switch (srcNComps) {
+        case 1:
+            switch (dstNComps) {
+                case 1:
+                    return getConvertRowsFunction<SRCPIX,DSTPIX,srcMaxValue,dstMaxValue,1,1>(useColorSpace);
+                case 3:
+                    return getConvertRowsFunction<SRCPIX,DSTPIX,srcMaxValue,dstMaxValue,1,3>(useColorSpace);
+                case 4:
+                    return getConvertRowsFunction<SRCPIX,DSTPIX,srcMaxValue,dstMaxValue,1,4>(useColorSpace);
+                default:
+                    break;
             }
-        }
-        return;
+            break;
+        case 3:
+            switch (dstNComps) {
+                case 1:
+                    return getConvertRowsFunction<SRCPIX,DSTPIX,srcMaxValue,dstMaxValue,3,1>(useColorSpace);
+                case 3:
+                    return getConvertRowsFunction<SRCPIX,DSTPIX,srcMaxValue,dstMaxValue,3,3>(useColorSpace);
+                case 4:
+                    return getConvertRowsFunction<SRCPIX,DSTPIX,srcMaxValue,dstMaxValue,3,4>(useColorSpace);
+                default:
+                    break;
+            }
+            break;
+        case 4:
+            switch (dstNComps) {
+                case 1:
+                    return getConvertRowsFunction<SRCPIX,DSTPIX,srcMaxValue,dstMaxValue,4,1>(useColorSpace);
+                case 3:
+                    return getConvertRowsFunction<SRCPIX,DSTPIX,srcMaxValue,dstMaxValue,4,3>(useColorSpace);
+                case 4:
+                    return getConvertRowsFunction<SRCPIX,DSTPIX,srcMaxValue,dstMaxValue,4,4>(useColorSpace);
+                default:
+                    break;
+            }
+            break;
+        default:
+            break;
     }
-    
-    const Natron::Color::Lut* srcLut = lutFromColorspace(srcColorSpace);
-    const Natron::Color::Lut* dstLut = lutFromColorspace(dstColorSpace);
-
-    
-    for (int y = 0; y < intersection.height(); ++y) {
-        
-        int start = rand() % intersection.width();
-        
-        const SRCPIX* srcPixels = (const SRCPIX*)srcImg.pixelAt(intersection.x1 + start, intersection.y1 + y);
-        DSTPIX* dstPixels = (DSTPIX*)dstImg.pixelAt(intersection.x1 + start, intersection.y1 + y);
-        const SRCPIX* srcStart = srcPixels;
-        DSTPIX* dstStart = dstPixels;
-        
-        for (int backward = 0;backward < 2; ++backward) {
-            int x = backward ? start - 1 : start;
-            int end = backward ? -1 : intersection.width();
-            
-            unsigned error[3] = { 0x80,0x80,0x80 };
-            
-            while (x != end && x >= 0 && x < intersection.width()) {
-                
-                if (dstComp == Natron::ImageComponentAlpha) {
-                    assert(channelForAlpha < srcNComp && channelForAlpha >= 0);
-                    *dstPixels = !sameBitDepth ? convertPixelDepth<SRCPIX, DSTPIX>(srcPixels[channelForAlpha])
-                    : srcPixels[channelForAlpha];
-                    if (invert) {
-                        *dstPixels = dstMaxValue - *dstPixels;
-                    }
-                } else {
-                    if (srcImg.getComponents() == Natron::ImageComponentAlpha) {
-                        if (dstComp == Natron::ImageComponentRGB) {
-                            for (int k = 0; k < dstNComp; ++k) {
-                                DSTPIX pix = convertPixelDepth<SRCPIX, DSTPIX>(*srcPixels);
-                                dstPixels[k] = invert ? dstMaxValue - pix : pix;
-                            }
-                        } else {
-                            assert(dstComp == Natron::ImageComponentRGBA);
-                            for (int k = 0; k < dstNComp - 1; ++k) {
-                                dstPixels[k] = invert ? dstMaxValue : 0;
-                            }
-                            DSTPIX pix = convertPixelDepth<SRCPIX, DSTPIX>(*srcPixels);
-                            dstPixels[3] = invert ? dstMaxValue : pix;
-                        }
-                    } else {
-                        for (int k = 0; k < dstNComp; ++k) {
-                            if (k < srcNComp) {
-                                if (k <= 2 && (srcLut || dstLut)) {
-                                    float pixFloat;
-                                    
-                                    if (srcLut) {
-                                        if (srcDepth == IMAGE_BYTE) {
-                                            pixFloat = srcLut->fromColorSpaceUint8ToLinearFloatFast(srcPixels[k]);
-                                        } else if (srcDepth == IMAGE_SHORT) {
-                                            pixFloat = srcLut->fromColorSpaceUint16ToLinearFloatFast(srcPixels[k]);
-                                        } else {
-                                            pixFloat = srcLut->fromColorSpaceFloatToLinearFloat(srcPixels[k]);
-                                        }
-                                    } else {
-                                        pixFloat = convertPixelDepth<SRCPIX, float>(srcPixels[k]);
-                                    }
-                                    
-                                    
-                                    DSTPIX pix;
-                                    if (dstDepth == IMAGE_BYTE) {
-                                        error[k] = (error[k]&0xff) + (dstLut ? dstLut->toColorSpaceUint8xxFromLinearFloatFast(pixFloat):
-                                                                      Color::floatToInt<0xff01>(pixFloat));
-                                        pix = error[k] >> 8;
-                                    } else if (dstDepth == IMAGE_SHORT) {
-                                        pix = dstLut ? dstLut->toColorSpaceUint16FromLinearFloatFast(pixFloat) :
-                                        convertPixelDepth<float, DSTPIX>(pixFloat);
-                                    } else {
-                                        if (dstLut) {
-                                            pixFloat = dstLut->toColorSpaceFloatFromLinearFloat(pixFloat);
-                                        } else {
-                                            pix = convertPixelDepth<float, DSTPIX>(pixFloat);
-                                        }
-                                    }
-                                    dstPixels[k] = invert ? dstMaxValue - pix : pix;
-                                    
-                                } else {
-                                    DSTPIX pix = convertPixelDepth<SRCPIX, DSTPIX>(srcPixels[k]);
-                                    dstPixels[k] = invert ? dstMaxValue - pix : pix;
-                                }
-                                
-                            } else {
-                                dstPixels[k] = k == 3 ? dstMaxValue :  0.;
-                                if (invert) {
-                                    dstPixels[k] = dstMaxValue - dstPixels[k];
-                                }
-                            }
-                        }
-                    }
-                }
+    return NULL;
+}
 
-                if (backward) {
-                    --x;
-                    srcPixels -= srcNComp;
-                    dstPixels -= dstNComp;
-                } else {
-                    ++x;
-                    srcPixels += srcNComp;
-                    dstPixels += dstNComp;
-                }
-            }
-            srcPixels = srcStart - srcNComp;
-            dstPixels = dstStart - dstNComp;
-        }
-        
-        
-        if (copyBitmap) {
-            const char* srcBitmap = srcImg.getBitmapAt(intersection.x1, intersection.y1 + y);
-            char* dstBitmap = dstImg.getBitmapAt(intersection.x1, intersection.y1 + y);
-            memcpy(dstBitmap, srcBitmap, intersection.width());
-        }
-        
+template <typename SRCPIX,int srcMaxValue>
+ConvertRowsFunction
+getConvertRowsFunctionForSrcDepth(Natron::ImageBitDepth dstDepth,int srcNComps,int dstNComps,bool useColorSpace)
+{
+    switch (dstDepth) {
+        case IMAGE_BYTE:
+            return getConvertRowsFunctionForDepths<SRCPIX,unsigned char,srcMaxValue,255>(srcNComps, dstNComps, useColorSpace);
+        case IMAGE_SHORT:
+            return getConvertRowsFunctionForDepths<SRCPIX,unsigned short,srcMaxValue,65535>(srcNComps, dstNComps, useColorSpace);
+        case IMAGE_FLOAT:
+            return getConvertRowsFunctionForDepths<SRCPIX,float,srcMaxValue,1>(srcNComps, dstNComps, useColorSpace);
+        case IMAGE_HALF:
+            return getConvertRowsFunctionForDepths<SRCPIX,Half,srcMaxValue,1>(srcNComps, dstNComps, useColorSpace);
+        default:
+            break;
     }
-    
+    return NULL;
 }
 
+struct ConvertRowsFunctor
+{
+    typedef void result_type;
+
+    ConvertRowsFunction function;
+    const ConvertToFormatArgs* args;
+    int rowsPerChunk;
 
+    void operator()(const int& chunk) const
+    {
+        int y1 = args->window.y1 + chunk * rowsPerChunk;
+        function(*args, y1, std::min(y1 + rowsPerChunk, args->window.y2));
+    }
+};
+
+///Converts the window on the calling thread, or splits its rows across the idle threads of the global pool if it is large enough
+void
+convertRowsInParallel(ConvertRowsFunction function,const ConvertToFormatArgs& args)
+{
+    const RectI& window = args.window;
+    int chunksCount = 1;
+    if (window.area() > NATRON_CONVERT_TO_FORMAT_PARALLEL_THRESHOLD) {
+        ///conversions are mostly made by render threads, which already occupy the pool: only use the idle threads.
+        ///activeThreadCount may be negative (for example if releaseThread() is called)
+        QThreadPool* pool = QThreadPool::globalInstance();
+        int idleThreads = std::max(0, pool->maxThreadCount() - std::max(0,pool->activeThreadCount()));
+        chunksCount = (int)std::min((U64)idleThreads + 1, window.area() / NATRON_CONVERT_TO_FORMAT_PARALLEL_THRESHOLD);
+        chunksCount = std::min(chunksCount, window.height());
+    }
+    if (chunksCount <= 1) {
+        function(args, window.y1, window.y2);
+        return;
+    }
+
+    ConvertRowsFunctor f;
+    f.function = function;
+    f.args = &args;
+    f.rowsPerChunk = (window.height() + chunksCount - 1) / chunksCount;
+    std::vector<int> chunks((window.height() + f.rowsPerChunk - 1) / f.rowsPerChunk);
+    for (U32 i = 0; i < chunks.size(); ++i) {
+        chunks[i] = i;
+    }
+    QtConcurrent::blockingMap(chunks, f);
+}
+
+} // anon namespace
 
 void Image::convertToFormat(const RectI& renderWindow,Natron::Image* dstImg,
                             Natron::ViewerColorSpace srcColorSpace,
                             Natron::ViewerColorSpace dstColorSpace,
                             int channelForAlpha,bool invert,bool copyBitmap) const
 {
-    assert(getPixelRoD() == dstImg->getPixelRoD());
-    
-    if (dstImg->getComponents() == getComponents()) {
-        switch (dstImg->getBitDepth()) {
-            case IMAGE_BYTE: {
-                switch (getBitDepth()) {
-                    case IMAGE_BYTE:
-                        ///Same as a copy
-                        convertToFormatInternal_sameComps<unsigned char, unsigned char, 255, 255>(renderWindow,*this, *dstImg,
-                                                                                                  srcColorSpace,
-                                                                                                  dstColorSpace,invert,copyBitmap);
-                        break;
-                    case IMAGE_SHORT:
-                        convertToFormatInternal_sameComps<unsigned short, unsigned char, 65535, 255>(renderWindow,*this, *dstImg,
-                                                                                                     srcColorSpace,
-                                                                                                     dstColorSpace,invert,copyBitmap);
-                        break;
-                    case IMAGE_FLOAT:
-                        convertToFormatInternal_sameComps<float, unsigned char, 1, 255>(renderWindow,*this, *dstImg,
-                                                                                        srcColorSpace,
-                                                                                        dstColorSpace,invert,copyBitmap);
-                        break;
-                    default:
-                        break;
-                }
-            } break;
-            case IMAGE_SHORT: {
-                switch (getBitDepth()) {
-                    case IMAGE_BYTE:
-                        convertToFormatInternal_sameComps<unsigned char, unsigned short, 255, 65535>(renderWindow,*this, *dstImg,
-                                                                                                     srcColorSpace,
-                                                                                                     dstColorSpace,invert,copyBitmap);
-                        break;
-                    case IMAGE_SHORT:
-                        ///Same as a copy
-                        convertToFormatInternal_sameComps<unsigned short, unsigned short, 65535, 65535>(renderWindow,*this, *dstImg,
-                                                                                                        srcColorSpace,
-                                                                                                        dstColorSpace,invert,copyBitmap);
-                        break;
-                    case IMAGE_FLOAT:
-                        convertToFormatInternal_sameComps<float, unsigned short, 1, 65535>(renderWindow,*this, *dstImg,
-                                                                                           srcColorSpace,
-                                                                                           dstColorSpace,invert,copyBitmap);
-                        break;
-                    default:
-                        break;
-                }
-            } break;
-            case IMAGE_FLOAT: {
-                switch (getBitDepth()) {
-                    case IMAGE_BYTE:
-                        convertToFormatInternal_sameComps<unsigned char, float, 255, 1>(renderWindow,*this, *dstImg,
-                                                                                        srcColorSpace,
-                                                                                        dstColorSpace,invert,copyBitmap);
-                        break;
-                    case IMAGE_SHORT:
-                        convertToFormatInternal_sameComps<unsigned short, float, 65535, 1>(renderWindow,*this, *dstImg,
-                                                                                           srcColorSpace,
-                                                                                           dstColorSpace,invert,copyBitmap);
-                        break;
-                    case IMAGE_FLOAT:
-                        ///Same as a copy
-                        convertToFormatInternal_sameComps<float, float, 1, 1>(renderWindow,*this, *dstImg,
-                                                                              srcColorSpace,
-                                                                              dstColorSpace,invert,copyBitmap);
-                        break;
-                    default:
-                        break;
-                }
-            } break;
-                
-            default:
-                break;
-        }
+    assert(getMipMapLevel() == dstImg->getMipMapLevel());
+
+    ConvertToFormatArgs args;
+    if (!renderWindow.intersect(getPixelRoD(), &args.window) || !args.window.intersect(dstImg->getPixelRoD(), &args.window)) {
+        return;
+    }
+    args.srcImg = this;
+    args.dstImg = dstImg;
+    args.srcLut = lutFromColorspace(srcColorSpace);
+    args.dstLut = lutFromColorspace(dstColorSpace);
+    args.channelForAlpha = channelForAlpha;
+    args.invert = invert;
+    args.copyBitmap = copyBitmap;
+
+    int srcNComps = getElementsCountForComponents(getComponents());
+    int dstNComps = getElementsCountForComponents(dstImg->getComponents());
+    bool sameComps = srcNComps == dstNComps;
+
+    ConvertRowsFunction function = NULL;
+    if (sameComps && !invert && args.srcLut == args.dstLut &&
+        ((getBitDepth() == IMAGE_FLOAT && dstImg->getBitDepth() == IMAGE_HALF) ||
+         (getBitDepth() == IMAGE_HALF && dstImg->getBitDepth() == IMAGE_FLOAT))) {
+        function = &convertFloatHalfRows;
     } else {
-        switch (dstImg->getBitDepth()) {
-            case IMAGE_BYTE: {
-                switch (getBitDepth()) {
-                    case IMAGE_BYTE:
-                        convertToFormatInternal<unsigned char, unsigned char, 255, 255>(renderWindow,*this, *dstImg,
-                                                                                        srcColorSpace,
-                                                                                        dstColorSpace,
-                                                                                        channelForAlpha,
-                                                                                        invert,copyBitmap);
-                        break;
-                    case IMAGE_SHORT:
-                        convertToFormatInternal<unsigned short, unsigned char, 65535, 255>(renderWindow,*this, *dstImg,
-                                                                                           srcColorSpace,
-                                                                                           dstColorSpace,
-                                                                                           channelForAlpha,
-                                                                                           invert,copyBitmap);
-                        break;
-                    case IMAGE_FLOAT:
-                        convertToFormatInternal<float, unsigned char, 1, 255>(renderWindow,*this, *dstImg,
-                                                                              srcColorSpace,
-                                                                              dstColorSpace,
-                                                                              channelForAlpha,
-                                                                              invert,copyBitmap);
-                        break;
-                    default:
-                        break;
-                }
-            } break;
-            case IMAGE_SHORT: {
-                switch (getBitDepth()) {
-                    case IMAGE_BYTE:
-                        convertToFormatInternal<unsigned char, unsigned short, 255, 65535>(renderWindow,*this, *dstImg,
-                                                                                           srcColorSpace,
-                                                                                           dstColorSpace,
-                                                                                           channelForAlpha,
-                                                                                           invert,copyBitmap);
-                        break;
-                    case IMAGE_SHORT:
-                        convertToFormatInternal<unsigned short, unsigned short, 65535, 65535>(renderWindow,*this, *dstImg,
-                                                                                              srcColorSpace,
-                                                                                              dstColorSpace,channelForAlpha, invert,copyBitmap);
-                        break;
-                    case IMAGE_FLOAT:
-                        convertToFormatInternal<float, unsigned short, 1, 65535>(renderWindow,*this, *dstImg,
-                                                                                 srcColorSpace,
-                                                                                 dstColorSpace,
-                                                                                 channelForAlpha,
-                                                                                 invert,copyBitmap);
-                        break;
-                    default:
-                        break;
-                }
-            } break;
-            case IMAGE_FLOAT: {
-                switch (getBitDepth()) {
-                    case IMAGE_BYTE:
-                        convertToFormatInternal<unsigned char, float, 255, 1>(renderWindow,*this, *dstImg,
-                                                                              srcColorSpace,
-                                                                              dstColorSpace, channelForAlpha,
-                                                                              invert,copyBitmap);
-                        break;
-                    case IMAGE_SHORT:
-                        convertToFormatInternal<unsigned short, float, 65535, 1>(renderWindow,*this, *dstImg,
-                                                                                 srcColorSpace,
-                                                                                 dstColorSpace, channelForAlpha,
-                                                                                 invert,copyBitmap);
-                        break;
-                    case IMAGE_FLOAT:
-                        convertToFormatInternal<float, float, 1, 1>(renderWindow,*this, *dstImg,
-                                                                    srcColorSpace,
-                                                                    dstColorSpace, channelForAlpha,
-                                                                    invert,copyBitmap);
-                        break;
-                    default:
-                        break;
-                }
-            } break;
-                
+        ///no colorspace conversion applied when luts are the same and components too
+        if (sameComps && args.srcLut == args.dstLut) {
+            args.srcLut = args.dstLut = 0;
+        }
+        bool useColorSpace = args.srcLut || args.dstLut;
+        switch (getBitDepth()) {
+            case IMAGE_BYTE:
+                function = getConvertRowsFunctionForSrcDepth<unsigned char,255>(dstImg->getBitDepth(), srcNComps, dstNComps, useColorSpace);
+                break;
+            case IMAGE_SHORT:
+                function = getConvertRowsFunctionForSrcDepth<unsigned short,65535>(dstImg->getBitDepth(), srcNComps, dstNComps, useColorSpace);
+                break;
+            case IMAGE_FLOAT:
+                function = getConvertRowsFunctionForSrcDepth<float,1>(dstImg->getBitDepth(), srcNComps, dstNComps, useColorSpace);
+                break;
+            case IMAGE_HALF:
+                function = getConvertRowsFunctionForSrcDepth<Half,1>(dstImg->getBitDepth(), srcNComps, dstNComps, useColorSpace);
+                break;
             default:
                 break;
         }
+        if (useColorSpace && dstImg->getBitDepth() == IMAGE_BYTE) {
+            args.ditherStarts.resize(args.window.height());
+            for (U32 i = 0; i < args.ditherStarts.size(); ++i) {
+                args.ditherStarts[i] = rand() % args.window.width();
+            }
+        }
+    }
+    if (!function) {
+        return;
     }
+    convertRowsInParallel(function, args);
 }
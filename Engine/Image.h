@@ -23,6 +23,8 @@ CLANG_DIAG_ON(deprecated)
 #include <QtCore/QReadWriteLock>
 
 #include "Engine/CacheEntry.h"
+#include "Engine/HalfFloat.h"
+#include "Engine/MemoryPool.h"
 #include "Engine/Rect.h"
 
 namespace Natron {
@@ -62,13 +64,12 @@ namespace Natron {
     public:
         Bitmap(const RectI& rod)
         : _rod(rod)
-        , _map(new char[rod.area()])
+        , _map((char*)MemoryPool::instance()->allocate(rod.area(),true))
         {
-            //Do not assert !rod.isNull() : An empty image can be created for entries that correspond to
-            // "identities" images (i.e: images that are just a link to another image). See EffectInstance :
-            // "!!!Note that if isIdentity is true it will allocate an empty image object with 0 bytes of data."
+            //Do not assert !rod.isNull() : the disk cache of a previous version may contain empty images for entries that
+            // correspond to "identities" images (i.e: images that are just a link to another image). They are discarded
+            // when found, identities are now recorded as aliases, see IdentityAliases.
             //assert(!rod.isNull());
-            clear();
         }
         
         Bitmap()
@@ -82,11 +83,10 @@ namespace Natron {
         {
             assert(!_map);
             _rod = rod;
-            _map = new char[rod.area()];
-            clear();
+            _map = (char*)MemoryPool::instance()->allocate(rod.area(),true);
         }
         
-        ~Bitmap() { delete [] _map; }
+        ~Bitmap() { MemoryPool::instance()->deallocate(_map,_rod.area()); }
         
         void clear() { std::fill(_map, _map+ _rod.area(), 0); }
         
@@ -135,6 +135,11 @@ namespace Natron {
          as it is not needed.*/
         Image(ImageComponents components,const RectI& regionOfDefinition,unsigned int mipMapLevel,Natron::ImageBitDepth bitdepth);
         
+        /*Same as above except that only the pixels within bounds, in pixel coordinates at the given mipmap level,
+         are allocated. bounds must be contained in the region of definition.*/
+        Image(ImageComponents components,const RectI& regionOfDefinition,const RectI& bounds,unsigned int mipMapLevel,
+              Natron::ImageBitDepth bitdepth);
+        
         virtual ~Image(){ deallocate(); }
 #ifdef NATRON_DEBUG
         virtual void onMemoryAllocated() OVERRIDE FINAL;
@@ -298,7 +303,8 @@ namespace Natron {
          *
          * Also this function converts to the output bit depth.
          *
-         * This function only works for images with the same region of definition and mipmaplevel.
+         * This function only works for images with the same mipmaplevel. Their bounds may differ, in which case
+         * only the part of the renderWindow contained in both is converted.
          *
          *
          * @param renderWindow The rectangle to convert
@@ -318,6 +324,10 @@ namespace Natron {
          * RGBA --> Alpha
          * or bit depth conversion
          * Implementation should tend to optimize these cases.
+         *
+         * Each combination of depths, components and color-space use has its own conversion function and
+         * large windows are split across the idle threads
+         * of the global thread pool.
          **/
         void convertToFormat(const RectI& renderWindow,Natron::Image* dstImg,
                              Natron::ViewerColorSpace srcColorSpace,
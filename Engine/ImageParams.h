@@ -35,6 +35,8 @@ namespace Natron {
                 return sizeof(unsigned short);
             case Natron::IMAGE_FLOAT:
                 return sizeof(float);
+            case Natron::IMAGE_HALF:
+                return sizeof(unsigned short);
             default:
                 assert(false);
                 break;
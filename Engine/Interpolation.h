@@ -34,6 +34,21 @@ double interpolate(double tcur, const double vcur, //start control point
                    KeyframeType interp,
                    KeyframeType interpNext) WARN_UNUSED_RETURN;
 
+/**
+ * @brief Computes the cubic used by interpolate() between the 2 control points: the value at time t
+ * is c[0] + c[1]*x + c[2]*x^2 + c[3]*x^3 with x = (t - t0) / (t1 - t0).
+ * Use it instead of interpolate() to evaluate the same segment at many different times.
+ **/
+void interpolationCoefficients(double tcur, const double vcur, //start control point
+                               const double vcurDerivRight, //being the derivative dv/dt at tcur
+                               const double vnextDerivLeft, //being the derivative dv/dt at tnext
+                               double tnext, const double vnext, //end control point
+                               KeyframeType interp,
+                               KeyframeType interpNext,
+                               double *t0,
+                               double *t1,
+                               double c[4]);
+
 /// derive at currentTime. The derivative is with respect to currentTime
 double derive(double tcur, const double vcur, //start control point
               const double vcurDerivRight, //being the derivative dv/dt at tcur
@@ -46,6 +46,14 @@ KnobSignalSlotHandler::KnobSignalSlotHandler(boost::shared_ptr<KnobI> knob)
                      SLOT(onEvaluateValueChangedInOtherThread(int,int)));
 }
 
+void KnobSignalSlotHandler::notifyHolderOfChange()
+{
+    KnobHolder* holder = k->getHolder();
+    if (holder) {
+        holder->incrementKnobsChangesCount();
+    }
+}
+
 void KnobSignalSlotHandler::onKeyFrameSet(SequenceTime time,int dimension)
 {
     k->onKeyFrameSet(time, dimension);
@@ -920,6 +928,8 @@ struct KnobHolder::KnobHolderPrivate
     KnobHolder::MultipleParamsEditLevel paramsEditLevel;
     mutable QMutex evaluationBlockedMutex;
     int evaluationBlocked;
+    mutable QMutex knobsChangesCountMutex;
+    U64 knobsChangesCount;
     
     KnobHolderPrivate(AppInstance* appInstance_)
     : app(appInstance_)
@@ -931,6 +941,8 @@ struct KnobHolder::KnobHolderPrivate
     , paramsEditLevel(PARAM_EDIT_OFF)
     , evaluationBlockedMutex(QMutex::Recursive)
     , evaluationBlocked(0)
+    , knobsChangesCountMutex()
+    , knobsChangesCount(0)
     {
         // Initialize local data on the main-thread
         ///Don't remove the if condition otherwise this will crash because QApp is not initialized yet for Natron settings.
@@ -971,6 +983,18 @@ bool KnobHolder::isEvaluationBlocked() const
     return _imp->evaluationBlocked > 0;
 }
 
+U64 KnobHolder::getKnobsChangesCount() const
+{
+    QMutexLocker l(&_imp->knobsChangesCountMutex);
+    return _imp->knobsChangesCount;
+}
+
+void KnobHolder::incrementKnobsChangesCount()
+{
+    QMutexLocker l(&_imp->knobsChangesCountMutex);
+    ++_imp->knobsChangesCount;
+}
+
 KnobHolder::MultipleParamsEditLevel KnobHolder::getMultipleParamsEditLevel() const
 {
     QMutexLocker l(&_imp->paramsEditLevelMutex);
@@ -31,6 +31,7 @@ class StringAnimationManager;
 
 namespace Natron {
 class OfxParamOverlayInteract;
+class KnobsSnapshot;
 }
 
 class KnobI : public OverlaySupport
@@ -532,23 +533,28 @@ public:
     boost::shared_ptr<KnobI> getKnob() const { return k; }
     
     void s_evaluateValueChangedInMainThread(int dimension,int reason)
-    { emit evaluateValueChangedInMainThread(dimension,reason); }
+    { notifyHolderOfChange(); emit evaluateValueChangedInMainThread(dimension,reason); }
     void s_animationLevelChanged(int level) { emit animationLevelChanged(level); }
     void s_deleted() { emit deleted(); }
-    void s_valueChanged(int dimension,int reason) { emit valueChanged(dimension,reason); }
+    void s_valueChanged(int dimension,int reason) { notifyHolderOfChange(); emit valueChanged(dimension,reason); }
     void s_secretChanged() { emit secretChanged(); }
     void s_enabledChanged() { emit enabledChanged(); }
-    void s_keyFrameSet(SequenceTime time,int dimension,bool added) { emit keyFrameSet(time,dimension,added); }
-    void s_keyFrameRemoved(SequenceTime time ,int dimension) { emit keyFrameRemoved(time,dimension); }
-    void s_animationAboutToBeRemoved(int dimension) { emit animationAboutToBeRemoved(dimension); }
+    void s_keyFrameSet(SequenceTime time,int dimension,bool added) { notifyHolderOfChange(); emit keyFrameSet(time,dimension,added); }
+    void s_keyFrameRemoved(SequenceTime time ,int dimension) { notifyHolderOfChange(); emit keyFrameRemoved(time,dimension); }
+    void s_animationAboutToBeRemoved(int dimension) { notifyHolderOfChange(); emit animationAboutToBeRemoved(dimension); }
     void s_updateSlaves(int dimension) { emit updateSlaves(dimension); }
-    void s_knobSlaved(int dim,bool slaved) { emit knobSlaved(dim,slaved); }
+    void s_knobSlaved(int dim,bool slaved) { notifyHolderOfChange(); emit knobSlaved(dim,slaved); }
     void s_setValueWithUndoStack(Variant v,int dim) { emit setValueWithUndoStack(v, dim); }
     void s_appendParamEditChange(Variant v,int dim,int time,bool createNewCommand,bool setKeyFrame) {
         emit appendParamEditChange(v, dim,time,createNewCommand,setKeyFrame);
     }
     void s_setDirty(bool b) { emit dirty(b); }
     
+private:
+    
+    ///Increments the knobs changes count of the holder of the knob, if any
+    void notifyHolderOfChange();
+    
 public slots:
     
     /**
@@ -1012,6 +1018,12 @@ private:
     
     T getValueFromMaster(int dimension);
     
+    /**
+     * @brief Returns true if the value could be read from the knobs snapshot of the render running in this thread, if any.
+     * If time is NULL, this is the value at the time of the render.
+     **/
+    bool getValueFromKnobsSnapshot(const double* time,int dimension,T* value) const WARN_UNUSED_RETURN;
+    
     void valueToVariant(const T& v,Variant* vari);
     
     int get_SetValueRecursionLevel() const
@@ -1138,6 +1150,12 @@ public:
     
     virtual bool isProject() const { return false; }
     
+    /**
+     * @brief Returns the snapshot of the knobs values taken by the render running in the calling thread,
+     * or NULL if this thread is not rendering. The knobs read their values from it without locking.
+     **/
+    virtual const Natron::KnobsSnapshot* getKnobsSnapshot() const { return NULL; }
+    
     /**
      * @brief Restore all knobs to their default values
      **/
@@ -1186,6 +1204,15 @@ public:
     void blockEvaluation();
     void unblockEvaluation();
     
+    /**
+     * @brief Incremented whenever the value, the animation or the master of one of the knobs changes. Unlike the
+     * knobs age of the nodes this is also incremented while the evaluation is blocked.
+     **/
+    U64 getKnobsChangesCount() const WARN_UNUSED_RETURN;
+    
+    ///Called by the knobs, don't call this
+    void incrementKnobsChangesCount();
+    
     /**
      * @brief The virtual portion of notifyProjectBeginValuesChanged(). This is called by the project
      * You should NEVER CALL THIS YOURSELF as it would break the bracketing system.
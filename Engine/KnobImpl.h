@@ -22,6 +22,7 @@
 #include "Engine/Project.h"
 #include "Engine/TimeLine.h"
 #include "Engine/EffectInstance.h"
+#include "Engine/KnobsSnapshot.h"
 
 ///template specializations
 
@@ -37,6 +38,33 @@ Knob<T>::Knob(KnobHolder*  holder,const std::string& description,int dimension,b
     
 }
 
+template <typename T>
+bool Knob<T>::getValueFromKnobsSnapshot(const double* time,int dimension,T* value) const
+{
+    KnobHolder* holder = getHolder();
+    const Natron::KnobsSnapshot* snapshot = holder ? holder->getKnobsSnapshot() : NULL;
+    if (!snapshot) {
+        return false;
+    }
+    double v;
+    if (!snapshot->getValue(this, dimension, time ? *time : snapshot->getTime(), &v)) {
+        return false;
+    }
+    *value = (T)v;
+    return true;
+}
+
+template <>
+bool Knob<std::string>::getValueFromKnobsSnapshot(const double* time,int dimension,std::string* value) const
+{
+    KnobHolder* holder = getHolder();
+    const Natron::KnobsSnapshot* snapshot = holder ? holder->getKnobsSnapshot() : NULL;
+    if (!snapshot) {
+        return false;
+    }
+    return snapshot->getValue(this, dimension, time ? *time : snapshot->getTime(), value);
+}
+
 //Declare the specialization before defining it to avoid the following
 //error: explicit specialization of 'getValueAtTime' after instantiation
 template<>
@@ -63,6 +91,11 @@ std::string Knob<std::string>::getValue(int dimension) const
     if (dimension > (int)_values.size() || dimension < 0) {
         throw std::invalid_argument("Knob::getValue(): Dimension out of range");
     }
+    
+    std::string snapshotValue;
+    if (getValueFromKnobsSnapshot(NULL, dimension, &snapshotValue)) {
+        return snapshotValue;
+    }
     ///if the knob is slaved to another knob, returns the other knob value
     std::pair<int,boost::shared_ptr<KnobI> > master = getMaster(dimension);
     if (master.second) {
@@ -97,6 +130,12 @@ T Knob<T>::getValue(int dimension) const
     if (dimension > (int)_values.size() || dimension < 0) {
         throw std::invalid_argument("Knob::getValue(): Dimension out of range");
     }
+    
+    ///during a render, read the value from the snapshot taken when the render started instead of locking
+    T snapshotValue;
+    if (getValueFromKnobsSnapshot(NULL, dimension, &snapshotValue)) {
+        return snapshotValue;
+    }
     ///if the knob is slaved to another knob, returns the other knob value
     std::pair<int,boost::shared_ptr<KnobI> > master = getMaster(dimension);
     if (master.second) {
@@ -125,6 +164,10 @@ std::string Knob<std::string>::getValueAtTime(double time, int dimension) const
         throw std::invalid_argument("Knob::getValueAtTime(): Dimension out of range");
     }
     
+    std::string snapshotValue;
+    if (getValueFromKnobsSnapshot(&time, dimension, &snapshotValue)) {
+        return snapshotValue;
+    }
     
     ///if the knob is slaved to another knob, returns the other knob value
     std::pair<int,boost::shared_ptr<KnobI> > master = getMaster(dimension);
@@ -168,6 +211,11 @@ T Knob<T>::getValueAtTime(double time, int dimension ) const
         throw std::invalid_argument("Knob::getValueAtTime(): Dimension out of range");
     }
 
+    ///during a render, read the value from the snapshot taken when the render started instead of locking
+    T snapshotValue;
+    if (getValueFromKnobsSnapshot(&time, dimension, &snapshotValue)) {
+        return snapshotValue;
+    }
 
     ///if the knob is slaved to another knob, returns the other knob value
     std::pair<int,boost::shared_ptr<KnobI> > master = getMaster(dimension);
@@ -21,6 +21,7 @@
 #include "Engine/AppInstance.h"
 #include "Engine/RotoContext.h"
 #include "Engine/Node.h"
+#include "Engine/KnobsSnapshot.h"
 
 using namespace Natron;
 using std::make_pair;
@@ -1181,6 +1182,18 @@ Natron::Status Parametric_Knob::getValue(int dimension,double parametricPosition
     if(dimension >= (int)_curves.size()){
         return StatFailed;
     }
+    
+    ///Plug-ins may call this for each pixel: during a render, read the table of the curve held by the knobs
+    ///snapshot of the render, which takes no lock.
+    KnobHolder* holder = getHolder();
+    const Natron::KnobsSnapshot* snapshot = holder ? holder->getKnobsSnapshot() : NULL;
+    if (snapshot) {
+        const CurveTable* table = snapshot->getParametricTable(this, dimension);
+        if (table && table->getValueAt(parametricPosition, returnValue)) {
+            return Natron::StatOK;
+        }
+    }
+    
     try {
         *returnValue = _curves[dimension]->getValueAt(parametricPosition);
     }catch(...){
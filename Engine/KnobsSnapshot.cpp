@@ -0,0 +1,138 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "KnobsSnapshot.h"
+
+#include "Engine/Knob.h"
+#include "Engine/KnobTypes.h"
+#include "Engine/Curve.h"
+
+using namespace Natron;
+
+namespace {
+
+template<typename T>
+bool
+snapshotNumericKnob(const KnobI* knob,SequenceTime time,std::vector<double>* numbers)
+{
+    const Knob<T>* isT = dynamic_cast<const Knob<T>*>(knob);
+    if (!isT) {
+        return false;
+    }
+    int dims = knob->getDimension();
+    numbers->resize(dims);
+    for (int i = 0; i < dims; ++i) {
+        (*numbers)[i] = (double)isT->getValueAtTime(time, i);
+    }
+    return true;
+}
+
+}
+
+KnobsSnapshot::KnobsSnapshot(U64 nodeHash,SequenceTime time)
+: _nodeHash(nodeHash)
+, _time(time)
+, _knobs()
+{
+}
+
+KnobsSnapshot::KnobsSnapshot(const KnobsSnapshot& other,const std::vector< boost::shared_ptr<KnobI> >& knobs)
+: _nodeHash(other._nodeHash)
+, _time(other._time)
+, _knobs()
+{
+    std::map<std::string,const KnobValues*> valuesByName;
+    for (KnobValuesMap::const_iterator it = other._knobs.begin(); it != other._knobs.end(); ++it) {
+        valuesByName.insert(std::make_pair(it->first->getName(),&it->second));
+    }
+    for (U32 i = 0; i < knobs.size(); ++i) {
+        std::map<std::string,const KnobValues*>::const_iterator found = valuesByName.find(knobs[i]->getName());
+        if (found != valuesByName.end()) {
+            _knobs.insert(std::make_pair(knobs[i].get(),*found->second));
+        }
+    }
+}
+
+void
+KnobsSnapshot::addKnobs(const std::vector< boost::shared_ptr<KnobI> >& knobs)
+{
+    for (U32 i = 0; i < knobs.size(); ++i) {
+        const KnobI* knob = knobs[i].get();
+        KnobValues values;
+        if (!snapshotNumericKnob<double>(knob, _time, &values.numbers) &&
+            !snapshotNumericKnob<int>(knob, _time, &values.numbers) &&
+            !snapshotNumericKnob<bool>(knob, _time, &values.numbers)) {
+            const Knob<std::string>* isString = dynamic_cast<const Knob<std::string>*>(knob);
+            if (!isString) {
+                continue;
+            }
+            int dims = knob->getDimension();
+            values.strings.resize(dims);
+            for (int d = 0; d < dims; ++d) {
+                values.strings[d] = isString->getValueAtTime(_time, d);
+            }
+        }
+        int dims = knob->getDimension();
+        values.timeDependent.resize(dims);
+        for (int d = 0; d < dims; ++d) {
+            values.timeDependent[d] = knob->isAnimated(d) || knob->getMaster(d).second;
+        }
+        const Parametric_Knob* isParametric = dynamic_cast<const Parametric_Knob*>(knob);
+        if (isParametric) {
+            ///the tables are only rebuilt when the curves change, taking them is cheap
+            values.tables.resize(dims);
+            for (int d = 0; d < dims; ++d) {
+                values.tables[d] = isParametric->getParametricCurve(d)->getTable();
+            }
+        }
+        _knobs.insert(std::make_pair(knob,values));
+    }
+}
+
+const KnobsSnapshot::KnobValues*
+KnobsSnapshot::findValues(const KnobI* knob,int dimension,double time) const
+{
+    KnobValuesMap::const_iterator found = _knobs.find(knob);
+    if (found == _knobs.end() || dimension < 0 || dimension >= (int)found->second.timeDependent.size()) {
+        return NULL;
+    }
+    if (found->second.timeDependent[dimension] && time != _time) {
+        return NULL;
+    }
+    return &found->second;
+}
+
+bool
+KnobsSnapshot::getValue(const KnobI* knob,int dimension,double time,double* value) const
+{
+    const KnobValues* values = findValues(knob, dimension, time);
+    if (!values || values->numbers.empty()) {
+        return false;
+    }
+    *value = values->numbers[dimension];
+    return true;
+}
+
+bool
+KnobsSnapshot::getValue(const KnobI* knob,int dimension,double time,std::string* value) const
+{
+    const KnobValues* values = findValues(knob, dimension, time);
+    if (!values || values->strings.empty()) {
+        return false;
+    }
+    *value = values->strings[dimension];
+    return true;
+}
+
+const CurveTable*
+KnobsSnapshot::getParametricTable(const KnobI* knob,int dimension) const
+{
+    KnobValuesMap::const_iterator found = _knobs.find(knob);
+    if (found == _knobs.end() || dimension < 0 || dimension >= (int)found->second.tables.size()) {
+        return NULL;
+    }
+    return found->second.tables[dimension].get();
+}
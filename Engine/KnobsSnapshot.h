@@ -0,0 +1,87 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef NATRON_ENGINE_KNOBSSNAPSHOT_H_
+#define NATRON_ENGINE_KNOBSSNAPSHOT_H_
+
+#include <map>
+#include <string>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+
+#include "Global/Macros.h"
+#include "Global/GlobalDefines.h"
+
+class KnobI;
+class CurveTable;
+
+namespace Natron {
+
+/**
+ * @brief The values of the knobs of an effect, evaluated at a given time for a given node hash.
+ * A snapshot is filled once when a render starts and is never modified afterwards: the render threads
+ * read it without taking any lock while the user keeps editing the knobs. Any edit changes the node hash,
+ * hence the next render takes a new snapshot whereas the running renders keep using theirs.
+ **/
+class KnobsSnapshot
+{
+public:
+
+    KnobsSnapshot(U64 nodeHash,SequenceTime time);
+
+    /**
+     * @brief Copies the values of other for the knobs of another instance of the same plug-in, e.g a render clone:
+     * the values of each knob of other are given to the knob with the same name in knobs.
+     **/
+    KnobsSnapshot(const KnobsSnapshot& other,const std::vector< boost::shared_ptr<KnobI> >& knobs);
+
+    /**
+     * @brief Evaluates the given knobs at the time of the snapshot. Only the int, bool, double and string knobs
+     * are stored, as well as the tables of the curves of the parametric knobs (see Curve::getTable).
+     * This must be called before the snapshot is shared with other threads.
+     **/
+    void addKnobs(const std::vector< boost::shared_ptr<KnobI> >& knobs);
+
+    U64 getNodeHash() const { return _nodeHash; }
+
+    SequenceTime getTime() const { return _time; }
+
+    /**
+     * @brief Returns in value the value of the knob at the given dimension and time. Returns false if the snapshot
+     * cannot answer: the knob is not in the snapshot, or its value depends on the time and time is not the time of the snapshot.
+     **/
+    bool getValue(const KnobI* knob,int dimension,double time,double* value) const WARN_UNUSED_RETURN;
+
+    bool getValue(const KnobI* knob,int dimension,double time,std::string* value) const WARN_UNUSED_RETURN;
+
+    /**
+     * @brief Returns the table of the curve of the parametric knob at the given dimension, or NULL if the snapshot
+     * has none. Parametric curves do not depend on the time.
+     **/
+    const CurveTable* getParametricTable(const KnobI* knob,int dimension) const WARN_UNUSED_RETURN;
+
+private:
+
+    struct KnobValues
+    {
+        std::vector<double> numbers; //< for int, bool and double knobs
+        std::vector<std::string> strings; //< for string knobs
+        std::vector<bool> timeDependent; //< true for the dimensions that are animated or slaved to another knob
+        std::vector< boost::shared_ptr<const CurveTable> > tables; //< for parametric knobs, the table of each curve
+    };
+
+    typedef std::map<const KnobI*,KnobValues> KnobValuesMap;
+
+    const KnobValues* findValues(const KnobI* knob,int dimension,double time) const;
+
+    U64 _nodeHash;
+    SequenceTime _time;
+    KnobValuesMap _knobs;
+};
+
+}
+
+#endif // NATRON_ENGINE_KNOBSSNAPSHOT_H_
@@ -231,6 +231,12 @@ namespace Natron {
             return (v8u_prev << 8) + v8u_prev + (v - v32f_prev) * (((v8u_next-v8u_prev)<<8) + (v8u_next+v8u_prev)) / (v32f_next-v32f_prev) + 0.5;
         }
 
+        float Lut::fromColorSpaceHalfToLinearFloatFast(Natron::Half v) const
+        {
+            assert(init_);
+            return fromFunc_half_to_float[v.bits()];
+        }
+        
         float Lut::fromColorSpaceUint16ToLinearFloatFast(unsigned short v) const
         {
             assert(init_);
@@ -268,6 +274,9 @@ namespace Natron {
                 int i = hipart(f);
                 toFunc_hipart_to_uint8xx[i] = Color::charToUint8xx(b);
             }
+            for (int i = 0; i < 0x10000; ++i) {
+                fromFunc_half_to_float[i] = _fromFunc(HalfFloat::toFloat((unsigned short)i));
+            }
             
         }
         
@@ -52,6 +52,7 @@ CLANG_DIAG_OFF(deprecated)
 #include <QMutex>
 CLANG_DIAG_ON(deprecated)
 
+#include "Engine/HalfFloat.h"
 
 class RectI;
 
@@ -150,6 +151,7 @@ namespace Natron {
             /// and never change afterwards
             mutable unsigned short toFunc_hipart_to_uint8xx[0x10000]; /// contains  2^16 = 65536 values between 0-255
             mutable float fromFunc_uint8_to_float[256]; /// values between 0-1.f
+            mutable float fromFunc_half_to_float[0x10000]; /// the transform of every half, indexed by its bits
             mutable bool init_; ///< false if the tables are not yet initialized
             mutable QMutex _lock; ///< protects init_
             
@@ -233,6 +235,12 @@ namespace Natron {
              */
             float fromColorSpaceUint16ToLinearFloatFast(unsigned short v) const;
 
+            /* @brief Converts a half in the destination color-space using the look-up tables.
+             * Every half has its entry in the table, hence this is exact.
+             * @return A float in linear color-space.
+             */
+            float fromColorSpaceHalfToLinearFloatFast(Natron::Half v) const;
+
             
             /////@TODO the following functions expects a float input buffer, one could extend it to cover all bitdepths.
             
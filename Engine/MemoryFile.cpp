@@ -74,8 +74,9 @@ InputMemoryFile::~InputMemoryFile() {
 #endif
 }
 
-MemoryFile::MemoryFile(const std::string& pathname, Natron::MMAPfile_mode open_mode):
+MemoryFile::MemoryFile(const std::string& pathname, Natron::MMAPfile_mode open_mode, int mappingFlags):
 _path(pathname),
+_mappingFlags(mappingFlags),
 data_(0),
 size_(0),
 capacity_(0),
@@ -132,10 +133,8 @@ file_mapping_handle_(INVALID_HANDLE_VALUE)
         str.append(std::strerror(errno));
         throw std::runtime_error(str);
     }
-    data_ = static_cast<char*>(::mmap(
-                                      0, adjusted_file_size, PROT_READ | PROT_WRITE, MAP_SHARED, file_handle_, 0));
-    if (data_ == MAP_FAILED){
-        data_ = 0;
+    map(adjusted_file_size);
+    if (!data_){
         std::string str("MemoryFile EXC : Failed to create mapping: ");
         str.append(pathname);
         throw std::runtime_error(str);
@@ -210,15 +209,16 @@ void MemoryFile::resize(size_t new_size) {
 void MemoryFile::reserve(size_t new_capacity) {
     if (new_capacity <= capacity_) return;
 #if defined(__NATRON_UNIX__)
-    ::munmap(data_, size_);
+    if (data_) {
+        ::munmap(data_, capacity_);
+        data_ = 0;
+    }
     if (::ftruncate(file_handle_, new_capacity) < 0) {
         std::string str("MemoryFile EXC : Failed to truncate mapped file: ");
         str.append(std::strerror(errno));
         throw std::runtime_error(str);
     }
-    data_ = static_cast<char*>(::mmap(
-                                      0, new_capacity, PROT_READ | PROT_WRITE, MAP_SHARED, file_handle_, 0));
-    if (data_ == MAP_FAILED) data_ = 0;
+    map(new_capacity);
     capacity_ = new_capacity;
 #elif defined(__NATRON_WIN32__)
     ::UnmapViewOfFile(data_);
@@ -234,7 +234,9 @@ void MemoryFile::reserve(size_t new_capacity) {
 
 MemoryFile::~MemoryFile() {
 #if defined(__NATRON_UNIX__)
-    ::munmap(data_, size_);
+    if (data_) {
+        ::munmap(data_, capacity_);
+    }
     if (size_ != capacity_) {
         if (::ftruncate(file_handle_, size_) < 0) {
             std::string str("MemoryFile EXC : Failed to truncate mapped file: ");
@@ -262,3 +264,34 @@ bool MemoryFile::flush() {
     return ::FlushViewOfFile(data_, size_) != 0;
 #endif
 }
+
+void MemoryFile::startWriteBack() {
+    if (!data_) {
+        return;
+    }
+#if defined(__NATRON_LINUX__) && defined(SYNC_FILE_RANGE_WRITE)
+    ///queues the dirty pages for writing without waiting, unlike msync(MS_ASYNC) which is a no-op on Linux
+    if (::sync_file_range(file_handle_, 0, size_, SYNC_FILE_RANGE_WRITE) != 0) {
+        ::msync(data_, size_, MS_ASYNC);
+    }
+#elif defined(__NATRON_UNIX__)
+    ::msync(data_, size_, MS_ASYNC);
+#elif defined(__NATRON_WIN32__)
+    ///FlushViewOfFile does not wait for the data to reach the disk
+    ::FlushViewOfFile(data_, size_);
+#endif
+}
+
+#if defined(__NATRON_UNIX__)
+void MemoryFile::map(size_t length) {
+    data_ = static_cast<char*>(::mmap(0, length, PROT_READ | PROT_WRITE, MAP_SHARED, file_handle_, 0));
+    if (data_ == MAP_FAILED) {
+        data_ = 0;
+        return;
+    }
+    ///unlike MAP_POPULATE this does not wait for the pages to be read: the caller may hold a lock
+    if (_mappingFlags & MAPPING_POPULATE) {
+        ::madvise(data_, length, MADV_WILLNEED);
+    }
+}
+#endif
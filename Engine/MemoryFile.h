@@ -50,10 +50,22 @@
  The "capacity()" function return the size the physical file has at this time.
  The "flush" function ensure that the disk is updated
  with the data written in memory.
+ The "startWriteBack" function asks the system to start writing the data to the disk
+ without waiting for it to be done.
+ The mapping flags are hints for the way the file is going to be accessed:
+ MAPPING_POPULATE asks the system to start reading the whole file upon opening, without waiting for it,
+ so that the pages are in memory when the whole file is read (e.g: a frame of the disk cache).
  */
 class MemoryFile {
 public:
-    MemoryFile(const std::string& pathname, Natron::MMAPfile_mode open_mode);
+    
+    enum MappingFlags
+    {
+        MAPPING_DEFAULT = 0,
+        MAPPING_POPULATE = 0x1
+    };
+    
+    MemoryFile(const std::string& pathname, Natron::MMAPfile_mode open_mode, int mappingFlags = MAPPING_DEFAULT);
     ~MemoryFile();
     char* data() const { return data_; }
     void resize(size_t new_size);
@@ -61,9 +73,14 @@ public:
     size_t size() const { return size_; }
     size_t capacity() const { return capacity_; }
     bool flush();
+    void startWriteBack();
     std::string path() const {return _path;}
 private:
+#if defined(__NATRON_UNIX__)
+    void map(size_t length);
+#endif
     std::string _path;
+    int _mappingFlags;
     char* data_;
     size_t size_;
     size_t capacity_;
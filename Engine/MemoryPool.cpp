@@ -0,0 +1,268 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "MemoryPool.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <new>
+#include <vector>
+
+#ifdef __NATRON_UNIX__
+#include <sys/mman.h>
+#endif
+
+CLANG_DIAG_OFF(deprecated)
+#include <QtCore/QMutex>
+CLANG_DIAG_ON(deprecated)
+
+using namespace Natron;
+
+namespace {
+
+void*
+systemAllocate(std::size_t size,bool hugePages)
+{
+#ifdef __NATRON_UNIX__
+    ///mapped memory is zeroed and does not fragment the malloc heap
+    void* ret = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ret == MAP_FAILED) {
+        return NULL;
+    }
+#ifdef MADV_HUGEPAGE
+    if (hugePages) {
+        (void)madvise(ret, size, MADV_HUGEPAGE);
+    }
+#else
+    (void)hugePages;
+#endif
+    return ret;
+#else
+    (void)hugePages;
+    return std::calloc(size,1);
+#endif
+}
+
+void
+systemDeallocate(void* ptr,std::size_t size)
+{
+#ifdef __NATRON_UNIX__
+    munmap(ptr, size);
+#else
+    (void)size;
+    std::free(ptr);
+#endif
+}
+
+///the pool of all the images, destroyed after main() returned
+MemoryPool globalPool;
+
+} // anon namespace
+
+struct Natron::MemoryPoolPrivate
+{
+    mutable QMutex lock; //< protects all the fields below
+    std::map<std::size_t,std::vector<void*> > freeBlocks; //< blocks kept for reuse, per size class
+    U64 heldBytes;
+    U64 heldBlocks;
+    U64 maximumSize;
+    U64 allocations;
+    U64 reuses;
+    bool hugePages;
+
+    MemoryPoolPrivate()
+    : lock()
+    , freeBlocks()
+    , heldBytes(0)
+    , heldBlocks(0)
+    , maximumSize(NATRON_MEMORY_POOL_DEFAULT_MAX_SIZE)
+    , allocations(0)
+    , reuses(0)
+    , hugePages(false)
+    {
+    }
+
+    ///must be called with lock locked
+    void freeBlocksUntil(U64 size)
+    {
+        std::map<std::size_t,std::vector<void*> >::iterator it = freeBlocks.begin();
+        while (heldBytes > size && it != freeBlocks.end()) {
+            while (heldBytes > size && !it->second.empty()) {
+                systemDeallocate(it->second.back(), it->first);
+                it->second.pop_back();
+                heldBytes -= it->first;
+                --heldBlocks;
+            }
+            if (it->second.empty()) {
+                freeBlocks.erase(it++);
+            } else {
+                ++it;
+            }
+        }
+    }
+};
+
+MemoryPool::MemoryPool()
+: _imp(new MemoryPoolPrivate())
+{
+}
+
+MemoryPool::~MemoryPool()
+{
+    clear();
+}
+
+MemoryPool*
+MemoryPool::instance()
+{
+    return &globalPool;
+}
+
+std::size_t
+MemoryPool::getSizeClass(std::size_t size)
+{
+    if (size < NATRON_MEMORY_POOL_MIN_BLOCK_SIZE) {
+        return size;
+    }
+    ///step is the largest power of 2 such that size >= 8 * step, i.e size is in [8 * step, 16 * step): the sizes
+    ///between 2 powers of 2 are rounded up to one of 8 multiples of step, the classes are at most step <= size / 8 apart
+    std::size_t step = 1;
+    while ((step << 4) <= size) {
+        step <<= 1;
+    }
+    return (size + step - 1) & ~(step - 1);
+}
+
+void*
+MemoryPool::allocate(std::size_t size,bool zeroed)
+{
+    if (size < NATRON_MEMORY_POOL_MIN_BLOCK_SIZE) {
+        void* ret = zeroed ? std::calloc(size > 0 ? size : 1,1) : std::malloc(size > 0 ? size : 1);
+        if (!ret) {
+            throw std::bad_alloc();
+        }
+        return ret;
+    }
+    std::size_t sizeClass = getSizeClass(size);
+    bool hugePages;
+    {
+        QMutexLocker l(&_imp->lock);
+        ++_imp->allocations;
+        std::map<std::size_t,std::vector<void*> >::iterator found = _imp->freeBlocks.find(sizeClass);
+        if (found != _imp->freeBlocks.end()) {
+            void* ret = found->second.back();
+            found->second.pop_back();
+            if (found->second.empty()) {
+                _imp->freeBlocks.erase(found);
+            }
+            _imp->heldBytes -= sizeClass;
+            --_imp->heldBlocks;
+            ++_imp->reuses;
+            l.unlock();
+            if (zeroed) {
+                std::memset(ret, 0, size);
+            }
+            return ret;
+        }
+        hugePages = _imp->hugePages;
+    }
+    void* ret = systemAllocate(sizeClass, hugePages);
+    if (!ret) {
+        ///give the memory held by the pool back to the system and try again
+        clear();
+        ret = systemAllocate(sizeClass, hugePages);
+        if (!ret) {
+            throw std::bad_alloc();
+        }
+    }
+    return ret;
+}
+
+void*
+MemoryPool::reallocate(void* ptr,std::size_t oldSize,std::size_t newSize)
+{
+    if (getSizeClass(oldSize) == getSizeClass(newSize) && oldSize >= NATRON_MEMORY_POOL_MIN_BLOCK_SIZE) {
+        return ptr;
+    }
+    if (oldSize < NATRON_MEMORY_POOL_MIN_BLOCK_SIZE && newSize < NATRON_MEMORY_POOL_MIN_BLOCK_SIZE) {
+        void* ret = std::realloc(ptr, newSize > 0 ? newSize : 1);
+        if (!ret) {
+            throw std::bad_alloc();
+        }
+        return ret;
+    }
+    void* ret = allocate(newSize);
+    std::memcpy(ret, ptr, std::min(oldSize,newSize));
+    deallocate(ptr, oldSize);
+    return ret;
+}
+
+void
+MemoryPool::deallocate(void* ptr,std::size_t size)
+{
+    if (!ptr) {
+        return;
+    }
+    if (size < NATRON_MEMORY_POOL_MIN_BLOCK_SIZE) {
+        std::free(ptr);
+        return;
+    }
+    std::size_t sizeClass = getSizeClass(size);
+    {
+        QMutexLocker l(&_imp->lock);
+        if (_imp->heldBytes + sizeClass <= _imp->maximumSize) {
+            _imp->freeBlocks[sizeClass].push_back(ptr);
+            _imp->heldBytes += sizeClass;
+            ++_imp->heldBlocks;
+            return;
+        }
+    }
+    systemDeallocate(ptr, sizeClass);
+}
+
+void
+MemoryPool::clear()
+{
+    QMutexLocker l(&_imp->lock);
+    _imp->freeBlocksUntil(0);
+}
+
+void
+MemoryPool::setMaximumSize(U64 size)
+{
+    QMutexLocker l(&_imp->lock);
+    _imp->maximumSize = size;
+    _imp->freeBlocksUntil(size);
+}
+
+U64
+MemoryPool::getMaximumSize() const
+{
+    QMutexLocker l(&_imp->lock);
+    return _imp->maximumSize;
+}
+
+void
+MemoryPool::setHugePagesEnabled(bool enabled)
+{
+    QMutexLocker l(&_imp->lock);
+    _imp->hugePages = enabled;
+}
+
+MemoryPoolStats
+MemoryPool::getStats() const
+{
+    QMutexLocker l(&_imp->lock);
+    MemoryPoolStats ret;
+    ret.allocations = _imp->allocations;
+    ret.reuses = _imp->reuses;
+    ret.heldBlocks = _imp->heldBlocks;
+    ret.heldBytes = _imp->heldBytes;
+    ret.maximumSize = _imp->maximumSize;
+    return ret;
+}
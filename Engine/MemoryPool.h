@@ -0,0 +1,109 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef NATRON_ENGINE_MEMORYPOOL_H_
+#define NATRON_ENGINE_MEMORYPOOL_H_
+
+#include <cstddef>
+
+#include "Global/Macros.h"
+#include "Global/GlobalDefines.h"
+
+#ifndef Q_MOC_RUN
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_ptr.hpp>
+#endif
+
+///Blocks smaller than this are not worth recycling, they are left to malloc
+#define NATRON_MEMORY_POOL_MIN_BLOCK_SIZE (64 * 1024)
+
+///The default amount of memory the pool may keep for later reuse
+#define NATRON_MEMORY_POOL_DEFAULT_MAX_SIZE (256 * 1024 * 1024)
+
+namespace Natron {
+
+struct MemoryPoolStats
+{
+    U64 allocations; //< number of blocks handed out by allocate()
+    U64 reuses; //< number of those blocks that were recycled instead of being requested to the system
+    U64 heldBlocks; //< number of blocks currently kept for reuse
+    U64 heldBytes; //< memory currently kept for reuse
+    U64 maximumSize; //< the maximum value heldBytes can reach
+};
+
+struct MemoryPoolPrivate;
+
+/**
+ * @brief A pool of large memory blocks used for image buffers and bitmaps. Released blocks are
+ * kept, sorted by size class, so that the next allocation of a similar size reuses them instead of
+ * going through the system allocator. Sizes are rounded up to size classes, 8 per power of 2, which are at most 12.5% apart.
+ * The pool never keeps more than getMaximumSize() bytes, blocks released beyond that are freed.
+ *
+ * On unix the blocks are mapped directly from the system, and can optionally be backed by huge pages
+ * (transparent huge pages on Linux), which lowers the number of page faults and TLB misses on large images.
+ *
+ * Thread safety: this class is thread-safe.
+ **/
+class MemoryPool
+    : boost::noncopyable
+{
+public:
+
+    MemoryPool();
+
+    ~MemoryPool();
+
+    /**
+     * @brief The pool used by all image buffers and bitmaps.
+     **/
+    static MemoryPool* instance() WARN_UNUSED_RETURN;
+
+    /**
+     * @brief Returns a block of at least size bytes. If zeroed is true, the content of the block is
+     * guaranteed to be 0, this is free for blocks that are requested to the system.
+     * Throws std::bad_alloc upon failure.
+     * The block must be released with deallocate(), with the same size.
+     **/
+    void* allocate(std::size_t size,bool zeroed = false) WARN_UNUSED_RETURN;
+
+    /**
+     * @brief Resizes a block returned by allocate(), keeping its content. Throws std::bad_alloc upon failure,
+     * in which case ptr is left untouched.
+     **/
+    void* reallocate(void* ptr,std::size_t oldSize,std::size_t newSize) WARN_UNUSED_RETURN;
+
+    void deallocate(void* ptr,std::size_t size);
+
+    /**
+     * @brief Frees all the blocks kept for reuse.
+     **/
+    void clear();
+
+    void setMaximumSize(U64 size);
+
+    U64 getMaximumSize() const WARN_UNUSED_RETURN;
+
+    /**
+     * @brief Enables huge pages for the blocks requested to the system from now on.
+     * This is a no-op on systems that do not support it.
+     **/
+    void setHugePagesEnabled(bool enabled);
+
+    MemoryPoolStats getStats() const WARN_UNUSED_RETURN;
+
+    /**
+     * @brief Returns the size actually reserved for a request of size bytes.
+     **/
+    static std::size_t getSizeClass(std::size_t size) WARN_UNUSED_RETURN;
+
+private:
+
+    boost::scoped_ptr<MemoryPoolPrivate> _imp;
+};
+
+} // namespace Natron
+
+#endif // NATRON_ENGINE_MEMORYPOOL_H_
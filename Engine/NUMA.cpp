@@ -0,0 +1,350 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "NUMA.h"
+
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef __NATRON_LINUX__
+#include <dirent.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+CLANG_DIAG_OFF(deprecated)
+#include <QtCore/QCoreApplication>
+#include <QtCore/QMutex>
+#include <QtCore/QThread>
+CLANG_DIAG_ON(deprecated)
+
+#include "Engine/ThreadStorage.h"
+
+#ifdef __NATRON_LINUX__
+///from linux/mempolicy.h, which is not always installed
+#ifndef MPOL_F_NODE
+#define MPOL_F_NODE (1 << 0)
+#endif
+#ifndef MPOL_F_ADDR
+#define MPOL_F_ADDR (1 << 1)
+#endif
+#endif
+
+namespace {
+
+struct NUMATopology
+{
+    bool initialized;
+    std::vector<std::vector<int> > nodesCpus; //< the cpus of each node
+    std::map<int,int> cpuToNode;
+
+    NUMATopology()
+    : initialized(false)
+    , nodesCpus()
+    , cpuToNode()
+    {
+    }
+};
+
+struct NUMAStats
+{
+    U64 localTiles;
+    U64 remoteTiles;
+};
+
+struct ThreadPinning
+{
+    int node; //< the node assigned to the thread, -1 if none yet
+    int depth; //< number of nested pinCurrentThread() calls
+#ifdef __NATRON_LINUX__
+    bool affinitySaved;
+    cpu_set_t previousAffinity; //< the cpus the thread could run on before it was pinned
+#endif
+
+    ThreadPinning()
+    : node(-1)
+    , depth(0)
+#ifdef __NATRON_LINUX__
+    , affinitySaved(false)
+#endif
+    {
+    }
+};
+
+QMutex topologyMutex; //< protects topology and nextNodeToPin
+NUMATopology topology;
+int nextNodeToPin = 0;
+bool enabled = false;
+
+QMutex statsMutex;
+NUMAStats stats = { 0, 0 };
+
+Natron::ThreadStorage<ThreadPinning> threadPinning;
+
+#ifdef __NATRON_LINUX__
+///parses a cpu list as found in /sys, e.g "0-7,16-23"
+void
+parseCpuList(const std::string& list,std::vector<int>* cpus)
+{
+    std::stringstream ss(list);
+    std::string range;
+    while (std::getline(ss, range, ',')) {
+        if (range.empty()) {
+            continue;
+        }
+        std::size_t dash = range.find('-');
+        int first = std::atoi(range.substr(0,dash).c_str());
+        int last = dash == std::string::npos ? first : std::atoi(range.substr(dash + 1).c_str());
+        for (int i = first; i <= last; ++i) {
+            cpus->push_back(i);
+        }
+    }
+}
+#endif
+
+///must be called with topologyMutex locked
+const NUMATopology&
+getTopology_locked()
+{
+    if (topology.initialized) {
+        return topology;
+    }
+    topology.initialized = true;
+#ifdef __NATRON_LINUX__
+    std::map<int,std::vector<int> > nodes; //< sorted by node index
+    DIR* dir = opendir("/sys/devices/system/node");
+    if (dir) {
+        struct dirent* entry;
+        while ((entry = readdir(dir)) != NULL) {
+            if (std::strncmp(entry->d_name, "node", 4) != 0 || entry->d_name[4] < '0' || entry->d_name[4] > '9') {
+                continue;
+            }
+            std::ifstream cpulist((std::string("/sys/devices/system/node/") + entry->d_name + "/cpulist").c_str());
+            std::string list;
+            if (!cpulist || !std::getline(cpulist, list)) {
+                continue;
+            }
+            std::vector<int> cpus;
+            parseCpuList(list, &cpus);
+            ///memory-only nodes cannot run threads
+            if (!cpus.empty()) {
+                nodes[std::atoi(entry->d_name + 4)] = cpus;
+            }
+        }
+        closedir(dir);
+    }
+    for (std::map<int,std::vector<int> >::iterator it = nodes.begin(); it != nodes.end(); ++it) {
+        for (unsigned int i = 0; i < it->second.size(); ++i) {
+            topology.cpuToNode[it->second[i]] = it->first;
+        }
+        topology.nodesCpus.push_back(it->second);
+    }
+#endif
+    return topology;
+}
+
+} // anon namespace
+
+namespace Natron {
+namespace NUMA {
+
+int
+getNodesCount()
+{
+    QMutexLocker l(&topologyMutex);
+    int count = (int)getTopology_locked().nodesCpus.size();
+    return count > 0 ? count : 1;
+}
+
+void
+setEnabled(bool e)
+{
+    enabled = e && getNodesCount() > 1;
+}
+
+bool
+isEnabled()
+{
+    return enabled;
+}
+
+void
+pinCurrentThread()
+{
+    if (QThread::currentThread() == qApp->thread()) {
+        return;
+    }
+    ThreadPinning& pinning = threadPinning.localData();
+    if (pinning.depth++ > 0) {
+        return;
+    }
+#ifdef __NATRON_LINUX__
+    std::vector<int> cpus;
+    {
+        QMutexLocker l(&topologyMutex);
+        const NUMATopology& t = getTopology_locked();
+        if (t.nodesCpus.size() < 2) {
+            return;
+        }
+        ///the thread keeps its node so that it stays close to the tiles it rendered before
+        if (pinning.node < 0) {
+            pinning.node = nextNodeToPin;
+            nextNodeToPin = (nextNodeToPin + 1) % (int)t.nodesCpus.size();
+        }
+        cpus = t.nodesCpus[pinning.node];
+    }
+    pinning.affinitySaved = sched_getaffinity(0, sizeof(pinning.previousAffinity), &pinning.previousAffinity) == 0;
+    if (!pinning.affinitySaved) {
+        ///the affinity could not be restored afterwards
+        return;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (unsigned int i = 0; i < cpus.size(); ++i) {
+        if (cpus[i] < CPU_SETSIZE) {
+            CPU_SET(cpus[i], &set);
+        }
+    }
+    ///failure is not an issue, the thread just keeps running anywhere
+    (void)sched_setaffinity(0, sizeof(set), &set);
+#endif
+}
+
+void
+unpinCurrentThread()
+{
+    if (QThread::currentThread() == qApp->thread()) {
+        return;
+    }
+    ThreadPinning& pinning = threadPinning.localData();
+    assert(pinning.depth > 0);
+    if (--pinning.depth > 0) {
+        return;
+    }
+#ifdef __NATRON_LINUX__
+    if (pinning.affinitySaved) {
+        (void)sched_setaffinity(0, sizeof(pinning.previousAffinity), &pinning.previousAffinity);
+        pinning.affinitySaved = false;
+    }
+#endif
+}
+
+int
+getCurrentNode()
+{
+#ifdef __NATRON_LINUX__
+    int cpu = sched_getcpu();
+    if (cpu < 0) {
+        return -1;
+    }
+    QMutexLocker l(&topologyMutex);
+    const NUMATopology& t = getTopology_locked();
+    std::map<int,int>::const_iterator found = t.cpuToNode.find(cpu);
+    return found != t.cpuToNode.end() ? found->second : -1;
+#else
+    return -1;
+#endif
+}
+
+int
+getNodeOfAddress(const void* ptr)
+{
+#if defined(__NATRON_LINUX__) && defined(SYS_get_mempolicy)
+    int node = -1;
+    if (syscall(SYS_get_mempolicy, &node, NULL, 0, const_cast<void*>(ptr), MPOL_F_NODE | MPOL_F_ADDR) != 0) {
+        return -1;
+    }
+    return node;
+#else
+    (void)ptr;
+    return -1;
+#endif
+}
+
+void*
+allocate(std::size_t size)
+{
+#ifdef __NATRON_LINUX__
+    ///anonymous mappings are not touched until they are written to, unlike the memory recycled by malloc
+    void* ret = mmap(NULL, size > 0 ? size : 1, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return ret == MAP_FAILED ? NULL : ret;
+#else
+    return std::malloc(size);
+#endif
+}
+
+void*
+reallocate(void* ptr,std::size_t oldSize,std::size_t newSize)
+{
+#ifdef __NATRON_LINUX__
+    void* ret = mremap(ptr, oldSize > 0 ? oldSize : 1, newSize > 0 ? newSize : 1, MREMAP_MAYMOVE);
+    return ret == MAP_FAILED ? NULL : ret;
+#else
+    (void)oldSize;
+    return std::realloc(ptr, newSize);
+#endif
+}
+
+void
+deallocate(void* ptr,std::size_t size)
+{
+    if (!ptr) {
+        return;
+    }
+#ifdef __NATRON_LINUX__
+    munmap(ptr, size > 0 ? size : 1);
+#else
+    (void)size;
+    std::free(ptr);
+#endif
+}
+
+void
+recordTileLocality(const std::vector<const void*>& pages)
+{
+    int cpuNode = getCurrentNode();
+    if (cpuNode < 0) {
+        return;
+    }
+    bool sampled = false;
+    bool remote = false;
+    for (unsigned int i = 0; i < pages.size() && !remote; ++i) {
+        int memNode = getNodeOfAddress(pages[i]);
+        if (memNode < 0) {
+            continue;
+        }
+        sampled = true;
+        remote = memNode != cpuNode;
+    }
+    if (!sampled) {
+        return;
+    }
+    QMutexLocker l(&statsMutex);
+    if (remote) {
+        ++stats.remoteTiles;
+    } else {
+        ++stats.localTiles;
+    }
+}
+
+void
+getTileLocalityStats(U64* localTiles,U64* remoteTiles)
+{
+    QMutexLocker l(&statsMutex);
+    *localTiles = stats.localTiles;
+    *remoteTiles = stats.remoteTiles;
+}
+
+} // namespace NUMA
+} // namespace Natron
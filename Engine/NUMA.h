@@ -0,0 +1,123 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef NATRON_ENGINE_NUMA_H_
+#define NATRON_ENGINE_NUMA_H_
+
+#include <cstddef>
+#include <vector>
+
+#include "Global/Macros.h"
+#include "Global/GlobalDefines.h"
+
+namespace Natron {
+
+/**
+ * @brief Helpers to make the render threads friendlier to machines with several memory nodes
+ * (e.g multi-socket workstations). When enabled:
+ * - a thread rendering a tile is pinned to the cpus of one node while it renders it. Threads are assigned
+ * a node in a round-robin fashion the first time they render a tile.
+ * - image buffers living in RAM are mapped without being touched, so that the pages of a tile are
+ * placed (first-touch policy of the OS) on the node of the thread that renders it.
+ * - the node of the memory of each rendered tile is sampled to report the ratio of remote accesses.
+ *
+ * On machines with a single memory node, or on systems where this is not supported (anything but Linux
+ * for now), everything here is a no-op and isEnabled() returns false.
+ **/
+namespace NUMA {
+
+/**
+ * @brief Returns the number of memory nodes of the machine, 1 if it cannot be determined.
+ **/
+int getNodesCount() WARN_UNUSED_RETURN;
+
+/**
+ * @brief Enables the NUMA mode. Should be called once at start-up, before any render.
+ **/
+void setEnabled(bool enabled);
+
+/**
+ * @brief Returns true if the NUMA mode was enabled and the machine has more than 1 memory node.
+ **/
+bool isEnabled() WARN_UNUSED_RETURN;
+
+/**
+ * @brief Pins the calling thread to the cpus of its memory node until the matching call to unpinCurrentThread().
+ * Calls can be nested, only the outermost ones have an effect. The main thread is never pinned.
+ * The threads rendering tiles belong to the global thread pool shared with the rest of the application: they must
+ * not remain pinned once the tile is rendered, use ScopedThreadPinning.
+ **/
+void pinCurrentThread();
+
+/**
+ * @brief Restores the cpus the calling thread could run on before the matching call to pinCurrentThread().
+ **/
+void unpinCurrentThread();
+
+class ScopedThreadPinning
+{
+    bool _pinned;
+
+public:
+
+    ScopedThreadPinning()
+        : _pinned(isEnabled())
+    {
+        if (_pinned) {
+            pinCurrentThread();
+        }
+    }
+
+    ~ScopedThreadPinning()
+    {
+        if (_pinned) {
+            unpinCurrentThread();
+        }
+    }
+};
+
+/**
+ * @brief Returns the memory node of the cpu running the calling thread, -1 if unknown.
+ **/
+int getCurrentNode() WARN_UNUSED_RETURN;
+
+/**
+ * @brief Returns the memory node where the page containing ptr lives, -1 if unknown
+ * (e.g the page was not touched yet).
+ **/
+int getNodeOfAddress(const void* ptr) WARN_UNUSED_RETURN;
+
+/**
+ * @brief Allocates size bytes of untouched memory. The pages will be placed on the node of the
+ * thread writing them first. Returns NULL upon failure.
+ * The memory must be released with deallocate().
+ **/
+void* allocate(std::size_t size) WARN_UNUSED_RETURN;
+
+/**
+ * @brief Resizes a buffer returned by allocate(), keeping its content. Returns NULL upon failure,
+ * in which case ptr is left untouched.
+ **/
+void* reallocate(void* ptr,std::size_t oldSize,std::size_t newSize) WARN_UNUSED_RETURN;
+
+void deallocate(void* ptr,std::size_t size);
+
+/**
+ * @brief Records whether the memory of a tile just written by the calling thread is on the node of the thread.
+ * pages are addresses sampled in the tile, the tile is counted as remote if any of them is on another node.
+ **/
+void recordTileLocality(const std::vector<const void*>& pages);
+
+/**
+ * @brief Returns the number of tiles recorded by recordTileLocality() that were rendered in
+ * local and remote memory.
+ **/
+void getTileLocalityStats(U64* localTiles,U64* remoteTiles);
+
+} // namespace NUMA
+} // namespace Natron
+
+#endif // NATRON_ENGINE_NUMA_H_
@@ -22,6 +22,7 @@
 
 #include <ofxNatron.h>
 
+#include "Global/MemoryInfo.h"
 #include "Engine/Hash64.h"
 #include "Engine/ChannelSet.h"
 #include "Engine/Format.h"
@@ -43,6 +44,7 @@
 #include "Engine/KnobTypes.h"
 #include "Engine/ImageParams.h"
 #include "Engine/RotoContext.h"
+#include "Engine/Settings.h"
 
 using namespace Natron;
 using std::make_pair;
@@ -54,6 +56,54 @@ namespace { // protect local classes in anonymous namespace
 /*The output node was connected from inputNumber to this...*/
 typedef std::map<boost::shared_ptr<Node> ,int > DeactivatedState;
 
+///A hidden instance of the plug-in used to render INSTANCE_SAFE effects concurrently, @see Node::acquireRenderClone
+struct RenderClone {
+    Natron::EffectInstance* effect;
+    std::vector< std::pair< boost::shared_ptr<KnobI>,boost::shared_ptr<KnobI> > > knobs; //< (clone knob, live instance knob)
+    U64 knobsChangesCount; //< the knobs changes count of the live instance when its knobs were last copied
+    bool hasSlavedKnobs; //< true if a knob of the live instance was slaved when its knobs were last copied
+    bool busy; //< true while a render uses it
+    bool stale; //< true if the inputs or the clip preferences changed since it was created, it is deleted once idle
+    
+    RenderClone()
+    : effect(0)
+    , knobs()
+    , knobsChangesCount(0)
+    , hasSlavedKnobs(false)
+    , busy(false)
+    , stale(false)
+    {
+    }
+    
+    /**
+     * @brief Copies the knobs of the live instance. A slaved knob of the live instance returns the value of its master
+     * whereas its copy would keep the value it had when it was slaved: the knobs are not copied if one of them is
+     * slaved and the clone must not be used.
+     **/
+    void syncKnobs()
+    {
+        hasSlavedKnobs = false;
+        for (U32 i = 0; i < knobs.size() && !hasSlavedKnobs; ++i) {
+            std::vector<std::pair<int,boost::shared_ptr<KnobI> > > masters = knobs[i].second->getMasters_mt_safe();
+            for (U32 j = 0; j < masters.size(); ++j) {
+                if (masters[j].second) {
+                    hasSlavedKnobs = true;
+                    break;
+                }
+            }
+        }
+        if (hasSlavedKnobs) {
+            return;
+        }
+        for (U32 i = 0; i < knobs.size(); ++i) {
+            knobs[i].first->clone(knobs[i].second.get());
+        }
+    }
+};
+
+///Keep at least that many times the memory used by an instance of the plug-in free when adding a render clone
+#define NATRON_RENDER_CLONE_MEMORY_MARGIN 4
+
 }
 
 struct Node::Implementation {
@@ -103,7 +153,27 @@ struct Node::Implementation {
         , multiInstanceParentName()
         , duringInputChangedAction(false)
         , keyframesDisplayedOnTimeline(false)
+        , renderClonesMutex()
+        , renderClones()
+        , renderCloneRequested(false)
+        , renderClonesDisabled(false)
+    {
+    }
+    
+    ///Moves the stale clones not used by a render to clones, must be called with renderClonesMutex held
+    void takeIdleStaleRenderClones(std::list<RenderClone>* clones)
     {
+        std::list<RenderClone>::iterator it = renderClones.begin();
+        while (it != renderClones.end()) {
+            if (it->stale && !it->busy) {
+                std::list<RenderClone>::iterator next = it;
+                ++next;
+                clones->splice(clones->end(), renderClones, it);
+                it = next;
+            } else {
+                ++it;
+            }
+        }
     }
     
 
@@ -187,6 +257,11 @@ struct Node::Implementation {
     
     bool keyframesDisplayedOnTimeline;
     
+    mutable QMutex renderClonesMutex; //< protects renderClones, renderCloneRequested and renderClonesDisabled
+    std::list<RenderClone> renderClones; //< see INSTANCE_SAFE in EffectInstance::renderRoI
+    bool renderCloneRequested; //< true while a clone creation is pending in the main thread
+    bool renderClonesDisabled; //< true if the effect cannot have clones
+    
     void abortPreview();
 };
 
@@ -208,6 +283,7 @@ Node::Node(AppInstance* app,LibraryBinary* plugin)
     , _imp(new Implementation(app,plugin))
 {
     QObject::connect(this, SIGNAL(pluginMemoryUsageChanged(qint64)), appPTR, SLOT(onNodeMemoryRegistered(qint64)));
+    QObject::connect(this, SIGNAL(renderCloneRequested()), this, SLOT(createRenderClone()), Qt::QueuedConnection);
 }
 
 void Node::createRotoContextConditionnally()
@@ -537,6 +613,7 @@ void Node::quitAnyProcessing() {
 
 Node::~Node()
 {
+    clearRenderClones();
     if (_imp->liveInstance) {
         delete _imp->liveInstance;
     }
@@ -548,6 +625,7 @@ void Node::removeReferences()
     if (isOutput && isOutput->getVideoEngine()->isThreadRunning()) {
         isOutput->getVideoEngine()->quitEngineThread();
     }
+    clearRenderClones();
     delete _imp->liveInstance;
     _imp->liveInstance = 0;
 }
@@ -1500,6 +1578,35 @@ void renderPreview(const Natron::Image& srcImg,
 
 }
 
+///Returns an image of the node fully rendered at the given time for the view 0, at mipMapLevel or at a finer level,
+///so that the preview can be made out of what the viewer or a writer already rendered instead of rendering again.
+boost::shared_ptr<Natron::Image>
+findCachedImageForPreview(U64 nodeHash,SequenceTime time,unsigned int mipMapLevel)
+{
+    for (int level = (int)mipMapLevel; level >= 0; --level) {
+        Natron::ImageKey key = Natron::Image::makeKey(nodeHash, time, level, 0);
+        boost::shared_ptr<const Natron::ImageParams> params;
+        boost::shared_ptr<Natron::Image> img;
+        if (!Natron::getImageFromCache(key, &params, &img) || !img || !params) {
+            continue;
+        }
+        ///an identity image holds nothing, the pixels are in the cache of the input
+        if (params->getInputNbIdentity() != -1) {
+            continue;
+        }
+        Natron::ImageComponents comps = img->getComponents();
+        if (comps != Natron::ImageComponentRGB && comps != Natron::ImageComponentRGBA) {
+            continue;
+        }
+        ///the image may have been only partially rendered (e.g: the viewer was zoomed-in)
+        if (!img->getRestToRender(img->getPixelRoD()).empty()) {
+            continue;
+        }
+        return img;
+    }
+    return boost::shared_ptr<Natron::Image>();
+}
+
 }
 
 void Node::makePreviewImage(SequenceTime time,int *width,int *height,unsigned int* buf)
@@ -1545,21 +1652,25 @@ void Node::makePreviewImage(SequenceTime time,int *width,int *height,unsigned in
 
     boost::shared_ptr<Image> img;
     
+    img = findCachedImageForPreview(_imp->liveInstance->hash(), time, mipMapLevel);
+
     RectI scaledRod = rod.roundPowerOfTwoLargestEnclosed(mipMapLevel);
     // Exceptions are caught because the program can run without a preview,
     // but any exception in renderROI is probably fatal.
     try {
-        img = _imp->liveInstance->renderRoI(EffectInstance::RenderRoIArgs(time,
-                                                                          scale,
-                                                                          mipMapLevel,
-                                                                          0, //< preview only renders view 0 (left)
-                                                                          scaledRod,
-                                                                          false,
-                                                                          true,
-                                                                          false,
-                                                                          &rod,
-                                                                          Natron::ImageComponentRGB,
-                                                                          getBitDepth())); //< preview is always rgb...
+        if (!img) {
+            img = _imp->liveInstance->renderRoI(EffectInstance::RenderRoIArgs(time,
+                                                                              scale,
+                                                                              mipMapLevel,
+                                                                              0, //< preview only renders view 0 (left)
+                                                                              scaledRod,
+                                                                              false,
+                                                                              true,
+                                                                              false,
+                                                                              &rod,
+                                                                              Natron::ImageComponentRGB,
+                                                                              getBitDepth())); //< preview is always rgb...
+        }
     } catch (const std::exception& e) {
         qDebug() << "Error: Cannot create preview" << ": " << e.what();
         _imp->computingPreview = false;
@@ -1598,6 +1709,9 @@ void Node::makePreviewImage(SequenceTime time,int *width,int *height,unsigned in
         case Natron::IMAGE_FLOAT: {
             renderPreview<float, 1>(*img, rod, elemCount, width, height,convertToSrgb, buf);
         } break;
+        case Natron::IMAGE_HALF: {
+            renderPreview<Natron::Half, 1>(*img, rod, elemCount, width, height,convertToSrgb, buf);
+        } break;
         default:
             break;
     }
@@ -1815,6 +1929,159 @@ QMutex& Node::getRenderInstancesSharedMutex()
     return _imp->renderInstancesSharedMutex;
 }
 
+Natron::EffectInstance* Node::acquireRenderClone()
+{
+    ///Unlike the knobs age, the changes count is incremented when a knob changes while the evaluation is blocked
+    U64 knobsChangesCount = _imp->liveInstance->getKnobsChangesCount();
+    RenderClone* found = 0;
+    {
+        QMutexLocker l(&_imp->renderClonesMutex);
+        for (std::list<RenderClone>::iterator it = _imp->renderClones.begin(); it != _imp->renderClones.end(); ++it) {
+            if (!it->busy && !it->stale) {
+                it->busy = true;
+                found = &(*it);
+                break;
+            }
+        }
+        if (!found) {
+            if (!_imp->renderCloneRequested && !_imp->renderClonesDisabled) {
+                _imp->renderCloneRequested = true;
+                emit renderCloneRequested();
+            }
+            return NULL;
+        }
+    }
+    
+    ///The clone is owned by this thread until it is released, its knobs can be written without holding the lock
+    if (found->knobsChangesCount != knobsChangesCount) {
+        found->syncKnobs();
+        found->knobsChangesCount = knobsChangesCount;
+    }
+    if (found->hasSlavedKnobs) {
+        releaseRenderClone(found->effect);
+        return NULL;
+    }
+    return found->effect;
+}
+
+void Node::releaseRenderClone(Natron::EffectInstance* clone)
+{
+    QMutexLocker l(&_imp->renderClonesMutex);
+    for (std::list<RenderClone>::iterator it = _imp->renderClones.begin(); it != _imp->renderClones.end(); ++it) {
+        if (it->effect == clone) {
+            assert(it->busy);
+            it->busy = false;
+            return;
+        }
+    }
+    assert(false);
+}
+
+void Node::clearRenderClones()
+{
+    std::list<RenderClone> clones;
+    {
+        QMutexLocker l(&_imp->renderClonesMutex);
+        clones.swap(_imp->renderClones);
+    }
+    for (std::list<RenderClone>::iterator it = clones.begin(); it != clones.end(); ++it) {
+        assert(!it->busy);
+        delete it->effect;
+    }
+}
+
+void Node::invalidateRenderClones()
+{
+    assert(QThread::currentThread() == qApp->thread());
+    std::list<RenderClone> clones;
+    {
+        QMutexLocker l(&_imp->renderClonesMutex);
+        for (std::list<RenderClone>::iterator it = _imp->renderClones.begin(); it != _imp->renderClones.end(); ++it) {
+            it->stale = true;
+        }
+        _imp->takeIdleStaleRenderClones(&clones);
+    }
+    for (std::list<RenderClone>::iterator it = clones.begin(); it != clones.end(); ++it) {
+        delete it->effect;
+    }
+}
+
+void Node::createRenderClone()
+{
+    ///Clones are created like the live instance, in the main thread.
+    assert(QThread::currentThread() == qApp->thread());
+    
+    int clonesCount;
+    std::list<RenderClone> staleClones;
+    {
+        QMutexLocker l(&_imp->renderClonesMutex);
+        _imp->renderCloneRequested = false;
+        _imp->takeIdleStaleRenderClones(&staleClones);
+        clonesCount = (int)_imp->renderClones.size();
+    }
+    for (std::list<RenderClone>::iterator it = staleClones.begin(); it != staleClones.end(); ++it) {
+        delete it->effect;
+    }
+    if (!_imp->liveInstance || !isActivated()) {
+        return;
+    }
+    
+    ///Only OpenFX effects can be instanciated more than once. Writers, roto and multi-instance nodes hold
+    ///state in the node that a clone would not share.
+    if (!dynamic_cast<OfxEffectInstance*>(_imp->liveInstance) || isOutputNode() || isRotoNode() ||
+        _imp->isMultiInstance || !_imp->multiInstanceParentName.empty()) {
+        QMutexLocker l(&_imp->renderClonesMutex);
+        _imp->renderClonesDisabled = true;
+        return;
+    }
+    
+    ///The live instance is one of the renderers, together they should not outnumber the cores
+    if (clonesCount + 1 >= QThread::idealThreadCount()) {
+        return;
+    }
+    
+    ///The memory the plug-in registered so far is shared by the live instance and the clones: a new clone
+    ///is expected to use as much as each of them. It must fit in the RAM that is not given to the caches.
+    qint64 instanceMemory;
+    {
+        QMutexLocker l(&_imp->memoryUsedMutex);
+        instanceMemory = (qint64)(_imp->pluginInstanceMemoryUsed / (clonesCount + 1));
+    }
+    qint64 freeMemory = (qint64)((1. - appPTR->getCurrentSettings()->getRamMaximumPercent()) * getSystemTotalRAM())
+    - appPTR->getTotalNodesMemoryRegistered();
+    if (instanceMemory * NATRON_RENDER_CLONE_MEMORY_MARGIN > freeMemory) {
+        return;
+    }
+    
+    RenderClone clone;
+    try {
+        clone.effect = appPTR->createOFXEffect(pluginID(), _imp->liveInstance->getNode(), NULL);
+    } catch (const std::exception& e) {
+        qDebug() << "Failed to create a render clone of " << getName_mt_safe().c_str() << ": " << e.what();
+        QMutexLocker l(&_imp->renderClonesMutex);
+        _imp->renderClonesDisabled = true;
+        return;
+    }
+    assert(clone.effect && clone.effect != _imp->liveInstance);
+    
+    ///Pair the knobs by name: the node adds its own knobs to the live instance only.
+    const std::vector< boost::shared_ptr<KnobI> >& cloneKnobs = clone.effect->getKnobs();
+    for (U32 i = 0; i < cloneKnobs.size(); ++i) {
+        boost::shared_ptr<KnobI> liveKnob = _imp->liveInstance->getKnobByName(cloneKnobs[i]->getName());
+        if (liveKnob) {
+            clone.knobs.push_back(std::make_pair(cloneKnobs[i], liveKnob));
+        }
+    }
+    clone.knobsChangesCount = _imp->liveInstance->getKnobsChangesCount();
+    clone.syncKnobs();
+    
+    ///The clip preferences depend on the knobs and on the inputs, the clone runs them like the live instance did
+    dynamic_cast<OfxEffectInstance*>(clone.effect)->refreshClipPreferences();
+    
+    QMutexLocker l(&_imp->renderClonesMutex);
+    _imp->renderClones.push_back(clone);
+}
+
 QMutex& Node::getFrameMutex(int time)
 {
     QMutexLocker l(&_imp->perFrameMutexesLock);
@@ -2029,6 +2296,7 @@ void Node::onInputChanged(int inputNb)
         it->second->setEvaluateOnChange(true);
     }
     _imp->liveInstance->onInputChanged(inputNb);
+    invalidateRenderClones();
     _imp->duringInputChangedAction = false;
 }
 
@@ -2041,6 +2309,7 @@ void Node::onMultipleInputChanged()
         it->second->setValue(inp ? true : false, 0);
     }
     _imp->liveInstance->onMultipleInputsChanged();
+    invalidateRenderClones();
     _imp->duringInputChangedAction = false;
 }
 
@@ -2185,6 +2454,7 @@ void Node::getAllKnobsKeyframes(std::list<SequenceTime>* keyframes)
 
 Natron::ImageBitDepth Natron::Node::getBitDepth() const
 {
+    bool foundHalf = false;
     bool foundShort = false;
     bool foundByte = false;
     for (std::list<ImageBitDepth>::const_iterator it = _imp->supportedDepths.begin(); it!= _imp->supportedDepths.end(); ++it) {
@@ -2194,10 +2464,14 @@ Natron::ImageBitDepth Natron::Node::getBitDepth() const
             foundByte = true;
         } else if (*it == Natron::IMAGE_SHORT) {
             foundShort = true;
+        } else if (*it == Natron::IMAGE_HALF) {
+            foundHalf = true;
         }
     }
     
-    if (foundShort) {
+    if (foundHalf) {
+        return Natron::IMAGE_HALF;
+    } else if (foundShort) {
         return Natron::IMAGE_SHORT;
     } else if (foundByte) {
         return Natron::IMAGE_BYTE;
@@ -500,9 +500,35 @@ public:
     void unregisterPluginMemory(size_t nBytes);
 
     //see INSTANCE_SAFE in EffectInstance::renderRoI
-    //only 1 clone can render at any time
+    //only 1 render can use the live instance at any time
     QMutex& getRenderInstancesSharedMutex();
     
+    /**
+     * @brief Returns an idle hidden clone of the live instance whose knobs hold the same values as the live instance,
+     * so that INSTANCE_SAFE effects can render several frames concurrently (see EffectInstance::renderRoI).
+     * Returns NULL if no clone is idle, or if a knob of the live instance is slaved: the render must then use the
+     * live instance under getRenderInstancesSharedMutex().
+     * Such a miss asks the main thread to create one more clone, as long as the number of clones is below the number
+     * of cores and the memory registered by the instances of this node allows it. MT-safe
+     * The clone must be given back with releaseRenderClone().
+     **/
+    Natron::EffectInstance* acquireRenderClone();
+    
+    void releaseRenderClone(Natron::EffectInstance* clone);
+    
+    /**
+     * @brief Deletes all the render clones, they will be created again when needed.
+     * Only called by the main-thread, when no render is running.
+     **/
+    void clearRenderClones();
+    
+    /**
+     * @brief Drops the render clones because the inputs or the clip preferences of the live instance changed, which
+     * the clones were not told about. The clones being used by a render are deleted once they are released.
+     * Only called by the main-thread.
+     **/
+    void invalidateRenderClones();
+    
     ///see FULLY_SAFE in EffectInstance::renderRoI
     QMutex& getFrameMutex(int time);
     
@@ -629,8 +655,13 @@ public slots:
     
     void notifySettingsPanelClosed(bool closed ) { emit settingsPanelClosed(closed); }
     
+    ///Creates a render clone if the pool is not full, @see acquireRenderClone
+    void createRenderClone();
+    
 signals:
     
+    void renderCloneRequested();
+    
     void settingsPanelClosed(bool);
     
     void knobsAgeChanged(U64 age);
@@ -289,8 +289,8 @@ OfxRectD OfxClipInstance::getRegionOfDefinition(OfxTime time) const
         
         ///If the RoD is cached accept it always if it doesn't depend on the project format.
         ///Otherwise cehck that it is really the current project format.
-        ///Also don't use cached RoDs for identity effects as they contain garbage here (because identity effects allocates
-        ///images with 0 bytes of data (rod null))
+        ///Also don't use the RoDs of identity images restored from the disk cache of a previous version, they were
+        ///allocated with 0 bytes of data (rod null). Identities are now recorded as aliases and never cached.
         if (isCached && (!cachedImgParams->isRodProjectFormat()
             || (cachedImgParams->isRodProjectFormat() && cachedImgParams->getRoD() == dynamic_cast<RectI&>(f))) &&
             cachedImgParams->getInputNbIdentity() == -1) {
@@ -419,6 +419,8 @@ Natron::ImageBitDepth OfxClipInstance::ofxDepthToNatronDepth(const std::string&
         return Natron::IMAGE_SHORT;
     } else if (depth == kOfxBitDepthFloat) {
         return Natron::IMAGE_FLOAT;
+    } else if (depth == kOfxBitDepthHalf) {
+        return Natron::IMAGE_HALF;
     } else {
         throw std::runtime_error(depth+": unsupported bitdepth"); //< comp unsupported
     }
@@ -433,6 +435,8 @@ std::string OfxClipInstance::natronsDepthToOfxDepth(Natron::ImageBitDepth depth)
             return kOfxBitDepthShort;
         case Natron::IMAGE_FLOAT:
             return kOfxBitDepthFloat;
+        case Natron::IMAGE_HALF:
+            return kOfxBitDepthHalf;
         default:
             assert(false);//< shouldve been caught earlier
             break;
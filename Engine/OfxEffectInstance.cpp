@@ -653,6 +653,15 @@ void OfxEffectInstance::checkClipPrefs(double time,const RenderScale& scale, con
     getNode()->toggleBitDepthWarning(setBitDepthWarning, bitDepthWarning);
 }
 
+void OfxEffectInstance::refreshClipPreferences()
+{
+    if (effect_->areAllNonOptionalClipsConnected()) {
+        RenderScale s;
+        s.x = s.y = 1.;
+        checkClipPrefs(effect_->getFrameRecursive(),s,kOfxChangeUserEdited);
+    }
+}
+
 void OfxEffectInstance::onMultipleInputsChanged() {
     
     ///Recursive action, must not call assertActionIsNotRecursive()
@@ -1597,6 +1606,7 @@ void OfxEffectInstance::knobChanged(KnobI* k,Natron::ValueChangedReason reason,c
         incrementRecursionLevel();
         effect_->runGetClipPrefsConditionally();
         decrementRecursionLevel();
+        _node->invalidateRenderClones();
     }
     if (_overlayInteract) {
         std::vector<std::string> params;
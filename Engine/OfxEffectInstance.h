@@ -210,6 +210,9 @@ public:
     
     virtual void onMultipleInputsChanged() OVERRIDE FINAL;
     
+    ///Runs the clip preferences action of a render clone, see Node::createRenderClone
+    void refreshClipPreferences();
+    
     virtual std::vector<std::string> supportedFileFormats() const OVERRIDE FINAL;
     
     virtual Natron::Status beginSequenceRender(SequenceTime first,SequenceTime last,
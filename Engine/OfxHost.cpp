@@ -11,6 +11,7 @@
 
 #include <cassert>
 #include <fstream>
+#include <sstream>
 #include <new> // std::bad_alloc
 #include <stdexcept> // std::exception
 #include <cctype> // tolower
@@ -60,7 +61,8 @@
 using namespace Natron;
 
 Natron::OfxHost::OfxHost()
-:_imageEffectPluginCache(new OFX::Host::ImageEffect::PluginCache(*this))
+: _imageEffectPluginCache(new OFX::Host::ImageEffect::PluginCache(*this))
+, _loadingStatusTimer()
 {
 
 }
@@ -114,6 +116,7 @@ void Natron::OfxHost::setProperties()
     _properties.setStringProperty(kOfxImageEffectPropSupportedPixelDepths,kOfxBitDepthFloat,0);
     _properties.setStringProperty(kOfxImageEffectPropSupportedPixelDepths,kOfxBitDepthShort,1);
     _properties.setStringProperty(kOfxImageEffectPropSupportedPixelDepths,kOfxBitDepthByte,2);
+    _properties.setStringProperty(kOfxImageEffectPropSupportedPixelDepths,kOfxBitDepthHalf,3);
     
     _properties.setIntProperty(kOfxImageEffectPropSupportsMultipleClipDepths, 1);
     _properties.setIntProperty(kOfxImageEffectPropSupportsMultipleClipPARs, 0);
@@ -349,6 +352,10 @@ void Natron::OfxHost::loadOFXPlugins(std::map<std::string,std::vector<std::strin
 {
     
     assert(OFX::Host::PluginCache::getPluginCache());
+    
+    QElapsedTimer loadTimer;
+    loadTimer.start();
+    
     /// set the version label in the global cache
     OFX::Host::PluginCache::getPluginCache()->setCacheVersion(NATRON_APPLICATION_NAME "OFXCachev1");
         
@@ -393,16 +400,34 @@ void Natron::OfxHost::loadOFXPlugins(std::map<std::string,std::vector<std::strin
     //on windows:
     QString ofxcachename = Natron::StandardPaths::writableLocation(Natron::StandardPaths::CacheLocation) + QDir::separator() + "OFXCache.xml";
 
-    std::ifstream ifs(ofxcachename.toStdString().c_str());
-    if (ifs.is_open()) {
-        OFX::Host::PluginCache::getPluginCache()->readCache(ifs);
-        ifs.close();
+    ///Read the whole file at once: the cache parser reads it in small chunks which is slow for large caches
+    std::string oldCacheContent;
+    {
+        std::ifstream ifs(ofxcachename.toStdString().c_str(),std::ios::in | std::ios::binary);
+        if (ifs.is_open()) {
+            std::ostringstream ss;
+            ss << ifs.rdbuf();
+            oldCacheContent = ss.str();
+            ifs.close();
+        }
     }
+    if (!oldCacheContent.empty()) {
+        std::istringstream iss(oldCacheContent);
+        OFX::Host::PluginCache::getPluginCache()->readCache(iss);
+    }
+    
+    /// Only the binaries whose modification time or size differ from the cache are loaded and described
     OFX::Host::PluginCache::getPluginCache()->scanPluginFiles();
 
-    // write the cache NOW (it won't change anyway)
-    /// flush out the current cache
-    writeOFXCache();
+    /// flush out the current cache, unless the scan didn't change anything
+    {
+        std::ostringstream newCache;
+        OFX::Host::PluginCache::getPluginCache()->writePluginCache(newCache);
+        std::string newCacheContent = newCache.str();
+        if (newCacheContent != oldCacheContent) {
+            writeOFXCache(newCacheContent);
+        }
+    }
 
     /*Filling node name list and plugin grouping*/
     const std::map<std::string,OFX::Host::ImageEffect::ImageEffectPlugin *>& ofxPlugins = _imageEffectPluginCache->getPluginsByID();
@@ -503,20 +528,21 @@ void Natron::OfxHost::loadOFXPlugins(std::map<std::string,std::vector<std::strin
         }
 
     }
+    
+    qDebug() << "Loaded" << ofxPlugins.size() << "OpenFX plug-ins in" << loadTimer.elapsed() << "ms";
 }
 
 
 
-void Natron::OfxHost::writeOFXCache(){
+void Natron::OfxHost::writeOFXCache(const std::string& content){
     /// and write a new cache, long version with everything in there
     QString ofxcachename = Natron::StandardPaths::writableLocation(Natron::StandardPaths::CacheLocation);
     QDir().mkpath(ofxcachename);
     ofxcachename +=  QDir::separator();
     ofxcachename += "OFXCache.xml";
-    std::ofstream of(ofxcachename.toStdString().c_str());
+    std::ofstream of(ofxcachename.toStdString().c_str(),std::ios::out | std::ios::binary);
     assert(of.is_open());
-    assert(OFX::Host::PluginCache::getPluginCache());
-    OFX::Host::PluginCache::getPluginCache()->writePluginCache(of);
+    of << content;
     of.close();
 }
 
@@ -533,10 +559,18 @@ void Natron::OfxHost::clearPluginsLoadedCache() {
     }
 }
 
+///Minimum interval between 2 refreshes of the loading status while plug-ins are loaded
+#define NATRON_OFX_LOADING_STATUS_INTERVAL_MS 100
+
 void Natron::OfxHost::loadingStatus(const std::string & pluginId) {
-    if (appPTR) {
-        appPTR->setLoadingStatus("OpenFX: " + QString(pluginId.c_str()));
+    if (!appPTR) {
+        return;
+    }
+    if (_loadingStatusTimer.isValid() && _loadingStatusTimer.elapsed() < NATRON_OFX_LOADING_STATUS_INTERVAL_MS) {
+        return;
     }
+    _loadingStatusTimer.start();
+    appPTR->setLoadingStatus("OpenFX: " + QString(pluginId.c_str()));
 }
 
 bool Natron::OfxHost::pluginSupported(OFX::Host::ImageEffect::ImageEffectPlugin */*plugin*/, std::string &/*reason*/) const
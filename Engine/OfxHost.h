@@ -18,6 +18,9 @@
 #include <ofxhImageEffectAPI.h>
 
 #include "Global/Macros.h"
+CLANG_DIAG_OFF(deprecated)
+#include <QtCore/QElapsedTimer>
+CLANG_DIAG_ON(deprecated)
 
 class AbstractOfxEffectInstance;
 class AppInstance;
@@ -119,11 +122,15 @@ private:
 
     void getPluginAndContextByID(const std::string& pluginID, OFX::Host::ImageEffect::ImageEffectPlugin** plugin,std::string& context);
 
-    /*Writes all plugins loaded and their descriptors to
-     the OFX plugin cache. (called by the destructor) */
-    void writeOFXCache();
+    /*Writes the content of the OFX plugin cache (all plugins loaded and their descriptors)
+     to the cache file.*/
+    void writeOFXCache(const std::string& content);
     
     OFX::Host::ImageEffect::PluginCache* _imageEffectPluginCache;
+    
+    ///The loading status is reported for every plug-in loaded by the plug-in cache but the splash-screen
+    ///is only refreshed every few milliseconds: repainting it for each of hundreds of plug-ins slows down start-up.
+    QElapsedTimer _loadingStatusTimer;
 
 
     /*plugin name -> pair< plugin id , plugin grouping >
@@ -34,6 +34,50 @@
 using std::cout; using std::endl;
 using std::make_pair;
 
+///Binary project files start with this line, followed by a boost binary archive.
+///XML project files start with "<?xml" so the two formats can be told apart by peeking at the file.
+#define NATRON_BINARY_PROJECT_MAGIC "NatronBinaryProject"
+
+///Increment this whenever the layout written after the magic line changes.
+#define NATRON_BINARY_PROJECT_VERSION_INITIAL 1
+#define NATRON_BINARY_PROJECT_VERSION_NODES_AS_ARCHIVES 2
+#define NATRON_BINARY_PROJECT_VERSION NATRON_BINARY_PROJECT_VERSION_NODES_AS_ARCHIVES
+
+///Every so many auto-saves, all nodes are serialized again even if their hash didn't change.
+///This guarantees that a change that doesn't affect the hash of a node (if any) cannot be missing from
+///the auto-saves for more than this number of auto-saves.
+#define NATRON_AUTO_SAVES_BETWEEN_FULL_SERIALIZATION 10
+
+namespace {
+    
+/**
+ * @brief Returns the version of the binary project format if the file was written in the binary project format
+ * and leaves the stream positioned at the start of the boost archive. Otherwise returns 0 and the stream is
+ * rewinded to the start of the file.
+ * Throws if the file is a binary project written by a more recent version.
+ **/
+int readBinaryProjectHeader(std::ifstream& ifile)
+{
+    std::string magic;
+    ifile >> magic;
+    if (magic != NATRON_BINARY_PROJECT_MAGIC) {
+        ifile.clear();
+        ifile.seekg(0,std::ios::beg);
+        return 0;
+    }
+    int version;
+    ifile >> version;
+    if (version > NATRON_BINARY_PROJECT_VERSION) {
+        throw std::runtime_error("This project was saved in a binary format version more recent than the one supported by "
+                                 "this version of " NATRON_APPLICATION_NAME ".");
+    }
+    ///skip the end of the header line
+    ifile.ignore();
+    return version;
+}
+
+}
+
 
 namespace Natron {
 
@@ -113,21 +157,29 @@ void Project::loadProjectInternal(const QString& path,const QString& name) {
         throw std::invalid_argument(QString(filePath + " : no such file.").toStdString());
     }
     std::ifstream ifile;
+    int binaryVersion;
     try {
+        ifile.open(filePath.toStdString().c_str(),std::ifstream::in | std::ifstream::binary);
+        binaryVersion = readBinaryProjectHeader(ifile);
+        if (binaryVersion == 0) {
+            ///re-open the XML project in text mode
+            ifile.close();
+            ifile.open(filePath.toStdString().c_str(),std::ifstream::in);
+        }
         ifile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-        ifile.open(filePath.toStdString().c_str(),std::ifstream::in);
     } catch (const std::ifstream::failure& e) {
         throw std::runtime_error(std::string("Exception occured when opening file ") + filePath.toStdString() + ": " + e.what());
     }
+    if (!ifile.good()) {
+        throw std::runtime_error(std::string("Failed to open file ") + filePath.toStdString());
+    }
     try {
-        boost::archive::xml_iarchive iArchive(ifile);
-        bool bgProject;
-        iArchive >> boost::serialization::make_nvp("Background_project",bgProject);
-        ProjectSerialization projectSerializationObj(getApp());
-        iArchive >> boost::serialization::make_nvp("Project",projectSerializationObj);
-        load(projectSerializationObj);
-        if (!bgProject) {
-            getApp()->loadProjectGui(iArchive);
+        if (binaryVersion != 0) {
+            boost::archive::binary_iarchive iArchive(ifile);
+            loadProjectFromArchive(iArchive, binaryVersion >= NATRON_BINARY_PROJECT_VERSION_NODES_AS_ARCHIVES);
+        } else {
+            boost::archive::xml_iarchive iArchive(ifile);
+            loadProjectFromArchive(iArchive, false);
         }
     } catch(const boost::archive::archive_exception& e) {
         ifile.close();
@@ -148,6 +200,40 @@ void Project::loadProjectInternal(const QString& path,const QString& name) {
     emit projectNameChanged(name);
 }
 
+template <class Archive>
+void Project::loadProjectFromArchive(Archive& archive,bool nodesAsBinaryArchives) {
+    bool bgProject;
+    archive >> boost::serialization::make_nvp("Background_project",bgProject);
+    ProjectSerialization projectSerializationObj(getApp(),nodesAsBinaryArchives);
+    archive >> boost::serialization::make_nvp("Project",projectSerializationObj);
+    load(projectSerializationObj);
+    if (!bgProject) {
+        getApp()->loadProjectGui(archive);
+    }
+}
+
+template <class Archive>
+void Project::saveProjectToArchive(Archive& archive,bool nodesAsBinaryArchives,bool useAutoSaveCache) {
+    assert(!useAutoSaveCache || nodesAsBinaryArchives);
+    bool bgProject = appPTR->isBackground();
+    archive << boost::serialization::make_nvp("Background_project",bgProject);
+    ProjectSerialization projectSerializationObj(getApp(),nodesAsBinaryArchives);
+    if (useAutoSaveCache) {
+        QMutexLocker l(&_imp->autoSaveCacheMutex);
+        if (++_imp->autoSavesSinceFullSerialization >= NATRON_AUTO_SAVES_BETWEEN_FULL_SERIALIZATION) {
+            _imp->autoSaveCache.clear();
+            _imp->autoSavesSinceFullSerialization = 0;
+        }
+        projectSerializationObj.initialize(this,&_imp->autoSaveCache);
+    } else {
+        save(&projectSerializationObj);
+    }
+    archive << boost::serialization::make_nvp("Project",projectSerializationObj);
+    if (!bgProject) {
+        getApp()->saveProjectGui(archive);
+    }
+}
+
 void Project::refreshViewersAndPreviews() {
     /*Refresh all previews*/
     for (U32 i = 0; i < _imp->currentNodes.size(); ++i) {
@@ -285,10 +371,14 @@ QDateTime Project::saveProjectInternal(const QString& path,const QString& name,b
     tmpFilename.append(QDir::separator());
     tmpFilename.append(QString::number(time.toMSecsSinceEpoch()));
     
+    ///Auto-saves are only ever read back by this application on this machine, so they always use the faster binary format.
+    ///Boost binary archives are not portable across platforms, hence user saves stay in XML unless requested otherwise.
+    bool saveAsBinary = autoSave || appPTR->getCurrentSettings()->isBinaryProjectFormatEnabled();
+    
     std::ofstream ofile;
     try {
         ofile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-        ofile.open(tmpFilename.toStdString().c_str(),std::ofstream::out);
+        ofile.open(tmpFilename.toStdString().c_str(),saveAsBinary ? std::ofstream::out | std::ofstream::binary : std::ofstream::out);
     } catch (const std::ofstream::failure& e) {
         throw std::runtime_error(std::string("Exception occured when opening file ") + filePath.toStdString() + ": " + e.what());
     }
@@ -299,14 +389,14 @@ QDateTime Project::saveProjectInternal(const QString& path,const QString& name,b
     }
     
     try {
-        boost::archive::xml_oarchive oArchive(ofile);
-        bool bgProject = appPTR->isBackground();
-        oArchive << boost::serialization::make_nvp("Background_project",bgProject);
-        ProjectSerialization projectSerializationObj(getApp());
-        save(&projectSerializationObj);
-        oArchive << boost::serialization::make_nvp("Project",projectSerializationObj);
-        if(!bgProject){
-            getApp()->saveProjectGui(oArchive);
+        if (saveAsBinary) {
+            ofile << NATRON_BINARY_PROJECT_MAGIC << ' ' << NATRON_BINARY_PROJECT_VERSION << '\n';
+            boost::archive::binary_oarchive oArchive(ofile);
+            ///For auto-saves, only the nodes that changed since the last auto-save are serialized again
+            saveProjectToArchive(oArchive, true, autoSave);
+        } else {
+            boost::archive::xml_oarchive oArchive(ofile);
+            saveProjectToArchive(oArchive, false, false);
         }
     } catch (...) {
         ofile.close();
@@ -317,12 +407,14 @@ QDateTime Project::saveProjectInternal(const QString& path,const QString& name,b
     QFile::remove(filePath);
     int nAttemps = 0;
     
-    while (nAttemps < 10 && !fileCopy(tmpFilename, filePath)) {
-        ++nAttemps;
+    ///Renaming is instantaneous when the temporary directory is on the same volume, otherwise fallback on a copy.
+    if (!QFile::rename(tmpFilename, filePath)) {
+        while (nAttemps < 10 && !fileCopy(tmpFilename, filePath)) {
+            ++nAttemps;
+        }
+        QFile::remove(tmpFilename);
     }
     
-    QFile::remove(tmpFilename);
-    
     _imp->projectName = name;
     if (!autoSave) {
         emit projectNameChanged(name); //< notify the gui so it can update the title
@@ -570,6 +662,16 @@ void Project::initializeKnobs(){
     _imp->colorSpace32bits->populateChoices(colorSpaces);
     _imp->colorSpace32bits->setDefaultValue(1);
     
+    _imp->halfFloatStorage = Natron::createKnob<Bool_Knob>(this, "Store intermediate images as half float");
+    _imp->halfFloatStorage->setHintToolTip("When checked, the images rendered in 32 bits floating point by the nodes are "
+                                           "kept in the cache as 16 bits floating point images. This doubles the number of "
+                                           "images the node cache can hold, at the cost of some precision (about 3 decimal digits) "
+                                           "and of a conversion when an image is fetched from the cache. The output of the "
+                                           "nodes is still delivered in 32 bits floating point.");
+    _imp->halfFloatStorage->setAnimationEnabled(false);
+    _imp->halfFloatStorage->setDefaultValue(false,0);
+    page->addKnob(_imp->halfFloatStorage);
+    
     emit knobsInitialized();
     
 }
@@ -811,6 +913,10 @@ bool Project::isAutoPreviewEnabled() const {
     return _imp->previewMode->getValue();
 }
 
+bool Project::isHalfFloatStorageEnabled() const {
+    return _imp->halfFloatStorage->getValue();
+}
+
 void Project::toggleAutoPreview() {
     QMutexLocker l(&_imp->previewModeMutex);
     _imp->previewMode->setValue(!_imp->previewMode->getValue(),0);
@@ -881,6 +987,11 @@ void Project::onKnobValueChanged(KnobI* knob,Natron::ValueChangedReason /*reason
         Format frmt;
         bool found = _imp->findFormat(index, &frmt);
         if (found) {
+            ///The region of definition of generators depends on the project format, which is not part of the hash
+            std::vector< boost::shared_ptr<Natron::Node> > nodes = getCurrentNodes();
+            for (U32 i = 0; i < nodes.size(); ++i) {
+                nodes[i]->getLiveInstance()->clearActionsCache();
+            }
             emit formatChanged(frmt);
         }
     } else if(knob == _imp->addFormatKnob.get()) {
@@ -944,6 +1055,12 @@ void Project::reset() {
         _imp->autoSaveTimer->stop();
         _imp->additionalFormats.clear();
     }
+    {
+        ///The names of the nodes of the next project may collide with the ones in the cache
+        QMutexLocker l(&_imp->autoSaveCacheMutex);
+        _imp->autoSaveCache.clear();
+        _imp->autoSavesSinceFullSerialization = 0;
+    }
     const std::vector<boost::shared_ptr<KnobI> >& knobs = getKnobs();
     for (U32 i = 0; i < knobs.size(); ++i) {
         knobs[i]->blockEvaluation();
@@ -1212,6 +1329,7 @@ Natron::ViewerColorSpace Project::getDefaultColorSpaceForBitDepth(Natron::ImageB
         case Natron::IMAGE_SHORT:
             return (Natron::ViewerColorSpace)_imp->colorSpace16bits->getValue();
         case Natron::IMAGE_FLOAT:
+        case Natron::IMAGE_HALF:
             return (Natron::ViewerColorSpace)_imp->colorSpace32bits->getValue();
         default:
             assert(false);
@@ -149,6 +149,12 @@ public:
     
     void toggleAutoPreview();
     
+    /**
+     * @brief Returns true if the images rendered in 32 bits floating point should be stored
+     * as Natron::IMAGE_HALF images.
+     **/
+    bool isHalfFloatStorageEnabled() const;
+    
     boost::shared_ptr<TimeLine> getTimeLine() const WARN_UNUSED_RETURN;
     
     // TimeLine operations (to avoid duplicating the shared_ptr when possible)
@@ -254,6 +260,19 @@ private:
     void loadProjectInternal(const QString& path,const QString& name);
     
     QDateTime saveProjectInternal(const QString& path,const QString& name,bool autosave = false);
+    
+    /**
+     * @brief Reads/writes the project (and its gui if any) from/to the given archive. The same code path
+     * is used for the XML and the binary project formats.
+     * @param nodesAsBinaryArchives If true, each node is stored in its own binary archive (@see ProjectSerialization)
+     * @param useAutoSaveCache If true, the nodes archives that are still up to date are taken from the auto-save cache
+     * instead of serializing the nodes again. Requires nodesAsBinaryArchives.
+     **/
+    template <class Archive>
+    void loadProjectFromArchive(Archive& archive,bool nodesAsBinaryArchives);
+    
+    template <class Archive>
+    void saveProjectToArchive(Archive& archive,bool nodesAsBinaryArchives,bool useAutoSaveCache);
  
     
     /**
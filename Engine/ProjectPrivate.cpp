@@ -42,6 +42,7 @@ ProjectPrivate::ProjectPrivate(Natron::Project* project)
     , colorSpace8bits()
     , colorSpace16bits()
     , colorSpace32bits()
+    , halfFloatStorage()
     , timelineMutex()
     , timeline(new TimeLine(project))
     , autoSetProjectFormat(true)
@@ -53,6 +54,9 @@ ProjectPrivate::ProjectPrivate(Natron::Project* project)
     , isSavingProjectMutex()
     , isSavingProject(false)
     , autoSaveTimer(new QTimer())
+    , autoSaveCacheMutex()
+    , autoSaveCache()
+    , autoSavesSinceFullSerialization(0)
 
 {
     autoSaveTimer->setSingleShot(true);
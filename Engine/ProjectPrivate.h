@@ -12,6 +12,7 @@
 #define PROJECTPRIVATE_H
 
 #include <map>
+#include <string>
 
 #include "Global/Macros.h"
 CLANG_DIAG_OFF(deprecated)
@@ -51,6 +52,24 @@ inline QString generateStringFromFormat(const Format& f){
     
    
 
+/**
+ * @brief The binary archive of a node written by the last auto-save, along with what it depends on at that time.
+ * The archive is out-dated if any of them changed: the hash changes whenever a knob of the node or of one of its
+ * inputs is evaluated, the knobs changes count whenever a knob of the node changes (even without evaluation),
+ * and the dependencies are the names of the other nodes written in the archive, which change when they are renamed.
+ * Nodes with a roto context are never cached: their items change without the node being notified.
+ **/
+struct NodeSerializationCacheEntry
+{
+    U64 hash;
+    U64 knobsChangesCount;
+    std::string dependencies;
+    std::string data;
+};
+    
+///Maps the name of a node to its last serialized binary archive
+typedef std::map<std::string,NodeSerializationCacheEntry> NodesSerializationCache;
+
 struct ProjectPrivate {
     
     mutable QMutex projectLock; //< protects the whole project
@@ -79,6 +98,8 @@ struct ProjectPrivate {
     
     boost::shared_ptr<Choice_Knob> colorSpace8bits,colorSpace16bits,colorSpace32bits;
     
+    boost::shared_ptr<Bool_Knob> halfFloatStorage; //< store float intermediates as half
+    
     mutable QMutex timelineMutex;
     boost::shared_ptr<TimeLine> timeline; // global timeline
     
@@ -101,6 +122,10 @@ struct ProjectPrivate {
     
     boost::shared_ptr<QTimer> autoSaveTimer;
     
+    mutable QMutex autoSaveCacheMutex; //< protects autoSaveCache & autoSavesSinceFullSerialization
+    NodesSerializationCache autoSaveCache; //< nodes archives re-used by the next auto-save if they didn't change
+    int autoSavesSinceFullSerialization; //< the cache is flushed every few auto-saves so that nothing can stay stale forever
+    
     ProjectPrivate(Natron::Project* project);
     
     void restoreFromSerialization(const ProjectSerialization& obj);
@@ -10,12 +10,70 @@
  */
 
 #include "ProjectSerialization.h"
+
+#include <sstream>
+
+#include "Engine/EffectInstance.h"
+#include "Engine/Knob.h"
+#include "Engine/Node.h"
 #include "Engine/TimeLine.h"
 #include "Engine/Project.h"
 #include "Engine/AppManager.h"
 
 
-void ProjectSerialization::initialize(const Natron::Project* project) {
+static std::string writeNodeBinaryArchive(const boost::shared_ptr<Natron::Node>& node)
+{
+    NodeSerialization state(node);
+    std::ostringstream ss(std::ios::out | std::ios::binary);
+    {
+        boost::archive::binary_oarchive oArchive(ss);
+        oArchive << boost::serialization::make_nvp("item",state);
+    }
+    return ss.str();
+}
+
+///Returns the names of the other nodes written in the archive of the node: its inputs and masters
+static std::string getNodeArchiveDependencies(const boost::shared_ptr<Natron::Node>& node)
+{
+    std::string ret;
+    std::vector<std::string> inputs = node->getInputNames();
+    for (U32 i = 0; i < inputs.size(); ++i) {
+        ret.append(inputs[i]);
+        ret.push_back('\n');
+    }
+    boost::shared_ptr<Natron::Node> masterNode = node->getMasterNode();
+    if (masterNode) {
+        ret.append(masterNode->getName_mt_safe());
+    }
+    ret.push_back('\n');
+    ret.append(node->getParentMultiInstanceName());
+    ret.push_back('\n');
+    const std::vector< boost::shared_ptr<KnobI> >& knobs = node->getKnobs();
+    for (U32 i = 0; i < knobs.size(); ++i) {
+        for (int j = 0; j < knobs[i]->getDimension(); ++j) {
+            std::pair<int,boost::shared_ptr<KnobI> > master = knobs[i]->getMaster(j);
+            if (master.second) {
+                NamedKnobHolder* holder = dynamic_cast<NamedKnobHolder*>(master.second->getHolder());
+                if (holder) {
+                    ret.append(holder->getName_mt_safe());
+                }
+                ret.push_back('.');
+                ret.append(master.second->getName());
+                ret.push_back('\n');
+            }
+        }
+    }
+    return ret;
+}
+
+void ProjectSerialization::readNodeBinaryArchive(const std::string& data,NodeSerialization* node)
+{
+    std::istringstream ss(data,std::ios::in | std::ios::binary);
+    boost::archive::binary_iarchive iArchive(ss);
+    iArchive >> boost::serialization::make_nvp("item",*node);
+}
+
+void ProjectSerialization::initialize(const Natron::Project* project,Natron::NodesSerializationCache* cache) {
     
     ///All the code in this function is MT-safe
     
@@ -29,9 +87,46 @@ void ProjectSerialization::initialize(const Natron::Project* project) {
     }
     
     _serializedNodes.clear();
-    for (U32 i = 0; i < activeNodes.size(); ++i) {
-        NodeSerialization state(activeNodes[i]);
-        _serializedNodes.push_back(state);
+    _serializedNodesArchives.clear();
+    if (_nodesAsBinaryArchives) {
+        Natron::NodesSerializationCache newCache;
+        for (U32 i = 0; i < activeNodes.size(); ++i) {
+            std::string name = activeNodes[i]->getName_mt_safe();
+            U64 hash = activeNodes[i]->getHashValue();
+            U64 knobsChangesCount = activeNodes[i]->getLiveInstance()->getKnobsChangesCount();
+            std::string dependencies;
+            bool upToDate = false;
+            ///Roto items are renamed, locked and edited through knobs that have no holder, and the node is not
+            ///told about any of it: the archive of a node with a roto context is never reused
+            if (cache && !activeNodes[i]->getRotoContext()) {
+                dependencies = getNodeArchiveDependencies(activeNodes[i]);
+                Natron::NodesSerializationCache::const_iterator found = cache->find(name);
+                if (found != cache->end() && found->second.hash == hash &&
+                    found->second.knobsChangesCount == knobsChangesCount && found->second.dependencies == dependencies) {
+                    _serializedNodesArchives.push_back(found->second.data);
+                    upToDate = true;
+                }
+            }
+            if (!upToDate) {
+                _serializedNodesArchives.push_back(writeNodeBinaryArchive(activeNodes[i]));
+            }
+            if (cache && !activeNodes[i]->getRotoContext()) {
+                Natron::NodeSerializationCacheEntry& entry = newCache[name];
+                entry.hash = hash;
+                entry.knobsChangesCount = knobsChangesCount;
+                entry.dependencies = dependencies;
+                entry.data = _serializedNodesArchives.back();
+            }
+        }
+        ///Only keep the nodes that still exist in the cache
+        if (cache) {
+            cache->swap(newCache);
+        }
+    } else {
+        for (U32 i = 0; i < activeNodes.size(); ++i) {
+            NodeSerialization state(activeNodes[i]);
+            _serializedNodes.push_back(state);
+        }
     }
     project->getAdditionalFormats(&_additionalFormats);
     
@@ -18,6 +18,8 @@ CLANG_DIAG_OFF(unused-parameter)
 #include <boost/archive/xml_iarchive.hpp>
 CLANG_DIAG_ON(unused-parameter)
 #include <boost/archive/xml_oarchive.hpp>
+#include <boost/archive/binary_iarchive.hpp>
+#include <boost/archive/binary_oarchive.hpp>
 #include <boost/serialization/list.hpp>
 #include <boost/serialization/map.hpp>
 #include <boost/serialization/shared_ptr.hpp>
@@ -36,6 +38,12 @@ class AppInstance;
 class ProjectSerialization{
     
     std::list< NodeSerialization > _serializedNodes;
+    
+    ///When true, each node is written to its own binary archive which is then stored as a string in
+    ///the project archive, so that the archives of nodes that didn't change can be re-used across auto-saves.
+    bool _nodesAsBinaryArchives;
+    std::list< std::string > _serializedNodesArchives; //< only used to save when _nodesAsBinaryArchives is true
+    
     std::list<Format> _additionalFormats;
     std::list< boost::shared_ptr<KnobSerialization> > _projectKnobs;
     SequenceTime _timelineLeft,_timelineRight,_timelineCurrent;
@@ -44,11 +52,19 @@ class ProjectSerialization{
     AppInstance* _app;
 public:
     
-    ProjectSerialization(AppInstance* app) : _app(app){}
+    ProjectSerialization(AppInstance* app,bool nodesAsBinaryArchives = false)
+    : _nodesAsBinaryArchives(nodesAsBinaryArchives)
+    , _app(app)
+    {}
     
     ~ProjectSerialization(){ _serializedNodes.clear(); }
     
-    void initialize(const Natron::Project* project);
+    /**
+     * @brief Takes a snapshot of the project. If the nodes are serialized as binary archives and cache is not NULL,
+     * the archive of a node whose hash didn't change since it was put in the cache is re-used instead of
+     * serializing the node again. The cache is then updated with the new archives.
+     **/
+    void initialize(const Natron::Project* project,Natron::NodesSerializationCache* cache = NULL);
     
     SequenceTime getCurrentTime() const { return _timelineCurrent; }
     
@@ -71,10 +87,18 @@ public:
     void save(Archive & ar, const unsigned int /*version*/) const
     {
 
-        int nodesCount = (int)_serializedNodes.size();
-        ar & boost::serialization::make_nvp("NodesCount",nodesCount);
-        for (std::list< NodeSerialization >::const_iterator it = _serializedNodes.begin() ; it!= _serializedNodes.end();++it) {
-            ar & boost::serialization::make_nvp("item",*it);
+        if (_nodesAsBinaryArchives) {
+            int nodesCount = (int)_serializedNodesArchives.size();
+            ar & boost::serialization::make_nvp("NodesCount",nodesCount);
+            for (std::list< std::string >::const_iterator it = _serializedNodesArchives.begin() ; it!= _serializedNodesArchives.end();++it) {
+                ar & boost::serialization::make_nvp("item",*it);
+            }
+        } else {
+            int nodesCount = (int)_serializedNodes.size();
+            ar & boost::serialization::make_nvp("NodesCount",nodesCount);
+            for (std::list< NodeSerialization >::const_iterator it = _serializedNodes.begin() ; it!= _serializedNodes.end();++it) {
+                ar & boost::serialization::make_nvp("item",*it);
+            }
         }
         int knobsCount = _projectKnobs.size();
         ar & boost::serialization::make_nvp("ProjectKnobsCount",knobsCount);
@@ -97,9 +121,15 @@ public:
         int nodesCount;
         ar & boost::serialization::make_nvp("NodesCount",nodesCount);
         for (int i = 0; i < nodesCount;++i) {
-            NodeSerialization ns(_app);
-            ar & boost::serialization::make_nvp("item",ns);
-            _serializedNodes.push_back(ns);
+            ///deserialize in place rather than copying every node (and all its knobs) into the list afterwards
+            _serializedNodes.push_back(NodeSerialization(_app));
+            if (_nodesAsBinaryArchives) {
+                std::string data;
+                ar & boost::serialization::make_nvp("item",data);
+                readNodeBinaryArchive(data, &_serializedNodes.back());
+            } else {
+                ar & boost::serialization::make_nvp("item",_serializedNodes.back());
+            }
         }
         
         int knobsCount;
@@ -119,6 +149,10 @@ public:
     }
     
     BOOST_SERIALIZATION_SPLIT_MEMBER()
+    
+private:
+    
+    static void readNodeBinaryArchive(const std::string& data,NodeSerialization* node);
 };
 
 
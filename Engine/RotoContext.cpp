@@ -4385,6 +4385,9 @@ boost::shared_ptr<Natron::Image> RotoContext::renderMask(const RectI& roi,Natron
         case Natron::IMAGE_SHORT:
             convertCairoImageToNatronImage<unsigned short, 65535>(cairoImg, image.get(), pixelRod);
             break;
+        case Natron::IMAGE_HALF:
+            convertCairoImageToNatronImage<Natron::Half, 1>(cairoImg, image.get(), pixelRod);
+            break;
         default:
             assert(false);
             break;
@@ -0,0 +1,397 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "SequenceScanner.h"
+
+#include <cctype>
+#include <map>
+#include <set>
+
+CLANG_DIAG_OFF(deprecated)
+#include <QtCore/QDir>
+#include <QtCore/QDirIterator>
+#include <QtCore/QFileInfo>
+#include <QtCore/QList>
+#include <QtCore/QMutex>
+#include <QtCore/QTime>
+#include <QtConcurrentRun>
+CLANG_DIAG_ON(deprecated)
+
+#include <SequenceParsing.h>
+
+#include "Global/GlobalDefines.h"
+
+///The number of files listed between 2 checks for an abort of the scan
+#define NATRON_SEQUENCE_SCANNER_ABORT_CHECK 64
+
+using namespace Natron;
+
+namespace {
+
+inline bool
+isDigit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+inline bool
+isLetter(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+struct ScannedDirectory
+{
+    QDateTime lastModified;
+    boost::shared_ptr<const SequenceIndex> index;
+    U64 lastUse;
+};
+
+/**
+ * @brief The indexes shared by all the scanners of the process.
+ **/
+struct ScannedDirectories
+{
+    QMutex lock;
+    std::map<QString,ScannedDirectory> directories;
+    U64 useCounter;
+
+    ScannedDirectories()
+    : lock()
+    , directories()
+    , useCounter(0)
+    {
+    }
+
+    ///must be called with the lock held
+    void insert(const QString& directory,const QDateTime& lastModified,const boost::shared_ptr<const SequenceIndex>& index)
+    {
+        ScannedDirectory& entry = directories[directory];
+        entry.lastModified = lastModified;
+        entry.index = index;
+        entry.lastUse = ++useCounter;
+        while (directories.size() > NATRON_SEQUENCE_SCANNER_MAX_DIRECTORIES) {
+            std::map<QString,ScannedDirectory>::iterator oldest = directories.begin();
+            for (std::map<QString,ScannedDirectory>::iterator it = directories.begin(); it != directories.end(); ++it) {
+                if (it->second.lastUse < oldest->second.lastUse) {
+                    oldest = it;
+                }
+            }
+            directories.erase(oldest);
+        }
+    }
+};
+
+ScannedDirectories&
+getScannedDirectories()
+{
+    static ScannedDirectories directories;
+
+    return directories;
+}
+} // anon namespace
+
+SequenceIndex::SequenceIndex(bool estimateSizes)
+: _sequencesByKey()
+, _files()
+, _estimateSizes(estimateSizes)
+, _sequences()
+{
+}
+
+SequenceIndex::~SequenceIndex()
+{
+}
+
+bool
+SequenceIndex::addFile(const std::string& absoluteFileName)
+{
+    FilesMap::const_iterator found = _files.find(absoluteFileName);
+    if (found != _files.end()) {
+        return found->second.representative;
+    }
+
+    SequenceParsing::FileNameContent content(absoluteFileName);
+    std::vector<int>& candidates = _sequencesByKey[getPatternKey(absoluteFileName)];
+    FileEntry entry;
+    for (U32 i = 0; i < candidates.size(); ++i) {
+        if (_sequences[candidates[i]]->tryInsertFile(content)) {
+            entry.sequence = candidates[i];
+            entry.representative = false;
+            _files.insert(std::make_pair(absoluteFileName, entry));
+            return false;
+        }
+    }
+    boost::shared_ptr<SequenceParsing::SequenceFromFiles> sequence(new SequenceParsing::SequenceFromFiles(content,_estimateSizes));
+    entry.sequence = (int)_sequences.size();
+    entry.representative = true;
+    _sequences.push_back(sequence);
+    candidates.push_back(entry.sequence);
+    _files.insert(std::make_pair(absoluteFileName, entry));
+    return true;
+}
+
+boost::shared_ptr<SequenceParsing::SequenceFromFiles>
+SequenceIndex::getSequenceForFile(const std::string& absoluteFileName,
+                                  bool* isRepresentative) const
+{
+    FilesMap::const_iterator found = _files.find(absoluteFileName);
+    if (found == _files.end()) {
+        if (isRepresentative) {
+            *isRepresentative = false;
+        }
+        return boost::shared_ptr<SequenceParsing::SequenceFromFiles>();
+    }
+    if (isRepresentative) {
+        *isRepresentative = found->second.representative;
+    }
+    return _sequences[found->second.sequence];
+}
+
+void
+SequenceIndex::clear()
+{
+    _sequencesByKey.clear();
+    _files.clear();
+    _sequences.clear();
+}
+
+std::string
+SequenceIndex::getPatternKey(const std::string& absoluteFileName)
+{
+    std::size_t nameStart = absoluteFileName.find_last_of("/\\");
+    nameStart = nameStart == std::string::npos ? 0 : nameStart + 1;
+
+    ///the path is kept as is, only files of the same directory can be in the same sequence
+    std::string ret(absoluteFileName, 0, nameStart);
+    ret.reserve(absoluteFileName.size());
+    std::size_t i = nameStart;
+    while (i < absoluteFileName.size()) {
+        char c = absoluteFileName[i];
+        if (isDigit(c)) {
+            while (i < absoluteFileName.size() && isDigit(absoluteFileName[i])) {
+                ++i;
+            }
+            ret.push_back('#');
+        } else if (isLetter(c)) {
+            std::size_t wordEnd = i;
+            std::string word;
+            while (wordEnd < absoluteFileName.size() && isLetter(absoluteFileName[wordEnd])) {
+                word.push_back((char)std::tolower(absoluteFileName[wordEnd]));
+                ++wordEnd;
+            }
+            if (word == "left" || word == "right") {
+                ret.append("%V");
+            } else if (word == "l" || word == "r") {
+                ret.append("%v");
+            } else {
+                ret.append(absoluteFileName, i, wordEnd - i);
+            }
+            i = wordEnd;
+        } else {
+            ret.push_back(c);
+            ++i;
+        }
+    }
+    return ret;
+}
+
+namespace Natron {
+struct SequenceScannerPrivate
+{
+    mutable QMutex generationMutex; //< protects generation and newSequences
+    int generation; //< incremented by every scan and abort, a scan stops when it no longer matches
+    std::list<SequenceScanner::SequenceName> newSequences; //< published by the current scan, @see takeNewSequences
+    QList< QFuture<void> > futures; //< the current scan and the aborted ones which may not have stopped yet
+
+    SequenceScannerPrivate()
+    : generationMutex()
+    , generation(0)
+    , newSequences()
+    , futures()
+    {
+    }
+
+    bool isAborted(int scanGeneration) const
+    {
+        QMutexLocker l(&generationMutex);
+
+        return generation != scanGeneration;
+    }
+};
+}
+
+SequenceScanner::SequenceScanner(QObject* parent)
+: QObject(parent)
+, _imp(new SequenceScannerPrivate)
+{
+    ///create the shared indexes on the main thread
+    (void)getScannedDirectories();
+}
+
+SequenceScanner::~SequenceScanner()
+{
+    abortScan();
+    for (int i = 0; i < _imp->futures.size(); ++i) {
+        _imp->futures[i].waitForFinished();
+    }
+}
+
+void
+SequenceScanner::scanDirectory(const QString& directory)
+{
+    abortScan();
+    ///the aborted scans stop at their next check for an abort, forget those which did
+    for (int i = _imp->futures.size() - 1; i >= 0; --i) {
+        if (_imp->futures[i].isFinished()) {
+            _imp->futures.removeAt(i);
+        }
+    }
+
+    QString path = QDir::cleanPath(directory);
+    QFileInfo info(path);
+    if (!info.isDir()) {
+        return;
+    }
+    QDateTime lastModified = info.lastModified();
+    {
+        ScannedDirectories& scanned = getScannedDirectories();
+        QMutexLocker l(&scanned.lock);
+        std::map<QString,ScannedDirectory>::iterator found = scanned.directories.find(path);
+        if (found != scanned.directories.end() && found->second.lastModified == lastModified) {
+            found->second.lastUse = ++scanned.useCounter;
+            l.unlock();
+            emit scanFinished(path);
+            return;
+        }
+    }
+
+    int generation;
+    {
+        QMutexLocker l(&_imp->generationMutex);
+        generation = ++_imp->generation;
+    }
+    _imp->futures.push_back(QtConcurrent::run(this,&SequenceScanner::scanDirectoryInternal,path,lastModified,generation));
+}
+
+void
+SequenceScanner::abortScan()
+{
+    QMutexLocker l(&_imp->generationMutex);
+
+    ++_imp->generation;
+    _imp->newSequences.clear();
+}
+
+std::list<SequenceScanner::SequenceName>
+SequenceScanner::takeNewSequences()
+{
+    std::list<SequenceName> ret;
+    QMutexLocker l(&_imp->generationMutex);
+
+    ret.swap(_imp->newSequences);
+
+    return ret;
+}
+
+void
+SequenceScanner::scanDirectoryInternal(const QString& directory,
+                                       const QDateTime& lastModified,
+                                       int generation)
+{
+    boost::shared_ptr<SequenceIndex> index(new SequenceIndex);
+    QString prefix = directory;
+    if (!prefix.endsWith('/')) {
+        prefix.append('/');
+    }
+
+    ///the sequences created or extended since the last scanProgress() signal, and the representative of each sequence
+    std::set<SequenceParsing::SequenceFromFiles*> changedSequences;
+    std::map<SequenceParsing::SequenceFromFiles*,QString> representatives;
+
+    QTime timer;
+    timer.start();
+    int filesCount = 0;
+    QDirIterator it(directory, QDir::Files | QDir::NoDotAndDotDot);
+    while (it.hasNext()) {
+        it.next();
+        QString fileName = prefix + it.fileName();
+        std::string file = fileName.toStdString();
+        bool isRepresentative = index->addFile(file);
+        SequenceParsing::SequenceFromFiles* sequence = index->getSequenceForFile(file).get();
+        if (isRepresentative) {
+            representatives[sequence] = fileName;
+        }
+        changedSequences.insert(sequence);
+        ++filesCount;
+        if (filesCount % NATRON_SEQUENCE_SCANNER_ABORT_CHECK == 0) {
+            if (_imp->isAborted(generation)) {
+                return;
+            }
+            if (timer.elapsed() >= NATRON_SEQUENCE_SCANNER_PROGRESS_INTERVAL) {
+                ///the sequences keep changing in this thread: publish their names rather than the sequences
+                std::list<SequenceName> names;
+                for (std::set<SequenceParsing::SequenceFromFiles*>::const_iterator it2 = changedSequences.begin();
+                     it2 != changedSequences.end(); ++it2) {
+                    SequenceName name;
+                    name.representative = representatives[*it2];
+                    name.pattern = (*it2)->generateUserFriendlySequencePattern().c_str();
+                    name.size = (qint64)(*it2)->getEstimatedTotalSize();
+                    names.push_back(name);
+                }
+                changedSequences.clear();
+                {
+                    QMutexLocker l(&_imp->generationMutex);
+                    if (_imp->generation != generation) {
+                        return;
+                    }
+                    _imp->newSequences.splice(_imp->newSequences.end(), names);
+                }
+                emit scanProgress(directory, filesCount);
+                timer.restart();
+            }
+        }
+    }
+    if (_imp->isAborted(generation)) {
+        return;
+    }
+
+    {
+        ScannedDirectories& scanned = getScannedDirectories();
+        QMutexLocker l(&scanned.lock);
+        scanned.insert(directory, lastModified, index);
+    }
+    emit scanFinished(directory);
+}
+
+boost::shared_ptr<const SequenceIndex>
+SequenceScanner::getIndex(const QString& directory) const
+{
+    QString path = QDir::cleanPath(directory);
+    QDateTime lastModified = QFileInfo(path).lastModified();
+    ScannedDirectories& scanned = getScannedDirectories();
+    QMutexLocker l(&scanned.lock);
+    std::map<QString,ScannedDirectory>::iterator found = scanned.directories.find(path);
+    if (found == scanned.directories.end()) {
+        return boost::shared_ptr<const SequenceIndex>();
+    }
+    if (found->second.lastModified != lastModified) {
+        ///the directory changed since it was scanned
+        scanned.directories.erase(found);
+        return boost::shared_ptr<const SequenceIndex>();
+    }
+    found->second.lastUse = ++scanned.useCounter;
+    return found->second.index;
+}
+
+void
+SequenceScanner::clearIndexes()
+{
+    ScannedDirectories& scanned = getScannedDirectories();
+    QMutexLocker l(&scanned.lock);
+
+    scanned.directories.clear();
+}
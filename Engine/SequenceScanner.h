@@ -0,0 +1,177 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef NATRON_ENGINE_SEQUENCESCANNER_H_
+#define NATRON_ENGINE_SEQUENCESCANNER_H_
+
+#include <list>
+#include <string>
+#include <vector>
+
+#include "Global/Macros.h"
+CLANG_DIAG_OFF(deprecated)
+#include <QtCore/QObject>
+#include <QtCore/QString>
+#include <QtCore/QDateTime>
+CLANG_DIAG_ON(deprecated)
+
+#ifndef Q_MOC_RUN
+#include <boost/shared_ptr.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/unordered_map.hpp>
+#endif
+
+///The number of directories whose index is kept by the SequenceScanner
+#define NATRON_SEQUENCE_SCANNER_MAX_DIRECTORIES 32
+
+///The minimum interval in milliseconds between 2 scanProgress() signals of a same scan
+#define NATRON_SEQUENCE_SCANNER_PROGRESS_INTERVAL 200
+
+namespace SequenceParsing {
+class SequenceFromFiles;
+}
+
+namespace Natron {
+
+/**
+ * @brief Groups files into sequences in constant time per file. Files are bucketed by their pattern key
+ * (the path and the file name with its frame numbers replaced, see getPatternKey()): only the few sequences
+ * of the bucket of a file are candidates for SequenceFromFiles::tryInsertFile, instead of all the sequences
+ * of the directory.
+ * The first file inserted in a sequence is its representative: this is the one a view shows for the sequence.
+ * This class is not thread-safe.
+ **/
+class SequenceIndex
+{
+public:
+
+    /**
+     * @brief If estimateSizes is true, the sequences estimate the size on disk of their files, which
+     * requires to read the size of every file.
+     **/
+    explicit SequenceIndex(bool estimateSizes = true);
+
+    ~SequenceIndex();
+
+    /**
+     * @brief Inserts the file in the sequence it belongs to or creates a new sequence for it.
+     * Returns true if the file is the representative of its sequence, i.e it started a new sequence
+     * or it was already inserted as a representative.
+     **/
+    bool addFile(const std::string& absoluteFileName);
+
+    /**
+     * @brief Returns the sequence containing the given file, or NULL if it was never inserted.
+     * If isRepresentative is not NULL, it is set to whether the file is the representative of the sequence.
+     **/
+    boost::shared_ptr<SequenceParsing::SequenceFromFiles> getSequenceForFile(const std::string& absoluteFileName,
+                                                                              bool* isRepresentative = NULL) const WARN_UNUSED_RETURN;
+
+    std::size_t getFilesCount() const WARN_UNUSED_RETURN { return _files.size(); }
+
+    std::size_t getSequencesCount() const WARN_UNUSED_RETURN { return _sequences.size(); }
+
+    void clear();
+
+    /**
+     * @brief Returns the key of the bucket of a file: its path followed by its file name in which every run of digits
+     * is replaced by a single '#' and the view names (left, right, l, r) by a view marker. All the files of a sequence
+     * share the same key whatever their frame number, padding and view.
+     **/
+    static std::string getPatternKey(const std::string& absoluteFileName) WARN_UNUSED_RETURN;
+
+private:
+
+    struct FileEntry
+    {
+        int sequence;
+        bool representative;
+    };
+
+    typedef boost::unordered_map<std::string,std::vector<int> > SequencesByKey;
+    typedef boost::unordered_map<std::string,FileEntry> FilesMap;
+
+    SequencesByKey _sequencesByKey;
+    FilesMap _files;
+    bool _estimateSizes;
+    std::vector< boost::shared_ptr<SequenceParsing::SequenceFromFiles> > _sequences;
+};
+
+struct SequenceScannerPrivate;
+
+/**
+ * @brief Lists the files of directories on a worker thread and groups them into sequences with a SequenceIndex.
+ * The indexes of the last NATRON_SEQUENCE_SCANNER_MAX_DIRECTORIES scanned directories are shared by all the scanners
+ * of the process: scanning a directory whose modification date did not change since its last scan finishes immediately.
+ * Only one directory is scanned at a time by a scanner, scanning another one aborts the current scan.
+ **/
+class SequenceScanner
+    : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    /**
+     * @brief How a view shows a sequence: its representative file, its pattern and the estimated size of its files.
+     **/
+    struct SequenceName
+    {
+        QString representative;
+        QString pattern;
+        qint64 size;
+    };
+
+    explicit SequenceScanner(QObject* parent = 0);
+
+    virtual ~SequenceScanner();
+
+    /**
+     * @brief Starts scanning the given directory. scanFinished() is emitted once its index is complete, which
+     * happens before this function returns if the directory was already indexed. Hidden files are not indexed.
+     * This never waits for the scan it aborts, which stops at its next check for an abort.
+     **/
+    void scanDirectory(const QString& directory);
+
+    /**
+     * @brief Returns the sequences the current scan created or extended since the previous call, as they were
+     * when the last scanProgress() signal was emitted.
+     **/
+    std::list<SequenceName> takeNewSequences() WARN_UNUSED_RETURN;
+
+    /**
+     * @brief Aborts the current scan, if any. The signals it already emitted may still be delivered.
+     **/
+    void abortScan();
+
+    /**
+     * @brief Returns the complete index of the given directory, or NULL if it was not entirely scanned
+     * or if it changed since. The index is never modified once returned.
+     **/
+    boost::shared_ptr<const SequenceIndex> getIndex(const QString& directory) const WARN_UNUSED_RETURN;
+
+    /**
+     * @brief Forgets all the indexes shared by the scanners.
+     **/
+    static void clearIndexes();
+
+signals:
+
+    ///Emitted periodically while a directory is scanned, with the number of files listed so far
+    void scanProgress(QString directory,int filesCount);
+
+    void scanFinished(QString directory);
+
+private:
+
+    void scanDirectoryInternal(const QString& directory,const QDateTime& lastModified,int generation);
+
+    boost::scoped_ptr<SequenceScannerPrivate> _imp;
+};
+
+} // namespace Natron
+
+#endif // NATRON_ENGINE_SEQUENCESCANNER_H_
@@ -23,6 +23,7 @@
 #include "Engine/KnobTypes.h"
 #include "Engine/KnobFile.h"
 #include "Engine/KnobFactory.h"
+#include "Engine/MemoryPool.h"
 #include "Engine/Project.h"
 #include "Engine/Node.h"
 #include "Engine/ViewerInstance.h"
@@ -83,6 +84,14 @@ void Settings::initializeKnobs(){
                                    " wait until it is done to actually auto-save.");
     _generalTab->addKnob(_autoSaveDelay);
     
+    _binaryProjectFormat = Natron::createKnob<Bool_Knob>(this, "Save projects in binary format");
+    _binaryProjectFormat->setAnimationEnabled(false);
+    _binaryProjectFormat->setHintToolTip("When checked, projects are saved in a compact binary format which is much faster "
+                                         "to save and load than XML for projects with a lot of animation. "
+                                         "Binary projects can only be opened on the same kind of platform "
+                                         "they were saved on. Auto-saves always use the binary format.");
+    _generalTab->addKnob(_binaryProjectFormat);
+    
     
     _linearPickers = Natron::createKnob<Bool_Knob>(this, "Linear color pickers");
     _linearPickers->setAnimationEnabled(false);
@@ -102,6 +111,14 @@ void Settings::initializeKnobs(){
     _numberOfThreads->setDisplayMinimum(-1);
     _generalTab->addKnob(_numberOfThreads);
     
+    _numaAwareRendering = Natron::createKnob<Bool_Knob>(this, "NUMA-aware rendering");
+    _numaAwareRendering->setAnimationEnabled(false);
+    _numaAwareRendering->setHintToolTip("When checked, on machines with several memory nodes (e.g multi-socket workstations), "
+                                        "render threads are pinned to the cores of a node and the images they render are "
+                                        "placed in the memory of that node. This has no effect on machines with a single "
+                                        "memory node. Any change will take effect on the next launch of " NATRON_APPLICATION_NAME ".");
+    _generalTab->addKnob(_numaAwareRendering);
+    
     _renderInSeparateProcess = Natron::createKnob<Bool_Knob>(this, "Render in a separate process");
     _renderInSeparateProcess->setAnimationEnabled(false);
     _renderInSeparateProcess->setHintToolTip("If true, " NATRON_APPLICATION_NAME " will render (using the write nodes) in "
@@ -458,6 +475,22 @@ void Settings::initializeKnobs(){
     _maxDiskCacheGB->setHintToolTip("The maximum disk space the caches can use. (in GB)");
     _cachingTab->addKnob(_maxDiskCacheGB);
     
+    _useHugePages = Natron::createKnob<Bool_Knob>(this, "Use huge pages for images");
+    _useHugePages->setAnimationEnabled(false);
+    _useHugePages->setHintToolTip("When checked, the memory of the images in RAM is backed by huge pages when the system "
+                                  "supports it (transparent huge pages on Linux). This reduces the cost of page "
+                                  "faults when working on large images, at the expense of a coarser memory usage. "
+                                  "It has no effect on the disk cache.");
+    _cachingTab->addKnob(_useHugePages);
+    
+    _compressPlaybackCache = Natron::createKnob<Bool_Knob>(this, "Compress the playback cache in RAM");
+    _compressPlaybackCache->setAnimationEnabled(false);
+    _compressPlaybackCache->setHintToolTip("When checked, half of the playback cache RAM keeps losslessly compressed "
+                                           "copies of the frames that were moved to the disk cache. Reading them back "
+                                           "is much faster than reading the disk, and usually fits 2 to 3 times more "
+                                           "frames in the same amount of memory.");
+    _cachingTab->addKnob(_compressPlaybackCache);
+    
  
 
     
@@ -491,12 +524,14 @@ void Settings::setDefaultValues() {
     _hostName->setDefaultValue(NATRON_ORGANIZATION_DOMAIN_TOPLEVEL "." NATRON_ORGANIZATION_DOMAIN_SUB "." NATRON_APPLICATION_NAME);
     _checkForUpdates->setDefaultValue(false);
     _autoSaveDelay->setDefaultValue(5, 0);
+    _binaryProjectFormat->setDefaultValue(false,0);
     _maxUndoRedoNodeGraph->setDefaultValue(20, 0);
     _linearPickers->setDefaultValue(true,0);
     _snapNodesToConnections->setDefaultValue(true);
     _useBWIcons->setDefaultValue(false);
     _useNodeGraphHints->setDefaultValue(true);
     _numberOfThreads->setDefaultValue(0,0);
+    _numaAwareRendering->setDefaultValue(false,0);
     _renderInSeparateProcess->setDefaultValue(true,0);
     _autoPreviewEnabledForNewProjects->setDefaultValue(true,0);
     _maxPanelsOpened->setDefaultValue(10,0);
@@ -509,6 +544,8 @@ void Settings::setDefaultValues() {
     _maxRAMPercent->setDefaultValue(50,0);
     _maxPlayBackPercent->setDefaultValue(25,0);
     _maxDiskCacheGB->setDefaultValue(10,0);
+    _useHugePages->setDefaultValue(false,0);
+    _compressPlaybackCache->setDefaultValue(false,0);
     setCachingLabels();
     _defaultNodeColor->setDefaultValue(0.6,0);
     _defaultNodeColor->setDefaultValue(0.6,1);
@@ -604,8 +641,10 @@ void Settings::saveSettings(){
     settings.beginGroup("General");
     settings.setValue("CheckUpdates", _checkForUpdates->getValue());
     settings.setValue("AutoSaveDelay", _autoSaveDelay->getValue());
+    settings.setValue("BinaryProjectFormat", _binaryProjectFormat->getValue());
     settings.setValue("LinearColorPickers",_linearPickers->getValue());
     settings.setValue("Number of threads", _numberOfThreads->getValue());
+    settings.setValue("NUMAAwareRendering", _numaAwareRendering->getValue());
     settings.setValue("RenderInSeparateProcess", _renderInSeparateProcess->getValue());
     settings.setValue("AutoPreviewDefault", _autoPreviewEnabledForNewProjects->getValue());
     settings.setValue("MaxPanelsOpened", _maxPanelsOpened->getValue());
@@ -628,6 +667,8 @@ void Settings::saveSettings(){
     settings.setValue("MaximumRAMUsagePercentage", _maxRAMPercent->getValue());
     settings.setValue("MaximumPlaybackRAMUsage", _maxPlayBackPercent->getValue());
     settings.setValue("MaximumDiskSizeUsage", _maxDiskCacheGB->getValue());
+    settings.setValue("UseHugePages", _useHugePages->getValue());
+    settings.setValue("CompressPlaybackCache", _compressPlaybackCache->getValue());
     settings.endGroup();
     
     settings.beginGroup("Viewers");
@@ -733,12 +774,18 @@ void Settings::restoreSettings(){
     if (settings.contains("AutoSaveDelay")) {
         _autoSaveDelay->setValue(settings.value("AutoSaveDelay").toInt(),0);
     }
+    if (settings.contains("BinaryProjectFormat")) {
+        _binaryProjectFormat->setValue(settings.value("BinaryProjectFormat").toBool(),0);
+    }
     if(settings.contains("LinearColorPickers")){
         _linearPickers->setValue(settings.value("LinearColorPickers").toBool(),0);
     }
     if (settings.contains("Number of threads")) {
         _numberOfThreads->setValue(settings.value("Number of threads").toInt(),0);
     }
+    if (settings.contains("NUMAAwareRendering")) {
+        _numaAwareRendering->setValue(settings.value("NUMAAwareRendering").toBool(),0);
+    }
     if (settings.contains("RenderInSeparateProcess")) {
         _renderInSeparateProcess->setValue(settings.value("RenderInSeparateProcess").toBool(),0);
     }
@@ -792,6 +839,12 @@ void Settings::restoreSettings(){
     if(settings.contains("MaximumDiskSizeUsage")){
         _maxDiskCacheGB->setValue(settings.value("MaximumDiskSizeUsage").toInt(),0);
     }
+    if (settings.contains("UseHugePages")) {
+        _useHugePages->setValue(settings.value("UseHugePages").toBool(),0);
+    }
+    if (settings.contains("CompressPlaybackCache")) {
+        _compressPlaybackCache->setValue(settings.value("CompressPlaybackCache").toBool(),0);
+    }
     settings.endGroup();
     
     settings.beginGroup("Viewers");
@@ -1092,9 +1145,11 @@ void Settings::onKnobValueChanged(KnobI* k,Natron::ValueChangedReason /*reason*/
     } else if(k == _maxRAMPercent.get()) {
         appPTR->setApplicationsCachesMaximumMemoryPercent(getRamMaximumPercent());
         setCachingLabels();
-    } else if(k == _maxPlayBackPercent.get()) {
+    } else if(k == _maxPlayBackPercent.get() || k == _compressPlaybackCache.get()) {
         appPTR->setPlaybackCacheMaximumSize(getRamPlaybackMaximumPercent());
         setCachingLabels();
+    } else if(k == _useHugePages.get()) {
+        Natron::MemoryPool::instance()->setHugePagesEnabled(areHugePagesEnabled());
     } else if(k == _numberOfThreads.get()) {
         int nbThreads = getNumberOfThreads();
         if (nbThreads == -1) {
@@ -1153,6 +1208,18 @@ void Settings::setNumberOfThreads(int threadsNb) {
     _numberOfThreads->setValue(threadsNb,0);
 }
 
+bool Settings::areHugePagesEnabled() const {
+    return _useHugePages->getValue();
+}
+
+bool Settings::isPlaybackCacheCompressionEnabled() const {
+    return _compressPlaybackCache->getValue();
+}
+
+bool Settings::isNUMAAwareRenderingEnabled() const {
+    return _numaAwareRendering->getValue();
+}
+
 bool Settings::isAutoPreviewOnForNewProjects() const {
     return _autoPreviewEnabledForNewProjects->getValue();
 }
@@ -1274,6 +1341,11 @@ int Settings::getAutoSaveDelayMS() const
     return _autoSaveDelay->getValue() * 1000;
 }
 
+bool Settings::isBinaryProjectFormatEnabled() const
+{
+    return _binaryProjectFormat->getValue();
+}
+
 bool Settings::isSnapToNodeEnabled() const
 {
     return _snapNodesToConnections->getValue();
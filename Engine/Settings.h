@@ -61,12 +61,18 @@ public:
     
     U64 getMaximumDiskCacheSize() const;
     
+    bool areHugePagesEnabled() const;
+    
+    bool isPlaybackCacheCompressionEnabled() const;
+    
     bool getColorPickerLinear() const;
     
     int getNumberOfThreads() const;
     
     void setNumberOfThreads(int threadsNb);
     
+    bool isNUMAAwareRenderingEnabled() const;
+    
     const std::string& getReaderPluginIDForFileType(const std::string& extension);
     
     const std::string& getWriterPluginIDForFileType(const std::string& extension);
@@ -101,6 +107,8 @@ public:
     
     int getAutoSaveDelayMS() const;
     
+    bool isBinaryProjectFormatEnabled() const;
+    
     bool isSnapToNodeEnabled() const;
     
     bool isCheckForUpdatesEnabled() const;
@@ -160,8 +168,10 @@ private:
     boost::shared_ptr<Page_Knob> _generalTab;
     boost::shared_ptr<Bool_Knob> _checkForUpdates;
     boost::shared_ptr<Int_Knob> _autoSaveDelay;
+    boost::shared_ptr<Bool_Knob> _binaryProjectFormat;
     boost::shared_ptr<Bool_Knob> _linearPickers;
     boost::shared_ptr<Int_Knob> _numberOfThreads;
+    boost::shared_ptr<Bool_Knob> _numaAwareRendering;
     boost::shared_ptr<Bool_Knob> _renderInSeparateProcess;
     boost::shared_ptr<Bool_Knob> _autoPreviewEnabledForNewProjects;
     boost::shared_ptr<Int_Knob> _maxPanelsOpened;
@@ -182,6 +192,8 @@ private:
     boost::shared_ptr<String_Knob> _maxRAMLabel;
     
     boost::shared_ptr<Int_Knob> _maxDiskCacheGB;
+    boost::shared_ptr<Bool_Knob> _useHugePages;
+    boost::shared_ptr<Bool_Knob> _compressPlaybackCache;
     
     boost::shared_ptr<Page_Knob> _viewersTab;
     boost::shared_ptr<Choice_Knob> _texturesMode;
@@ -19,6 +19,7 @@ _firstFrame(0)
 , _leftBoundary(_firstFrame)
 , _rightBoundary(_lastFrame)
 , _keyframes()
+, _playbackForward(true)
 , _project(project)
 {}
 
@@ -52,6 +53,16 @@ void TimeLine::incrementCurrentFrame(Natron::OutputEffectInstance* caller) { see
 
 void TimeLine::decrementCurrentFrame(Natron::OutputEffectInstance* caller) { seekFrame(_currentFrame-1,caller); }
 
+void TimeLine::setPlaybackForward(bool forward) {
+    QMutexLocker l(&_lock);
+    _playbackForward = forward;
+}
+
+bool TimeLine::isPlaybackForward() const {
+    QMutexLocker l(&_lock);
+    return _playbackForward;
+}
+
 void TimeLine::onFrameChanged(SequenceTime frame){
     _currentFrame = frame;
     /*This function is called in response to a signal emitted by a single timeline gui, but we also
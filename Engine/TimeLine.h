@@ -59,6 +59,14 @@ public:
 
     void decrementCurrentFrame(Natron::OutputEffectInstance* caller) ;
     
+    /**
+     * @brief Set by the video engine of a viewer when it starts playing, so that the readers know in which order
+     * the next frames will be requested. Thread-safe.
+     **/
+    void setPlaybackForward(bool forward);
+    
+    bool isPlaybackForward() const WARN_UNUSED_RETURN;
+    
     void removeAllKeyframesIndicators();
     
     void addKeyframeIndicator(SequenceTime time);
@@ -118,6 +126,7 @@ private:
     SequenceTime _currentFrame;
     SequenceTime _leftBoundary,_rightBoundary; //these boundaries are within the interval [firstFrame,lastFrame]
     std::list<SequenceTime> _keyframes;
+    bool _playbackForward; //< the direction of the last playback started by a viewer
     mutable QMutex _lock;
     Natron::Project* _project;
 };
@@ -248,6 +248,9 @@ bool VideoEngine::startEngine(bool singleThreaded) {
 
     
     if(!_currentRunArgs._sameFrame){
+        if (_tree.isOutputAViewer()) {
+            _timeline->setPlaybackForward(_currentRunArgs._forward);
+        }
         emit engineStarted(_currentRunArgs._forward,_currentRunArgs._frameRequestsCount);
         _timer->playState = RUNNING; /*activating the timer*/
 
@@ -321,6 +324,11 @@ bool VideoEngine::stopEngine() {
     Natron::OutputEffectInstance* outputEffect = dynamic_cast<Natron::OutputEffectInstance*>(_tree.getOutput());
     outputEffect->setDoingFullSequenceRender(false);
     
+    ///the render is not over until the frames handed off by the writer are on disk
+    if (!_tree.isOutputAViewer()) {
+        outputEffect->waitForPendingWrites();
+    }
+    
     if (!_tree.isOutputAViewer() && _currentRunArgs._forceSequential) {
         (void)_tree.endSequentialRender(_firstFrame, _lastFrame, _tree.getOutput()->getApp()->getMainView());
     }
@@ -11,8 +11,11 @@
 
 #include "ViewerInstancePrivate.h"
 
+#include <algorithm>
+
 #include <boost/shared_ptr.hpp>
 #include <boost/bind.hpp>
+#include <boost/type_traits/is_integral.hpp>
 
 CLANG_DIAG_OFF(deprecated)
 #include <QtCore/QtGlobal>
@@ -49,18 +52,11 @@ using namespace Natron;
 using std::make_pair;
 using boost::shared_ptr;
 
+///How many mipmap levels coarser than the final render the draft shown after a parameter change is
+#define NATRON_VIEWER_DRAFT_MIPMAP_LEVEL_OFFSET 2
 
 
 
-static void
-scaleToTexture8bits(std::pair<int,int> yRange,
-                    const RenderViewerArgs& args,
-                    U32* output);
-
-static void
-scaleToTexture32bits(std::pair<int,int> yRange,
-                     const RenderViewerArgs& args,
-                     float *output);
 
 static std::pair<double, double>
 findAutoContrastVminVmax(boost::shared_ptr<const Natron::Image> inputImage,
@@ -110,6 +106,90 @@ lutFromColorspace(Natron::ViewerColorSpace cs)
     return lut;
 }
 
+/**
+ * @brief Fills dst, a texture at a coarser mipmap level, with the average of the blocks of pixels
+ * of src, a texture of the same image at a finer level. Both textures have 4 components per pixel.
+ * src must cover all the blocks of dst: see downscaleFinerTexture()
+ **/
+template <typename PIX>
+static void
+downscaleTexture(const TextureRect& srcRect,
+                 const PIX* src,
+                 const TextureRect& dstRect,
+                 PIX* dst,
+                 int factor)
+{
+    for (int y = dstRect.y1; y < dstRect.y2; ++y) {
+        PIX* dst_pixels = dst + (y - dstRect.y1) * dstRect.w * 4;
+        int srcY1 = y * factor;
+        int srcY2 = std::min(srcY1 + factor, srcRect.y2);
+        for (int x = dstRect.x1; x < dstRect.x2; ++x) {
+            int srcX1 = x * factor;
+            int srcX2 = std::min(srcX1 + factor, srcRect.x2);
+            double sum[4] = {0., 0., 0., 0.};
+            for (int sy = srcY1; sy < srcY2; ++sy) {
+                const PIX* src_pixels = src + ((sy - srcRect.y1) * srcRect.w + (srcX1 - srcRect.x1)) * 4;
+                for (int sx = srcX1; sx < srcX2; ++sx, src_pixels += 4) {
+                    for (int c = 0; c < 4; ++c) {
+                        sum[c] += src_pixels[c];
+                    }
+                }
+            }
+            int count = (srcY2 - srcY1) * (srcX2 - srcX1);
+            assert(count > 0);
+            for (int c = 0; c < 4; ++c) {
+                dst_pixels[c] = (PIX)(sum[c] / count + (boost::is_integral<PIX>::value ? 0.5 : 0.));
+            }
+            dst_pixels += 4;
+        }
+    }
+}
+
+/**
+ * @brief When zooming out, the texture requested by key differs from the texture previously displayed only by its
+ * mipmap level. In that case a draft of the new texture is made into buffer by downscaling the previous one, to be
+ * displayed while the texture is rendered. The draft is never cached: it filters display-encoded values and
+ * differs from the render.
+ * Returns false if the finer texture cannot be downscaled to the texture requested by key.
+ **/
+static bool
+downscaleFinerTexture(const FrameKey& key,
+                      const boost::shared_ptr<Natron::FrameEntry>& finerTexture,
+                      unsigned char* buffer)
+{
+    const FrameKey& finerKey = finerTexture->getKey();
+    if (finerKey.getTime() != key.getTime() ||
+        finerKey.getTreeVersion() != key.getTreeVersion() ||
+        finerKey.getGain() != key.getGain() ||
+        finerKey.getLut() != key.getLut() ||
+        finerKey.getBitDepth() != key.getBitDepth() ||
+        finerKey.getChannels() != key.getChannels() ||
+        finerKey.getView() != key.getView() ||
+        finerKey.getInputName() != key.getInputName()) {
+        return false;
+    }
+    const TextureRect& srcRect = finerKey.getTexRect();
+    const TextureRect& dstRect = key.getTexRect();
+    if (srcRect.closestPo2 >= dstRect.closestPo2) {
+        return false;
+    }
+    int factor = dstRect.closestPo2 / srcRect.closestPo2;
+    
+    ///every block of the finer texture must at least have its bottom-left pixel in the finer texture
+    if (dstRect.x1 * factor < srcRect.x1 || dstRect.y1 * factor < srcRect.y1 ||
+        (dstRect.x2 - 1) * factor >= srcRect.x2 || (dstRect.y2 - 1) * factor >= srcRect.y2) {
+        return false;
+    }
+    
+    if (key.getBitDepth() == OpenGLViewerI::FLOAT || key.getBitDepth() == OpenGLViewerI::HALF_FLOAT) {
+        downscaleTexture<float>(srcRect, (const float*)finerTexture->data(), dstRect, (float*)buffer, factor);
+    } else {
+        ///8 bits textures are packed BGRA, each byte is a channel
+        downscaleTexture<unsigned char>(srcRect, finerTexture->data(), dstRect, buffer, factor);
+    }
+    return true;
+}
+
 namespace {
 class MetaTypesRegistration
 {
@@ -316,12 +396,20 @@ ViewerInstance::renderViewer(SequenceTime time,
     if (!_imp->uiContext) {
         return StatReplyDefault;
     }
+    int texturesCount = _imp->uiContext->getCompositingOperator() == Natron::OPERATOR_NONE ? 1 : 2;
+    
+    ///When the tree changed (e.g: a parameter was tweaked) and the texture is not cached, first display a draft at a
+    ///coarser mipmap level which is much faster to render, then refine it. This is never done during playback where
+    ///each frame is rendered once.
+    ///Note that the refinement is a single full-frame pass uploaded at once when done: it is not split in tiles
+    ///rendered from the centre outward, and it can only be aborted as a whole, by the VideoEngine.
+    U64 treeHash = hash();
+    bool renderDraft = !isSequentialRender && treeHash != _imp->lastTreeHashRendered;
+    _imp->lastTreeHashRendered = treeHash;
+    
     Natron::Status ret[2] = { StatOK,StatOK };
-    for (int i = 0; i < 2; ++i) {
-        if (i == 1 && _imp->uiContext->getCompositingOperator() == Natron::OPERATOR_NONE) {
-            break;
-        }
-        ret[i] = renderViewer_internal(time, singleThreaded, isSequentialRender, i);
+    for (int i = 0; i < texturesCount; ++i) {
+        ret[i] = renderViewer_internal(time, singleThreaded, isSequentialRender, i, false, renderDraft);
         if (ret[i] == StatFailed) {
             emit disconnectTextureRequest(i);
         }
@@ -337,7 +425,7 @@ ViewerInstance::renderViewer(SequenceTime time,
 
 Natron::Status
 ViewerInstance::renderViewer_internal(SequenceTime time,bool singleThreaded,bool isSequentialRender,
-                                     int textureIndex)
+                                     int textureIndex,bool draft,bool draftIfNotCached)
 {
     // always running in the VideoEngine thread
     _imp->assertVideoEngine();
@@ -399,15 +487,18 @@ ViewerInstance::renderViewer_internal(SequenceTime time,bool singleThreaded,bool
     {
         QMutexLocker forceRenderLocker(&_imp->forceRenderMutex);
         forceRender = _imp->forceRender;
-        _imp->forceRender = false;
+        ///the draft doesn't consume the request, the real render must by-pass the cache too
+        if (!draft) {
+            _imp->forceRender = false;
+        }
     }
     
     ///instead of calling getRegionOfDefinition on the active input, check the image cache
     ///to see whether the result of getRegionOfDefinition is already present. A cache lookup
     ///might be much cheaper than a call to getRegionOfDefinition.
     ///
-    ///Note that we can't yet use the texture cache because we would need the TextureRect identifyin
-    ///the texture in order to retrieve from the cache, but to make the TextureRect we need the RoD!
+    ///Otherwise getRegionOfDefinition_public answers from the actions cache of the input as long as its hash
+    ///didn't change, so that finding the texture in the cache doesn't call into any plug-in.
     boost::shared_ptr<const ImageParams> cachedImgParams;
     boost::shared_ptr<Image> inputImage;
     
@@ -424,6 +515,9 @@ ViewerInstance::renderViewer_internal(SequenceTime time,bool singleThreaded,bool
     double zoomFactor = _imp->uiContext->getZoomFactor();
     double closestPowerOf2 = zoomFactor >= 1 ? 1 : std::pow(2,-std::ceil(std::log(zoomFactor) / M_LN2));
     mipMapLevel = std::max((double)mipMapLevel,std::log(closestPowerOf2) / M_LN2);
+    if (draft) {
+        mipMapLevel += NATRON_VIEWER_DRAFT_MIPMAP_LEVEL_OFFSET;
+    }
   
     
     scale.x = Natron::Image::getScaleFromMipMapLevel(mipMapLevel);
@@ -436,13 +530,25 @@ ViewerInstance::renderViewer_internal(SequenceTime time,bool singleThreaded,bool
     
     emit imageFormatChanged(textureIndex,components, imageDepth);
     
+    ///A plug-in that doesn't support the render scale renders at full size anyway: the draft would be slower than the real render
+    if (draft && !activeInputToRender->supportsRenderScale()) {
+        return StatOK;
+    }
+    
     U64 inputNodeHash = activeInputToRender->hash();
+    
+    ///If the image of the input is an identity of an image upstream at the same time, render the latter directly
+    boost::shared_ptr<Natron::Node> aliasedNode;
+    SequenceTime aliasedTime;
+    if (!forceRender && appPTR->resolveIdentityAlias(inputNodeHash, time, mipMapLevel, view, &aliasedNode, &aliasedTime) &&
+        aliasedTime == time) {
+        activeInputToRender = aliasedNode->getLiveInstance();
+        inputNodeHash = activeInputToRender->hash();
+    }
         
     Natron::ImageKey inputImageKey = Natron::Image::makeKey(inputNodeHash, time, mipMapLevel,view);
     RectI rod,pixelRoD;
     bool isRodProjectFormat = false;
-    int inputIdentityNumber = -1;
-    SequenceTime inputIdentityTime = time;
     
     
     bool isInputImgCached = Natron::getImageFromCache(inputImageKey, &cachedImgParams,&inputImage);
@@ -451,12 +557,18 @@ ViewerInstance::renderViewer_internal(SequenceTime time,bool singleThreaded,bool
     ////When it goes out of scope the lock will be released automatically
     boost::shared_ptr<OutputImageLocker> imageLock;
     
+    if (isInputImgCached && cachedImgParams->getInputNbIdentity() != -1) {
+        ///an empty identity image restored from the disk cache of a previous version, identities are now aliases
+        appPTR->removeFromNodeCache(inputImage);
+        isInputImgCached = false;
+        cachedImgParams.reset();
+        inputImage.reset();
+    }
+    
     if (isInputImgCached) {
         assert(inputImage);
         imageLock.reset(new OutputImageLocker(getNode().get(),inputImage));
         
-        inputIdentityNumber = cachedImgParams->getInputNbIdentity();
-        inputIdentityTime = cachedImgParams->getInputTimeIdentity();
         if (forceRender) {
             ///If we want to by-pass the cache, we will just zero-out the bitmap of the image, so
             ///we're sure renderRoIInternal will compute the whole image again.
@@ -491,29 +603,11 @@ ViewerInstance::renderViewer_internal(SequenceTime time,bool singleThreaded,bool
     }
     
     
-    ////While the inputs are identity get the RoD of the first non identity input
-    while (inputIdentityNumber != -1 && isInputImgCached) {
-        EffectInstance* recursiveInput = activeInputToRender->input_other_thread(inputIdentityNumber);
-        if (recursiveInput) {
-            inputImageKey = Natron::Image::makeKey(recursiveInput->hash(), inputIdentityTime, mipMapLevel,view);
-            isInputImgCached = Natron::getImageFromCache(inputImageKey, &cachedImgParams,&inputImage);
-            if (isInputImgCached) {
-                inputIdentityNumber = cachedImgParams->getInputNbIdentity();
-                inputIdentityTime = cachedImgParams->getInputTimeIdentity();
-            }
-            activeInputToRender = recursiveInput;
-        } else {
-            isInputImgCached = false;
-        }
-    }
-    
     if (isInputImgCached) {
         
         ////If the image was cached with a RoD dependent on the project format, but the project format changed,
         ////just discard this entry.
-        //// We do this ONLY if the effect is not an identity, because otherwise the isRoDProjectFormat is meaningless
-        //// because we fetched an image upstream anyway.
-        if (inputIdentityNumber == -1 && cachedImgParams->isRodProjectFormat()) {
+        if (cachedImgParams->isRodProjectFormat()) {
             if (dynamic_cast<RectI&>(dispW) != cachedImgParams->getRoD()) {
                 isInputImgCached = false;
                 appPTR->removeFromNodeCache(inputImage);
@@ -671,8 +765,9 @@ ViewerInstance::renderViewer_internal(SequenceTime time,bool singleThreaded,bool
     if (!forceRender) {
         ///we never use the texture cache when the user RoI is enabled, otherwise we would have
         ///zillions of textures in the cache, each a few pixels different.
+        ///The drafts are never cached either: they are displayed once, until the real texture is rendered.
         assert(_imp->uiContext);
-        if (!_imp->uiContext->isUserRegionOfInterestEnabled() && !autoContrast) {
+        if (!draft && !_imp->uiContext->isUserRegionOfInterestEnabled() && !autoContrast) {
             boost::shared_ptr<const Natron::FrameParams> cachedFrameParams;
             isCached = Natron::getTextureFromCache(key, &cachedFrameParams, &params->cachedFrame);
             assert(!isCached || cachedFrameParams);
@@ -696,6 +791,24 @@ ViewerInstance::renderViewer_internal(SequenceTime time,bool singleThreaded,bool
                 }
             }
 
+            ///The viewer was zoomed-out: until the texture is rendered, display the texture of the finer level downscaled
+            if (!isCached && lastRenderedTex && lastRenderHash == nodeHash) {
+                unsigned char* draftBuffer = _imp->getRAMBuffer(bytesCount);
+                if (downscaleFinerTexture(key, lastRenderedTex, draftBuffer)) {
+                    boost::shared_ptr<UpdateViewerParams> draftParams(new UpdateViewerParams);
+                    draftParams->ramBuffer = draftBuffer;
+                    draftParams->textureRect = textureRect;
+                    draftParams->bytesCount = bytesCount;
+                    draftParams->gain = gain;
+                    draftParams->offset = offset;
+                    draftParams->lut = lut;
+                    draftParams->mipMapLevel = (unsigned int)mipMapLevel;
+                    draftParams->textureIndex = textureIndex;
+                    _imp->uploadRAMBuffer(draftParams, singleThreaded);
+                    _imp->redrawViewer();
+                }
+            }
+
             
         }
     } else {
@@ -729,25 +842,24 @@ ViewerInstance::renderViewer_internal(SequenceTime time,bool singleThreaded,bool
     } else { // !isCached
         /*We didn't find it in the viewer cache, hence we render
          the frame*/
+        
+        if (draftIfNotCached) {
+            if (renderViewer_internal(time, singleThreaded, isSequentialRender, textureIndex, true, false) != StatFailed) {
+                _imp->redrawViewer();
+            }
+            if (aborted()) {
+                ///the parameters changed again, a new render was requested
+                return StatOK;
+            }
+        }
+        
         ///If the user RoI is enabled, the odds that we find a texture containing exactly the same portion
         ///is very low, we better render again (and let the NodeCache do the work) rather than just
         ///overload the ViewerCache which may become slowe
         assert(_imp->uiContext);
-        if (byPassCache || _imp->uiContext->isUserRegionOfInterestEnabled() || autoContrast) {
+        if (draft || byPassCache || _imp->uiContext->isUserRegionOfInterestEnabled() || autoContrast) {
             assert(!params->cachedFrame);
-            // don't reallocate if we need less memory (avoid fragmentation)
-            if (_imp->bufferAllocated < bytesCount) {
-                if (_imp->bufferAllocated > 0) {
-                    free(_imp->buffer);
-                }
-                _imp->bufferAllocated = bytesCount;
-                _imp->buffer = (unsigned char*)malloc(_imp->bufferAllocated);
-                if (!_imp->buffer) {
-                    _imp->bufferAllocated = 0;
-                    throw std::bad_alloc();
-                }
-            }
-            ramBuffer = (unsigned char*)_imp->buffer;
+            ramBuffer = _imp->getRAMBuffer(bytesCount);
             usingRAMBuffer = true;
 
         } else {
@@ -1181,19 +1293,19 @@ void scaleToTexture8bits_internal(const std::pair<int,int>& yRange,
                     int a;
                     switch (comps) {
                         case Natron::ImageComponentRGBA:
-                            r = (src_pixels ? src_pixels[srcIndex * nComps + rOffset] : 0.);
-                            g = (src_pixels ? src_pixels[srcIndex * nComps + gOffset] : 0.);
-                            b = (src_pixels ? src_pixels[srcIndex * nComps + bOffset] : 0.) ;
+                            r = (src_pixels ? (double)src_pixels[srcIndex * nComps + rOffset] : 0.);
+                            g = (src_pixels ? (double)src_pixels[srcIndex * nComps + gOffset] : 0.);
+                            b = (src_pixels ? (double)src_pixels[srcIndex * nComps + bOffset] : 0.) ;
                             a = (src_pixels ? Color::floatToInt<256>(src_pixels[srcIndex * nComps + 3]) : 0);
                             break;
                         case Natron::ImageComponentRGB:
-                            r = (src_pixels ? src_pixels[srcIndex * nComps + rOffset] : 0.);
-                            g = (src_pixels ? src_pixels[srcIndex * nComps + gOffset] : 0.);
-                            b = (src_pixels ? src_pixels[srcIndex * nComps + bOffset] : 0.);
+                            r = (src_pixels ? (double)src_pixels[srcIndex * nComps + rOffset] : 0.);
+                            g = (src_pixels ? (double)src_pixels[srcIndex * nComps + gOffset] : 0.);
+                            b = (src_pixels ? (double)src_pixels[srcIndex * nComps + bOffset] : 0.);
                             a = (src_pixels ? 255 : 0);
                             break;
                         case Natron::ImageComponentAlpha:
-                            r = src_pixels ? src_pixels[srcIndex] : 0.;
+                            r = src_pixels ? (double)src_pixels[srcIndex] : 0.;
                             g = b = r;
                             a = src_pixels ? 255 : 0;
                             break;
@@ -1225,6 +1337,7 @@ void scaleToTexture8bits_internal(const std::pair<int,int>& yRange,
                             }
                             break;
                         case Natron::IMAGE_FLOAT:
+                        case Natron::IMAGE_HALF:
                             if (args.srcColorSpace) {
                                 r = args.srcColorSpace->fromColorSpaceFloatToLinearFloat(r);
                                 g = args.srcColorSpace->fromColorSpaceFloatToLinearFloat(g);
@@ -1328,6 +1441,9 @@ scaleToTexture8bits(std::pair<int,int> yRange,
         case Natron::IMAGE_SHORT:
             scaleToTexture8bits_internal<unsigned short, 65535>(yRange, args, output, rOffset, gOffset, bOffset, nComps);
             break;
+        case Natron::IMAGE_HALF:
+            scaleToTexture8bits_internal<Natron::Half, 1>(yRange, args, output, rOffset, gOffset, bOffset, nComps);
+            break;
             
         default:
             break;
@@ -1354,7 +1470,7 @@ void scaleToTexture32bitsInternal(const std::pair<int,int>& yRange,
     int dstY = 0;
     for (int y = yRange.first; y < yRange.second; y += args.closestPowerOf2) {
         
-        const float* src_pixels = (const float*)args.inputImage->pixelAt(args.texRect.x1, y);
+        const PIX* src_pixels = (const PIX*)args.inputImage->pixelAt(args.texRect.x1, y);
         float* dst_pixels = output + dstY * dst_width;
         
         ///we fill the scan-line with all the pixels of the input image
@@ -1367,7 +1483,7 @@ void scaleToTexture32bitsInternal(const std::pair<int,int>& yRange,
                     r = (double)(src_pixels[rOffset]);
                     g = (double)src_pixels[gOffset] ;
                     b = (double)src_pixels[bOffset] ;
-                    a = (nComps < 4) ? 1. : src_pixels[3];
+                    a = (nComps < 4) ? 1. : (double)src_pixels[3];
                     break;
                 case Natron::ImageComponentRGB:
                     r = (double)(src_pixels[rOffset]) ;
@@ -1376,7 +1492,7 @@ void scaleToTexture32bitsInternal(const std::pair<int,int>& yRange,
                     a = 1.;
                     break;
                 case Natron::ImageComponentAlpha:
-                    a = (nComps < 4) ? 1. : *src_pixels;
+                    a = (nComps < 4) ? 1. : (double)*src_pixels;
                     r = g = b = a;
                     a = 1.;
                     break;
@@ -1409,6 +1525,7 @@ void scaleToTexture32bitsInternal(const std::pair<int,int>& yRange,
                     }
                     break;
                 case Natron::IMAGE_FLOAT:
+                case Natron::IMAGE_HALF:
                     if (args.srcColorSpace) {
                         r = args.srcColorSpace->fromColorSpaceFloatToLinearFloat(r);
                         g = args.srcColorSpace->fromColorSpaceFloatToLinearFloat(g);
@@ -1491,6 +1608,9 @@ scaleToTexture32bits(std::pair<int,int> yRange,
         case Natron::IMAGE_SHORT:
             scaleToTexture32bitsInternal<unsigned short, 65535>(yRange, args, output, rOffset, gOffset, bOffset,nComps);
             break;
+        case Natron::IMAGE_HALF:
+            scaleToTexture32bitsInternal<Natron::Half, 1>(yRange, args, output, rOffset, gOffset, bOffset,nComps);
+            break;
         default:
             break;
     }
@@ -1519,6 +1639,49 @@ ViewerInstance::ViewerInstancePrivate::updateViewerVideoEngine(const boost::shar
     emit doUpdateViewer(params);
 }
 
+unsigned char*
+ViewerInstance::ViewerInstancePrivate::getRAMBuffer(size_t bytesCount)
+{
+    // don't reallocate if we need less memory (avoid fragmentation)
+    if (bufferAllocated < bytesCount) {
+        if (bufferAllocated > 0) {
+            free(buffer);
+        }
+        bufferAllocated = bytesCount;
+        buffer = (unsigned char*)malloc(bufferAllocated);
+        if (!buffer) {
+            bufferAllocated = 0;
+            throw std::bad_alloc();
+        }
+    }
+    return (unsigned char*)buffer;
+}
+
+void
+ViewerInstance::ViewerInstancePrivate::uploadRAMBuffer(const boost::shared_ptr<UpdateViewerParams>& params,bool singleThreaded)
+{
+    // always running in the VideoEngine thread
+    assertVideoEngine();
+
+    QMutexLocker locker(&updateViewerMutex);
+    // wait until previous updateViewer (if any) finishes
+    while (updateViewerRunning) {
+        updateViewerCond.wait(&updateViewerMutex);
+    }
+    updateViewerRunning = true;
+    if (singleThreaded) {
+        locker.unlock();
+        updateViewer(params);
+        locker.relock();
+    } else {
+        updateViewerVideoEngine(params);
+    }
+    ///the buffer is written again by the next render
+    while (updateViewerRunning) {
+        updateViewerCond.wait(&updateViewerMutex);
+    }
+}
+
 void
 ViewerInstance::ViewerInstancePrivate::updateViewer(boost::shared_ptr<UpdateViewerParams> params)
 {
@@ -1824,6 +1987,17 @@ ViewerInstance::getColorAt(int x,int y,float* r,float* g,float* b,float* a,bool
                                                    srcColorSpace,
                                                    dstColorSpace, r, g, b, a);
         }   break;
+        case IMAGE_HALF: {
+            ViewerColorSpace halfCS = getApp()->getDefaultColorSpaceForBitDepth(IMAGE_HALF);
+            const Natron::Color::Lut* srcColorSpace = lutFromColorspace(halfCS);
+            if (srcColorSpace == dstColorSpace) {
+                srcColorSpace = 0;
+                dstColorSpace = 0;
+            }
+            queried = getColorAtInternal<Natron::Half, 1>(img.get(), xPixel, yPixel,forceLinear,
+                                                          srcColorSpace,
+                                                          dstColorSpace, r, g, b, a);
+        }   break;
             
         default:
             break;
@@ -215,8 +215,15 @@ private:
     /*******************************************/
 
     
+    /**
+     * @brief Renders the texture textureIndex. If draft is true, the texture is rendered at a coarser
+     * mipmap level than the one required by the zoom factor so it can be displayed quickly before the real render,
+     * it is not inserted in the viewer cache. If draftIfNotCached is true and the texture is not in the viewer cache,
+     * a draft is displayed before it is rendered.
+     * Either way the whole texture is rendered before it is uploaded.
+     **/
     Natron::Status renderViewer_internal(SequenceTime time,bool singleThreaded,bool isSequentialRender,
-                                         int textureIndex) WARN_UNUSED_RETURN;
+                                         int textureIndex,bool draft,bool draftIfNotCached) WARN_UNUSED_RETURN;
     
 
 private:
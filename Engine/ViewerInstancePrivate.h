@@ -62,6 +62,19 @@ struct RenderViewerArgs {
     const Natron::Color::Lut* colorSpace;
 };
 
+/**
+ * @brief Converts the rows in yRange of args.inputImage to the 8-bit BGRA texture
+ * format (or to linear 32-bit float for scaleToTexture32bits) into output.
+ * These are called by the viewer render threads, they are declared here so they can be benchmarked.
+ **/
+void scaleToTexture8bits(std::pair<int,int> yRange,
+                         const RenderViewerArgs& args,
+                         U32* output);
+
+void scaleToTexture32bits(std::pair<int,int> yRange,
+                          const RenderViewerArgs& args,
+                          float *output);
+
 /// parameters send from the VideoEngine thread to updateViewer() (which runs in the main thread)
 struct UpdateViewerParams
 {
@@ -116,6 +129,7 @@ public:
     , lastRenderedTextureMutex()
     , lastRenderHash(0)
     , lastRenderedTexture()
+    , lastTreeHashRendered(0)
     {
         connect(this,SIGNAL(doUpdateViewer(boost::shared_ptr<UpdateViewerParams>)),this,
                 SLOT(updateViewer(boost::shared_ptr<UpdateViewerParams>)));
@@ -144,6 +158,12 @@ public:
     
     void redrawViewer() { emit mustRedrawViewer(); }
     
+    /// returns the private buffer, grown to at least bytesCount bytes. Throws std::bad_alloc upon failure.
+    unsigned char* getRAMBuffer(size_t bytesCount);
+    
+    /// uploads a texture held by the private buffer and waits until it is done, so that the buffer can be written again
+    void uploadRAMBuffer(const boost::shared_ptr<UpdateViewerParams>& params,bool singleThreaded);
+    
     public slots:
     /**
      * @brief Slot called internally by the renderViewer() function when it wants to refresh the OpenGL viewer.
@@ -206,6 +226,10 @@ public:
     U64 lastRenderHash;
     boost::shared_ptr<Natron::FrameEntry> lastRenderedTexture;
     
+    ///The hash of the viewer at the last call of renderViewer(), a draft is rendered first when it changes.
+    ///Only accessed by the VideoEngine thread.
+    U64 lastTreeHashRendered;
+    
 };
 //} // namespace Natron
 
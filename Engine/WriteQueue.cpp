@@ -0,0 +1,276 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "WriteQueue.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <list>
+#include <stdexcept>
+#include <vector>
+
+CLANG_DIAG_OFF(deprecated)
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QMutex>
+#include <QtCore/QThread>
+#include <QtCore/QWaitCondition>
+CLANG_DIAG_ON(deprecated)
+
+using namespace Natron;
+
+namespace {
+
+class WriteQueueWorker
+    : public QThread
+{
+public:
+
+    explicit WriteQueueWorker(WriteQueuePrivate* queue)
+    : QThread()
+    , _queue(queue)
+    {
+    }
+
+    virtual ~WriteQueueWorker()
+    {
+    }
+
+private:
+
+    virtual void run() OVERRIDE FINAL;
+
+    WriteQueuePrivate* _queue;
+};
+} // anon namespace
+
+namespace Natron {
+struct WriteQueuePrivate
+{
+    int maxPendingFrames;
+    mutable QMutex lock; //< protects all the members below
+    QWaitCondition frameAppended; //< the workers wait on it for a frame
+    QWaitCondition frameWritten; //< the render thread waits on it for a free slot or for the pending writes
+    std::list<WriteQueue::WriteJob> jobs; //< the frames not picked by a worker yet
+    int writingCount; //< the frames being written by the workers
+    bool mustQuit;
+    WriteQueueStats stats;
+    bool active; //< true from the first frame appended to the next waitForPendingWrites()
+    QElapsedTimer activeTimer; //< started when active became true
+    std::vector<WriteQueueWorker*> workers;
+
+    WriteQueuePrivate(int maxPendingFrames_)
+    : maxPendingFrames(maxPendingFrames_)
+    , lock()
+    , frameAppended()
+    , frameWritten()
+    , jobs()
+    , writingCount(0)
+    , mustQuit(false)
+    , stats()
+    , active(false)
+    , activeTimer()
+    , workers()
+    {
+        resetStats();
+    }
+
+    ///must be called with the lock held
+    void resetStats()
+    {
+        int workersCount = stats.workersCount;
+        stats = WriteQueueStats();
+        stats.workersCount = workersCount;
+        if (active) {
+            activeTimer.restart();
+        }
+    }
+
+    ///must be called with the lock held
+    bool isFull() const
+    {
+        return (int)jobs.size() + writingCount >= maxPendingFrames;
+    }
+
+    ///called by the workers, returns false when they must quit
+    bool takeJob(WriteQueue::WriteJob* job)
+    {
+        QMutexLocker l(&lock);
+        QElapsedTimer idle;
+        idle.start();
+        while (jobs.empty() && !mustQuit) {
+            frameAppended.wait(&lock);
+        }
+        if (jobs.empty()) {
+            return false;
+        }
+        ///only the idle time during which frames were handed off is meaningful
+        stats.workersIdleMs += (U64)std::min(idle.elapsed(), activeTimer.elapsed());
+        *job = jobs.front();
+        jobs.pop_front();
+        ++writingCount;
+        return true;
+    }
+
+    void onJobDone(bool success,const std::string& error)
+    {
+        QMutexLocker l(&lock);
+        --writingCount;
+        if (success) {
+            ++stats.framesWritten;
+        } else {
+            ++stats.failedWrites;
+            if (!error.empty()) {
+                stats.lastError = error;
+            }
+        }
+        frameWritten.wakeAll();
+    }
+};
+}
+
+void
+WriteQueueWorker::run()
+{
+    WriteQueue::WriteJob job;
+    while (_queue->takeJob(&job)) {
+        bool success;
+        std::string error;
+        try {
+            success = job();
+        } catch (const std::exception& e) {
+            error = e.what();
+            success = false;
+        }
+        ///release what the job holds (e.g the image) before the render thread is woken up
+        job.clear();
+        _queue->onJobDone(success,error);
+    }
+}
+
+WriteQueue::WriteQueue(int maxPendingFrames,int workersCount)
+: _imp(new WriteQueuePrivate(std::max(maxPendingFrames, 1)))
+{
+    if (workersCount <= 0) {
+        workersCount = std::min(QThread::idealThreadCount(), _imp->maxPendingFrames);
+    }
+    workersCount = std::max(workersCount, 1);
+    _imp->stats.workersCount = workersCount;
+    for (int i = 0; i < workersCount; ++i) {
+        WriteQueueWorker* worker = new WriteQueueWorker(_imp.get());
+        _imp->workers.push_back(worker);
+        worker->start();
+    }
+}
+
+WriteQueue::~WriteQueue()
+{
+    waitForPendingWrites();
+    {
+        QMutexLocker l(&_imp->lock);
+        _imp->mustQuit = true;
+        _imp->frameAppended.wakeAll();
+    }
+    for (U32 i = 0; i < _imp->workers.size(); ++i) {
+        _imp->workers[i]->wait();
+        delete _imp->workers[i];
+    }
+}
+
+void
+WriteQueue::append(const WriteJob& job)
+{
+    QMutexLocker l(&_imp->lock);
+    if (!_imp->active) {
+        _imp->active = true;
+        _imp->activeTimer.start();
+    }
+    if (_imp->isFull()) {
+        QElapsedTimer wait;
+        wait.start();
+        while (_imp->isFull()) {
+            _imp->frameWritten.wait(&_imp->lock);
+        }
+        _imp->stats.renderWaitMs += (U64)wait.elapsed();
+    }
+    _imp->jobs.push_back(job);
+    _imp->frameAppended.wakeOne();
+}
+
+void
+WriteQueue::waitForPendingWrites()
+{
+    QMutexLocker l(&_imp->lock);
+    while (!_imp->jobs.empty() || _imp->writingCount > 0) {
+        _imp->frameWritten.wait(&_imp->lock);
+    }
+    if (_imp->active) {
+        _imp->stats.elapsedMs += (U64)_imp->activeTimer.elapsed();
+        _imp->active = false;
+    }
+}
+
+WriteQueueStats
+WriteQueue::getStats() const
+{
+    QMutexLocker l(&_imp->lock);
+    WriteQueueStats ret = _imp->stats;
+    if (_imp->active) {
+        ret.elapsedMs += (U64)_imp->activeTimer.elapsed();
+    }
+    return ret;
+}
+
+void
+WriteQueue::resetStats()
+{
+    QMutexLocker l(&_imp->lock);
+
+    _imp->resetStats();
+}
+
+double
+WriteQueue::getBackPressure() const
+{
+    WriteQueueStats stats = getStats();
+    if (stats.elapsedMs == 0) {
+        return 0.;
+    }
+    return std::min(1., (double)stats.renderWaitMs / (double)stats.elapsedMs);
+}
+
+bool
+WriteQueue::isWriteBound() const
+{
+    WriteQueueStats stats = getStats();
+
+    return stats.renderWaitMs * (U64)stats.workersCount > stats.workersIdleMs;
+}
+
+std::string
+WriteQueue::getTemporaryFileName(const std::string& filename)
+{
+    std::size_t nameStart = filename.find_last_of("/\\");
+    nameStart = nameStart == std::string::npos ? 0 : nameStart + 1;
+    std::string ret(filename);
+    ret.insert(nameStart, ".");
+    ret.append(".tmp");
+    return ret;
+}
+
+bool
+WriteQueue::commitTemporaryFile(const std::string& temporaryFileName,
+                                const std::string& filename)
+{
+#ifdef __NATRON_WIN32__
+    ///rename() does not replace an existing file on Windows, the replacement is not atomic there
+    std::remove(filename.c_str());
+#endif
+    if (std::rename(temporaryFileName.c_str(), filename.c_str()) != 0) {
+        std::remove(temporaryFileName.c_str());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,110 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef NATRON_ENGINE_WRITEQUEUE_H_
+#define NATRON_ENGINE_WRITEQUEUE_H_
+
+#include <string>
+
+#include "Global/Macros.h"
+#include "Global/GlobalDefines.h"
+
+#ifndef Q_MOC_RUN
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_ptr.hpp>
+#endif
+
+///The number of frames a writer may hand off before its render thread waits for one of them to be written
+#define NATRON_WRITE_QUEUE_MAX_PENDING_FRAMES 4
+
+namespace Natron {
+
+struct WriteQueueStats
+{
+    U64 framesWritten; //< number of frames whose write succeeded
+    U64 failedWrites; //< number of frames whose write failed
+    std::string lastError; //< the reason of the last failed write, empty if unknown
+    U64 renderWaitMs; //< time the render thread spent waiting for a free slot in the queue
+    U64 workersIdleMs; //< time the workers spent waiting for a frame, summed over all the workers
+    U64 elapsedMs; //< time during which frames were handed off, from the first frame to waitForPendingWrites()
+    int workersCount;
+};
+
+struct WriteQueuePrivate;
+
+/**
+ * @brief The output stage of writers: the render thread appends the writing of a frame (its conversion, encoding
+ * and I/O) and moves on to the next frame while a pool of workers writes it. The queue is bounded: when
+ * NATRON_WRITE_QUEUE_MAX_PENDING_FRAMES frames are pending, append() blocks until one of them is written, which
+ * keeps the memory held by the pending frames bounded.
+ * The time the render thread spends blocked and the time the workers spend idle tell whether the render is
+ * write-bound or render-bound, see getBackPressure().
+ * Frames may be written in a different order than they were appended.
+ *
+ * Thread safety: this class is thread-safe.
+ **/
+class WriteQueue
+    : boost::noncopyable
+{
+public:
+
+    ///Writes a frame, returns false upon failure
+    typedef boost::function<bool ()> WriteJob;
+
+    /**
+     * @brief If workersCount is not positive, the number of workers is the ideal thread count of the machine,
+     * at most maxPendingFrames.
+     **/
+    explicit WriteQueue(int maxPendingFrames = NATRON_WRITE_QUEUE_MAX_PENDING_FRAMES,int workersCount = 0);
+
+    ///Waits for the pending writes
+    ~WriteQueue();
+
+    /**
+     * @brief Hands off the writing of a frame to the workers. Blocks while the queue is full.
+     **/
+    void append(const WriteJob& job);
+
+    /**
+     * @brief Blocks until every frame appended so far is written.
+     **/
+    void waitForPendingWrites();
+
+    WriteQueueStats getStats() const WARN_UNUSED_RETURN;
+
+    void resetStats();
+
+    /**
+     * @brief Returns the fraction (between 0 and 1) of the time the render thread spent waiting for the workers.
+     **/
+    double getBackPressure() const WARN_UNUSED_RETURN;
+
+    /**
+     * @brief Returns true if the render thread waited for the workers longer than the workers waited for it:
+     * writing is the bottleneck of the render.
+     **/
+    bool isWriteBound() const WARN_UNUSED_RETURN;
+
+    /**
+     * @brief Returns a hidden file next to filename where a frame can be written before commitTemporaryFile()
+     * moves it to filename, so that readers never see partially written files.
+     **/
+    static std::string getTemporaryFileName(const std::string& filename) WARN_UNUSED_RETURN;
+
+    /**
+     * @brief Renames the temporary file to filename, replacing it. The temporary file is removed upon failure.
+     **/
+    static bool commitTemporaryFile(const std::string& temporaryFileName,const std::string& filename) WARN_UNUSED_RETURN;
+
+private:
+
+    boost::scoped_ptr<WriteQueuePrivate> _imp;
+};
+
+} // namespace Natron
+
+#endif // NATRON_ENGINE_WRITEQUEUE_H_
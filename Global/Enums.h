@@ -279,7 +279,8 @@ namespace Natron{
     {
         IMAGE_BYTE = 0,
         IMAGE_SHORT,
-        IMAGE_FLOAT
+        IMAGE_FLOAT,
+        IMAGE_HALF
     };
     
     enum SequentialPreference {
@@ -100,6 +100,7 @@
 #define NATRON_PREVIEW_WIDTH 64
 #define NATRON_PREVIEW_HEIGHT 48
 #define NATRON_WHEEL_ZOOM_PER_DELTA 1.00152 // 120 wheel deltas (one click on a standard wheel mouse) is x1.2
+#define NATRON_NODEGRAPH_LOD_ZOOM_THRESHOLD 0.4 // below this zoom factor the node graph draws simplified nodes and edges
 //#define NATRON_FONT "Helvetica"
 //#define NATRON_FONT_ALT "Times"
 #define NATRON_FONT "Droid Sans"
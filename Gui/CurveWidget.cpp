@@ -259,26 +259,35 @@ void CurveGui::drawCurve(int curveIndex,int curvesCount)
     double w = _curveWidget->width();
     KeyFrameSet keyframes = _internalCurve->getKeyFrames_mt_safe();
     std::pair<KeyFrame,bool> isX1AKey;
+    
+    ///Vertices lying on a keyframe take the keyframe's value, the others are collected (in increasing order)
+    ///and evaluated at once with Curve::getValuesAt.
+    std::vector<double> evaluatedX;
+    std::vector<int> evaluatedVertices;
     while(x1 < (w -1)){
-        double x,y;
         if(!isX1AKey.second){
-            x = _curveWidget->toZoomCoordinates(x1,0).x();
-            y = evaluate(x);
+            evaluatedVertices.push_back((int)vertices.size());
+            evaluatedX.push_back(_curveWidget->toZoomCoordinates(x1,0).x());
+            vertices.push_back(0.f);
+            vertices.push_back(0.f);
         }else{
-            x = isX1AKey.first.getTime();
-            y = isX1AKey.first.getValue();
+            vertices.push_back((float)isX1AKey.first.getTime());
+            vertices.push_back((float)isX1AKey.first.getValue());
         }
-        vertices.push_back((float)x);
-        vertices.push_back((float)y);
         isX1AKey = nextPointForSegment(x1,&x2,keyframes);
         x1 = x2;
     }
     //also add the last point
-    {
-        double x = _curveWidget->toZoomCoordinates(x1,0).x();
-        double y = evaluate(x);
-        vertices.push_back((float)x);
-        vertices.push_back((float)y);
+    evaluatedVertices.push_back((int)vertices.size());
+    evaluatedX.push_back(_curveWidget->toZoomCoordinates(x1,0).x());
+    vertices.push_back(0.f);
+    vertices.push_back(0.f);
+    
+    std::vector<double> evaluatedY;
+    _internalCurve->getValuesAt(evaluatedX, &evaluatedY);
+    for (U32 i = 0; i < evaluatedVertices.size(); ++i) {
+        vertices[evaluatedVertices[i]] = (float)evaluatedX[i];
+        vertices[evaluatedVertices[i] + 1] = (float)evaluatedY[i];
     }
     
     const QColor& curveColor = _selected ?  _curveWidget->getSelectedCurveColor() : _color;
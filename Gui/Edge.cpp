@@ -13,6 +13,7 @@
 #include <cmath>
 #include <QPainter>
 #include <QGraphicsScene>
+#include <QStyleOptionGraphicsItem>
 
 #include "Gui/NodeGui.h"
 #include "Engine/Node.h"
@@ -320,6 +321,7 @@ void Edge::initLine()
     QPointF arrowP2 = line().p1() + QPointF(std::sin(a + M_PI - M_PI / 3) * arrowSize,
                                             std::cos(a + M_PI - M_PI / 3) * arrowSize);
 
+    prepareGeometryChange();
     arrowHead.clear();
     arrowHead << dst << arrowP1 << arrowP2;
 }
@@ -333,6 +335,12 @@ QPainterPath Edge::shape() const
 
      return path;
  }
+
+QRectF Edge::boundingRect() const
+{
+    ///the margin accounts for the bend point drawn around the middle of the edge
+    return QGraphicsLineItem::boundingRect().united(arrowHead.boundingRect()).adjusted(-6, -6, 6, 6);
+}
 static double dist2(const QPointF& p1,const QPointF& p2){
     return  pow(p2.x() - p1.x(),2) +  pow(p2.y() - p1.y(),2);
 }
@@ -371,6 +379,7 @@ void Edge::dragSource(const QPointF& src)
                                             std::cos(a + M_PI / 3) * arrowSize);
     QPointF arrowP2 = line().p1() + QPointF(std::sin(a + M_PI - M_PI / 3) * arrowSize,
                                             std::cos(a + M_PI - M_PI / 3) * arrowSize);
+    prepareGeometryChange();
     arrowHead.clear();
 	arrowHead << line().p1() << arrowP1 << arrowP2;
 
@@ -393,6 +402,7 @@ void Edge::dragDest(const QPointF& dst)
                                             std::cos(a + M_PI / 3) * arrowSize);
     QPointF arrowP2 = line().p1() + QPointF(std::sin(a + M_PI - M_PI / 3) * arrowSize,
                                             std::cos(a + M_PI - M_PI / 3) * arrowSize);
+    prepareGeometryChange();
     arrowHead.clear();
 	arrowHead << line().p1() << arrowP1 << arrowP2;
     
@@ -418,10 +428,29 @@ bool Edge::isNearbyBendPoint(const QPointF& scenePoint)
     return false;
 }
 
-void Edge::paint(QPainter *painter, const QStyleOptionGraphicsItem * /*options*/,
+void Edge::paint(QPainter *painter, const QStyleOptionGraphicsItem *options,
            QWidget * /*parent*/)
  {
 
+     QColor color;
+     if (_useHighlight) {
+         color = Qt::green;
+     } else if (_useRenderingColor) {
+         color = _renderingColor;
+     } else {
+         color = _defaultColor;
+     }
+
+     ///When zoomed-out, the arrow head, the dashes and the bend point are not distinguishable:
+     ///just draw a 1 pixel wide line which is much cheaper to rasterize
+     if (options->levelOfDetailFromTransform(painter->worldTransform()) < NATRON_NODEGRAPH_LOD_ZOOM_THRESHOLD) {
+         QPen simplePen(color);
+         simplePen.setCosmetic(true);
+         painter->setPen(simplePen);
+         painter->drawLine(line());
+         return;
+     }
+
      QPen myPen = pen();
      
      if (_paintWithDash) {
@@ -433,14 +462,6 @@ void Edge::paint(QPainter *painter, const QStyleOptionGraphicsItem * /*options*/
          myPen.setStyle(Qt::SolidLine);
      }
      
-     QColor color;
-     if (_useHighlight) {
-         color = Qt::green;
-     } else if (_useRenderingColor) {
-         color = _renderingColor;
-     } else {
-         color = _defaultColor;
-     }
      myPen.setColor(color);
      painter->setPen(myPen);
      QLineF l = line();
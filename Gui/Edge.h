@@ -46,6 +46,9 @@ public:
     virtual ~Edge() OVERRIDE;
     
     QPainterPath shape() const;
+
+    ///Includes the arrow head and the bend point, which are drawn outside of the line
+    virtual QRectF boundingRect() const OVERRIDE FINAL;
     
     bool contains(const QPointF &point) const;
     
@@ -1957,6 +1957,16 @@ void Gui::saveProjectGui(boost::archive::xml_oarchive& archive) {
     _imp->_projectGui->save(archive);
 }
 
+void Gui::loadProjectGui(boost::archive::binary_iarchive& obj) const {
+    assert(_imp->_projectGui);
+    _imp->_projectGui->load(obj);
+}
+
+void Gui::saveProjectGui(boost::archive::binary_oarchive& archive) {
+    assert(_imp->_projectGui);
+    _imp->_projectGui->save(archive);
+}
+
 void Gui::errorDialog(const std::string& title,const std::string& text){
     ///don't show dialogs when about to close, otherwise we could enter in a deadlock situation
     {
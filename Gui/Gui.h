@@ -33,6 +33,8 @@ namespace boost {
     namespace archive {
         class xml_iarchive;
         class xml_oarchive;
+        class binary_iarchive;
+        class binary_oarchive;
     }
 }
 
@@ -215,6 +217,10 @@ public:
     
     void saveProjectGui(boost::archive::xml_oarchive& archive);
     
+    void loadProjectGui(boost::archive::binary_iarchive& obj) const;
+    
+    void saveProjectGui(boost::archive::binary_oarchive& archive);
+    
     void setColorPickersColor(const QColor& c);
     
     void registerNewColorPicker(boost::shared_ptr<Color_Knob> knob);
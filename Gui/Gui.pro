@@ -72,6 +72,7 @@ SOURCES += \
     NodeGui.cpp \
     NodeGuiSerialization.cpp \
     PreferencesPanel.cpp \
+    PreviewScheduler.cpp \
     ProjectGui.cpp \
     ProjectGuiSerialization.cpp \
     QtDecoder.cpp \
@@ -133,6 +134,7 @@ HEADERS += \
     NodeGui.h \
     NodeGuiSerialization.h \
     PreferencesPanel.h \
+    PreviewScheduler.h \
     ProjectGui.h \
     ProjectGuiSerialization.h \
     QtDecoder.h \
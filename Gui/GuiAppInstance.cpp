@@ -347,6 +347,14 @@ void GuiAppInstance::saveProjectGui(boost::archive::xml_oarchive& archive) {
     _imp->_gui->saveProjectGui(archive);
 }
 
+void GuiAppInstance::loadProjectGui(boost::archive::binary_iarchive& archive) const {
+    _imp->_gui->loadProjectGui(archive);
+}
+
+void GuiAppInstance::saveProjectGui(boost::archive::binary_oarchive& archive) {
+    _imp->_gui->saveProjectGui(archive);
+}
+
 void GuiAppInstance::setupViewersForViews(int viewsCount) {
     _imp->_gui->updateViewersViewsMenu(viewsCount);
 }
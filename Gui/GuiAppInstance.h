@@ -68,6 +68,10 @@ public:
     
     virtual void saveProjectGui(boost::archive::xml_oarchive& archive) OVERRIDE FINAL;
     
+    virtual void loadProjectGui(boost::archive::binary_iarchive& archive) const OVERRIDE FINAL;
+    
+    virtual void saveProjectGui(boost::archive::binary_oarchive& archive) OVERRIDE FINAL;
+    
     virtual void notifyRenderProcessHandlerStarted(const QString& sequenceName,
                                                    int firstFrame,int lastFrame,
                                                    const boost::shared_ptr<ProcessHandler>& process) OVERRIDE FINAL;
@@ -11,6 +11,7 @@
 #include "NodeGraph.h"
 
 #include <cstdlib>
+#include <algorithm>
 #include <set>
 #include <map>
 #include <vector>
@@ -80,6 +81,7 @@ CLANG_DIAG_ON(uninitialized)
 #include "Gui/NodeBackDropSerialization.h"
 #include "Gui/NodeGraphUndoRedo.h"
 #include "Gui/NodeCreationDialog.h"
+#include "Gui/PreviewScheduler.h"
 
 #define NATRON_CACHE_SIZE_TEXT_REFRESH_INTERVAL_MS 1000
 
@@ -88,6 +90,9 @@ CLANG_DIAG_ON(uninitialized)
 
 #define NATRON_NODE_DUPLICATE_X_OFFSET 50
 
+///The largest dimension of the image drawn for the navigator, it is then shrunk to the navigator size
+#define NATRON_NODEGRAPH_NAVIGATOR_IMAGE_SIZE 512.
+
 using namespace Natron;
 using std::cout; using std::endl;
 
@@ -237,6 +242,10 @@ struct NodeGraphPrivate
     
     bool _bendPointsVisible;
 
+    ///false when the zoom is below NATRON_NODEGRAPH_LOD_ZOOM_THRESHOLD: nodes are drawn without their details
+    bool _detailsVisible;
+
+    boost::scoped_ptr<PreviewScheduler> _previewScheduler;
     
     NodeGraphPrivate(Gui* gui,NodeGraph* p)
     : _publicInterface(p)
@@ -281,6 +290,8 @@ struct NodeGraphPrivate
     , _selection()
     , _selectionRect(NULL)
     , _bendPointsVisible(false)
+    , _detailsVisible(true)
+    , _previewScheduler(new PreviewScheduler(gui->getApp()))
     {
         
     }
@@ -288,6 +299,9 @@ struct NodeGraphPrivate
     void resetAllClipboards();
     
     QRectF calcNodesBoundingRect();
+
+    ///Shows or hides the details of all the nodes if the zoom crossed NATRON_NODEGRAPH_LOD_ZOOM_THRESHOLD
+    void refreshLevelOfDetail();
     
     void copyNodesInternal(NodeClipBoard& clipboard);
     void pasteNodesInternal(const NodeClipBoard& clipboard);
@@ -335,7 +349,9 @@ NodeGraph::NodeGraph(Gui* gui,QGraphicsScene* scene,QWidget *parent)
     
     setMouseTracking(true);
     setCacheMode(CacheBackground);
-    setViewportUpdateMode(QGraphicsView::FullViewportUpdate);
+    ///Only repaint the parts of the viewport covered by the items that changed: with thousands of nodes
+    ///redrawing everything when a single node is highlighted makes the graph unusable.
+    setViewportUpdateMode(QGraphicsView::BoundingRectViewportUpdate);
     setRenderHint(QPainter::Antialiasing);
     setTransformationAnchor(QGraphicsView::AnchorViewCenter);
     scale(qreal(0.8), qreal(0.8));
@@ -458,6 +474,7 @@ NodeGraph::~NodeGraph() {
 
     onProjectNodesCleared();
 
+    _imp->_previewScheduler->quitThread();
 }
 
 void NodeGraph::setPropertyBinPtr(QScrollArea* propertyBin) { _imp->_propertyBin = propertyBin; }
@@ -468,6 +485,8 @@ QGraphicsItem* NodeGraph::getRootItem() const { return _imp->_root; }
 
 Gui* NodeGraph::getGui() const { return _imp->_gui; }
 
+PreviewScheduler* NodeGraph::getPreviewScheduler() const { return _imp->_previewScheduler.get(); }
+
 void NodeGraph::discardGuiPointer() { _imp->_gui = 0; }
 
 void NodeGraph::onProjectNodesCleared() {
@@ -546,6 +565,7 @@ boost::shared_ptr<NodeGui> NodeGraph::createNodeGUI(QVBoxLayout *dockContainer,c
         node_ui.reset(new DotGui(_imp->_nodeRoot));
     }
     node_ui->initialize(this, node_ui, dockContainer, node, requestedByLoad);
+    node_ui->setDetailsVisible(_imp->_detailsVisible);
     
     ///only move main instances
     if (node->getParentMultiInstanceName().empty()) {
@@ -1288,7 +1308,6 @@ void NodeGraph::mouseMoveEvent(QMouseEvent *event) {
     }
 
     _imp->_lastScenePosClick = newPos;
-    update();
     
     /*Now update navigator*/
     //updateNavigator();
@@ -1742,6 +1761,7 @@ void NodeGraph::wheelEvent(QWheelEvent *event){
         _imp->_magnifiedNode->setScale_natron(_imp->_magnifiedNode->scale() * scaleFactor);
     } else {
         scale(scaleFactor,scaleFactor);
+        _imp->refreshLevelOfDetail();
         _imp->_refreshOverlays = true;
     }
     QPointF newPos = mapToScene(event->pos());
@@ -1907,40 +1927,57 @@ bool NodeGraph::areAllNodesVisible(){
 }
 
 QImage NodeGraph::getFullSceneScreenShot(){
-    const QTransform& currentTransform = transform();
-    setTransform(currentTransform.inverted());
+    ///The graph is drawn in a simplified form (backdrops, node rectangles and edges) rather than
+    ///with QGraphicsScene::render(): the image ends-up as a small thumbnail and rendering the text and previews
+    ///of thousands of nodes at full size is very slow.
     QRectF sceneR = _imp->calcNodesBoundingRect();
     QRectF viewRect = visibleRect();
     sceneR = sceneR.united(viewRect);
-    QImage img((int)sceneR.width(), (int)sceneR.height(), QImage::Format_ARGB32_Premultiplied);
+    double ratio = std::min(1.,NATRON_NODEGRAPH_NAVIGATOR_IMAGE_SIZE / std::max(sceneR.width(),sceneR.height()));
+    QImage img(std::max(1,(int)(sceneR.width() * ratio)), std::max(1,(int)(sceneR.height() * ratio)),
+               QImage::Format_ARGB32_Premultiplied);
     img.fill(QColor(71,71,71,255));
-    viewRect.setX(viewRect.x() - sceneR.x());
-    viewRect.setY(viewRect.y() - sceneR.y());
     QPainter painter(&img);
-    painter.save();
+    painter.scale(ratio, ratio);
+    painter.translate(-sceneR.topLeft());
+    
+    for (std::list<NodeBackDrop*>::iterator it = _imp->_backdrops.begin(); it != _imp->_backdrops.end(); ++it) {
+        if ((*it)->isVisible()) {
+            painter.fillRect((*it)->mapToScene((*it)->boundingRect()).boundingRect(), (*it)->getCurrentColor());
+        }
+    }
+    
+    QPen edgePen(QColor(0,0,0,255));
+    edgePen.setCosmetic(true);
+    painter.setPen(edgePen);
+    {
+        QMutexLocker l(&_imp->_nodesMutex);
+        for (std::list<boost::shared_ptr<NodeGui> >::iterator it = _imp->_nodes.begin(); it != _imp->_nodes.end(); ++it) {
+            if (!(*it)->isVisible()) {
+                continue;
+            }
+            const std::map<int,Edge*>& edges = (*it)->getInputsArrows();
+            for (std::map<int,Edge*>::const_iterator it2 = edges.begin(); it2 != edges.end(); ++it2) {
+                if (it2->second->hasSource() && it2->second->isVisible()) {
+                    QLineF line = it2->second->line();
+                    painter.drawLine(it2->second->mapToScene(line.p1()), it2->second->mapToScene(line.p2()));
+                }
+            }
+        }
+        for (std::list<boost::shared_ptr<NodeGui> >::iterator it = _imp->_nodes.begin(); it != _imp->_nodes.end(); ++it) {
+            if ((*it)->isVisible()) {
+                painter.fillRect((*it)->mapToScene((*it)->boundingRect()).boundingRect(), (*it)->getCurrentColor());
+            }
+        }
+    }
+    
+    painter.fillRect(viewRect, QColor(200,200,200,100));
     QPen p;
     p.setColor(Qt::yellow);
-    p.setWidth(10);
+    p.setWidth(2);
+    p.setCosmetic(true);
     painter.setPen(p);
     painter.drawRect(viewRect);
-    painter.restore();
-    scene()->removeItem(_imp->_navLeftEdge);
-    scene()->removeItem(_imp->_navBottomEdge);
-    scene()->removeItem(_imp->_navTopEdge);
-    scene()->removeItem(_imp->_navRightEdge);
-    scene()->removeItem(_imp->_cacheSizeText);
-    scene()->removeItem(_imp->_navigatorProxy);
-    scene()->render(&painter,QRectF(),sceneR);
-    scene()->addItem(_imp->_navigatorProxy);
-    scene()->addItem(_imp->_cacheSizeText);
-    scene()->addItem(_imp->_navLeftEdge);
-    scene()->addItem(_imp->_navBottomEdge);
-    scene()->addItem(_imp->_navTopEdge);
-    scene()->addItem(_imp->_navRightEdge);
-    p.setColor(QColor(200,200,200,255));
-    painter.setPen(p);
-    painter.fillRect(viewRect, QColor(200,200,200,100));
-    setTransform(currentTransform);
     return img;
 }
 
@@ -1985,6 +2022,8 @@ void NodeGraph::restoreFromTrash(NodeGui* node) {
     QMutexLocker l(&_imp->_nodesMutex);
     for (std::list<boost::shared_ptr<NodeGui> >::iterator it = _imp->_nodesTrash.begin();it!=_imp->_nodesTrash.end();++it) {
         if ((*it).get() == node) {
+            ///the zoom may have changed since the node was removed
+            (*it)->setDetailsVisible(_imp->_detailsVisible);
             _imp->_nodes.push_back(*it);
             _imp->_nodesTrash.erase(it);
             break;
@@ -2032,6 +2071,21 @@ NodeGraph::updateCacheSizeText()
                                  .arg(QDirModelPrivate_size(appPTR->getCachesTotalMemorySize())));
 }
 
+void
+NodeGraphPrivate::refreshLevelOfDetail()
+{
+    double zoom = _publicInterface->transform().mapRect(QRectF(0,0,1,1)).width();
+    bool detailsVisible = zoom >= NATRON_NODEGRAPH_LOD_ZOOM_THRESHOLD;
+    if (detailsVisible == _detailsVisible) {
+        return;
+    }
+    _detailsVisible = detailsVisible;
+    QMutexLocker l(&_nodesMutex);
+    for (std::list<boost::shared_ptr<NodeGui> >::iterator it = _nodes.begin(); it != _nodes.end(); ++it) {
+        (*it)->setDetailsVisible(detailsVisible);
+    }
+}
+
 QRectF
 NodeGraphPrivate::calcNodesBoundingRect()
 {
@@ -2835,6 +2889,7 @@ NodeGraph::centerOnAllNodes()
     
     QRect rect(xmin,ymin,(xmax - xmin),(ymax - ymin));
     fitInView(rect,Qt::KeepAspectRatio);
+    _imp->refreshLevelOfDetail();
     _imp->_refreshOverlays = true;
     repaint();
 }
@@ -39,6 +39,7 @@ class NodeSerialization;
 class NodeGuiSerialization;
 class NodeBackDropSerialization;
 class NodeBackDrop;
+class PreviewScheduler;
 struct NodeGraphPrivate;
 namespace Natron{
     class Node;
@@ -88,6 +89,9 @@ public:
     QGraphicsItem* getRootItem() const;
     
     Gui* getGui() const;
+
+    ///The scheduler computing the previews of all the nodes of this graph
+    PreviewScheduler* getPreviewScheduler() const;
     
     void discardGuiPointer();
         
@@ -15,9 +15,9 @@
 
 #include <QLayout>
 #include <QAction> 
-#include <QtConcurrentRun>
 #include <QFontMetrics>
 #include <QMenu>
+#include <QImage>
 #include <QTextDocument> // for Qt::convertFromPlainText
 #include <QTextBlockFormat>
 #include <QTextCursor>
@@ -86,6 +86,7 @@ NodeGui::NodeGui(QGraphicsItem *parent)
 , _settingNameFromGui(false)
 , _nameItem(NULL)
 , _boundingBox(NULL)
+, _detailsItem(NULL)
 , _channelsPixmap(NULL)
 , _previewPixmap(NULL)
 , _persistentMessage(NULL)
@@ -119,7 +120,9 @@ NodeGui::NodeGui(QGraphicsItem *parent)
 
 NodeGui::~NodeGui()
 {
-    
+    if (_graph) {
+        _graph->getPreviewScheduler()->cancelPreview(this);
+    }
     deleteReferences();
     
     delete _clonedGradient;
@@ -278,13 +281,19 @@ void NodeGui::createGui()
 {
     _boundingBox = new QGraphicsRectItem(this);
     _boundingBox->setZValue(0);
+
+    ///Parent of everything that is not drawn when the graph is zoomed-out. It is at the origin of the node
+    ///so its children keep the coordinates they would have as direct children of the node.
+    _detailsItem = new QGraphicsRectItem(this);
+    _detailsItem->setFlag(QGraphicsItem::ItemHasNoContents);
+    _detailsItem->setZValue(1);
 	
-    _nameItem = new QGraphicsTextItem(_internalNode->getName().c_str(),this);
+    _nameItem = new QGraphicsTextItem(_internalNode->getName().c_str(),_detailsItem);
     _nameItem->setDefaultTextColor(QColor(0,0,0,255));
     _nameItem->setFont(QFont(NATRON_FONT, NATRON_FONT_SIZE_12));
     _nameItem->setZValue(1);
     
-    _persistentMessage = new QGraphicsTextItem("",this);
+    _persistentMessage = new QGraphicsTextItem("",_detailsItem);
     _persistentMessage->setZValue(3);
     QFont f = _persistentMessage->font();
     f.setPixelSize(25);
@@ -301,7 +310,7 @@ void NodeGui::createGui()
     bitDepthGrad.push_back(qMakePair(0.3, QColor(Qt::yellow)));
     bitDepthGrad.push_back(qMakePair(1., QColor(243,137,0)));
     _bitDepthWarning = new NodeGuiIndicator("C",bitDepthPos,NATRON_ELLIPSE_WARN_DIAMETER,NATRON_ELLIPSE_WARN_DIAMETER,
-                                            bitDepthGrad,QColor(0,0,0,255),this);
+                                            bitDepthGrad,QColor(0,0,0,255),_detailsItem);
     _bitDepthWarning->setActive(false);
 
 }
@@ -333,7 +342,7 @@ void NodeGui::togglePreview_internal(bool refreshPreview)
             QImage prev(NATRON_PREVIEW_WIDTH, NATRON_PREVIEW_HEIGHT, QImage::Format_ARGB32);
             prev.fill(Qt::black);
             QPixmap prev_pixmap = QPixmap::fromImage(prev);
-            _previewPixmap = new QGraphicsPixmapItem(prev_pixmap,this);
+            _previewPixmap = new QGraphicsPixmapItem(prev_pixmap,_detailsItem ? _detailsItem : this);
             _previewPixmap->setZValue(1);
            
         }
@@ -610,47 +619,25 @@ void NodeGui::updateChannelsTooltip(const Natron::ChannelSet& chan){
 void NodeGui::updatePreviewImage(int time) {
     
     if(_internalNode->isPreviewEnabled()  && _internalNode->getApp()->getProject()->isAutoPreviewEnabled()) {
-        QtConcurrent::run(this,&NodeGui::computePreviewImage,time);
+        _graph->getPreviewScheduler()->schedulePreview(this,time);
     }
 }
 
 void NodeGui::forceComputePreview(int time) {
     if(_internalNode->isPreviewEnabled()) {
-        QtConcurrent::run(this,&NodeGui::computePreviewImage,time);
+        _graph->getPreviewScheduler()->schedulePreview(this,time);
     }
 }
 
-void NodeGui::computePreviewImage(int time){
-    
-    if (_internalNode->isRenderingPreview()) {
-        return;
-    }
-    
-    int w = NATRON_PREVIEW_WIDTH;
-    int h = NATRON_PREVIEW_HEIGHT;
-    size_t dataSize = 4*w*h;
-    {
-#ifndef __NATRON_WIN32__
-        unsigned int* buf = (unsigned int*)calloc(dataSize,1);
-#else
-		unsigned int* buf = (unsigned int*)malloc(dataSize);
-		for (int i = 0; i < w*h ;++i) {
-				buf[i] = qRgba(0,0,0,255);
-		}
-#endif
-        _internalNode->makePreviewImage(time, &w, &h, buf);
-        {
-            QImage img(reinterpret_cast<const uchar*>(buf), w, h, QImage::Format_ARGB32_Premultiplied);
-            QPixmap prev_pixmap = QPixmap::fromImage(img);
-            _previewPixmap->setPixmap(prev_pixmap);
-            QPointF topLeft = mapFromParent(pos());
-            QRectF bbox = boundingRect();
-            _previewPixmap->setPos(topLeft.x() + bbox.width() / 2 - w / 2,
-                                   topLeft.y() + bbox.height() / 2 - h / 2 + 10);
-        }
-        free(buf);
-    }
+void NodeGui::setPreviewImage(const QImage& img)
+{
+    _previewPixmap->setPixmap(QPixmap::fromImage(img));
+    QPointF topLeft = mapFromParent(pos());
+    QRectF bbox = boundingRect();
+    _previewPixmap->setPos(topLeft.x() + bbox.width() / 2 - img.width() / 2,
+                           topLeft.y() + bbox.height() / 2 - img.height() / 2 + 10);
 }
+
 void NodeGui::initializeInputs()
 {
     
@@ -1603,6 +1590,13 @@ void NodeGuiIndicator::refreshPosition(const QPointF& topLeft)
 
 ///////////////////
 
+void NodeGui::setDetailsVisible(bool visible)
+{
+    if (_detailsItem) {
+        _detailsItem->setVisible(visible);
+    }
+}
+
 void NodeGui::setScale_natron(double scale)
 {
     setScale(scale);
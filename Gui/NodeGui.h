@@ -44,6 +44,7 @@ class KnobGui;
 class QUndoStack;
 class MultiInstancePanel;
 class QMenu;
+class QImage;
 namespace Natron {
 class ChannelSet;
 class Node;
@@ -253,6 +254,10 @@ public:
     
     ///same as setScale() but also scales the arrows
     void setScale_natron(double scale);
+
+    ///Shows or hides the name, the preview and the indicators of the node, the rectangle is always drawn.
+    ///This is called by the NodeGraph when the zoom crosses NATRON_NODEGRAPH_LOD_ZOOM_THRESHOLD.
+    void setDetailsVisible(bool visible);
     
     void removeHighlightOnAllEdges();
     
@@ -291,6 +296,9 @@ public slots:
     
     /*Updates the preview image no matter what*/
     void forceComputePreview(int time);
+
+    /*Called by the PreviewScheduler on the main thread once the preview has been computed*/
+    void setPreviewImage(const QImage& img);
     
     /*Updates the channels tooltip. This is called by Node::validate(),
      i.e, when the channel requested for the node change.*/
@@ -382,8 +390,6 @@ private:
     
     void setAboveItem(QGraphicsItem* item);
     
-    void computePreviewImage(int time);
-    
     void populateMenu();
     
     void refreshCurrentBrush();
@@ -404,6 +410,9 @@ private:
         
     /*A pointer to the rectangle of the node.*/
     QGraphicsRectItem* _boundingBox;
+
+    /*The parent of the name, preview and indicators: hidden when the graph is zoomed-out*/
+    QGraphicsRectItem* _detailsItem;
     
     /*A pointer to the channels pixmap displayed*/
     QGraphicsPixmapItem* _channelsPixmap;
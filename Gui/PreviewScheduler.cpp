@@ -0,0 +1,213 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "PreviewScheduler.h"
+
+#include <cassert>
+#include <cstdlib>
+#include <list>
+#include <map>
+
+CLANG_DIAG_OFF(deprecated)
+#include <QtCore/QCoreApplication>
+#include <QtCore/QMetaObject>
+#include <QtCore/QMutex>
+#include <QtCore/QWaitCondition>
+#include <QtGui/QImage>
+CLANG_DIAG_ON(deprecated)
+
+#include "Engine/AppInstance.h"
+#include "Engine/EffectInstance.h"
+#include "Engine/Node.h"
+#include "Engine/Project.h"
+#include "Engine/VideoEngine.h"
+
+#include "Gui/NodeGui.h"
+
+///How long the scheduler sleeps before checking again whether the viewers and writers are done rendering
+#define NATRON_PREVIEW_SCHEDULER_WAIT_MS 50
+
+struct PreviewSchedulerPrivate
+{
+    struct PendingPreview
+    {
+        boost::shared_ptr<Natron::Node> node;
+        int time;
+    };
+
+    AppInstance* app;
+
+    QMutex requestsMutex; //< protects all the fields below
+    QWaitCondition requestsCond;
+    std::list<NodeGui*> queue; //< the order in which the pending requests are served
+    std::map<NodeGui*,PendingPreview> requests; //< at most 1 pending request per node
+    NodeGui* computing; //< the node whose preview is being computed, NULL if it was cancelled meanwhile
+    bool mustQuit;
+
+    PreviewSchedulerPrivate(AppInstance* app)
+    : app(app)
+    , requestsMutex()
+    , requestsCond()
+    , queue()
+    , requests()
+    , computing(NULL)
+    , mustQuit(false)
+    {
+    }
+};
+
+PreviewScheduler::PreviewScheduler(AppInstance* app)
+: QThread()
+, _imp(new PreviewSchedulerPrivate(app))
+{
+    setObjectName("PreviewScheduler");
+}
+
+PreviewScheduler::~PreviewScheduler()
+{
+    quitThread();
+}
+
+void
+PreviewScheduler::schedulePreview(NodeGui* node,int time)
+{
+    assert(QThread::currentThread() == qApp->thread());
+    {
+        QMutexLocker l(&_imp->requestsMutex);
+        if (_imp->mustQuit) {
+            return;
+        }
+        std::map<NodeGui*,PreviewSchedulerPrivate::PendingPreview>::iterator found = _imp->requests.find(node);
+        if (found != _imp->requests.end()) {
+            ///already pending: the node keeps its place in the queue, only the latest time matters
+            found->second.time = time;
+            return;
+        }
+        PreviewSchedulerPrivate::PendingPreview p;
+        p.node = node->getNode();
+        p.time = time;
+        _imp->requests.insert(std::make_pair(node,p));
+        _imp->queue.push_back(node);
+        _imp->requestsCond.wakeOne();
+    }
+    if (!isRunning()) {
+        start(QThread::LowestPriority);
+    }
+}
+
+void
+PreviewScheduler::cancelPreview(NodeGui* node)
+{
+    QMutexLocker l(&_imp->requestsMutex);
+    if (_imp->requests.erase(node)) {
+        _imp->queue.remove(node);
+    }
+    if (_imp->computing == node) {
+        _imp->computing = NULL;
+    }
+}
+
+void
+PreviewScheduler::quitThread()
+{
+    {
+        QMutexLocker l(&_imp->requestsMutex);
+        _imp->mustQuit = true;
+        _imp->queue.clear();
+        _imp->requests.clear();
+        _imp->computing = NULL;
+        _imp->requestsCond.wakeOne();
+    }
+    wait();
+}
+
+bool
+PreviewScheduler::isOutputRendering() const
+{
+    std::vector<boost::shared_ptr<Natron::Node> > nodes = _imp->app->getProject()->getCurrentNodes();
+    for (U32 i = 0; i < nodes.size(); ++i) {
+        Natron::OutputEffectInstance* output = dynamic_cast<Natron::OutputEffectInstance*>(nodes[i]->getLiveInstance());
+        if (output && output->getVideoEngine() && output->getVideoEngine()->isWorking()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void
+PreviewScheduler::run()
+{
+    for (;;) {
+        {
+            QMutexLocker l(&_imp->requestsMutex);
+            while (!_imp->mustQuit && _imp->queue.empty()) {
+                _imp->requestsCond.wait(&_imp->requestsMutex);
+            }
+            if (_imp->mustQuit) {
+                return;
+            }
+        }
+
+        ///Previews are the least important renders: let the viewers and writers finish first.
+        ///Requests keep being coalesced meanwhile.
+        while (isOutputRendering()) {
+            {
+                QMutexLocker l(&_imp->requestsMutex);
+                if (_imp->mustQuit) {
+                    return;
+                }
+            }
+            msleep(NATRON_PREVIEW_SCHEDULER_WAIT_MS);
+        }
+
+        NodeGui* nodeGui;
+        PreviewSchedulerPrivate::PendingPreview request;
+        {
+            QMutexLocker l(&_imp->requestsMutex);
+            if (_imp->mustQuit) {
+                return;
+            }
+            if (_imp->queue.empty()) {
+                continue;
+            }
+            nodeGui = _imp->queue.front();
+            _imp->queue.pop_front();
+            std::map<NodeGui*,PreviewSchedulerPrivate::PendingPreview>::iterator found = _imp->requests.find(nodeGui);
+            assert(found != _imp->requests.end());
+            request = found->second;
+            _imp->requests.erase(found);
+            _imp->computing = nodeGui;
+        }
+
+        int w = NATRON_PREVIEW_WIDTH;
+        int h = NATRON_PREVIEW_HEIGHT;
+        size_t dataSize = 4 * w * h;
+#ifndef __NATRON_WIN32__
+        unsigned int* buf = (unsigned int*)calloc(dataSize,1);
+#else
+        unsigned int* buf = (unsigned int*)malloc(dataSize);
+        for (int i = 0; i < w * h; ++i) {
+            buf[i] = qRgba(0,0,0,255);
+        }
+#endif
+        request.node->makePreviewImage(request.time, &w, &h, buf);
+
+        ///the image must own its pixels since it outlives buf
+        QImage img = QImage(reinterpret_cast<const uchar*>(buf), w, h, QImage::Format_ARGB32_Premultiplied).copy();
+        free(buf);
+
+        {
+            QMutexLocker l(&_imp->requestsMutex);
+            ///The node cannot be destroyed while the mutex is held since its destructor calls cancelPreview():
+            ///it is still alive if it is still the one being computed. The queued call is discarded by Qt if the
+            ///node gets destroyed before the main thread processes it.
+            if (_imp->computing == nodeGui) {
+                QMetaObject::invokeMethod(nodeGui, "setPreviewImage", Qt::QueuedConnection, Q_ARG(QImage, img));
+            }
+            _imp->computing = NULL;
+        }
+    }
+}
@@ -0,0 +1,63 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef NATRON_GUI_PREVIEWSCHEDULER_H_
+#define NATRON_GUI_PREVIEWSCHEDULER_H_
+
+#include "Global/Macros.h"
+CLANG_DIAG_OFF(deprecated)
+#include <QtCore/QThread>
+CLANG_DIAG_ON(deprecated)
+
+#ifndef Q_MOC_RUN
+#include <boost/scoped_ptr.hpp>
+#endif
+
+class AppInstance;
+class NodeGui;
+struct PreviewSchedulerPrivate;
+
+/**
+ * @brief Computes the previews of the nodes of the node graph, one at a time, on a single
+ * low priority thread. Pending requests are coalesced per node: if a node asks for a preview
+ * while its previous request is still pending, only the time of the request is updated.
+ * A preview is not started while a viewer or a writer is rendering.
+ * The resulting image is handed back to the NodeGui on the main thread.
+ **/
+class PreviewScheduler : public QThread
+{
+public:
+
+    PreviewScheduler(AppInstance* app);
+
+    virtual ~PreviewScheduler();
+
+    /**
+     * @brief Requests the preview of the node at the given time. Must be called on the main thread.
+     **/
+    void schedulePreview(NodeGui* node,int time);
+
+    /**
+     * @brief Drops the pending request of the node, if any. If the preview of the node is being computed,
+     * its result will not be delivered. Must be called before the node is destroyed.
+     **/
+    void cancelPreview(NodeGui* node);
+
+    /**
+     * @brief Drops all pending requests and stops the thread.
+     **/
+    void quitThread();
+
+private:
+
+    virtual void run() OVERRIDE FINAL;
+
+    bool isOutputRendering() const WARN_UNUSED_RETURN;
+
+    boost::scoped_ptr<PreviewSchedulerPrivate> _imp;
+};
+
+#endif // NATRON_GUI_PREVIEWSCHEDULER_H_
@@ -40,6 +40,8 @@
 #include "Gui/NodeGui.h"
 #include "Gui/TabWidget.h"
 #include "Gui/ProjectGuiSerialization.h"
+#include <boost/archive/binary_iarchive.hpp>
+#include <boost/archive/binary_oarchive.hpp>
 #include "Gui/GuiAppInstance.h"
 #include "Gui/NodeGraph.h"
 #include "Gui/Splitter.h"
@@ -232,6 +234,12 @@ void ProjectGui::save(boost::archive::xml_oarchive& archive) const {
     archive << boost::serialization::make_nvp("ProjectGui",projectGuiSerializationObj);
 }
 
+void ProjectGui::save(boost::archive::binary_oarchive& archive) const {
+    ProjectGuiSerialization projectGuiSerializationObj;
+    projectGuiSerializationObj.initialize(this);
+    archive << boost::serialization::make_nvp("ProjectGui",projectGuiSerializationObj);
+}
+
 void restoreTabWidgetLayoutRecursively(Gui* gui,const std::map<std::string,PaneLayout>& guiLayout,
                                        std::map<std::string,PaneLayout>::const_iterator layout){
     const std::list<TabWidget*>& initialWidgets = gui->getPanes();
@@ -280,6 +288,17 @@ void ProjectGui::load(boost::archive::xml_iarchive& archive){
     
     ProjectGuiSerialization obj;
     archive >> boost::serialization::make_nvp("ProjectGui",obj);
+    restore(obj);
+}
+
+void ProjectGui::load(boost::archive::binary_iarchive& archive){
+    
+    ProjectGuiSerialization obj;
+    archive >> boost::serialization::make_nvp("ProjectGui",obj);
+    restore(obj);
+}
+
+void ProjectGui::restore(const ProjectGuiSerialization& obj){
  
     const std::map<std::string, ViewerData >& viewersProjections = obj.getViewersProjections();
     
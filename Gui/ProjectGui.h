@@ -38,7 +38,10 @@ class NodeGui;
 class NodeGuiSerialization;
 namespace boost {
     namespace archive {
-        class xml_archive;
+        class xml_iarchive;
+        class xml_oarchive;
+        class binary_iarchive;
+        class binary_oarchive;
     }
 }
 
@@ -69,6 +72,11 @@ public:
     
     void load(boost::archive::xml_iarchive& archive);
     
+    ///Same as above for projects saved in the binary format (@see Project::saveProjectInternal)
+    void save(boost::archive::binary_oarchive& archive) const;
+    
+    void load(boost::archive::binary_iarchive& archive);
+    
     void registerNewColorPicker(boost::shared_ptr<Color_Knob> knob);
     
     void removeColorPicker(boost::shared_ptr<Color_Knob> knob);
@@ -94,6 +102,8 @@ public slots:
 
 private:
     
+    ///Restores the gui state once it has been read from an archive, whatever its format
+    void restore(const ProjectGuiSerialization& obj);
     
     Gui* _gui;
     
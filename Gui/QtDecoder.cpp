@@ -18,6 +18,7 @@
 #include <QtGui/QImageReader>
 
 #include "Engine/AppManager.h"
+#include "Engine/AppInstance.h"
 #include "Engine/Image.h"
 #include "Engine/Lut.h"
 #include "Engine/KnobTypes.h"
@@ -25,13 +26,43 @@
 #include "Engine/Knob.h"
 #include "Engine/Project.h"
 #include "Engine/Node.h"
+#include "Engine/FramePrefetcher.h"
+#include "Engine/TimeLine.h"
 
 using namespace Natron;
 using std::cout; using std::endl;
 
+namespace {
+
+class DecodedImage : public Natron::PrefetchedFrame {
+public:
+    explicit DecodedImage(const std::string& filename)
+    : image(filename.c_str())
+    {
+    }
+    
+    virtual std::size_t getSize() const OVERRIDE FINAL { return image.byteCount(); }
+    
+    QImage image;
+};
+
+///Runs on the threads of the prefetcher, or on the render thread if the file was not prefetched.
+///QImage does not throw: a file it cannot decode gives a null image, which is a failure for the prefetcher.
+boost::shared_ptr<Natron::PrefetchedFrame> decodeImage(const std::string& filename) {
+    boost::shared_ptr<DecodedImage> decoded(new DecodedImage(filename));
+    if (decoded->image.isNull()) {
+        return boost::shared_ptr<Natron::PrefetchedFrame>();
+    }
+    return decoded;
+}
+
+}
+
 QtReader::QtReader(boost::shared_ptr<Natron::Node> node)
 : Natron::EffectInstance(node)
 , _lut(Color::LutManager::sRGBLut())
+, _prefetcher(new FramePrefetcher(&decodeImage))
+, _frame()
 , _img(0)
 , _fileKnob()
 , _firstFrame()
@@ -49,8 +80,6 @@ QtReader::QtReader(boost::shared_ptr<Natron::Node> node)
 
 
 QtReader::~QtReader(){
-    if(_img)
-        delete _img;
 }
 
 std::string QtReader::pluginID() const {
@@ -141,6 +170,7 @@ void QtReader::initializeKnobs() {
 
 void QtReader::knobChanged(KnobI* k, Natron::ValueChangedReason /*reason*/,const RectI& /*rod*/,int /*view*/,SequenceTime /*time*/) {
     if (k == _fileKnob.get()) {
+        _prefetcher->clear();
         SequenceTime first,last;
         getSequenceTimeDomain(first,last);
         timeDomainFromSequenceTimeDomain(first,last, true);
@@ -387,6 +417,29 @@ void QtReader::getFilenameAtSequenceTime(SequenceTime time, std::string &filenam
     
 }
 
+void QtReader::prefetchFrames(SequenceTime time) {
+    ///playing backward is the only case where the frames are requested in decreasing order
+    int direction = getApp()->getTimeLine()->isPlaybackForward() ? 1 : -1;
+    
+    SequenceTime first,last;
+    getFrameRange(&first, &last);
+    int timeOffset = _timeOffset->getValue();
+    _prefetcher->setMaximumMemory(appPTR->getNodeCacheMaximumSize() / NATRON_FRAME_PREFETCHER_NODE_CACHE_FRACTION);
+    int count = _prefetcher->getPrefetchCount();
+    std::vector<std::string> filenames;
+    for (int i = 1; i <= count; ++i) {
+        SequenceTime t = time + i * direction;
+        if (t < first || t > last) {
+            break;
+        }
+        std::string filename = _fileKnob->getFileName(t - timeOffset, 0);
+        if (!filename.empty() && filename != _filename) {
+            filenames.push_back(filename);
+        }
+    }
+    _prefetcher->prefetch(filenames);
+}
+
 Natron::Status QtReader::getRegionOfDefinition(SequenceTime time,const RenderScale& /*scale*/,int /*view*/,RectI* rod ) {
 
     QMutexLocker l(&_lock);
@@ -406,16 +459,21 @@ Natron::Status QtReader::getRegionOfDefinition(SequenceTime time,const RenderSca
     
     if(filename != _filename){
         _filename = filename;
-        if(_img){
-            delete _img;
-        }
-        _img = new QImage(_filename.c_str());
-        if(_img->format() == QImage::Format_Invalid){
+        ///the frame is NULL if the file could not be decoded
+        _frame = _prefetcher->getFrame(_filename);
+        DecodedImage* decoded = dynamic_cast<DecodedImage*>(_frame.get());
+        _img = decoded ? &decoded->image : 0;
+        prefetchFrames(time);
+        if(!_img){
             setPersistentMessage(Natron::ERROR_MESSAGE, QObject::tr("Failed to load the image ").toStdString() + filename);
             return StatFailed;
         }
     }
     
+    if (!_img) {
+        return StatFailed;
+    }
+    
     rod->x1 = 0;
     rod->x2 = _img->width();
     rod->y1 = 0;
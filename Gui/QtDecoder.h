@@ -28,6 +28,8 @@ namespace Natron {
     namespace Color {
         class Lut;
     }
+    class FramePrefetcher;
+    class PrefetchedFrame;
 }
 
 class File_Knob;
@@ -103,10 +105,17 @@ private:
 
     void getFilenameAtSequenceTime(SequenceTime time, std::string &filename);
 
+    /**
+     * @brief Prefetches the files of the frames following time, in the direction of the playback.
+     **/
+    void prefetchFrames(SequenceTime time);
+
 
     const Natron::Color::Lut* _lut;
     std::string _filename;
-    QImage* _img;
+    boost::scoped_ptr<Natron::FramePrefetcher> _prefetcher;
+    boost::shared_ptr<Natron::PrefetchedFrame> _frame; //< the decoded file, holds _img
+    const QImage* _img;
     QMutex _lock;
     boost::shared_ptr<File_Knob> _fileKnob;
     boost::shared_ptr<Int_Knob> _firstFrame;
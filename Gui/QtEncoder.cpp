@@ -12,12 +12,16 @@
 
 #include "QtEncoder.h"
 
+#include <cstdio>
 #include <string>
 #include <vector>
 #include <stdexcept>
+#include <QtCore/QFileInfo>
 #include <QtGui/QImage>
 #include <QtGui/QImageWriter>
 
+#include <boost/bind.hpp>
+
 #include "Engine/AppManager.h"
 #include "Engine/AppInstance.h"
 #include "Engine/Lut.h"
@@ -27,6 +31,7 @@
 #include "Engine/KnobFile.h"
 #include "Engine/TimeLine.h"
 #include "Engine/Node.h"
+#include "Engine/WriteQueue.h"
 
 using namespace Natron;
 
@@ -199,42 +204,56 @@ static std::string filenameFromPattern(const std::string& pattern,int frameIndex
     return ret;
 }
 
-Natron::Status QtWriter::render(SequenceTime time, RenderScale scale, const RectI& roi, int view,
-                                bool /*isSequentialRender*/,bool /*isRenderResponseToUserInteraction*/,
-                                boost::shared_ptr<Natron::Image> output){
-    
-    boost::shared_ptr<Natron::Image> src = getImage(0, time, scale, view, NULL, output->getComponents(), output->getBitDepth(), false);
-    
-    if(hasOutputConnected()){
-        output->copy(*src,src->getRoD());
-    }
-    
+///Runs on a worker of the write queue
+static bool writeFrame(const Natron::Color::Lut* lut,boost::shared_ptr<Natron::Image> src,const RectI& roi,bool premult,
+                       const std::string& filename) {
     ////initializes to black
     unsigned char* buf = (unsigned char*)calloc(roi.area() * 4,1);
     
-    
     QImage::Format type;
-    bool premult = _premultKnob->getValue();
     if (premult) {
         type = QImage::Format_ARGB32_Premultiplied;
     }else{
         type = QImage::Format_ARGB32;
     }
     
-    _lut->to_byte_packed(buf, (const float*)src->pixelAt(0, 0), roi, src->getRoD(), roi,
-                         Natron::Color::PACKING_RGBA, Natron::Color::PACKING_BGRA, true, premult);
+    lut->to_byte_packed(buf, (const float*)src->pixelAt(0, 0), roi, src->getRoD(), roi,
+                        Natron::Color::PACKING_RGBA, Natron::Color::PACKING_BGRA, true, premult);
     
     QImage img(buf,roi.width(),roi.height(),type);
     
+    ///the format is deduced from the extension of the final file, write it under a temporary name so that
+    ///a partially written frame is never visible
+    std::string tmpFilename = WriteQueue::getTemporaryFileName(filename);
+    QByteArray format = QFileInfo(filename.c_str()).suffix().toLower().toLatin1();
+    bool ok = img.save(tmpFilename.c_str(),format.constData());
+    free(buf);
+    if (!ok) {
+        std::remove(tmpFilename.c_str());
+        return false;
+    }
+    return WriteQueue::commitTemporaryFile(tmpFilename, filename);
+}
+
+Natron::Status QtWriter::render(SequenceTime time, RenderScale scale, const RectI& roi, int view,
+                                bool /*isSequentialRender*/,bool /*isRenderResponseToUserInteraction*/,
+                                boost::shared_ptr<Natron::Image> output){
+    
+    boost::shared_ptr<Natron::Image> src = getImage(0, time, scale, view, NULL, output->getComponents(), output->getBitDepth(), false);
+    
+    if(hasOutputConnected()){
+        output->copy(*src,src->getRoD());
+    }
+    
     std::string filename = _fileKnob->getValue();
     filename = filenameFromPattern(filename,std::floor(time + 0.5));
     
-    img.save(filename.c_str());
-    free(buf);
+    ///Hand off the conversion, the encoding and the I/O to the write queue and render the next frame meanwhile.
+    ///The queue holds a reference to src, which prevents the cache from evicting it until it is written.
+    getWriteQueue()->append(boost::bind(&writeFrame, _lut, src, roi, _premultKnob->getValue(), filename));
     return StatOK;
 }
 
-
 void QtWriter::addAcceptedComponents(int /*inputNb*/,std::list<Natron::ImageComponents>* comps)
 {
     ///QtWriter only supports RGBA for now.
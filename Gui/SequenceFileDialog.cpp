@@ -85,28 +85,6 @@ static inline bool nocase_equal_string (const std::string &s1, const std::string
 
 
 
-namespace {
-    struct NameMappingCompareFirst {
-        NameMappingCompareFirst(const QString &val) : val_(val) {}
-      bool operator()(const SequenceFileDialog::NameMappingElement& elem) const {
-            return val_ == elem.first;
-        }
-    private:
-        QString val_;
-    };
-
-    struct NameMappingCompareFirstNoPath {
-        NameMappingCompareFirstNoPath(const QString &val) : val_(val) {}
-        bool operator()(const SequenceFileDialog::NameMappingElement& elem) const {
-            std::string unpathed = elem.first.toStdString();
-            SequenceParsing::removePath(unpathed);
-            return val_.toStdString() == unpathed;
-        }
-    private:
-        QString val_;
-    };
-}
-
 SequenceFileDialog::SequenceFileDialog(QWidget* parent, // necessary to transmit the stylesheet to the dialog
                                        const std::vector<std::string>& filters, // the user accepted file types
                                        bool isSequenceDialog, // true if this dialog can display sequences
@@ -159,6 +137,7 @@ SequenceFileDialog::SequenceFileDialog(QWidget* parent, // necessary to transmit
 , _showHiddenAction(0)
 , _newFolderAction(0)
 , _dialogMode(mode)
+, _scanner(0)
 {
     setWindowFlags(Qt::Window);
     _mainLayout = new QVBoxLayout(this);
@@ -173,6 +152,9 @@ SequenceFileDialog::SequenceFileDialog(QWidget* parent, // necessary to transmit
     _view->setItemDelegate(_itemDelegate);
     QObject::connect(_model,SIGNAL(directoryLoaded(QString)),this,SLOT(fetchSequencesAndRefreshView(QString)));
     QObject::connect(_model,SIGNAL(rootPathChanged(QString)),this,SLOT(updateView(QString)));
+    _scanner = new Natron::SequenceScanner(this);
+    QObject::connect(_scanner,SIGNAL(scanProgress(QString,int)),this,SLOT(onSequenceScanProgress(QString,int)));
+    QObject::connect(_scanner,SIGNAL(scanFinished(QString)),this,SLOT(onSequenceScanFinished(QString)));
     QObject::connect(_view, SIGNAL(doubleClicked(QModelIndex)), this, SLOT(doubleClickOpen(QModelIndex)));
     
     /*creating GUI*/
@@ -569,6 +551,7 @@ void SequenceFileDialog::createMenuActions(){
 void SequenceFileDialog::enableSequenceMode(bool b){
     _proxy->clear();
     if(!b){
+        _scanner->abortScan();
         QWriteLocker locker(&_nameMappingMutex);
         _nameMapping.clear();
         _view->updateNameMapping(_nameMapping);
@@ -657,7 +640,14 @@ void SequenceFileDialog::setDirectory(const QString &directory){
     if (!directory.isEmpty() && newDirectory.isEmpty())
         return;
     _requestedDir = newDirectory;
-    //_proxy->clear(); //< clear already recorded frame sequences to speed-up filterAcceptsRow
+    if (sequenceModeEnabled()) {
+        ///if the directory did not change since it was last indexed, the sequences are known before the model is filled
+        boost::shared_ptr<const Natron::SequenceIndex> index = _scanner->getIndex(newDirectory);
+        _proxy->setScannedSequences(index);
+        if (!index) {
+            _scanner->scanDirectory(newDirectory);
+        }
+    }
     _model->setRootPath(newDirectory); // < calls filterAcceptsRow
     _createDirButton->setEnabled(_dialogMode != OPEN_DIALOG);
     if(newDirectory.at(newDirectory.size()-1) != QChar('/')){
@@ -710,6 +700,36 @@ void SequenceFileDialog::fetchSequencesAndRefreshView(const QString& currentDire
 
 }
 
+void SequenceFileDialog::onSequenceScanProgress(const QString& directory,int /*filesCount*/) {
+    if (directory != _requestedDir) {
+        return;
+    }
+    if (!sequenceModeEnabled()) {
+        return;
+    }
+    ///only the sequences the scanner found or extended since the last progress are renamed: the names of all the
+    ///rows are computed again once the directory is loaded by the model or indexed by the scanner
+    std::list<Natron::SequenceScanner::SequenceName> sequences = _scanner->takeNewSequences();
+    if (sequences.empty()) {
+        return;
+    }
+    NameMapping nameMapping;
+    nameMapping.reserve(sequences.size());
+    for (std::list<Natron::SequenceScanner::SequenceName>::const_iterator it = sequences.begin(); it != sequences.end(); ++it) {
+        nameMapping.push_back(make_pair(it->representative,make_pair(it->size,it->pattern)));
+    }
+    _view->addToNameMapping(nameMapping);
+}
+
+void SequenceFileDialog::onSequenceScanFinished(const QString& directory) {
+    if (directory != _requestedDir || !sequenceModeEnabled()) {
+        return;
+    }
+    _proxy->setScannedSequences(_scanner->getIndex(directory));
+    _proxy->invalidate(); // < calls filterAcceptsRow
+    itemsToSequence(_model->index(directory));
+}
+
 bool SequenceFileDialog::sequenceModeEnabled() const{
     return _sequenceButton->activeIndex() == 0;
 }
@@ -763,25 +783,40 @@ bool SequenceDialogProxyModel::filterAcceptsRow(int source_row, const QModelInde
     
     
     /*if we reach here, this is a valid file and we need to take actions*/
-    SequenceParsing::FileNameContent fileContent(path.toStdString());
-    for (U32 i = 0; i < _frameSequences.size(); ++i) {
-        if (_frameSequences[i]->tryInsertFile(fileContent)) {
-            ///don't accept the file in the proxy because it already belongs to a sequence
-            return false;
+    std::string file = path.toStdString();
+    if (_scannedSequences) {
+        bool isRepresentative;
+        if (_scannedSequences->getSequenceForFile(file, &isRepresentative)) {
+            ///only the first file of a sequence is shown, it stands for the whole sequence
+            return isRepresentative;
         }
     }
-    boost::shared_ptr<SequenceParsing::SequenceFromFiles> newSequence(new SequenceParsing::SequenceFromFiles(fileContent,true));
-    _frameSequences.push_back(newSequence);
-    
-    return true;
+    ///don't accept the file in the proxy if it already belongs to a sequence
+    return _frameSequences.addFile(file);
+}
+
+namespace {
+boost::shared_ptr<SequenceParsing::SequenceFromFiles>
+findSequence(const boost::shared_ptr<const Natron::SequenceIndex>& scannedSequences,
+             const Natron::SequenceIndex& frameSequences,
+             const std::string& file)
+{
+    boost::shared_ptr<SequenceParsing::SequenceFromFiles> ret;
+    if (scannedSequences) {
+        ret = scannedSequences->getSequenceForFile(file);
+    }
+    if (!ret) {
+        ret = frameSequences.getSequenceForFile(file);
+    }
+    return ret;
+}
 }
 
 QString SequenceDialogProxyModel::getUserFriendlyFileSequencePatternForFile(const QString& filename,quint64* sequenceSize) const {
-    for (U32 i = 0; i < _frameSequences.size(); ++i) {
-        if (_frameSequences[i]->contains(filename.toStdString())) {
-            *sequenceSize = _frameSequences[i]->getEstimatedTotalSize();
-            return _frameSequences[i]->generateUserFriendlySequencePattern().c_str();
-        }
+    boost::shared_ptr<SequenceParsing::SequenceFromFiles> sequence = findSequence(_scannedSequences, _frameSequences, filename.toStdString());
+    if (sequence) {
+        *sequenceSize = sequence->getEstimatedTotalSize();
+        return sequence->generateUserFriendlySequencePattern().c_str();
     }
     *sequenceSize = 0;
     return filename;
@@ -789,11 +824,9 @@ QString SequenceDialogProxyModel::getUserFriendlyFileSequencePatternForFile(cons
 
 
 void SequenceDialogProxyModel::getSequenceFromFilesForFole(const QString& file,SequenceParsing::SequenceFromFiles* sequence) const {
-    for (U32 i = 0; i < _frameSequences.size(); ++i) {
-        if (_frameSequences[i]->contains(file.toStdString())) {
-            *sequence = *_frameSequences[i];
-            break;
-        }
+    boost::shared_ptr<SequenceParsing::SequenceFromFiles> found = findSequence(_scannedSequences, _frameSequences, file.toStdString());
+    if (found) {
+        *sequence = *found;
     }
 }
 
@@ -818,35 +851,28 @@ void SequenceDialogProxyModel::setFilter(const QString& filter)
 }
 
 void SequenceFileDialog::itemsToSequence(const QModelIndex& parent){
-    _nameMapping.clear();
     if(!sequenceModeEnabled()){
+        QWriteLocker locker(&_nameMappingMutex);
+        _nameMapping.clear();
         return;
     }
   
+    ///the rows of the model are unique files: no need to check for duplicates
+    NameMapping nameMapping;
     int rowCount = _model->rowCount(parent);
-    //QModelIndex proxyIndex = _proxy->mapFromSource(parent);
-    //int rowCount = _proxy->rowCount(proxyIndex);
     for(int c = 0 ; c < rowCount ; ++c) {
         QModelIndex item = _model->index(c,0,parent);
-        //QModelIndex item = _proxy->index(c, 0,proxyIndex);
-        /*We skip directories*/
-        QString name = item.data(QFileSystemModel::FilePathRole).toString();
-
-        if (!item.isValid() || _model->isDir(item)) {
+        /*We skip directories and the files hidden by the proxy: only the first file of a sequence is displayed*/
+        if (!item.isValid() || _model->isDir(item) || !_proxy->mapFromSource(item).isValid()) {
             continue;
         }
+        QString name = item.data(QFileSystemModel::FilePathRole).toString();
         quint64 sequenceSize;
         QString mappedName = _proxy->getUserFriendlyFileSequencePatternForFile(name,&sequenceSize);
-        {
-            QWriteLocker locker(&_nameMappingMutex);
-            NameMapping::const_iterator it = std::find_if(_nameMapping.begin(), _nameMapping.end(), NameMappingCompareFirst(name));
-            if (it == _nameMapping.end()) {
-                _nameMapping.push_back(make_pair(name,make_pair(sequenceSize,mappedName)));
-            }
-        }
-
+        nameMapping.push_back(make_pair(name,make_pair(sequenceSize,mappedName)));
     }
-    QReadLocker locker(&_nameMappingMutex);
+    QWriteLocker locker(&_nameMappingMutex);
+    _nameMapping.swap(nameMapping);
     _view->updateNameMapping(_nameMapping);
 }
 void SequenceFileDialog::setRootIndex(const QModelIndex& index){
@@ -917,6 +943,11 @@ void SequenceDialogView::updateNameMapping(const std::vector<std::pair<QString,
     dynamic_cast<SequenceItemDelegate*>(itemDelegate())->setNameMapping(nameMapping);
 }
 
+void SequenceDialogView::addToNameMapping(const std::vector<std::pair<QString, std::pair<qint64, QString> > >& nameMapping){
+    dynamic_cast<SequenceItemDelegate*>(itemDelegate())->addToNameMapping(nameMapping);
+    viewport()->update();
+}
+
 
 SequenceItemDelegate::SequenceItemDelegate(SequenceFileDialog* fd) : QStyledItemDelegate(),_maxW(200),_fd(fd){}
 
@@ -927,9 +958,10 @@ void SequenceItemDelegate::setNameMapping(const std::vector<std::pair<QString, s
     {
         QWriteLocker locker(&_nameMappingMutex);
         _nameMapping.clear();
+        _nameMapping.reserve(nameMapping.size());
         for(unsigned int i = 0 ; i < nameMapping.size() ; ++i) {
             const SequenceFileDialog::NameMappingElement& p = nameMapping[i];
-            _nameMapping.push_back(p);
+            _nameMapping.insert(p.first.mid(p.first.lastIndexOf(QChar('/')) + 1), p.second);
             int w = metric.width(p.second.second);
             if(w > _maxW) _maxW = w;
         }
@@ -937,6 +969,18 @@ void SequenceItemDelegate::setNameMapping(const std::vector<std::pair<QString, s
 
 }
 
+void SequenceItemDelegate::addToNameMapping(const std::vector<std::pair<QString, std::pair<qint64, QString> > >& nameMapping) {
+    QFont f(NATRON_FONT_ALT, NATRON_FONT_SIZE_6);
+    QFontMetrics metric(f);
+    QWriteLocker locker(&_nameMappingMutex);
+    for(unsigned int i = 0 ; i < nameMapping.size() ; ++i) {
+        const SequenceFileDialog::NameMappingElement& p = nameMapping[i];
+        _nameMapping.insert(p.first.mid(p.first.lastIndexOf(QChar('/')) + 1), p.second);
+        int w = metric.width(p.second.second);
+        if(w > _maxW) _maxW = w;
+    }
+}
+
 
 
 void SequenceItemDelegate::paint(QPainter * painter, const QStyleOptionViewItem &option, const QModelIndex & index) const {
@@ -962,11 +1006,11 @@ void SequenceItemDelegate::paint(QPainter * painter, const QStyleOptionViewItem
     std::pair<qint64,QString> found_item;
     {
         QReadLocker locker(&_nameMappingMutex);
-        SequenceFileDialog::NameMapping::const_iterator it = std::find_if(_nameMapping.begin(), _nameMapping.end(), NameMappingCompareFirstNoPath(str));
+        QHash<QString,std::pair<qint64,QString> >::const_iterator it = _nameMapping.find(str);
         if (it == _nameMapping.end()) { // probably a directory or a single image file
             return QStyledItemDelegate::paint(painter,option,index);
         }
-        found_item = it->second;
+        found_item = it.value();
     }
     // get the proper subrect from the style
     QStyle *style = QApplication::style();
@@ -38,6 +38,7 @@ CLANG_DIAG_OFF(uninitialized)
 #include <QtCore/QUrl>
 #include <QtCore/QRegExp>
 #include <QtCore/QLatin1Char>
+#include <QtCore/QHash>
 #include <QComboBox>
 #include <QListView>
 CLANG_DIAG_ON(deprecated)
@@ -45,6 +46,7 @@ CLANG_DIAG_ON(uninitialized)
 
 #include "Global/Macros.h"
 #include "Global/QtCompat.h"
+#include "Engine/SequenceScanner.h"
 
 class LineEdit;
 class Button;
@@ -173,6 +175,9 @@ public:
     
     void updateNameMapping(const std::vector<std::pair<QString,std::pair<qint64,QString> > >& nameMapping);
 
+    ///Adds the given names to the current ones, replacing those of the same files
+    void addToNameMapping(const std::vector<std::pair<QString,std::pair<qint64,QString> > >& nameMapping);
+
     void expandColumnsToFullWidth(int w);
     
     void dropEvent(QDropEvent* event);
@@ -193,17 +198,20 @@ public:
  * @brief The SequenceDialogProxyModel class is a proxy that filters image sequences from the QFileSystemModel
  */
 class SequenceDialogProxyModel: public QSortFilterProxyModel{
-    /*multimap of <sequence name, FileSequence >
+    /*The sequences built from the files filtered so far.
      *Several sequences can have a same name but a different file extension within a same directory.
      */
-    mutable QMutex _frameSequencesMutex; // protects _frameSequences
-    mutable std::vector< boost::shared_ptr<SequenceParsing::SequenceFromFiles> > _frameSequences;
+    mutable Natron::SequenceIndex _frameSequences;
+    /*The complete index of the current directory made by the SequenceScanner, if it is available.
+     *It has priority over _frameSequences.
+     */
+    boost::shared_ptr<const Natron::SequenceIndex> _scannedSequences;
     SequenceFileDialog* _fd;
     QString _filter;
     std::list<QRegExp> _regexps;
 public:
 
-    explicit SequenceDialogProxyModel(SequenceFileDialog* fd) : QSortFilterProxyModel(),_fd(fd){}
+    explicit SequenceDialogProxyModel(SequenceFileDialog* fd) : QSortFilterProxyModel(),_frameSequences(),_scannedSequences(),_fd(fd){}
 
     virtual ~SequenceDialogProxyModel(){
         clear();
@@ -213,7 +221,10 @@ public:
         
     void getSequenceFromFilesForFole(const QString& file,SequenceParsing::SequenceFromFiles* sequence) const;
 
-    void clear(){_frameSequences.clear();}
+    void clear(){_frameSequences.clear(); _scannedSequences.reset();}
+
+    ///Sets the index of the current directory. Call invalidate() afterwards to filter the files again.
+    void setScannedSequences(const boost::shared_ptr<const Natron::SequenceIndex>& index) {_scannedSequences = index;}
     
     
     void setFilter(const QString& filter);
@@ -370,6 +381,12 @@ public slots:
     
     ///slot called when a directory has been fully loaded, it will refresh the view with good names.
     void fetchSequencesAndRefreshView(const QString& currentDirectory);
+
+    ///slot called while the sequence scanner lists a directory, it renames the sequences found or extended since the last call.
+    void onSequenceScanProgress(const QString& directory,int filesCount);
+
+    ///slot called when the sequence scanner indexed a directory, it filters the view again with the complete index.
+    void onSequenceScanFinished(const QString& directory);
     
     ////////
     ///////// Buttons slots
@@ -517,6 +534,8 @@ private:
     QAction* _newFolderAction;
 
     FileDialogMode _dialogMode;
+
+    Natron::SequenceScanner* _scanner;
 };
 
 /**
@@ -527,13 +546,15 @@ class SequenceItemDelegate : public QStyledItemDelegate {
 
     int _maxW;
     mutable QReadWriteLock _nameMappingMutex; // protects _nameMapping
-    SequenceFileDialog::NameMapping _nameMapping;
+    QHash<QString,std::pair<qint64,QString> > _nameMapping; // indexed by file name without path
     SequenceFileDialog* _fd;
 public:
     explicit SequenceItemDelegate(SequenceFileDialog* fd);
 
     void setNameMapping(const SequenceFileDialog::NameMapping& nameMapping);
 
+    void addToNameMapping(const SequenceFileDialog::NameMapping& nameMapping);
+
 private:
     virtual void paint(QPainter * painter, const QStyleOptionViewItem & option, const QModelIndex & index) const;
     virtual QSize sizeHint(const QStyleOptionViewItem & option, const QModelIndex & index) const ;
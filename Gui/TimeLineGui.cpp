@@ -60,25 +60,6 @@ struct ZoomContext {
     double lastOrthoLeft, lastOrthoBottom, lastOrthoRight, lastOrthoTop; //< remembers the last values passed to the glOrtho call
 };
 
-struct CachedFrame {
-    SequenceTime time;
-    StorageMode mode;
-    
-    CachedFrame(SequenceTime t,StorageMode m)
-    : time(t)
-    , mode(m)
-    {
-        
-    }
-};
-    
-struct CachedFrame_compare_time {
-    bool operator() (const CachedFrame& lhs, const CachedFrame& rhs) const {
-        return lhs.time < rhs.time;
-    }
-};
-    
-typedef std::set<CachedFrame,CachedFrame_compare_time> CachedFrames;
 }
 
 struct TimelineGuiPrivate{
@@ -104,7 +85,8 @@ struct TimelineGuiPrivate{
     QFont _font;
     bool _firstPaint;
     
-    CachedFrames cachedFrames;
+    FrameRangeSet ramCachedFrames; //< frames of the viewer cache in RAM
+    FrameRangeSet diskCachedFrames; //< frames of the viewer cache on disk
 
     TimelineGuiPrivate(boost::shared_ptr<TimeLine> timeline,Gui* gui):
         _timeline(timeline)
@@ -125,7 +107,8 @@ struct TimelineGuiPrivate{
       , _scaleColor(100,100,100)
       , _font(NATRON_FONT_ALT, NATRON_FONT_SIZE_10)
       , _firstPaint(true)
-      , cachedFrames()
+      , ramCachedFrames()
+      , diskCachedFrames()
     {}
 
 
@@ -432,17 +415,20 @@ void TimeLineGui::paintGL()
     glLineWidth(2);
     glCheckError();
     glBegin(GL_LINES);
-    for(CachedFrames::const_iterator i = _imp->cachedFrames.begin();i!= _imp->cachedFrames.end();++i) {
-        if (i->mode == RAM) {
-            glColor4f(_imp->_cachedLineColor.redF(),_imp->_cachedLineColor.greenF(),
-                      _imp->_cachedLineColor.blueF(),_imp->_cachedLineColor.alphaF());
-        } else if (i->mode == DISK) {
-            glColor4f(_imp->_diskCachedLineColor.redF(),_imp->_diskCachedLineColor.greenF(),
-                      _imp->_diskCachedLineColor.blueF(),_imp->_diskCachedLineColor.alphaF());
-
-        }
-        glVertex2f(i->time - 0.5,lineYpos);
-        glVertex2f(i->time + 0.5,lineYpos);
+    ///one line per range of consecutive cached frames
+    glColor4f(_imp->_cachedLineColor.redF(),_imp->_cachedLineColor.greenF(),
+              _imp->_cachedLineColor.blueF(),_imp->_cachedLineColor.alphaF());
+    const FrameRangeSet::Ranges& ramRanges = _imp->ramCachedFrames.getRanges();
+    for (FrameRangeSet::Ranges::const_iterator i = ramRanges.begin(); i != ramRanges.end(); ++i) {
+        glVertex2f(i->first - 0.5,lineYpos);
+        glVertex2f(i->second + 0.5,lineYpos);
+    }
+    glColor4f(_imp->_diskCachedLineColor.redF(),_imp->_diskCachedLineColor.greenF(),
+              _imp->_diskCachedLineColor.blueF(),_imp->_diskCachedLineColor.alphaF());
+    const FrameRangeSet::Ranges& diskRanges = _imp->diskCachedFrames.getRanges();
+    for (FrameRangeSet::Ranges::const_iterator i = diskRanges.begin(); i != diskRanges.end(); ++i) {
+        glVertex2f(i->first - 0.5,lineYpos);
+        glVertex2f(i->second + 0.5,lineYpos);
     }
     glEnd();
     
@@ -692,10 +678,8 @@ void TimeLineGui::connectSlotsToViewerCache()
     assert(qApp && qApp->thread() == QThread::currentThread());
     
     Natron::CacheSignalEmitter* emitter = appPTR->getOrActivateViewerCacheSignalEmitter();
-    QObject::connect(emitter, SIGNAL(addedEntry(SequenceTime)), this, SLOT(onCachedFrameAdded(SequenceTime)));
-    QObject::connect(emitter, SIGNAL(removedEntry(SequenceTime,int)), this, SLOT(onCachedFrameRemoved(SequenceTime,int)));
-    QObject::connect(emitter, SIGNAL(entryStorageChanged(SequenceTime,int,int)), this,
-                     SLOT(onCachedFrameStorageChanged(SequenceTime,int,int)));
+    QObject::connect(emitter, SIGNAL(entriesChanged(Natron::CacheEntriesChanges)), this,
+                     SLOT(onCachedFramesChanged(Natron::CacheEntriesChanges)));
     QObject::connect(emitter, SIGNAL(clearedDiskPortion()), this, SLOT(onDiskCacheCleared()));
     QObject::connect(emitter, SIGNAL(clearedInMemoryPortion()), this, SLOT(onMemoryCacheCleared()));
 }
@@ -706,66 +690,39 @@ void TimeLineGui::disconnectSlotsFromViewerCache()
     assert(qApp && qApp->thread() == QThread::currentThread());
     
     Natron::CacheSignalEmitter* emitter = appPTR->getOrActivateViewerCacheSignalEmitter();
-    QObject::disconnect(emitter, SIGNAL(addedEntry(SequenceTime)), this, SLOT(onCachedFrameAdded(SequenceTime)));
-    QObject::disconnect(emitter, SIGNAL(removedEntry(SequenceTime,int)), this, SLOT(onCachedFrameRemoved(SequenceTime,int)));
-    QObject::disconnect(emitter, SIGNAL(entryStorageChanged(SequenceTime,int,int)), this,
-                        SLOT(onCachedFrameStorageChanged(SequenceTime,int,int)));
+    QObject::disconnect(emitter, SIGNAL(entriesChanged(Natron::CacheEntriesChanges)), this,
+                        SLOT(onCachedFramesChanged(Natron::CacheEntriesChanges)));
     QObject::disconnect(emitter, SIGNAL(clearedDiskPortion()), this, SLOT(onDiskCacheCleared()));
     QObject::disconnect(emitter, SIGNAL(clearedInMemoryPortion()), this, SLOT(onMemoryCacheCleared()));}
 
-void TimeLineGui::onCachedFrameAdded(SequenceTime time)
-{
-    _imp->cachedFrames.insert(CachedFrame(time,RAM));
-}
-
-void TimeLineGui::onCachedFrameRemoved(SequenceTime time,int /*storage*/)
+void TimeLineGui::onCachedFramesChanged(const Natron::CacheEntriesChanges& changes)
 {
-    for (CachedFrames::iterator it = _imp->cachedFrames.begin();it!=_imp->cachedFrames.end();++it) {
-        if (it->time == time) {
-            _imp->cachedFrames.erase(it);
-            break;
-        }
-    }
+    _imp->ramCachedFrames.subtract(changes.removed);
+    _imp->diskCachedFrames.subtract(changes.removed);
+    
+    _imp->diskCachedFrames.subtract(changes.inRAM);
+    _imp->ramCachedFrames.merge(changes.inRAM);
+    
+    _imp->ramCachedFrames.subtract(changes.onDisk);
+    _imp->diskCachedFrames.merge(changes.onDisk);
     update();
 }
 
-void TimeLineGui::onCachedFrameStorageChanged(SequenceTime time,int /*oldStorage*/,int newStorage)
-{
-    for (CachedFrames::iterator it = _imp->cachedFrames.begin();it!=_imp->cachedFrames.end();++it) {
-        if (it->time == time) {
-            _imp->cachedFrames.erase(it);
-            _imp->cachedFrames.insert(CachedFrame(time,(StorageMode)newStorage));
-            break;
-        }
-    }
-}
-
 void TimeLineGui::onMemoryCacheCleared()
 {
-    CachedFrames copy;
-    for (CachedFrames::iterator it = _imp->cachedFrames.begin();it!=_imp->cachedFrames.end();++it) {
-        if (it->mode == DISK) {
-            copy.insert(*it);
-        }
-    }
-    _imp->cachedFrames = copy;
+    _imp->ramCachedFrames.clear();
     update();
 }
 
 void TimeLineGui::onDiskCacheCleared()
 {
-    CachedFrames copy;
-    for (CachedFrames::iterator it = _imp->cachedFrames.begin();it!=_imp->cachedFrames.end();++it) {
-        if (it->mode == RAM) {
-            copy.insert(*it);
-        }
-    }
-    _imp->cachedFrames = copy;
+    _imp->diskCachedFrames.clear();
     update();
 }
 
 void TimeLineGui::clearCachedFrames()
 {
-    _imp->cachedFrames.clear();
+    _imp->ramCachedFrames.clear();
+    _imp->diskCachedFrames.clear();
     update();
 }
@@ -32,6 +32,9 @@ class Gui;
 class ViewerTab;
 class QMouseEvent;
 class TimeLine;
+namespace Natron {
+struct CacheEntriesChanges;
+}
 struct TimelineGuiPrivate;
 
 class TimeLineGui : public QGLWidget {
@@ -96,9 +99,7 @@ public slots:
     void onFrameRangeChanged(SequenceTime first, SequenceTime last);
     void onBoundariesChanged(SequenceTime, SequenceTime, int);
     
-    void onCachedFrameAdded(SequenceTime time);
-    void onCachedFrameRemoved(SequenceTime time,int storage);
-    void onCachedFrameStorageChanged(SequenceTime time,int oldStorage,int newStorage);
+    void onCachedFramesChanged(const Natron::CacheEntriesChanges& changes);
     void onMemoryCacheCleared();
     void onDiskCacheCleared();
 
@@ -14,6 +14,7 @@ SUBDIRS += \
     Gui \
     Renderer \
     Tests \
+    Benchmarks \
     App
 
 OTHER_FILES += \
@@ -0,0 +1,69 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <gtest/gtest.h>
+#include "Engine/ActionsCache.h"
+
+using namespace Natron;
+
+TEST(ActionsCache,ResultsAreKeyedByArguments) {
+    ActionsCache cache;
+    RenderScale scale;
+    scale.x = scale.y = 1.;
+    RenderScale halfScale;
+    halfScale.x = halfScale.y = 0.5;
+
+    RectI rod;
+    EXPECT_FALSE(cache.getRoDResult(1, 10, scale, 0, &rod));
+    cache.setRoDResult(1, 10, scale, 0, RectI(0,0,1920,1080));
+    ASSERT_TRUE(cache.getRoDResult(1, 10, scale, 0, &rod));
+    EXPECT_EQ(RectI(0,0,1920,1080), rod);
+    EXPECT_FALSE(cache.getRoDResult(1, 11, scale, 0, &rod));
+    EXPECT_FALSE(cache.getRoDResult(1, 10, halfScale, 0, &rod));
+    EXPECT_FALSE(cache.getRoDResult(1, 10, scale, 1, &rod));
+    EXPECT_FALSE(cache.getRoDResult(2, 10, scale, 0, &rod));
+
+    bool isIdentity;
+    SequenceTime inputTime;
+    int inputNb;
+    cache.setIdentityResult(1, 10, scale, RectI(0,0,100,100), 0, true, 9, 0);
+    EXPECT_FALSE(cache.getIdentityResult(1, 10, scale, RectI(0,0,100,101), 0, &isIdentity, &inputTime, &inputNb));
+    ASSERT_TRUE(cache.getIdentityResult(1, 10, scale, RectI(0,0,100,100), 0, &isIdentity, &inputTime, &inputNb));
+    EXPECT_TRUE(isIdentity);
+    EXPECT_EQ(9, inputTime);
+    EXPECT_EQ(0, inputNb);
+
+    ActionsCache::FramesNeededMap frames;
+    frames[0].push_back(RangeD());
+    frames[0][0].min = 9;
+    frames[0][0].max = 11;
+    cache.setFramesNeededResult(1, 10, frames);
+    ActionsCache::FramesNeededMap cachedFrames;
+    ASSERT_TRUE(cache.getFramesNeededResult(1, 10, &cachedFrames));
+    ASSERT_EQ((std::size_t)1, cachedFrames[0].size());
+    EXPECT_EQ(11, cachedFrames[0][0].max);
+
+    cache.clear();
+    EXPECT_FALSE(cache.getRoDResult(1, 10, scale, 0, &rod));
+}
+
+TEST(ActionsCache,OldHashesAreForgotten) {
+    ActionsCache cache(2);
+    RenderScale scale;
+    scale.x = scale.y = 1.;
+    RectI rod;
+
+    cache.setRoDResult(1, 0, scale, 0, RectI(0,0,1,1));
+    cache.setRoDResult(2, 0, scale, 0, RectI(0,0,2,2));
+    ///using the first hash makes it the most recent one
+    EXPECT_TRUE(cache.getRoDResult(1, 0, scale, 0, &rod));
+    cache.setRoDResult(3, 0, scale, 0, RectI(0,0,3,3));
+
+    EXPECT_TRUE(cache.getRoDResult(1, 0, scale, 0, &rod));
+    EXPECT_FALSE(cache.getRoDResult(2, 0, scale, 0, &rod));
+    ASSERT_TRUE(cache.getRoDResult(3, 0, scale, 0, &rod));
+    EXPECT_EQ(RectI(0,0,3,3), rod);
+}
@@ -0,0 +1,90 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <gtest/gtest.h>
+#include "Engine/CompressedBuffer.h"
+
+using namespace Natron;
+
+TEST(CompressedBuffer,RoundTripBGRA) {
+    ///a 8-bit BGRA gradient spanning several slices, with a partial last slice
+    const int width = 1000;
+    const int height = 300;
+    std::vector<unsigned char> src(width * height * 4);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            unsigned char* pix = &src[(y * width + x) * 4];
+            pix[0] = (unsigned char)(x / 4);
+            pix[1] = (unsigned char)(y / 2);
+            pix[2] = (unsigned char)((x + y) / 8);
+            pix[3] = 255;
+        }
+    }
+    CompressedBuffer compressed;
+    ASSERT_TRUE(compressed.compress(&src[0], src.size(), 4));
+    EXPECT_EQ(src.size(), compressed.getUncompressedSize());
+    EXPECT_LT(compressed.getCompressedSize(), src.size() / 2);
+
+    std::vector<unsigned char> dst(src.size());
+    ASSERT_TRUE(compressed.decompress(&dst[0]));
+    EXPECT_TRUE(std::memcmp(&src[0], &dst[0], src.size()) == 0);
+}
+
+TEST(CompressedBuffer,RoundTripFloat) {
+    ///32-bit float RGBA with some noise: the delta filter works on 16 bytes pixels
+    const int count = 100000;
+    std::vector<float> src(count * 4);
+    std::srand(1);
+    for (int i = 0; i < count; ++i) {
+        src[i * 4] = i / (float)count;
+        src[i * 4 + 1] = (std::rand() % 16) / 256.f;
+        src[i * 4 + 2] = 0.5f;
+        src[i * 4 + 3] = 1.f;
+    }
+    std::size_t size = src.size() * sizeof(float);
+    CompressedBuffer compressed;
+    ASSERT_TRUE(compressed.compress((const unsigned char*)&src[0], size, 16));
+
+    std::vector<float> dst(src.size());
+    ASSERT_TRUE(compressed.decompress((unsigned char*)&dst[0]));
+    EXPECT_TRUE(std::memcmp(&src[0], &dst[0], size) == 0);
+}
+
+TEST(CompressedBuffer,IncompressibleDataIsRejected) {
+    std::vector<unsigned char> src(300 * 1024);
+    std::srand(2);
+    for (std::size_t i = 0; i < src.size(); ++i) {
+        src[i] = (unsigned char)(std::rand() >> 4);
+    }
+    CompressedBuffer compressed;
+    EXPECT_FALSE(compressed.compress(&src[0], src.size(), 4, 0.8));
+    EXPECT_TRUE(compressed.isEmpty());
+
+    ///when allowed to grow, random data is still decoded exactly
+    ASSERT_TRUE(compressed.compress(&src[0], src.size(), 4, 2.));
+    std::vector<unsigned char> dst(src.size());
+    ASSERT_TRUE(compressed.decompress(&dst[0]));
+    EXPECT_TRUE(std::memcmp(&src[0], &dst[0], src.size()) == 0);
+}
+
+TEST(CompressedBuffer,CorruptedSliceIsDetected) {
+    std::vector<unsigned char> src(4096, 7);
+    std::vector<unsigned char> slice(CompressedBuffer::compressBound(src.size()));
+    std::size_t compressedSize = CompressedBuffer::compressSlice(&src[0], src.size(), 4, &slice[0]);
+    ASSERT_GT(compressedSize, 0u);
+
+    std::vector<unsigned char> dst(src.size());
+    ASSERT_TRUE(CompressedBuffer::decompressSlice(&slice[0], compressedSize, 4, &dst[0], dst.size()));
+    EXPECT_TRUE(dst == src);
+
+    ///truncated input
+    EXPECT_FALSE(CompressedBuffer::decompressSlice(&slice[0], compressedSize - 1, 4, &dst[0], dst.size()));
+    ///wrong output size
+    EXPECT_FALSE(CompressedBuffer::decompressSlice(&slice[0], compressedSize, 4, &dst[0], dst.size() - 1));
+}
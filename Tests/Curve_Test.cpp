@@ -4,6 +4,8 @@
  * License, v. 2.0. If a copy of the MPL was not distributed with this
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 
+#include <stdexcept>
+#include <vector>
 #include <gtest/gtest.h>
 
 #include <QString>
@@ -101,3 +103,68 @@ TEST(Curve,Basic)
 }
 
 
+
+TEST(Curve,GetValuesAt)
+{
+    Curve c;
+    Natron::KeyframeType interps[] = { Natron::KEYFRAME_SMOOTH, Natron::KEYFRAME_LINEAR, Natron::KEYFRAME_CONSTANT, Natron::KEYFRAME_CUBIC };
+    for (int i = 0; i < 20; ++i) {
+        EXPECT_TRUE(c.addKeyFrame(KeyFrame(i * 5.,(i % 3) * 10. - i,0.,0.,interps[i % 4])));
+    }
+
+    ///sample before the first keyframe, on keyframes, between them and after the last one
+    std::vector<double> times;
+    for (double t = -20.; t <= 120.; t += 0.25) {
+        times.push_back(t);
+    }
+    std::vector<double> values;
+    c.getValuesAt(times, &values);
+    ASSERT_EQ(times.size(), values.size());
+    for (U32 i = 0; i < times.size(); ++i) {
+        EXPECT_DOUBLE_EQ(c.getValueAt(times[i]), values[i]) << "time " << times[i];
+    }
+
+    ///the segments must follow the keyframes
+    c.removeKeyFrameWithTime(50.);
+    c.getValuesAt(times, &values);
+    for (U32 i = 0; i < times.size(); ++i) {
+        EXPECT_DOUBLE_EQ(c.getValueAt(times[i]), values[i]) << "time " << times[i];
+    }
+
+    c.clearKeyFrames();
+    EXPECT_THROW(c.getValuesAt(times, &values), std::runtime_error);
+}
+
+TEST(Curve,Table)
+{
+    Curve c;
+    ///no bounded range: no table
+    EXPECT_TRUE(c.addKeyFrame(KeyFrame(0.,0.)));
+    EXPECT_FALSE(c.getTable());
+
+    c.setXRange(0., 1.);
+    EXPECT_TRUE(c.addKeyFrame(KeyFrame(0.3,0.8)));
+    EXPECT_TRUE(c.addKeyFrame(KeyFrame(1.,0.5)));
+    boost::shared_ptr<const CurveTable> table = c.getTable();
+    ASSERT_TRUE(table);
+    EXPECT_EQ(table, c.getTable()) << "the table must be kept until the curve changes";
+    for (double x = 0.; x <= 1.; x += 1. / 1000.) {
+        double v;
+        ASSERT_TRUE(table->getValueAt(x, &v));
+        EXPECT_NEAR(c.getValueAt(x), v, 1e-4) << "x " << x;
+    }
+    double v;
+    EXPECT_FALSE(table->getValueAt(1.5, &v));
+
+    ///a change rebuilds the table
+    EXPECT_TRUE(c.addKeyFrame(KeyFrame(0.6,0.1)));
+    boost::shared_ptr<const CurveTable> newTable = c.getTable();
+    ASSERT_TRUE(newTable);
+    EXPECT_NE(table, newTable);
+    ASSERT_TRUE(newTable->getValueAt(0.6, &v));
+    EXPECT_NEAR(0.1, v, 1e-4);
+
+    ///steps are not tabulated
+    c.setCurveInterpolation(Natron::KEYFRAME_CONSTANT);
+    EXPECT_FALSE(c.getTable());
+}
@@ -0,0 +1,194 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <QtCore/QMutex>
+#include <QtCore/QThread>
+
+#include <boost/bind.hpp>
+
+#include "Engine/FramePrefetcher.h"
+
+using namespace Natron;
+
+namespace {
+
+///QThread::msleep is protected in Qt 4
+class Sleeper
+    : public QThread
+{
+public:
+
+    static void sleepMs(unsigned long ms)
+    {
+        QThread::msleep(ms);
+    }
+};
+
+class NamedFrame
+    : public PrefetchedFrame
+{
+public:
+
+    explicit NamedFrame(const std::string& name_)
+    : name(name_)
+    {
+    }
+
+    virtual std::size_t getSize() const OVERRIDE FINAL
+    {
+        return 1024;
+    }
+
+    std::string name;
+};
+
+struct FakeDecoder
+{
+    QMutex lock;
+    std::map<std::string,int> decodeCount;
+    unsigned long decodeMs;
+};
+
+boost::shared_ptr<PrefetchedFrame>
+decode(FakeDecoder* decoder,const std::string& filename)
+{
+    Sleeper::sleepMs(decoder->decodeMs);
+    QMutexLocker l(&decoder->lock);
+    ++decoder->decodeCount[filename];
+    if (filename == "missing") {
+        return boost::shared_ptr<PrefetchedFrame>();
+    }
+    if (filename == "corrupted") {
+        throw std::runtime_error("corrupted file");
+    }
+    return boost::shared_ptr<PrefetchedFrame>(new NamedFrame(filename));
+}
+
+void
+waitForDecodedFrames(const FramePrefetcher& prefetcher,U64 count)
+{
+    for (int i = 0; i < 200 && prefetcher.getStats().decodedFrames < count; ++i) {
+        Sleeper::sleepMs(5);
+    }
+}
+
+std::string
+getName(const boost::shared_ptr<PrefetchedFrame>& frame)
+{
+    NamedFrame* named = dynamic_cast<NamedFrame*>(frame.get());
+    return named ? named->name : std::string();
+}
+} // anon namespace
+
+TEST(FramePrefetcher,PrefetchedFramesAreNotDecodedAgain) {
+    FakeDecoder decoder;
+    decoder.decodeMs = 1;
+    FramePrefetcher prefetcher(boost::bind(&decode, &decoder, _1), 2);
+
+    std::vector<std::string> files;
+    files.push_back("a");
+    files.push_back("b");
+    files.push_back("c");
+    prefetcher.prefetch(files);
+    waitForDecodedFrames(prefetcher, 3);
+
+    EXPECT_EQ(std::string("a"), getName(prefetcher.getFrame("a")));
+    EXPECT_EQ(std::string("c"), getName(prefetcher.getFrame("c")));
+    EXPECT_EQ(std::string("d"), getName(prefetcher.getFrame("d")));
+    ///prefetching decoded files does nothing
+    prefetcher.prefetch(files);
+    EXPECT_EQ(std::string("b"), getName(prefetcher.getFrame("b")));
+
+    FramePrefetcherStats stats = prefetcher.getStats();
+    EXPECT_EQ((U64)3, stats.hits);
+    EXPECT_EQ((U64)1, stats.misses);
+    EXPECT_EQ((U64)4, stats.decodedFrames);
+    EXPECT_EQ(1, decoder.decodeCount["a"]);
+    EXPECT_EQ(1, decoder.decodeCount["b"]);
+}
+
+TEST(FramePrefetcher,RequestsWaitForFramesBeingDecoded) {
+    FakeDecoder decoder;
+    decoder.decodeMs = 50;
+    FramePrefetcher prefetcher(boost::bind(&decode, &decoder, _1), 1);
+
+    prefetcher.prefetch(std::vector<std::string>(1, "a"));
+    Sleeper::sleepMs(10);
+    EXPECT_EQ(std::string("a"), getName(prefetcher.getFrame("a")));
+    EXPECT_EQ((U64)1, prefetcher.getStats().waits);
+    EXPECT_EQ(1, decoder.decodeCount["a"]);
+}
+
+TEST(FramePrefetcher,FailuresAndClear) {
+    FakeDecoder decoder;
+    decoder.decodeMs = 1;
+    FramePrefetcher prefetcher(boost::bind(&decode, &decoder, _1), 1);
+
+    EXPECT_FALSE(prefetcher.getFrame("missing"));
+    ///the failures are not kept: the file may have been fixed meanwhile
+    EXPECT_FALSE(prefetcher.getFrame("missing"));
+    EXPECT_EQ(2, decoder.decodeCount["missing"]);
+    EXPECT_EQ((U64)0, prefetcher.getStats().decodedMemory);
+    EXPECT_FALSE(prefetcher.getFrame("corrupted"));
+
+    EXPECT_TRUE(prefetcher.getFrame("a"));
+    prefetcher.clear();
+    EXPECT_TRUE(prefetcher.getFrame("a"));
+    EXPECT_EQ(2, decoder.decodeCount["a"]);
+}
+
+TEST(FramePrefetcher,PrefetchCountAdaptsToTheDecodingTime) {
+    FakeDecoder decoder;
+    decoder.decodeMs = 30;
+    FramePrefetcher prefetcher(boost::bind(&decode, &decoder, _1), 4);
+    EXPECT_EQ(NATRON_FRAME_PREFETCHER_MIN_FRAMES, prefetcher.getPrefetchCount());
+
+    std::vector<std::string> files;
+    for (int i = 0; i < NATRON_FRAME_PREFETCHER_MAX_FRAMES; ++i) {
+        files.push_back(std::string(1, (char)('a' + i)));
+    }
+    prefetcher.prefetch(files);
+    waitForDecodedFrames(prefetcher, files.size());
+
+    ///the frames are requested much faster than they are decoded
+    for (U32 i = 0; i < files.size(); ++i) {
+        EXPECT_TRUE(prefetcher.getFrame(files[i]));
+        Sleeper::sleepMs(2);
+    }
+    EXPECT_EQ(NATRON_FRAME_PREFETCHER_MAX_FRAMES, prefetcher.getPrefetchCount());
+}
+
+TEST(FramePrefetcher,DecodedFramesFitInTheMaximumMemory) {
+    FakeDecoder decoder;
+    decoder.decodeMs = 1;
+    FramePrefetcher prefetcher(boost::bind(&decode, &decoder, _1), 1);
+    prefetcher.setMaximumMemory(3 * 1024);
+
+    EXPECT_TRUE(prefetcher.getFrame("a"));
+    EXPECT_TRUE(prefetcher.getFrame("b"));
+    EXPECT_TRUE(prefetcher.getFrame("c"));
+    EXPECT_TRUE(prefetcher.getFrame("d"));
+    EXPECT_EQ((U64)3 * 1024, prefetcher.getStats().decodedMemory);
+    ///besides the last requested frame, only 2 frames fit
+    EXPECT_EQ(2, prefetcher.getPrefetchCount());
+
+    ///a is the least recently requested frame, it was forgotten
+    EXPECT_TRUE(prefetcher.getFrame("b"));
+    EXPECT_TRUE(prefetcher.getFrame("a"));
+    EXPECT_EQ(2, decoder.decodeCount["a"]);
+    EXPECT_EQ(1, decoder.decodeCount["b"]);
+
+    prefetcher.setMaximumMemory(1024);
+    EXPECT_EQ((U64)1024, prefetcher.getStats().decodedMemory);
+    EXPECT_EQ(0, prefetcher.getPrefetchCount());
+}
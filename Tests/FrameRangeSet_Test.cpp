@@ -0,0 +1,89 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <cstdlib>
+#include <set>
+#include <gtest/gtest.h>
+#include "Engine/FrameRangeSet.h"
+
+using namespace Natron;
+
+TEST(FrameRangeSet,MergesConsecutiveFrames) {
+    FrameRangeSet s;
+    ASSERT_TRUE(s.isEmpty());
+
+    for (int i = 0; i < 10000; ++i) {
+        s.insert(i);
+    }
+    EXPECT_EQ(1, (int)s.getRanges().size()) << "Consecutive frames must be a single range";
+    EXPECT_EQ(10000, s.getFramesCount());
+
+    s.remove(5000);
+    ASSERT_EQ(2, (int)s.getRanges().size());
+    EXPECT_FALSE(s.contains(5000));
+    EXPECT_TRUE(s.contains(4999));
+    EXPECT_TRUE(s.contains(5001));
+
+    s.insert(5000);
+    EXPECT_EQ(1, (int)s.getRanges().size()) << "Filling a hole must merge the 2 ranges";
+
+    s.removeRange(0, 9999);
+    EXPECT_TRUE(s.isEmpty());
+}
+
+TEST(FrameRangeSet,MergeAndSubtract) {
+    FrameRangeSet a,b;
+    a.insertRange(0, 10);
+    a.insertRange(20, 30);
+    b.insertRange(5, 25);
+
+    FrameRangeSet merged = a;
+    merged.merge(b);
+    ASSERT_EQ(1, (int)merged.getRanges().size());
+    EXPECT_EQ(0, merged.getRanges().begin()->first);
+    EXPECT_EQ(30, merged.getRanges().begin()->second);
+
+    a.subtract(b);
+    ASSERT_EQ(2, (int)a.getRanges().size());
+    EXPECT_TRUE(a.contains(4));
+    EXPECT_FALSE(a.contains(5));
+    EXPECT_FALSE(a.contains(25));
+    EXPECT_TRUE(a.contains(26));
+    EXPECT_EQ(10, a.getFramesCount());
+}
+
+TEST(FrameRangeSet,MatchesStdSet) {
+    srand(2014);
+    FrameRangeSet s;
+    std::set<int> reference;
+    for (int k = 0; k < 2000; ++k) {
+        int first = rand() % 200 - 50;
+        int last = first + rand() % 15;
+        if (rand() % 2) {
+            s.insertRange(first, last);
+            for (int i = first; i <= last; ++i) {
+                reference.insert(i);
+            }
+        } else {
+            s.removeRange(first, last);
+            for (int i = first; i <= last; ++i) {
+                reference.erase(i);
+            }
+        }
+    }
+    EXPECT_EQ((int)reference.size(), s.getFramesCount());
+    for (int i = -60; i < 170; ++i) {
+        EXPECT_EQ(reference.count(i) > 0, s.contains(i)) << "frame " << i;
+    }
+
+    ///ranges are sorted, disjoint and never touch
+    int previousLast = -1000;
+    for (FrameRangeSet::Ranges::const_iterator it = s.getRanges().begin(); it != s.getRanges().end(); ++it) {
+        EXPECT_LE(it->first, it->second);
+        EXPECT_GT(it->first, previousLast + 1);
+        previousLast = it->second;
+    }
+}
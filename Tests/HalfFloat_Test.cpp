@@ -0,0 +1,74 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <gtest/gtest.h>
+#include "Engine/HalfFloat.h"
+
+using namespace Natron;
+
+TEST(HalfFloat,ExactValues) {
+    EXPECT_EQ(0x0000, HalfFloat::fromFloat(0.f));
+    EXPECT_EQ(0x8000, HalfFloat::fromFloat(-0.f));
+    EXPECT_EQ(0x3c00, HalfFloat::fromFloat(1.f));
+    EXPECT_EQ(0x3800, HalfFloat::fromFloat(0.5f));
+    EXPECT_EQ(0xc000, HalfFloat::fromFloat(-2.f));
+    EXPECT_EQ(0x7bff, HalfFloat::fromFloat(65504.f));
+    ///the smallest denormalized half
+    EXPECT_EQ(0x0001, HalfFloat::fromFloat(std::ldexp(1.f,-24)));
+
+    ///every half except NaNs survives a round trip through float
+    for (unsigned int bits = 0; bits < 0x10000; ++bits) {
+        if ((bits & 0x7c00) == 0x7c00 && (bits & 0x3ff) != 0) {
+            continue;
+        }
+        unsigned short h = (unsigned short)bits;
+        EXPECT_EQ(h, HalfFloat::fromFloat(HalfFloat::toFloat(h))) << "bits " << bits;
+    }
+}
+
+TEST(HalfFloat,SpecialValues) {
+    EXPECT_EQ(0x7c00, HalfFloat::fromFloat(std::numeric_limits<float>::infinity()));
+    EXPECT_EQ(0xfc00, HalfFloat::fromFloat(-std::numeric_limits<float>::infinity()));
+    ///overflow
+    EXPECT_EQ(0x7c00, HalfFloat::fromFloat(1e6f));
+    ///underflow
+    EXPECT_EQ(0x0000, HalfFloat::fromFloat(1e-10f));
+    float nan = HalfFloat::toFloat(HalfFloat::fromFloat(std::numeric_limits<float>::quiet_NaN()));
+    EXPECT_TRUE(nan != nan);
+    ///1 + 2^-11 is half way between 1 and the next half: rounds to the even one
+    EXPECT_EQ(0x3c00, HalfFloat::fromFloat(1.f + std::ldexp(1.f,-11)));
+    EXPECT_EQ(0x3c02, HalfFloat::fromFloat(1.f + 3 * std::ldexp(1.f,-11)));
+}
+
+TEST(HalfFloat,BulkConversionsMatchScalar) {
+    std::vector<float> src(1003);
+    for (std::size_t i = 0; i < src.size(); ++i) {
+        src[i] = ((float)i - 500.f) * 0.137f;
+    }
+    std::vector<unsigned short> halves(src.size());
+    HalfFloat::fromFloat(&src[0], &halves[0], src.size());
+    std::vector<float> back(src.size());
+    HalfFloat::toFloat(&halves[0], &back[0], src.size());
+    for (std::size_t i = 0; i < src.size(); ++i) {
+        EXPECT_EQ(HalfFloat::fromFloat(src[i]), halves[i]);
+        EXPECT_EQ(HalfFloat::toFloat(halves[i]), back[i]);
+        EXPECT_NEAR(src[i], back[i], std::fabs(src[i]) / 1024.f);
+    }
+}
+
+TEST(HalfFloat,PixelArithmetic) {
+    Half a = 0.25f;
+    Half b(0.5f);
+    EXPECT_EQ(0.75f, a + b);
+    a += 0.25f;
+    EXPECT_EQ(0.5f, (float)a);
+    Half c = (a + b) / 4.;
+    EXPECT_EQ(0.25f, (float)c);
+    EXPECT_EQ(0x3c00, Half::fromBits(0x3c00).bits());
+}
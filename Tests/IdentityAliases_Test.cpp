@@ -0,0 +1,96 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <gtest/gtest.h>
+#include "Engine/IdentityAliases.h"
+
+using namespace Natron;
+
+TEST(IdentityAliases,AliasesAreKeyedLikeImages) {
+    IdentityAliases aliases;
+    boost::shared_ptr<Node> node;
+    IdentityAliases::Target target;
+
+    EXPECT_FALSE(aliases.resolve(1, 10, 0, 0, &target));
+    aliases.setAlias(1, 10, 0, 0, node, 2, 9);
+    ASSERT_TRUE(aliases.resolve(1, 10, 0, 0, &target));
+    EXPECT_EQ((U64)2, target.hash);
+    EXPECT_EQ(9, target.time);
+    EXPECT_FALSE(aliases.resolve(1, 11, 0, 0, &target));
+    EXPECT_FALSE(aliases.resolve(1, 10, 1, 0, &target));
+    EXPECT_FALSE(aliases.resolve(1, 10, 0, 1, &target));
+    EXPECT_FALSE(aliases.resolve(2, 9, 0, 0, &target));
+
+    aliases.clear();
+    EXPECT_FALSE(aliases.resolve(1, 10, 0, 0, &target));
+}
+
+TEST(IdentityAliases,ChainsAreCompressed) {
+    IdentityAliases aliases;
+    boost::shared_ptr<Node> node;
+    IdentityAliases::Target target;
+
+    ///1 at 10 is 2 at 10, which is 3 at 8, which is 4 at 8
+    aliases.setAlias(1, 10, 0, 0, node, 2, 10);
+    aliases.setAlias(2, 10, 0, 0, node, 3, 8);
+    aliases.setAlias(3, 8, 0, 0, node, 4, 8);
+
+    ASSERT_TRUE(aliases.resolve(1, 10, 0, 0, &target));
+    EXPECT_EQ((U64)4, target.hash);
+    EXPECT_EQ(8, target.time);
+
+    ///once resolved the chain no longer depends on the intermediate aliases
+    aliases.removeAliasesWithHash(3);
+    ASSERT_TRUE(aliases.resolve(1, 10, 0, 0, &target));
+    EXPECT_EQ((U64)4, target.hash);
+    ASSERT_TRUE(aliases.resolve(2, 10, 0, 0, &target));
+    EXPECT_EQ((U64)4, target.hash);
+}
+
+TEST(IdentityAliases,RemovingAHashForgetsItsAliases) {
+    IdentityAliases aliases;
+    boost::shared_ptr<Node> node;
+    IdentityAliases::Target target;
+
+    aliases.setAlias(1, 0, 0, 0, node, 2, 0);
+    aliases.setAlias(3, 0, 0, 0, node, 4, 0);
+    aliases.setAlias(5, 0, 0, 0, node, 6, 0);
+    EXPECT_EQ((std::size_t)3, aliases.getAliasesCount());
+
+    aliases.removeAliasesWithHash(1);
+    aliases.removeAliasesWithHash(4);
+    EXPECT_FALSE(aliases.resolve(1, 0, 0, 0, &target));
+    EXPECT_FALSE(aliases.resolve(3, 0, 0, 0, &target));
+    EXPECT_TRUE(aliases.resolve(5, 0, 0, 0, &target));
+    EXPECT_EQ((std::size_t)1, aliases.getAliasesCount());
+}
+
+TEST(IdentityAliases,LoopsAreForgotten) {
+    IdentityAliases aliases;
+    boost::shared_ptr<Node> node;
+    IdentityAliases::Target target;
+
+    ///an effect identity of itself at 2 at time 1 and at 1 at time 2
+    aliases.setAlias(1, 1, 0, 0, node, 1, 2);
+    aliases.setAlias(1, 2, 0, 0, node, 1, 1);
+    aliases.setAlias(5, 0, 0, 0, node, 6, 0);
+
+    EXPECT_FALSE(aliases.resolve(1, 1, 0, 0, &target));
+    EXPECT_FALSE(aliases.resolve(1, 2, 0, 0, &target));
+    EXPECT_EQ((std::size_t)1, aliases.getAliasesCount());
+}
+
+TEST(IdentityAliases,StartsOverWhenFull) {
+    IdentityAliases aliases;
+    boost::shared_ptr<Node> node;
+
+    for (U64 i = 0; i < NATRON_IDENTITY_ALIASES_MAX_ENTRIES; ++i) {
+        aliases.setAlias(i, 0, 0, 0, node, i + 1, 0);
+    }
+    EXPECT_EQ((std::size_t)NATRON_IDENTITY_ALIASES_MAX_ENTRIES, aliases.getAliasesCount());
+    aliases.setAlias(NATRON_IDENTITY_ALIASES_MAX_ENTRIES, 0, 0, 0, node, 0, 0);
+    EXPECT_EQ((std::size_t)1, aliases.getAliasesCount());
+}
@@ -9,9 +9,13 @@
  *
  */
 
+#include <algorithm>
+#include <cstdlib>
 #include <cstring>
 #include <gtest/gtest.h>
 #include "Engine/Image.h"
+#include "Engine/ImageParams.h"
+#include "Engine/Lut.h"
 
 
 TEST(BitmapTest,SimpleRect) {
@@ -114,3 +118,358 @@ TEST(ImageKeyTest,Difference) {
 
 }
 
+
+TEST(ImageTest,HalfFloatConversions) {
+    RectI rod(0,0,64,32);
+    Natron::Image floatImg(Natron::ImageComponentRGBA,rod,0,Natron::IMAGE_FLOAT);
+    for (int y = rod.y1; y < rod.y2; ++y) {
+        float* pix = (float*)floatImg.pixelAt(rod.x1, y);
+        for (int x = rod.x1; x < rod.x2; ++x, pix += 4) {
+            pix[0] = x / 64.f;
+            pix[1] = y / 32.f;
+            pix[2] = (x + y) * 0.37f;
+            pix[3] = 1.f;
+        }
+    }
+
+    ///no color-space conversion: values are kept with the precision of a half
+    Natron::Image halfImg(Natron::ImageComponentRGBA,rod,0,Natron::IMAGE_HALF);
+    floatImg.convertToFormat(rod, &halfImg, Natron::Linear, Natron::Linear, 3, false, false);
+    Natron::Image backImg(Natron::ImageComponentRGBA,rod,0,Natron::IMAGE_FLOAT);
+    halfImg.convertToFormat(rod, &backImg, Natron::Linear, Natron::Linear, 3, false, false);
+    for (int y = rod.y1; y < rod.y2; ++y) {
+        const float* src = (const float*)floatImg.pixelAt(rod.x1, y);
+        const float* back = (const float*)backImg.pixelAt(rod.x1, y);
+        for (int i = 0; i < rod.width() * 4; ++i) {
+            EXPECT_NEAR(src[i], back[i], src[i] / 1024.f);
+        }
+    }
+
+    ///through the luts, a half image gives the same 8 bits image as the float one
+    Natron::Image fromFloat(Natron::ImageComponentRGBA,rod,0,Natron::IMAGE_BYTE);
+    Natron::Image fromHalf(Natron::ImageComponentRGBA,rod,0,Natron::IMAGE_BYTE);
+    backImg.convertToFormat(rod, &fromFloat, Natron::Linear, Natron::sRGB, 3, false, false);
+    halfImg.convertToFormat(rod, &fromHalf, Natron::Linear, Natron::sRGB, 3, false, false);
+    ///the error diffusion starts at a random column of each row: allow 1 of difference
+    const unsigned char* a = fromFloat.pixelAt(rod.x1, rod.y1);
+    const unsigned char* b = fromHalf.pixelAt(rod.x1, rod.y1);
+    for (int i = 0; i < rod.area() * 4; ++i) {
+        EXPECT_LE(std::abs(a[i] - b[i]), 1);
+    }
+
+    ///mipmaps of half images
+    Natron::Image halvedImg(Natron::ImageComponentRGBA,rod.downscalePowerOfTwo(1),0,Natron::IMAGE_HALF);
+    halfImg.downscale_mipmap(rod, &halvedImg, 1);
+    const Natron::Half* halved = (const Natron::Half*)halvedImg.pixelAt(0, 0);
+    EXPECT_NEAR((0 + 1) / 128.f, (float)halved[0], 1e-4);
+    EXPECT_NEAR((0 + 1) / 64.f, (float)halved[1], 1e-4);
+    EXPECT_EQ(1.f, (float)halved[3]);
+}
+
+namespace {
+
+const Natron::Color::Lut*
+referenceLut(Natron::ViewerColorSpace cs)
+{
+    const Natron::Color::Lut* lut = 0;
+    if (cs == Natron::sRGB) {
+        lut = Natron::Color::LutManager::sRGBLut();
+    } else if (cs == Natron::Rec709) {
+        lut = Natron::Color::LutManager::Rec709Lut();
+    }
+    if (lut) {
+        lut->validate();
+    }
+    return lut;
+}
+
+///The single-threaded conversion that Image::convertToFormat replaced, used as the reference of its output.
+///The only difference is that the conversions to float through a color-space of images with different components
+///set the output, which the previous implementation left uninitialized.
+template <typename SRCPIX,typename DSTPIX,int dstMaxValue>
+void
+referenceConvert(const Natron::Image& srcImg,Natron::Image& dstImg,Natron::ViewerColorSpace srcColorSpace,
+                 Natron::ViewerColorSpace dstColorSpace,int channelForAlpha,bool invert)
+{
+    const RectI& r = srcImg.getPixelRoD();
+    Natron::ImageBitDepth srcDepth = srcImg.getBitDepth();
+    Natron::ImageBitDepth dstDepth = dstImg.getBitDepth();
+    Natron::ImageComponents srcComp = srcImg.getComponents();
+    Natron::ImageComponents dstComp = dstImg.getComponents();
+    int srcNComp = Natron::getElementsCountForComponents(srcComp);
+    int dstNComp = Natron::getElementsCountForComponents(dstComp);
+    bool sameComps = srcComp == dstComp;
+    const Natron::Color::Lut* srcLut = referenceLut(srcColorSpace);
+    const Natron::Color::Lut* dstLut = referenceLut(dstColorSpace);
+    if (sameComps && srcLut == dstLut) {
+        srcLut = dstLut = 0;
+    }
+
+    if (!sameComps && dstComp == Natron::ImageComponentAlpha && channelForAlpha == -1) {
+        for (int y = r.y1; y < r.y2; ++y) {
+            DSTPIX* dstPixels = (DSTPIX*)dstImg.pixelAt(r.x1, y);
+            std::fill(dstPixels, dstPixels + r.width(), 0.);
+        }
+        return;
+    }
+
+    for (int y = 0; y < r.height(); ++y) {
+        int start = rand() % r.width();
+        const SRCPIX* srcStart = (const SRCPIX*)srcImg.pixelAt(r.x1 + start, r.y1 + y);
+        DSTPIX* dstStart = (DSTPIX*)dstImg.pixelAt(r.x1 + start, r.y1 + y);
+        const SRCPIX* srcPixels = srcStart;
+        DSTPIX* dstPixels = dstStart;
+        for (int backward = 0; backward < 2; ++backward) {
+            int x = backward ? start - 1 : start;
+            int end = backward ? -1 : r.width();
+            unsigned error[3] = { 0x80,0x80,0x80 };
+            while (x != end && x >= 0 && x < r.width()) {
+                if (!sameComps && dstComp == Natron::ImageComponentAlpha) {
+                    *dstPixels = Natron::convertPixelDepth<SRCPIX, DSTPIX>(srcPixels[channelForAlpha]);
+                    if (invert) {
+                        *dstPixels = dstMaxValue - *dstPixels;
+                    }
+                } else if (!sameComps && srcComp == Natron::ImageComponentAlpha) {
+                    if (dstComp == Natron::ImageComponentRGB) {
+                        for (int k = 0; k < dstNComp; ++k) {
+                            DSTPIX pix = Natron::convertPixelDepth<SRCPIX, DSTPIX>(*srcPixels);
+                            dstPixels[k] = invert ? DSTPIX(dstMaxValue - pix) : pix;
+                        }
+                    } else {
+                        for (int k = 0; k < dstNComp - 1; ++k) {
+                            dstPixels[k] = invert ? dstMaxValue : 0;
+                        }
+                        DSTPIX pix = Natron::convertPixelDepth<SRCPIX, DSTPIX>(*srcPixels);
+                        dstPixels[3] = invert ? DSTPIX(dstMaxValue) : pix;
+                    }
+                } else {
+                    for (int k = 0; k < dstNComp; ++k) {
+                        if (k < srcNComp) {
+                            DSTPIX pix;
+                            if (k <= 2 && (srcLut || dstLut)) {
+                                float pixFloat;
+                                if (srcLut) {
+                                    if (srcDepth == Natron::IMAGE_BYTE) {
+                                        pixFloat = srcLut->fromColorSpaceUint8ToLinearFloatFast(srcPixels[k]);
+                                    } else if (srcDepth == Natron::IMAGE_SHORT) {
+                                        pixFloat = srcLut->fromColorSpaceUint16ToLinearFloatFast(srcPixels[k]);
+                                    } else if (srcDepth == Natron::IMAGE_HALF) {
+                                        pixFloat = srcLut->fromColorSpaceHalfToLinearFloatFast(srcPixels[k]);
+                                    } else {
+                                        pixFloat = srcLut->fromColorSpaceFloatToLinearFloat(srcPixels[k]);
+                                    }
+                                } else {
+                                    pixFloat = Natron::convertPixelDepth<SRCPIX, float>(srcPixels[k]);
+                                }
+                                if (dstDepth == Natron::IMAGE_BYTE) {
+                                    error[k] = (error[k]&0xff) + (dstLut ? dstLut->toColorSpaceUint8xxFromLinearFloatFast(pixFloat) :
+                                                                  Natron::Color::floatToInt<0xff01>(pixFloat));
+                                    pix = error[k] >> 8;
+                                } else if (dstDepth == Natron::IMAGE_SHORT) {
+                                    pix = dstLut ? DSTPIX(dstLut->toColorSpaceUint16FromLinearFloatFast(pixFloat)) :
+                                    Natron::convertPixelDepth<float, DSTPIX>(pixFloat);
+                                } else {
+                                    if (dstLut) {
+                                        pixFloat = dstLut->toColorSpaceFloatFromLinearFloat(pixFloat);
+                                    }
+                                    pix = Natron::convertPixelDepth<float, DSTPIX>(pixFloat);
+                                }
+                            } else {
+                                pix = Natron::convertPixelDepth<SRCPIX, DSTPIX>(srcPixels[k]);
+                            }
+                            dstPixels[k] = invert ? DSTPIX(dstMaxValue - pix) : pix;
+                        } else {
+                            dstPixels[k] = k == 3 ? dstMaxValue :  0.;
+                            if (invert) {
+                                dstPixels[k] = dstMaxValue - dstPixels[k];
+                            }
+                        }
+                    }
+                }
+                if (backward) {
+                    --x;
+                    srcPixels -= srcNComp;
+                    dstPixels -= dstNComp;
+                } else {
+                    ++x;
+                    srcPixels += srcNComp;
+                    dstPixels += dstNComp;
+                }
+            }
+            srcPixels = srcStart - srcNComp;
+            dstPixels = dstStart - dstNComp;
+        }
+    }
+}
+
+template <typename SRCPIX>
+void
+referenceConvertFromSrc(const Natron::Image& srcImg,Natron::Image& dstImg,Natron::ViewerColorSpace srcColorSpace,
+                        Natron::ViewerColorSpace dstColorSpace,int channelForAlpha,bool invert)
+{
+    switch (dstImg.getBitDepth()) {
+        case Natron::IMAGE_BYTE:
+            referenceConvert<SRCPIX,unsigned char,255>(srcImg, dstImg, srcColorSpace, dstColorSpace, channelForAlpha, invert);
+            break;
+        case Natron::IMAGE_SHORT:
+            referenceConvert<SRCPIX,unsigned short,65535>(srcImg, dstImg, srcColorSpace, dstColorSpace, channelForAlpha, invert);
+            break;
+        case Natron::IMAGE_FLOAT:
+            referenceConvert<SRCPIX,float,1>(srcImg, dstImg, srcColorSpace, dstColorSpace, channelForAlpha, invert);
+            break;
+        case Natron::IMAGE_HALF:
+            referenceConvert<SRCPIX,Natron::Half,1>(srcImg, dstImg, srcColorSpace, dstColorSpace, channelForAlpha, invert);
+            break;
+        default:
+            break;
+    }
+}
+
+void
+referenceConvertToFormat(const Natron::Image& srcImg,Natron::Image& dstImg,Natron::ViewerColorSpace srcColorSpace,
+                         Natron::ViewerColorSpace dstColorSpace,int channelForAlpha,bool invert)
+{
+    switch (srcImg.getBitDepth()) {
+        case Natron::IMAGE_BYTE:
+            referenceConvertFromSrc<unsigned char>(srcImg, dstImg, srcColorSpace, dstColorSpace, channelForAlpha, invert);
+            break;
+        case Natron::IMAGE_SHORT:
+            referenceConvertFromSrc<unsigned short>(srcImg, dstImg, srcColorSpace, dstColorSpace, channelForAlpha, invert);
+            break;
+        case Natron::IMAGE_FLOAT:
+            referenceConvertFromSrc<float>(srcImg, dstImg, srcColorSpace, dstColorSpace, channelForAlpha, invert);
+            break;
+        case Natron::IMAGE_HALF:
+            referenceConvertFromSrc<Natron::Half>(srcImg, dstImg, srcColorSpace, dstColorSpace, channelForAlpha, invert);
+            break;
+        default:
+            break;
+    }
+}
+
+void
+fillImage(Natron::Image* img)
+{
+    const RectI& rod = img->getPixelRoD();
+    int nComps = Natron::getElementsCountForComponents(img->getComponents());
+    for (int y = rod.y1; y < rod.y2; ++y) {
+        unsigned char* pix = img->pixelAt(rod.x1, y);
+        for (int i = 0; i < rod.width() * nComps; ++i) {
+            ///values slightly out of [0,1] for the floating point depths
+            float v = (float)(rand() % 1200) / 1000.f - 0.1f;
+            switch (img->getBitDepth()) {
+                case Natron::IMAGE_BYTE:
+                    pix[i] = (unsigned char)(rand() % 256);
+                    break;
+                case Natron::IMAGE_SHORT:
+                    ((unsigned short*)pix)[i] = (unsigned short)(rand() % 65536);
+                    break;
+                case Natron::IMAGE_FLOAT:
+                    ((float*)pix)[i] = v;
+                    break;
+                case Natron::IMAGE_HALF:
+                    ((Natron::Half*)pix)[i] = v;
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+}
+
+///Compares the output of convertToFormat with the reference for all the combinations of depths and components
+void
+compareWithReference(const RectI& rod,Natron::ViewerColorSpace srcColorSpace,Natron::ViewerColorSpace dstColorSpace,bool invert)
+{
+    const Natron::ImageBitDepth depths[4] = { Natron::IMAGE_BYTE, Natron::IMAGE_SHORT, Natron::IMAGE_FLOAT, Natron::IMAGE_HALF };
+    const Natron::ImageComponents comps[3] = { Natron::ImageComponentAlpha, Natron::ImageComponentRGB, Natron::ImageComponentRGBA };
+    for (int sd = 0; sd < 4; ++sd) {
+        for (int sc = 0; sc < 3; ++sc) {
+            Natron::Image src(comps[sc],rod,0,depths[sd]);
+            fillImage(&src);
+            for (int dd = 0; dd < 4; ++dd) {
+                for (int dc = 0; dc < 3; ++dc) {
+                    int channelForAlpha = comps[sc] == Natron::ImageComponentRGB ? 1 : comps[sc] == Natron::ImageComponentRGBA ? 3 : 0;
+                    for (int clear = 0; clear < 2; ++clear) {
+                        if (clear && (comps[dc] != Natron::ImageComponentAlpha || comps[sc] == Natron::ImageComponentAlpha)) {
+                            continue;
+                        }
+                        Natron::Image expected(comps[dc],rod,0,depths[dd]);
+                        Natron::Image result(comps[dc],rod,0,depths[dd]);
+                        srand(1234);
+                        referenceConvertToFormat(src, expected, srcColorSpace, dstColorSpace, clear ? -1 : channelForAlpha, invert);
+                        srand(1234);
+                        src.convertToFormat(rod, &result, srcColorSpace, dstColorSpace, clear ? -1 : channelForAlpha, invert, false);
+                        std::size_t rowSize = rod.width() * Natron::getElementsCountForComponents(comps[dc]) * Natron::getSizeOfForBitDepth(depths[dd]);
+                        for (int y = rod.y1; y < rod.y2; ++y) {
+                            if (memcmp(expected.pixelAt(rod.x1, y), result.pixelAt(rod.x1, y), rowSize) != 0) {
+                                ADD_FAILURE() << Natron::Image::getFormatString(comps[sc], depths[sd]) << " to "
+                                              << Natron::Image::getFormatString(comps[dc], depths[dd])
+                                              << " differs at row " << y << " (colorspaces " << srcColorSpace << ", "
+                                              << dstColorSpace << ", invert " << invert << ", clear " << clear << ")";
+                                break;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+} // anon namespace
+
+TEST(ImageTest,ConvertToFormatMatchesReference) {
+    RectI rod(-3,5,45,27);
+    const Natron::ViewerColorSpace colorSpaces[3] = { Natron::Linear, Natron::sRGB, Natron::Rec709 };
+    for (int s = 0; s < 3; ++s) {
+        for (int d = 0; d < 3; ++d) {
+            compareWithReference(rod, colorSpaces[s], colorSpaces[d], false);
+        }
+    }
+    compareWithReference(rod, Natron::sRGB, Natron::Linear, true);
+    compareWithReference(rod, Natron::Linear, Natron::Linear, true);
+}
+
+TEST(ImageTest,ConvertToFormatInParallel) {
+    ///large enough for the rows to be split across threads
+    RectI rod(0,0,400,340);
+    compareWithReference(rod, Natron::Linear, Natron::sRGB, false);
+    compareWithReference(rod, Natron::Linear, Natron::Linear, false);
+}
+
+TEST(ImageTest,CopyBetweenDifferentBounds) {
+    RectI srcRod(-3,5,45,27);
+    RectI dstRod(10,0,60,20);
+    Natron::Image src(Natron::ImageComponentRGBA,srcRod,0,Natron::IMAGE_FLOAT);
+    fillImage(&src);
+    Natron::Image dst(Natron::ImageComponentRGBA,dstRod,0,Natron::IMAGE_FLOAT);
+    dst.copy(src, dstRod, false);
+
+    ///only the intersection is copied, each pixel to the same coordinates
+    RectI intersection;
+    ASSERT_TRUE(srcRod.intersect(dstRod, &intersection));
+    for (int y = intersection.y1; y < intersection.y2; ++y) {
+        ASSERT_EQ(0, memcmp(src.pixelAt(intersection.x1, y), dst.pixelAt(intersection.x1, y),
+                            intersection.width() * 4 * sizeof(float)));
+    }
+}
+
+TEST(ImageTest,ConvertToFormatIntoSmallerBounds) {
+    RectI rod(0,0,64,48);
+    Natron::Image src(Natron::ImageComponentRGBA,rod,0,Natron::IMAGE_HALF);
+    fillImage(&src);
+    RectI bounds(10,5,30,40);
+    Natron::Image dst(Natron::ImageComponentRGBA,rod,bounds,0,Natron::IMAGE_FLOAT);
+    ASSERT_EQ(rod, dst.getRoD());
+    ASSERT_EQ(bounds, dst.getPixelRoD());
+    src.convertToFormat(rod, &dst, Natron::Linear, Natron::Linear, 3, false, false);
+
+    ///only the bounds of the destination are converted, each pixel to the same coordinates
+    Natron::Image reference(Natron::ImageComponentRGBA,rod,0,Natron::IMAGE_FLOAT);
+    src.convertToFormat(rod, &reference, Natron::Linear, Natron::Linear, 3, false, false);
+    for (int y = bounds.y1; y < bounds.y2; ++y) {
+        ASSERT_EQ(0, memcmp(reference.pixelAt(bounds.x1, y), dst.pixelAt(bounds.x1, y),
+                            bounds.width() * 4 * sizeof(float)));
+    }
+}
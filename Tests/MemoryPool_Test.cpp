@@ -0,0 +1,92 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <cstring>
+#include <gtest/gtest.h>
+#include "Engine/MemoryPool.h"
+
+using namespace Natron;
+
+TEST(MemoryPool,SizeClasses) {
+    ///small sizes are not rounded
+    EXPECT_EQ((std::size_t)100, MemoryPool::getSizeClass(100));
+
+    std::size_t previous = 0;
+    for (std::size_t size = NATRON_MEMORY_POOL_MIN_BLOCK_SIZE; size < 64 * 1024 * 1024; size = size * 5 / 4 + 4093) {
+        std::size_t sizeClass = MemoryPool::getSizeClass(size);
+        EXPECT_GE(sizeClass, size);
+        EXPECT_LE(sizeClass - size, size / 8) << "size " << size;
+        EXPECT_EQ(sizeClass, MemoryPool::getSizeClass(sizeClass)) << "a size class must be its own class";
+        EXPECT_GE(sizeClass, previous);
+        previous = sizeClass;
+    }
+
+    ///there are exactly 8 classes between 2 consecutive powers of 2 (12.5% apart)
+    for (std::size_t power = NATRON_MEMORY_POOL_MIN_BLOCK_SIZE; power < 64 * 1024 * 1024; power *= 2) {
+        int classesCount = 0;
+        for (std::size_t sizeClass = MemoryPool::getSizeClass(power); sizeClass < 2 * power;
+             sizeClass = MemoryPool::getSizeClass(sizeClass + 1)) {
+            ++classesCount;
+        }
+        EXPECT_EQ(8, classesCount) << "power " << power;
+    }
+}
+
+TEST(MemoryPool,RecyclesBlocks) {
+    MemoryPool pool;
+    const std::size_t size = 1024 * 1024;
+
+    void* a = pool.allocate(size);
+    std::memset(a, 1, size);
+    pool.deallocate(a, size);
+    MemoryPoolStats stats = pool.getStats();
+    EXPECT_EQ(1u, stats.heldBlocks);
+    EXPECT_EQ(MemoryPool::getSizeClass(size), stats.heldBytes);
+
+    ///a slightly different size in the same class reuses the block, zeroed on demand
+    void* b = pool.allocate(size - 10, true);
+    EXPECT_EQ(a, b);
+    const char* bytes = (const char*)b;
+    for (std::size_t i = 0; i < size - 10; ++i) {
+        if (bytes[i] != 0) {
+            ADD_FAILURE() << "recycled block not zeroed at " << i;
+            break;
+        }
+    }
+    stats = pool.getStats();
+    EXPECT_EQ(2u, stats.allocations);
+    EXPECT_EQ(1u, stats.reuses);
+    EXPECT_EQ(0u, stats.heldBlocks);
+
+    ///growing the block keeps its content
+    std::memset(b, 7, size - 10);
+    void* c = pool.reallocate(b, size - 10, 4 * size);
+    EXPECT_EQ(7, ((const char*)c)[size - 11]);
+    pool.deallocate(c, 4 * size);
+}
+
+TEST(MemoryPool,RespectsMaximumSize) {
+    MemoryPool pool;
+    const std::size_t size = 1024 * 1024;
+    pool.setMaximumSize(2 * size);
+
+    void* blocks[4];
+    for (int i = 0; i < 4; ++i) {
+        blocks[i] = pool.allocate(size);
+    }
+    for (int i = 0; i < 4; ++i) {
+        pool.deallocate(blocks[i], size);
+    }
+    MemoryPoolStats stats = pool.getStats();
+    EXPECT_EQ(2u, stats.heldBlocks);
+    EXPECT_LE(stats.heldBytes, 2 * size);
+
+    pool.setMaximumSize(size);
+    EXPECT_EQ(1u, pool.getStats().heldBlocks);
+
+    pool.clear();
+    EXPECT_EQ(0u, pool.getStats().heldBytes);
+}
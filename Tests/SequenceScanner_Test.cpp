@@ -0,0 +1,55 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <gtest/gtest.h>
+#include <SequenceParsing.h>
+#include "Engine/SequenceScanner.h"
+
+using namespace Natron;
+
+TEST(SequenceIndex,PatternKey) {
+    ///frame numbers and padding do not change the key
+    EXPECT_EQ(SequenceIndex::getPatternKey("/images/shot_0001.exr"), SequenceIndex::getPatternKey("/images/shot_0002.exr"));
+    EXPECT_EQ(SequenceIndex::getPatternKey("/images/12345.jpg"), SequenceIndex::getPatternKey("/images/122938.jpg"));
+    EXPECT_EQ(SequenceIndex::getPatternKey("/images/shot_left.1.exr"), SequenceIndex::getPatternKey("/images/shot_right.1.exr"));
+
+    ///the path is not altered
+    EXPECT_EQ(std::string("/images2/shot_#.exr"), SequenceIndex::getPatternKey("/images2/shot_01.exr"));
+    EXPECT_NE(SequenceIndex::getPatternKey("/images1/shot_1.exr"), SequenceIndex::getPatternKey("/images2/shot_1.exr"));
+    EXPECT_NE(SequenceIndex::getPatternKey("/images/shot_1.exr"), SequenceIndex::getPatternKey("/images/shot_1.png"));
+    EXPECT_NE(SequenceIndex::getPatternKey("/images/shot_1.exr"), SequenceIndex::getPatternKey("/images/plate_1.exr"));
+}
+
+TEST(SequenceIndex,GroupsFiles) {
+    SequenceIndex index(false);
+
+    EXPECT_TRUE(index.addFile("/images/shot_0001.exr"));
+    EXPECT_FALSE(index.addFile("/images/shot_0002.exr"));
+    EXPECT_FALSE(index.addFile("/images/shot_0003.exr"));
+    EXPECT_TRUE(index.addFile("/images/plate_0001.exr"));
+    EXPECT_TRUE(index.addFile("/images/shot_0001.png"));
+    ///inserting a file again does not change its sequence
+    EXPECT_TRUE(index.addFile("/images/shot_0001.exr"));
+    EXPECT_FALSE(index.addFile("/images/shot_0002.exr"));
+
+    EXPECT_EQ((std::size_t)5, index.getFilesCount());
+    EXPECT_EQ((std::size_t)3, index.getSequencesCount());
+
+    bool isRepresentative;
+    boost::shared_ptr<SequenceParsing::SequenceFromFiles> sequence = index.getSequenceForFile("/images/shot_0003.exr", &isRepresentative);
+    ASSERT_TRUE(sequence);
+    EXPECT_FALSE(isRepresentative);
+    EXPECT_EQ(1, sequence->getFirstFrame());
+    EXPECT_EQ(3, sequence->getLastFrame());
+    EXPECT_EQ(sequence, index.getSequenceForFile("/images/shot_0001.exr", &isRepresentative));
+    EXPECT_TRUE(isRepresentative);
+
+    EXPECT_FALSE(index.getSequenceForFile("/images/shot_0004.exr"));
+
+    index.clear();
+    EXPECT_EQ((std::size_t)0, index.getFilesCount());
+    EXPECT_EQ((std::size_t)0, index.getSequencesCount());
+}
@@ -99,7 +99,16 @@ SOURCES += \
     Image_Test.cpp \
     Lut_Test.cpp \
     File_Knob_Test.cpp \
-    Curve_Test.cpp
+    Curve_Test.cpp \
+    FrameRangeSet_Test.cpp \
+    MemoryPool_Test.cpp \
+    CompressedBuffer_Test.cpp \
+    ActionsCache_Test.cpp \
+    HalfFloat_Test.cpp \
+    SequenceScanner_Test.cpp \
+    IdentityAliases_Test.cpp \
+    WriteQueue_Test.cpp \
+    FramePrefetcher_Test.cpp
 
 HEADERS += \
     BaseTest.h
@@ -0,0 +1,142 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <QtCore/QMutex>
+#include <QtCore/QThread>
+
+#include <boost/bind.hpp>
+
+#include "Engine/WriteQueue.h"
+
+using namespace Natron;
+
+namespace {
+
+///QThread::msleep is protected in Qt 4
+class Sleeper
+    : public QThread
+{
+public:
+
+    static void sleepMs(unsigned long ms)
+    {
+        QThread::msleep(ms);
+    }
+};
+
+struct PendingFrames
+{
+    QMutex lock;
+    int pending;
+    int maxPending;
+};
+
+bool
+writeSlot(std::vector<int>* slots,int index)
+{
+    (*slots)[index] = index;
+    return index % 5 != 0;
+}
+
+bool
+writeToFullDisk()
+{
+    throw std::runtime_error("No space left on device");
+}
+
+bool
+writeSlowly(PendingFrames* frames)
+{
+    Sleeper::sleepMs(10);
+    QMutexLocker l(&frames->lock);
+    --frames->pending;
+    return true;
+}
+} // anon namespace
+
+TEST(WriteQueue,AllFramesAreWritten) {
+    std::vector<int> slots(20, -1);
+    {
+        WriteQueue queue;
+        for (int i = 0; i < 20; ++i) {
+            queue.append(boost::bind(&writeSlot, &slots, i));
+        }
+        queue.waitForPendingWrites();
+        WriteQueueStats stats = queue.getStats();
+        EXPECT_EQ((U64)16, stats.framesWritten);
+        EXPECT_EQ((U64)4, stats.failedWrites);
+        queue.resetStats();
+        EXPECT_EQ((U64)0, queue.getStats().framesWritten);
+    }
+    for (int i = 0; i < 20; ++i) {
+        EXPECT_EQ(i, slots[i]);
+    }
+}
+
+TEST(WriteQueue,FailuresAreReported) {
+    WriteQueue queue;
+    queue.append(&writeToFullDisk);
+    queue.waitForPendingWrites();
+    WriteQueueStats stats = queue.getStats();
+    EXPECT_EQ((U64)1, stats.failedWrites);
+    EXPECT_EQ(std::string("No space left on device"), stats.lastError);
+    queue.resetStats();
+    EXPECT_TRUE(queue.getStats().lastError.empty());
+}
+
+TEST(WriteQueue,PendingFramesAreBounded) {
+    PendingFrames frames;
+    frames.pending = 0;
+    frames.maxPending = 0;
+    WriteQueue queue(2, 1);
+    for (int i = 0; i < 10; ++i) {
+        {
+            QMutexLocker l(&frames.lock);
+            ++frames.pending;
+            frames.maxPending = std::max(frames.maxPending, frames.pending);
+        }
+        queue.append(boost::bind(&writeSlowly, &frames));
+    }
+    queue.waitForPendingWrites();
+    EXPECT_EQ(0, frames.pending);
+    ///the frame being appended is counted too
+    EXPECT_LE(frames.maxPending, 3);
+
+    ///the render thread only hands off frames, writing is the bottleneck
+    WriteQueueStats stats = queue.getStats();
+    EXPECT_EQ((U64)10, stats.framesWritten);
+    EXPECT_GT(stats.renderWaitMs, (U64)0);
+    EXPECT_TRUE(queue.isWriteBound());
+    EXPECT_GT(queue.getBackPressure(), 0.5);
+}
+
+TEST(WriteQueue,TemporaryFilesAreCommitted) {
+    EXPECT_EQ(std::string("/a/b/.c.png.tmp"), WriteQueue::getTemporaryFileName("/a/b/c.png"));
+    EXPECT_EQ(std::string(".c.png.tmp"), WriteQueue::getTemporaryFileName("c.png"));
+
+    std::string filename("WriteQueue_Test.txt");
+    std::string tmp = WriteQueue::getTemporaryFileName(filename);
+    FILE* f = std::fopen(tmp.c_str(), "w");
+    ASSERT_TRUE(f != NULL);
+    std::fputs("frame", f);
+    std::fclose(f);
+    ASSERT_TRUE(WriteQueue::commitTemporaryFile(tmp, filename));
+    EXPECT_TRUE(std::fopen(tmp.c_str(), "r") == NULL);
+    f = std::fopen(filename.c_str(), "r");
+    ASSERT_TRUE(f != NULL);
+    std::fclose(f);
+    std::remove(filename.c_str());
+
+    EXPECT_FALSE(WriteQueue::commitTemporaryFile(tmp, filename));
+}